@@ -0,0 +1,146 @@
+#include "OTABundle.h"
+
+namespace
+{
+    uint32_t readLE32(const uint8_t *p)
+    {
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+}
+
+OTABundleReader::OTABundleReader(SectionEvent start, Output output, SectionEvent end)
+    : start(start), output(output), end(end), state(STATE_HEADER), pendingLength(0),
+      pendingNeeded(HEADER_SIZE), count(0), current(0), remaining(0), errorMessage("")
+{
+}
+
+bool OTABundleReader::fail(const char *message)
+{
+    state = STATE_FAILED;
+    errorMessage = message;
+    return false;
+}
+
+bool OTABundleReader::parseEntries()
+{
+    bool seen[MAX_SECTIONS] = {false, false};
+    for (uint8_t i = 0; i < count; i++)
+    {
+        const uint8_t *entry = pending + i * ENTRY_SIZE;
+        Section &section = sections[i];
+        section.type = entry[0];
+        section.encoding = entry[1];
+        section.length = readLE32(entry + 4);
+        memcpy(section.sha256, entry + 8, sizeof(section.sha256));
+        section.hasDigest = false;
+        for (size_t k = 0; k < sizeof(section.sha256); k++)
+        {
+            section.hasDigest |= section.sha256[k] != 0;
+        }
+
+        if (section.type >= MAX_SECTIONS || seen[section.type])
+        {
+            return fail("unknown or repeated section type");
+        }
+        if (section.encoding > ENCODING_GZIP)
+        {
+            return fail("unknown section encoding");
+        }
+        if (section.length == 0)
+        {
+            return fail("empty section");
+        }
+        seen[section.type] = true;
+    }
+    current = 0;
+    return nextSection();
+}
+
+bool OTABundleReader::nextSection()
+{
+    if (current == count)
+    {
+        state = STATE_DONE;
+        return true;
+    }
+    state = STATE_DATA;
+    remaining = sections[current].length;
+    if (!start(sections[current]))
+    {
+        return fail("section rejected");
+    }
+    return true;
+}
+
+bool OTABundleReader::write(const uint8_t *data, size_t len)
+{
+    while (len > 0)
+    {
+        switch (state)
+        {
+        case STATE_HEADER:
+        case STATE_ENTRIES:
+        {
+            size_t take = min(len, pendingNeeded - pendingLength);
+            memcpy(pending + pendingLength, data, take);
+            pendingLength += take;
+            data += take;
+            len -= take;
+            if (pendingLength < pendingNeeded)
+            {
+                return true;
+            }
+            pendingLength = 0;
+
+            if (state == STATE_HEADER)
+            {
+                if (memcmp(pending, "OTAB", 4) != 0 || pending[4] != 1)
+                {
+                    return fail("not an OTAB v1 bundle");
+                }
+                count = pending[5];
+                if (count == 0 || count > MAX_SECTIONS)
+                {
+                    return fail("bad section count");
+                }
+                state = STATE_ENTRIES;
+                pendingNeeded = count * ENTRY_SIZE;
+            }
+            else if (!parseEntries())
+            {
+                return false;
+            }
+            break;
+        }
+        case STATE_DATA:
+        {
+            size_t take = min(len, (size_t)remaining);
+            if (!output(data, take))
+            {
+                return fail("section write failed");
+            }
+            data += take;
+            len -= take;
+            remaining -= take;
+            if (remaining == 0)
+            {
+                if (!end(sections[current]))
+                {
+                    return fail("section failed verification");
+                }
+                current++;
+                if (!nextSection())
+                {
+                    return false;
+                }
+            }
+            break;
+        }
+        case STATE_DONE:
+            return fail("data after the last section");
+        case STATE_FAILED:
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,82 @@
+#ifndef OTA_BUNDLE_H
+#define OTA_BUNDLE_H
+
+#include <Arduino.h>
+
+// Streaming reader for OTAB bundles: several partition images in one file
+// (see tools/otabundle.py).
+//
+// Layout, all integers little-endian:
+//   header  : "OTAB" | u8 version | u8 sectionCount | 2 reserved
+//   entries : sectionCount x { u8 type | u8 encoding | 2 reserved | u32 length | 32 byte SHA-256 }
+//   data    : the sections' bytes, back to back in entry order
+//
+// type is SECTION_APP or SECTION_SPIFFS, each at most once; encoding is 0 for
+// a raw image or 1 for gzip. length counts the bytes stored in the bundle.
+// The SHA-256 is over the decoded image, all zeros if the packer left it out.
+//
+// Bundle bytes are fed in arbitrary pieces; each section is announced with
+// `start`, its bytes are passed through to `output` and `end` is called once
+// its last byte has been delivered.
+class OTABundleReader
+{
+public:
+    static const uint8_t SECTION_APP = 0;
+    static const uint8_t SECTION_SPIFFS = 1;
+    static const uint8_t ENCODING_RAW = 0;
+    static const uint8_t ENCODING_GZIP = 1;
+    static const uint8_t MAX_SECTIONS = 2;
+
+    struct Section
+    {
+        uint8_t type;
+        uint8_t encoding;
+        uint32_t length;
+        uint8_t sha256[32];
+        bool hasDigest;
+    };
+
+    typedef std::function<bool(const Section &section)> SectionEvent;
+    typedef std::function<bool(const uint8_t *data, size_t len)> Output;
+
+    OTABundleReader(SectionEvent start, Output output, SectionEvent end);
+
+    bool write(const uint8_t *data, size_t len);
+    bool finished() const { return state == STATE_DONE; }
+    bool failed() const { return state == STATE_FAILED; }
+    const char *error() const { return errorMessage; }
+    uint8_t sectionCount() const { return count; }
+
+private:
+    enum State
+    {
+        STATE_HEADER,
+        STATE_ENTRIES,
+        STATE_DATA,
+        STATE_DONE,
+        STATE_FAILED
+    };
+
+    static const size_t HEADER_SIZE = 8;
+    static const size_t ENTRY_SIZE = 40;
+
+    bool fail(const char *message);
+    bool parseEntries();
+    bool nextSection();
+
+    SectionEvent start;
+    Output output;
+    SectionEvent end;
+
+    State state;
+    uint8_t pending[ENTRY_SIZE * MAX_SECTIONS];
+    size_t pendingLength;
+    size_t pendingNeeded;
+    Section sections[MAX_SECTIONS];
+    uint8_t count;
+    uint8_t current;
+    uint32_t remaining;
+    const char *errorMessage;
+};
+
+#endif
@@ -0,0 +1,236 @@
+#include "OTADelta.h"
+
+namespace
+{
+    uint32_t readLE32(const uint8_t *p)
+    {
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+}
+
+OTADeltaPatcher::OTADeltaPatcher(const esp_partition_t *source, const String &sourceMd5, Output output)
+    : source(source), sourceMd5(sourceMd5), output(output),
+      state(STATE_HEADER), op(OP_END), pendingLength(0), pendingNeeded(HEADER_SIZE),
+      opOffset(0), opRemaining(0), target(0), sourceSize(0), outputBytes(0), errorMessage("")
+{
+}
+
+bool OTADeltaPatcher::fail(const char *message)
+{
+    state = STATE_FAILED;
+    errorMessage = message;
+    return false;
+}
+
+bool OTADeltaPatcher::emit(const uint8_t *data, size_t len)
+{
+    if (outputBytes + len > target)
+    {
+        return fail("patch produces more than the target size");
+    }
+    if (!output(data, len))
+    {
+        return fail("output write failed");
+    }
+    outputBytes += len;
+    return true;
+}
+
+bool OTADeltaPatcher::parseHeader()
+{
+    if (memcmp(pending, "OTAD", 4) != 0 || pending[4] != 1)
+    {
+        return fail("not an OTAD v1 patch");
+    }
+
+    target = readLE32(pending + 8);
+    sourceSize = readLE32(pending + 12);
+    if (source == nullptr || sourceSize > source->size)
+    {
+        return fail("patch source larger than running partition");
+    }
+
+    // The patch must have been built against exactly the image we are running
+    char hex[33];
+    for (int i = 0; i < 16; i++)
+    {
+        snprintf(hex + i * 2, 3, "%02x", pending[16 + i]);
+    }
+    if (!sourceMd5.equalsIgnoreCase(String(hex)))
+    {
+        return fail("patch was built for a different running image");
+    }
+    return true;
+}
+
+bool OTADeltaPatcher::startOp()
+{
+    switch (op)
+    {
+    case OP_END:
+        if (outputBytes != target)
+        {
+            return fail("patch ended before the target size");
+        }
+        state = STATE_DONE;
+        return true;
+    case OP_COPY:
+    case OP_ADD:
+        pendingNeeded = 8;
+        break;
+    case OP_INSERT:
+        pendingNeeded = 4;
+        break;
+    default:
+        return fail("unknown patch op");
+    }
+    state = STATE_ARGS;
+    return true;
+}
+
+bool OTADeltaPatcher::copyFromSource(uint32_t offset, uint32_t length)
+{
+    while (length > 0)
+    {
+        size_t chunk = min((size_t)length, (size_t)SCRATCH_SIZE);
+        if (esp_partition_read(source, offset, scratch, chunk) != ESP_OK)
+        {
+            return fail("reading running partition failed");
+        }
+        if (!emit(scratch, chunk))
+        {
+            return false;
+        }
+        offset += chunk;
+        length -= chunk;
+    }
+    return true;
+}
+
+bool OTADeltaPatcher::write(const uint8_t *data, size_t len)
+{
+    while (len > 0)
+    {
+        switch (state)
+        {
+        case STATE_HEADER:
+        case STATE_OP:
+        case STATE_ARGS:
+        {
+            size_t take = min(len, pendingNeeded - pendingLength);
+            memcpy(pending + pendingLength, data, take);
+            pendingLength += take;
+            data += take;
+            len -= take;
+            if (pendingLength < pendingNeeded)
+            {
+                return true;
+            }
+            pendingLength = 0;
+
+            if (state == STATE_HEADER)
+            {
+                if (!parseHeader())
+                {
+                    return false;
+                }
+                state = STATE_OP;
+                pendingNeeded = 1;
+            }
+            else if (state == STATE_OP)
+            {
+                op = pending[0];
+                if (!startOp())
+                {
+                    return false;
+                }
+            }
+            else
+            {
+                uint32_t first = readLE32(pending);
+                if (op == OP_INSERT)
+                {
+                    opRemaining = first;
+                    state = STATE_INSERT;
+                }
+                else
+                {
+                    uint32_t length = readLE32(pending + 4);
+                    if ((uint64_t)first + length > sourceSize)
+                    {
+                        return fail("patch reads past the source image");
+                    }
+                    if (op == OP_COPY)
+                    {
+                        if (!copyFromSource(first, length))
+                        {
+                            return false;
+                        }
+                        opRemaining = 0;
+                    }
+                    else
+                    {
+                        opOffset = first;
+                        opRemaining = length;
+                        state = STATE_ADD;
+                    }
+                }
+                if (opRemaining == 0)
+                {
+                    state = STATE_OP;
+                    pendingNeeded = 1;
+                }
+            }
+            break;
+        }
+        case STATE_INSERT:
+        {
+            size_t take = min(len, (size_t)opRemaining);
+            if (!emit(data, take))
+            {
+                return false;
+            }
+            data += take;
+            len -= take;
+            opRemaining -= take;
+            if (opRemaining == 0)
+            {
+                state = STATE_OP;
+                pendingNeeded = 1;
+            }
+            break;
+        }
+        case STATE_ADD:
+        {
+            size_t take = min(min(len, (size_t)opRemaining), (size_t)SCRATCH_SIZE);
+            if (esp_partition_read(source, opOffset, scratch, take) != ESP_OK)
+            {
+                return fail("reading running partition failed");
+            }
+            for (size_t i = 0; i < take; i++)
+            {
+                scratch[i] += data[i];
+            }
+            if (!emit(scratch, take))
+            {
+                return false;
+            }
+            data += take;
+            len -= take;
+            opOffset += take;
+            opRemaining -= take;
+            if (opRemaining == 0)
+            {
+                state = STATE_OP;
+                pendingNeeded = 1;
+            }
+            break;
+        }
+        case STATE_DONE:
+            return fail("data after end of patch");
+        case STATE_FAILED:
+            return false;
+        }
+    }
+    return true;
+}
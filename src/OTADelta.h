@@ -0,0 +1,75 @@
+#ifndef OTA_DELTA_H
+#define OTA_DELTA_H
+
+#include <Arduino.h>
+#include <esp_partition.h>
+
+// Streaming applier for OTAD binary patches (see tools/otadelta.py).
+//
+// Patch layout, all integers little-endian:
+//   header : "OTAD" | u8 version | 3 reserved | u32 targetSize | u32 sourceSize | 16 byte source MD5
+//   ops    : 0x01 COPY   u32 srcOffset u32 length               -> old[srcOffset..+length]
+//            0x02 INSERT u32 length   <length literal bytes>    -> literal bytes
+//            0x03 ADD    u32 srcOffset u32 length <length diff> -> old[srcOffset+i] + diff[i]
+//            0x00 END
+//
+// Patch bytes are fed in arbitrary pieces; the rebuilt image is pushed to
+// `output` as it is produced. Memory use is fixed at one scratch sector.
+class OTADeltaPatcher
+{
+public:
+    typedef std::function<bool(const uint8_t *data, size_t len)> Output;
+
+    OTADeltaPatcher(const esp_partition_t *source, const String &sourceMd5, Output output);
+
+    bool write(const uint8_t *data, size_t len);
+    bool finished() const { return state == STATE_DONE; }
+    bool failed() const { return state == STATE_FAILED; }
+    const char *error() const { return errorMessage; }
+    size_t targetSize() const { return target; }
+    size_t produced() const { return outputBytes; }
+
+private:
+    enum State
+    {
+        STATE_HEADER,
+        STATE_OP,
+        STATE_ARGS,
+        STATE_INSERT,
+        STATE_ADD,
+        STATE_DONE,
+        STATE_FAILED
+    };
+
+    static const uint8_t OP_END = 0x00;
+    static const uint8_t OP_COPY = 0x01;
+    static const uint8_t OP_INSERT = 0x02;
+    static const uint8_t OP_ADD = 0x03;
+    static const size_t HEADER_SIZE = 32;
+    static const size_t SCRATCH_SIZE = 512;
+
+    bool fail(const char *message);
+    bool parseHeader();
+    bool startOp();
+    bool copyFromSource(uint32_t offset, uint32_t length);
+    bool emit(const uint8_t *data, size_t len);
+
+    const esp_partition_t *source;
+    String sourceMd5;
+    Output output;
+
+    State state;
+    uint8_t op;
+    uint8_t pending[HEADER_SIZE];
+    size_t pendingLength;
+    size_t pendingNeeded;
+    uint32_t opOffset;
+    uint32_t opRemaining;
+    uint32_t target;
+    uint32_t sourceSize;
+    size_t outputBytes;
+    const char *errorMessage;
+    uint8_t scratch[SCRATCH_SIZE];
+};
+
+#endif
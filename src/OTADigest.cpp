@@ -0,0 +1,74 @@
+#include "OTADigest.h"
+
+OTADigest::OTADigest() : hashedBytes(0), hashTime(0), finished(false)
+{
+    memset(digestBytes, 0, sizeof(digestBytes));
+    digestHex[0] = '\0';
+    mbedtls_sha256_init(&context);
+}
+
+OTADigest::~OTADigest()
+{
+    mbedtls_sha256_free(&context);
+}
+
+void OTADigest::begin()
+{
+    mbedtls_sha256_free(&context);
+    mbedtls_sha256_init(&context);
+    mbedtls_sha256_starts(&context, 0);
+    digestHex[0] = '\0';
+    hashedBytes = 0;
+    hashTime = 0;
+    finished = false;
+}
+
+void OTADigest::update(const uint8_t *data, size_t len)
+{
+    unsigned long start = micros();
+    mbedtls_sha256_update(&context, data, len);
+    hashTime += micros() - start;
+    hashedBytes += len;
+}
+
+bool OTADigest::updateFromPartition(const esp_partition_t *partition, size_t offset, size_t len)
+{
+    uint8_t buffer[512];
+    while (len > 0)
+    {
+        size_t chunk = min(len, sizeof(buffer));
+        if (esp_partition_read(partition, offset, buffer, chunk) != ESP_OK)
+        {
+            return false;
+        }
+        update(buffer, chunk);
+        offset += chunk;
+        len -= chunk;
+    }
+    return true;
+}
+
+const uint8_t *OTADigest::finish()
+{
+    if (!finished)
+    {
+        mbedtls_sha256_finish(&context, digestBytes);
+        finished = true;
+    }
+    return digestBytes;
+}
+
+const char *OTADigest::hex()
+{
+    for (int i = 0; i < 32; i++)
+    {
+        snprintf(digestHex + i * 2, 3, "%02x", digestBytes[i]);
+    }
+    return digestHex;
+}
+
+bool OTADigest::matches(const String &expectedHex)
+{
+    finish();
+    return expectedHex.equalsIgnoreCase(hex());
+}
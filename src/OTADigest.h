@@ -0,0 +1,42 @@
+#ifndef OTA_DIGEST_H
+#define OTA_DIGEST_H
+
+#include <Arduino.h>
+#include <esp_partition.h>
+#include <mbedtls/sha256.h>
+
+// Incremental SHA-256 of an image as it is written, so verifying it needs no
+// second pass over flash. mbedtls uses the SHA peripheral on ESP32 parts that
+// have one.
+class OTADigest
+{
+public:
+    OTADigest();
+    ~OTADigest();
+
+    void begin();
+    void update(const uint8_t *data, size_t len);
+    // Hashes bytes already in flash, e.g. the part of a resumed image written before a reset
+    bool updateFromPartition(const esp_partition_t *partition, size_t offset, size_t len);
+    // Ends the hash (once; later calls return the same digest) and returns the raw 32 bytes
+    const uint8_t *finish();
+    // Lower-case hex of the digest, valid after finish()
+    const char *hex();
+    // Finishes the hash and compares it with a hex digest
+    bool matches(const String &expectedHex);
+    // Raw 32-byte digest, valid after finish() or matches()
+    const uint8_t *digest() const { return digestBytes; }
+
+    size_t hashed() const { return hashedBytes; }
+    unsigned long hashMicros() const { return hashTime; }
+
+private:
+    mbedtls_sha256_context context;
+    uint8_t digestBytes[32];
+    char digestHex[65];
+    size_t hashedBytes;
+    unsigned long hashTime;
+    bool finished;
+};
+
+#endif
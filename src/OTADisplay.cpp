@@ -0,0 +1,156 @@
+#include "OTADisplay.h"
+#if __has_include(<Adafruit_SSD1306.h>)
+
+OTADisplayRenderer::OTADisplayRenderer()
+    : display(nullptr), wire(nullptr), address(0x3c), minIntervalMs(250), partial(true)
+{
+    reset();
+}
+
+void OTADisplayRenderer::attach(Adafruit_SSD1306 &display, TwoWire &wire, uint8_t address)
+{
+    this->display = &display;
+    this->wire = &wire;
+    this->address = address;
+    reset();
+}
+
+void OTADisplayRenderer::reset()
+{
+    lastProgress = -1;
+    textX = 0;
+    textWidth = 0;
+    lastRender = 0;
+    frameCount = 0;
+    fullFrameCount = 0;
+    ioTime = 0;
+    sentBytes = 0;
+}
+
+// Percent ticks arrive far faster than anyone can read them; only the first
+// and last frame bypass the time limit
+bool OTADisplayRenderer::due(int progress) const
+{
+    return display && (lastProgress < 0 || progress >= 100 || millis() - lastRender >= minIntervalMs);
+}
+
+void OTADisplayRenderer::render(const String &heading, int progress)
+{
+    if (!display)
+    {
+        return;
+    }
+    unsigned long start = micros();
+
+    // Page maths assumes the unrotated framebuffer layout
+    if (!partial || lastProgress < 0 || progress < lastProgress || heading != currentHeading ||
+        display->getRotation() != 0)
+    {
+        renderFull(heading, progress);
+    }
+    else
+    {
+        renderChanges(progress);
+    }
+
+    lastProgress = progress;
+    lastRender = millis();
+    frameCount++;
+    ioTime += micros() - start;
+}
+
+void OTADisplayRenderer::renderFull(const String &heading, int progress)
+{
+    display->clearDisplay();
+
+    // Set text size and color
+    display->setTextSize(1);
+    display->setTextColor(SSD1306_WHITE);
+
+    // The heading is only laid out when it changes
+    int16_t x, y;
+    uint16_t w, h;
+    display->getTextBounds(heading, 0, 0, &x, &y, &w, &h);
+    display->setCursor((display->width() - w) / 2, 10);
+    display->print(heading);
+    currentHeading = heading;
+
+    display->drawRect(BAR_X, BAR_Y, BAR_WIDTH, BAR_HEIGHT, SSD1306_WHITE);
+    display->fillRect(BAR_X, BAR_Y, (progress * BAR_WIDTH) / 100, BAR_HEIGHT, SSD1306_WHITE);
+
+    String progressText = String(progress) + "%";
+    textWidth = progressText.length() * CHAR_WIDTH;
+    textX = (display->width() - textWidth) / 2;
+    display->setCursor(textX, TEXT_Y);
+    display->print(progressText);
+
+    display->display();
+    fullFrameCount++;
+    sentBytes += display->width() * ((display->height() + 7) / 8);
+}
+
+void OTADisplayRenderer::renderChanges(int progress)
+{
+    // Progress only grows here, so the bar just gains filled columns
+    int16_t oldFill = (lastProgress * BAR_WIDTH) / 100;
+    int16_t newFill = (progress * BAR_WIDTH) / 100;
+    if (newFill > oldFill)
+    {
+        display->fillRect(BAR_X + oldFill, BAR_Y, newFill - oldFill, BAR_HEIGHT, SSD1306_WHITE);
+        flushRegion(BAR_X + oldFill, BAR_X + newFill - 1, BAR_Y, BAR_Y + BAR_HEIGHT - 1);
+    }
+
+    String progressText = String(progress) + "%";
+    int16_t width = progressText.length() * CHAR_WIDTH;
+    int16_t x = (display->width() - width) / 2;
+    int16_t x0 = min(x, textX);
+    int16_t x1 = max((int16_t)(x + width), (int16_t)(textX + textWidth)) - 1;
+
+    display->fillRect(textX, TEXT_Y, textWidth, 8, SSD1306_BLACK);
+    display->setCursor(x, TEXT_Y);
+    display->print(progressText);
+    flushRegion(x0, x1, TEXT_Y, TEXT_Y + 7);
+
+    textX = x;
+    textWidth = width;
+}
+
+// Sends framebuffer columns x0..x1 of the pages covering rows y0..y1
+void OTADisplayRenderer::flushRegion(int16_t x0, int16_t x1, int16_t y0, int16_t y1)
+{
+    x0 = max(x0, (int16_t)0);
+    x1 = min(x1, (int16_t)(display->width() - 1));
+    if (x1 < x0)
+    {
+        return;
+    }
+    uint8_t page0 = y0 / 8;
+    uint8_t page1 = y1 / 8;
+
+    display->ssd1306_command(SSD1306_PAGEADDR);
+    display->ssd1306_command(page0);
+    display->ssd1306_command(page1);
+    display->ssd1306_command(SSD1306_COLUMNADDR);
+    display->ssd1306_command(x0);
+    display->ssd1306_command(x1);
+
+    // The controller wraps to the next page at x1, so rows go out back to back
+    const uint8_t *buffer = display->getBuffer();
+    size_t columns = x1 - x0 + 1;
+    for (uint8_t page = page0; page <= page1; page++)
+    {
+        const uint8_t *row = buffer + page * display->width() + x0;
+        for (size_t sent = 0; sent < columns;)
+        {
+            size_t chunk = min(columns - sent, (size_t)31);
+            wire->beginTransmission(address);
+            wire->write((uint8_t)0x40);
+            wire->write(row + sent, chunk);
+            wire->endTransmission();
+            sent += chunk;
+        }
+    }
+    sentBytes += columns * (page1 - page0 + 1);
+}
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef OTA_DISPLAY_H
+#define OTA_DISPLAY_H
+
+#include <Arduino.h>
+#if __has_include(<Adafruit_SSD1306.h>)
+#include <Wire.h>
+#include <Adafruit_SSD1306.h>
+
+// Draws the progress screen and, after the first full frame, only pushes the
+// parts of the bar and percent text that changed straight to the panel's RAM
+// over I2C instead of the whole 1 KB framebuffer.
+class OTADisplayRenderer
+{
+public:
+    OTADisplayRenderer();
+
+    // Nothing is drawn until a display is attached
+    void attach(Adafruit_SSD1306 &display, TwoWire &wire = Wire, uint8_t address = 0x3c);
+    bool attached() const { return display != nullptr; }
+
+    void setMinInterval(uint16_t ms) { minIntervalMs = ms; }
+    void setPartialRefresh(bool enabled) { partial = enabled; }
+
+    // Forget the last frame so the next render is a full redraw, and zero the stats
+    void reset();
+    bool due(int progress) const;
+    void render(const String &heading, int progress);
+
+    uint32_t frames() const { return frameCount; }
+    uint32_t fullFrames() const { return fullFrameCount; }
+    unsigned long ioMicros() const { return ioTime; }
+    size_t bytesSent() const { return sentBytes; }
+
+private:
+    static const int16_t BAR_X = 10;
+    static const int16_t BAR_Y = 30;
+    static const int16_t BAR_WIDTH = 100;
+    static const int16_t BAR_HEIGHT = 10;
+    static const int16_t TEXT_Y = BAR_Y + BAR_HEIGHT + 5;
+    static const int16_t CHAR_WIDTH = 6;
+
+    void renderFull(const String &heading, int progress);
+    void renderChanges(int progress);
+    void flushRegion(int16_t x0, int16_t x1, int16_t y0, int16_t y1);
+
+    Adafruit_SSD1306 *display;
+    TwoWire *wire;
+    uint8_t address;
+    uint16_t minIntervalMs;
+    bool partial;
+
+    String currentHeading;
+    int lastProgress;
+    int16_t textX;
+    int16_t textWidth;
+    unsigned long lastRender;
+
+    uint32_t frameCount;
+    uint32_t fullFrameCount;
+    unsigned long ioTime;
+    size_t sentBytes;
+};
+
+#endif
+#endif
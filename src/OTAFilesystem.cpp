@@ -0,0 +1,116 @@
+#include "OTAFilesystem.h"
+
+namespace
+{
+#if !defined(OTA_FILESYSTEM_FFAT)
+    // LittleFS superblocks carry their name right after the block header
+    bool isLittleFsImage(const uint8_t *head, size_t len)
+    {
+        return len >= 16 && memcmp(head + 8, "littlefs", 8) == 0;
+    }
+#endif
+
+#if !defined(OTA_FILESYSTEM_LITTLEFS)
+    // A FAT boot sector starts with a jump and ends with the 0x55AA signature
+    bool isFatImage(const uint8_t *head, size_t len)
+    {
+        return len >= 512 && (head[0] == 0xEB || head[0] == 0xE9) && head[510] == 0x55 && head[511] == 0xAA;
+    }
+#endif
+}
+
+const char *OTAFilesystem::name()
+{
+#if defined(OTA_FILESYSTEM_LITTLEFS)
+    return "LittleFS";
+#elif defined(OTA_FILESYSTEM_FFAT)
+    return "FFat";
+#else
+    return "SPIFFS";
+#endif
+}
+
+bool OTAFilesystem::mount(bool formatOnFail)
+{
+    return OTA_FS.begin(formatOnFail);
+}
+
+const esp_partition_t *OTAFilesystem::partition()
+{
+#if defined(OTA_FILESYSTEM_FFAT)
+    return esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_FAT, NULL);
+#else
+    // Arduino partition tables give LittleFS the spiffs subtype too
+    return esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_SPIFFS, NULL);
+#endif
+}
+
+size_t OTAFilesystem::imageOffset()
+{
+#if defined(OTA_FILESYSTEM_FFAT)
+    return 0x1000;
+#else
+    return 0;
+#endif
+}
+
+bool OTAFilesystem::imageMatches(const uint8_t *head, size_t len)
+{
+#if defined(OTA_FILESYSTEM_LITTLEFS)
+    return isLittleFsImage(head, len);
+#elif defined(OTA_FILESYSTEM_FFAT)
+    return isFatImage(head, len);
+#else
+    return !isLittleFsImage(head, len) && !isFatImage(head, len);
+#endif
+}
+
+OTAFilesystemStats OTAFilesystem::benchmark(const char *path)
+{
+    OTAFilesystemStats stats;
+    memset(&stats, 0, sizeof(stats));
+
+    OTA_FS.end();
+    unsigned long start = millis();
+    if (!OTA_FS.begin(false))
+    {
+        Serial.printf("❌ %s did not mount.\n", name());
+        return stats;
+    }
+    stats.mountMs = millis() - start;
+    stats.totalBytes = OTA_FS.totalBytes();
+    stats.usedBytes = OTA_FS.usedBytes();
+
+    String target = path ? path : "";
+    if (target.length() == 0)
+    {
+        File root = OTA_FS.open("/");
+        size_t largest = 0;
+        for (File entry = root.openNextFile(); entry; entry = root.openNextFile())
+        {
+            if (!entry.isDirectory() && entry.size() > largest)
+            {
+                largest = entry.size();
+                target = entry.path();
+            }
+        }
+    }
+
+    File file = target.length() > 0 ? OTA_FS.open(target, "r") : File();
+    if (file)
+    {
+        uint8_t buffer[512];
+        start = millis();
+        size_t n;
+        while ((n = file.read(buffer, sizeof(buffer))) > 0)
+        {
+            stats.readBytes += n;
+        }
+        stats.readMs = millis() - start;
+    }
+
+    Serial.printf("🗂️ %s: mounted in %u ms, %u/%u bytes used, read %s at %.1f KB/s\n", name(), stats.mountMs,
+                  stats.usedBytes, stats.totalBytes, target.length() > 0 ? target.c_str() : "nothing",
+                  stats.readThroughput() / 1024);
+    return stats;
+}
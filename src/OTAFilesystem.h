@@ -0,0 +1,62 @@
+#ifndef OTA_FILESYSTEM_H
+#define OTA_FILESYSTEM_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <esp_partition.h>
+
+// Filesystem on the data partition, chosen at build time like the progress
+// sink: -DOTA_FILESYSTEM_LITTLEFS or -DOTA_FILESYSTEM_FFAT, SPIFFS otherwise.
+// The data image published as spiffs.bin has to be built for the same
+// backend (mkspiffs, mklittlefs or mkfatfs).
+#if defined(OTA_FILESYSTEM_LITTLEFS)
+#include <LittleFS.h>
+#define OTA_FS LittleFS
+#elif defined(OTA_FILESYSTEM_FFAT)
+#include <FFat.h>
+#define OTA_FS FFat
+#else
+#include <SPIFFS.h>
+#define OTA_FS SPIFFS
+#endif
+
+// Mount time and sequential read speed of the configured backend
+struct OTAFilesystemStats
+{
+    uint32_t mountMs;
+    uint32_t readBytes;
+    uint32_t readMs;
+    uint32_t totalBytes;
+    uint32_t usedBytes;
+
+    // Bytes per second
+    float readThroughput() const
+    {
+        return readMs ? readBytes * 1000.0f / readMs : 0.0f;
+    }
+};
+
+class OTAFilesystem
+{
+public:
+    static const char *name();
+    static bool mount(bool formatOnFail);
+    // The data partition and where Update puts an image in it (Update skips
+    // the first sector of a FAT partition)
+    static const esp_partition_t *partition();
+    static size_t imageOffset();
+    // True if a data image starting with head can be mounted by this backend:
+    // LittleFS and FFat images carry a signature, SPIFFS has none, so for it
+    // anything that isn't recognisably LittleFS or FAT. head holds the first
+    // IMAGE_HEAD_SIZE bytes, or the whole image if it is shorter.
+    static bool imageMatches(const uint8_t *head, size_t len);
+#if defined(OTA_FILESYSTEM_LITTLEFS)
+    static const size_t IMAGE_HEAD_SIZE = 16;
+#else
+    static const size_t IMAGE_HEAD_SIZE = 512;
+#endif
+    // Remounts and reads path (the largest file in / if null) end to end
+    static OTAFilesystemStats benchmark(const char *path = nullptr);
+};
+
+#endif
@@ -0,0 +1,224 @@
+#include "OTAInflate.h"
+#include <esp_rom_crc.h>
+#if __has_include(<rom/miniz.h>)
+#include <rom/miniz.h>
+#else
+#include <esp32/rom/miniz.h>
+#endif
+
+namespace
+{
+    const uint8_t GZIP_FHCRC = 0x02;
+    const uint8_t GZIP_FEXTRA = 0x04;
+    const uint8_t GZIP_FNAME = 0x08;
+    const uint8_t GZIP_FCOMMENT = 0x10;
+    const uint8_t GZIP_OPTIONAL = GZIP_FHCRC | GZIP_FEXTRA | GZIP_FNAME | GZIP_FCOMMENT;
+    const size_t GZIP_FIXED_HEADER = 10;
+
+    uint32_t readLE32(const uint8_t *p)
+    {
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+}
+
+OTAInflater::OTAInflater(Output output, uint8_t windowBits, size_t blockSize)
+    : output(output), windowSize((size_t)1 << windowBits), decompressor(nullptr), window(nullptr), windowPos(0),
+      blockSize(blockSize > 0 && ((size_t)1 << windowBits) % blockSize == 0 ? blockSize : 0), emittedPos(0),
+      state(STATE_HEADER), headerFlags(0), headerPos(0), headerSkip(0), trailerLength(0), crc(0), outputBytes(0),
+      errorMessage("")
+{
+}
+
+OTAInflater::~OTAInflater()
+{
+    free(decompressor);
+    free(window);
+}
+
+bool OTAInflater::begin()
+{
+    // Allocated once per image and reused for the whole stream
+    decompressor = (tinfl_decompressor *)malloc(sizeof(tinfl_decompressor));
+    window = (uint8_t *)malloc(windowSize);
+    if (!decompressor || !window)
+    {
+        return fail("not enough memory for decompressor");
+    }
+    tinfl_init(decompressor);
+    return true;
+}
+
+size_t OTAInflater::memoryUsage() const
+{
+    return sizeof(tinfl_decompressor) + windowSize;
+}
+
+bool OTAInflater::fail(const char *message)
+{
+    state = STATE_FAILED;
+    errorMessage = message;
+    return false;
+}
+
+bool OTAInflater::parseHeaderByte(uint8_t b)
+{
+    if (headerPos < GZIP_FIXED_HEADER)
+    {
+        if ((headerPos == 0 && b != 0x1f) || (headerPos == 1 && b != 0x8b))
+        {
+            return fail("not a gzip stream");
+        }
+        if (headerPos == 2 && b != 8)
+        {
+            return fail("unsupported gzip compression method");
+        }
+        if (headerPos == 3)
+        {
+            if (b & ~GZIP_OPTIONAL & 0xFE)
+            {
+                return fail("unsupported gzip header flags");
+            }
+            headerFlags = b & GZIP_OPTIONAL;
+        }
+        headerPos++;
+    }
+    else if (headerSkip > 0)
+    {
+        headerSkip--;
+    }
+    else if (headerFlags & GZIP_FEXTRA)
+    {
+        // Two length bytes, then the extra field itself is skipped
+        if (headerPos == GZIP_FIXED_HEADER)
+        {
+            trailer[0] = b;
+            headerPos++;
+        }
+        else
+        {
+            headerSkip = trailer[0] | ((size_t)b << 8);
+            headerFlags &= ~GZIP_FEXTRA;
+            headerPos = GZIP_FIXED_HEADER;
+        }
+    }
+    else if (headerFlags & GZIP_FNAME)
+    {
+        if (b == 0)
+        {
+            headerFlags &= ~GZIP_FNAME;
+        }
+    }
+    else if (headerFlags & GZIP_FCOMMENT)
+    {
+        if (b == 0)
+        {
+            headerFlags &= ~GZIP_FCOMMENT;
+        }
+    }
+    else if (headerFlags & GZIP_FHCRC)
+    {
+        headerSkip = 1;
+        headerFlags &= ~GZIP_FHCRC;
+    }
+
+    if (headerPos == GZIP_FIXED_HEADER && headerSkip == 0 && headerFlags == 0)
+    {
+        state = STATE_DEFLATE;
+    }
+    return true;
+}
+
+// Hands on the window from emittedPos up to end
+bool OTAInflater::emit(size_t end)
+{
+    if (end > emittedPos && !output(window + emittedPos, end - emittedPos))
+    {
+        return fail("output write failed");
+    }
+    emittedPos = end & (windowSize - 1);
+    return true;
+}
+
+bool OTAInflater::inflate(const uint8_t *&data, size_t &len)
+{
+    tinfl_status status;
+    do
+    {
+        size_t inBytes = len;
+        size_t outBytes = windowSize - windowPos;
+        status = tinfl_decompress(decompressor, data, &inBytes, window, window + windowPos, &outBytes,
+                                  TINFL_FLAG_HAS_MORE_INPUT);
+        data += inBytes;
+        len -= inBytes;
+
+        if (outBytes > 0)
+        {
+            crc = esp_rom_crc32_le(crc, window + windowPos, outBytes);
+            outputBytes += outBytes;
+            size_t end = windowPos + outBytes;
+            // Whole blocks only; tinfl won't write over the rest before the window wraps
+            if (!emit(blockSize ? end - end % blockSize : end))
+            {
+                return false;
+            }
+            windowPos = end & (windowSize - 1);
+        }
+
+        if (status < TINFL_STATUS_DONE)
+        {
+            return fail("corrupt deflate stream");
+        }
+        if (status == TINFL_STATUS_DONE)
+        {
+            state = STATE_TRAILER;
+            return emit(windowPos);
+        }
+    } while (len > 0 || status == TINFL_STATUS_HAS_MORE_OUTPUT);
+    return true;
+}
+
+bool OTAInflater::write(const uint8_t *data, size_t len)
+{
+    while (len > 0)
+    {
+        switch (state)
+        {
+        case STATE_HEADER:
+            if (!parseHeaderByte(*data))
+            {
+                return false;
+            }
+            data++;
+            len--;
+            break;
+        case STATE_DEFLATE:
+            if (!inflate(data, len))
+            {
+                return false;
+            }
+            break;
+        case STATE_TRAILER:
+        {
+            size_t take = min(len, sizeof(trailer) - trailerLength);
+            memcpy(trailer + trailerLength, data, take);
+            trailerLength += take;
+            data += take;
+            len -= take;
+            if (trailerLength == sizeof(trailer))
+            {
+                if (readLE32(trailer) != crc || readLE32(trailer + 4) != (uint32_t)outputBytes)
+                {
+                    return fail("gzip CRC or length mismatch");
+                }
+                state = STATE_DONE;
+            }
+            break;
+        }
+        case STATE_DONE:
+            return fail("data after end of gzip stream");
+        case STATE_FAILED:
+            return false;
+        }
+    }
+    return true;
+}
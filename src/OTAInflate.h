@@ -0,0 +1,72 @@
+#ifndef OTA_INFLATE_H
+#define OTA_INFLATE_H
+
+#include <Arduino.h>
+
+struct tinfl_decompressor_tag;
+
+// Streaming gzip decoder built on the ROM copy of miniz's tinfl.
+//
+// Compressed bytes are fed in arbitrary pieces and decoded output is pushed
+// to `output` straight out of the history window, so RAM use is fixed at the
+// decompressor state plus a window of 2^windowBits bytes. The window must be
+// at least as large as the one the image was compressed with (gzip default is
+// 15 bits; tools/otacompress.py can build smaller ones). The gzip CRC-32 and
+// length trailer are checked at the end of the stream.
+//
+// With a blockSize that divides the window, output is held in the window
+// until a whole block is there and handed on a block at a time (the rest at
+// the end of the stream). Block n of the output is then block n of the image,
+// so sectors reach flash without being gathered into another buffer.
+class OTAInflater
+{
+public:
+    typedef std::function<bool(const uint8_t *data, size_t len)> Output;
+
+    OTAInflater(Output output, uint8_t windowBits = 15, size_t blockSize = 0);
+    ~OTAInflater();
+
+    bool begin();
+    bool write(const uint8_t *data, size_t len);
+    bool finished() const { return state == STATE_DONE; }
+    bool failed() const { return state == STATE_FAILED; }
+    const char *error() const { return errorMessage; }
+    size_t produced() const { return outputBytes; }
+    size_t memoryUsage() const;
+
+private:
+    enum State
+    {
+        STATE_HEADER,
+        STATE_DEFLATE,
+        STATE_TRAILER,
+        STATE_DONE,
+        STATE_FAILED
+    };
+
+    bool fail(const char *message);
+    bool parseHeaderByte(uint8_t b);
+    bool inflate(const uint8_t *&data, size_t &len);
+    bool emit(size_t end);
+
+    Output output;
+    size_t windowSize;
+    tinfl_decompressor_tag *decompressor;
+    uint8_t *window;
+    size_t windowPos;
+    size_t blockSize;
+    // Window position up to which output has been handed on
+    size_t emittedPos;
+
+    State state;
+    uint8_t headerFlags;
+    size_t headerPos;
+    size_t headerSkip;
+    uint8_t trailer[8];
+    size_t trailerLength;
+    uint32_t crc;
+    size_t outputBytes;
+    const char *errorMessage;
+};
+
+#endif
@@ -0,0 +1,133 @@
+#include "OTAManifest.h"
+
+namespace
+{
+    const size_t ARENA_ALIGN = 8;
+    const size_t HEADER_SIZE = ARENA_ALIGN; // keeps the block behind it aligned
+
+    size_t alignUp(size_t n)
+    {
+        return (n + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+    }
+}
+
+OTAJsonArena::OTAJsonArena() : top(0), last(0), peakUsed(0), failed(0)
+{
+}
+
+void OTAJsonArena::reset()
+{
+    top = 0;
+    last = 0;
+    peakUsed = 0;
+    failed = 0;
+}
+
+// Each block is preceded by its size so reallocate() knows how much to copy
+size_t &OTAJsonArena::blockSize(size_t offset)
+{
+    return *reinterpret_cast<size_t *>(buffer + offset - HEADER_SIZE);
+}
+
+void *OTAJsonArena::allocate(size_t size)
+{
+    size_t need = HEADER_SIZE + alignUp(size);
+    if (need > sizeof(buffer) - top)
+    {
+        failed++;
+        return nullptr;
+    }
+    last = top + HEADER_SIZE;
+    top += need;
+    blockSize(last) = size;
+    peakUsed = max(peakUsed, top);
+    return buffer + last;
+}
+
+void OTAJsonArena::deallocate(void *ptr)
+{
+    // Only the newest block can be returned; the rest is freed by reset()
+    if (ptr && static_cast<uint8_t *>(ptr) == buffer + last && top > last)
+    {
+        top = last - HEADER_SIZE;
+        last = top;
+    }
+}
+
+void *OTAJsonArena::reallocate(void *ptr, size_t newSize)
+{
+    if (!ptr)
+    {
+        return allocate(newSize);
+    }
+    size_t offset = static_cast<uint8_t *>(ptr) - buffer;
+    if (offset == last && top > last)
+    {
+        // The newest block grows or shrinks in place
+        if (alignUp(newSize) > sizeof(buffer) - last)
+        {
+            failed++;
+            return nullptr;
+        }
+        top = last + alignUp(newSize);
+        blockSize(last) = newSize;
+        peakUsed = max(peakUsed, top);
+        return ptr;
+    }
+    size_t oldSize = blockSize(offset);
+    if (newSize <= oldSize)
+    {
+        blockSize(offset) = newSize;
+        return ptr;
+    }
+    void *moved = allocate(newSize);
+    if (moved)
+    {
+        memcpy(moved, ptr, oldSize);
+    }
+    return moved;
+}
+
+OTABodyStream::OTABodyStream(Stream &in, size_t length) : in(in), left(length)
+{
+    setTimeout(in.getTimeout());
+}
+
+int OTABodyStream::available()
+{
+    return min((size_t)max(in.available(), 0), left);
+}
+
+int OTABodyStream::read()
+{
+    if (left == 0)
+    {
+        return -1;
+    }
+    int c = in.read();
+    if (c >= 0)
+    {
+        left--;
+    }
+    return c;
+}
+
+int OTABodyStream::peek()
+{
+    return left > 0 ? in.peek() : -1;
+}
+
+bool OTABodyStream::drain()
+{
+    uint8_t scratch[64];
+    while (left > 0)
+    {
+        size_t n = in.readBytes(scratch, min(left, sizeof(scratch)));
+        if (n == 0)
+        {
+            return false;
+        }
+        left -= n;
+    }
+    return true;
+}
@@ -0,0 +1,67 @@
+#ifndef OTA_MANIFEST_H
+#define OTA_MANIFEST_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Bytes reserved for parsing config.json. Only the filtered fields are kept,
+// so this bounds the manifest's useful content, not the size of the file.
+#ifndef OTA_MANIFEST_ARENA_SIZE
+#define OTA_MANIFEST_ARENA_SIZE 4096
+#endif
+
+// ArduinoJson allocator over a fixed buffer. Parsing the manifest then never
+// touches the heap, which should stay unfragmented for the image download.
+// Blocks are handed out in order; only the last one can grow or be given back,
+// which is all the parser needs when it builds strings and pools.
+class OTAJsonArena : public ArduinoJson::Allocator
+{
+public:
+    OTAJsonArena();
+
+    // Forgets every block; documents using the arena must be gone by then
+    void reset();
+
+    void *allocate(size_t size) override;
+    void deallocate(void *ptr) override;
+    void *reallocate(void *ptr, size_t newSize) override;
+
+    size_t used() const { return top; }
+    size_t peak() const { return peakUsed; }
+    size_t capacity() const { return sizeof(buffer); }
+    // Allocations refused since the last reset()
+    uint32_t failures() const { return failed; }
+
+private:
+    size_t &blockSize(size_t offset);
+
+    alignas(8) uint8_t buffer[OTA_MANIFEST_ARENA_SIZE];
+    size_t top;
+    size_t last; // offset of the newest block, or top if there is none
+    size_t peakUsed;
+    uint32_t failed;
+};
+
+// Response body as a Stream that ends after Content-Length bytes, so the
+// parser reads straight from the socket and the connection is left at the
+// end of the response for keep-alive.
+class OTABodyStream : public Stream
+{
+public:
+    OTABodyStream(Stream &in, size_t length);
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t write(uint8_t) override { return 0; }
+
+    size_t remaining() const { return left; }
+    // Reads and drops whatever the parser left, e.g. trailing whitespace
+    bool drain();
+
+private:
+    Stream &in;
+    size_t left;
+};
+
+#endif
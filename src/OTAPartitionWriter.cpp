@@ -0,0 +1,78 @@
+#include "OTAPartitionWriter.h"
+
+OTAPartitionWriter::OTAPartitionWriter(const esp_partition_t *partition, size_t startOffset)
+    : partition(partition), committed(startOffset), headerAt(startOffset), headerLength(0),
+      sectors([this](const uint8_t *data, size_t len)
+              { return program(data, len); })
+{
+}
+
+bool OTAPartitionWriter::begin()
+{
+    if (!partition || committed % SECTOR_SIZE != 0 || committed > partition->size)
+    {
+        return false;
+    }
+    return sectors.begin();
+}
+
+bool OTAPartitionWriter::begin(const esp_partition_t *target, size_t startOffset)
+{
+    partition = target;
+    committed = startOffset;
+    headerAt = startOffset;
+    headerLength = 0;
+    return begin();
+}
+
+void OTAPartitionWriter::holdHeader(size_t len)
+{
+    headerLength = min(len, sizeof(header));
+}
+
+// One erase and one program call for each run of sectors the buffer hands on
+bool OTAPartitionWriter::program(const uint8_t *data, size_t len)
+{
+    size_t eraseLength = (len + SECTOR_SIZE - 1) / SECTOR_SIZE * SECTOR_SIZE;
+    if (committed + eraseLength > partition->size)
+    {
+        return false;
+    }
+    if (esp_partition_erase_range(partition, committed, eraseLength) != ESP_OK)
+    {
+        return false;
+    }
+    // The held header stays erased until finish()
+    size_t skip = 0;
+    if (committed == headerAt && headerLength > 0)
+    {
+        skip = min(headerLength, len);
+        memcpy(header, data, skip);
+    }
+    if (len > skip && esp_partition_write(partition, committed + skip, data + skip, len - skip) != ESP_OK)
+    {
+        return false;
+    }
+    committed += len;
+    return true;
+}
+
+bool OTAPartitionWriter::write(const uint8_t *data, size_t len)
+{
+    return sectors.write(data, len);
+}
+
+bool OTAPartitionWriter::finish()
+{
+    if (!sectors.flush())
+    {
+        return false;
+    }
+    if (headerLength > 0 && committed > headerAt)
+    {
+        size_t len = min(headerLength, committed - headerAt);
+        headerLength = 0;
+        return esp_partition_write(partition, headerAt, header, len) == ESP_OK;
+    }
+    return true;
+}
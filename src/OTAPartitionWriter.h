@@ -0,0 +1,52 @@
+#ifndef OTA_PARTITION_WRITER_H
+#define OTA_PARTITION_WRITER_H
+
+#include <Arduino.h>
+#include <esp_partition.h>
+#include "OTASectorBuffer.h"
+
+// Writes an image straight into a flash partition, erasing and programming
+// whole 4 KB sectors, starting from a sector-aligned offset. Aligned sectors
+// go to the partition as they are, without the copy Update makes of every
+// byte into its own buffer.
+class OTAPartitionWriter
+{
+public:
+    OTAPartitionWriter(const esp_partition_t *partition = nullptr, size_t startOffset = 0);
+
+    bool begin();
+    // Starts over on another partition or offset, keeping the buffer
+    bool begin(const esp_partition_t *partition, size_t startOffset);
+    // Leaves the first len bytes (at most HEADER_HOLD) erased until finish(),
+    // like Update does for app images, so an image is only valid once whole
+    void holdHeader(size_t len);
+    bool write(const uint8_t *data, size_t len);
+    bool finish();
+    // Drops buffered bytes and gives back an allocated buffer
+    void release() { sectors.release(); }
+
+    // See OTASectorBuffer
+    void useBuffer(uint8_t *buffer) { sectors.useBuffer(buffer); }
+    uint8_t *space(size_t &room) { return sectors.space(room); }
+
+    // Bytes accepted so far and bytes already programmed, both as partition offsets
+    size_t position() const { return committed + sectors.buffered(); }
+    size_t offset() const { return committed; }
+    const esp_partition_t *target() const { return partition; }
+    const OTASectorBuffer &sectorBuffer() const { return sectors; }
+
+    static const size_t SECTOR_SIZE = OTASectorBuffer::SECTOR_SIZE;
+    static const size_t HEADER_HOLD = 16;
+
+private:
+    bool program(const uint8_t *data, size_t len);
+
+    const esp_partition_t *partition;
+    size_t committed;
+    size_t headerAt;
+    size_t headerLength;
+    uint8_t header[HEADER_HOLD];
+    OTASectorBuffer sectors;
+};
+
+#endif
@@ -0,0 +1,195 @@
+#ifndef OTA_PROGRESS_SINK_H
+#define OTA_PROGRESS_SINK_H
+
+#include <Arduino.h>
+#include "OTADisplay.h"
+#if __has_include(<Adafruit_SSD1306.h>)
+#define OTA_HAS_OLED 1
+#endif
+
+class Adafruit_SSD1306;
+
+// text is the heading for progress reports; status messages arrive with progress -1
+typedef std::function<void(const char *text, int progress)> OTAProgressCallback;
+
+// Progress and status reporting is resolved at compile time: OTAUpdate calls
+// these members on the sink type chosen with OTA_PROGRESS_SINK, so unused
+// hooks inline away and a disabled sink takes no space in OTAUpdate.
+// Sinks derive from OTASinkBase and only override what they handle.
+struct OTASinkBase
+{
+    static const bool enabled = true; // false skips progress maths in the transfer loop entirely
+    static const bool visual = false; // true if status messages should stay up for a moment
+
+    void begin() {}
+    void attachDisplay(Adafruit_SSD1306 &) {}
+    void setCallback(OTAProgressCallback) {}
+    void setDisplayRefresh(uint16_t, bool) {}
+    void transferStarted(const String &) {}
+    void progress(const String &, int) {}
+    void message(const char *, const char *) {}
+    void transferFinished(bool) {}
+    // Time spent driving the output device, for the transfer metrics
+    unsigned long ioMicros() { return 0; }
+};
+
+struct OTANullSink : OTASinkBase
+{
+    static const bool enabled = false;
+};
+
+struct OTASerialSink : OTASinkBase
+{
+    void progress(const String &, int progress)
+    {
+        Serial.printf("📊 Progress: %d%%\n", progress);
+    }
+};
+
+class OTACallbackSink : public OTASinkBase
+{
+public:
+    void setCallback(OTAProgressCallback cb)
+    {
+        callback = cb;
+    }
+    void progress(const String &heading, int progress)
+    {
+        if (callback)
+        {
+            callback(heading.c_str(), progress);
+        }
+    }
+    void message(const char *line1, const char *line2)
+    {
+        if (callback)
+        {
+            callback(line2 ? (String(line1) + " " + line2).c_str() : line1, -1);
+        }
+    }
+
+private:
+    OTAProgressCallback callback;
+};
+
+#ifdef OTA_HAS_OLED
+class OTAOledSink : public OTASinkBase
+{
+public:
+    static const bool visual = true;
+
+    OTAOledSink() : display(nullptr) {}
+
+    // Keeps a reference to the sketch's display rather than a copy of the driver
+    void attachDisplay(Adafruit_SSD1306 &d)
+    {
+        display = &d;
+        renderer.attach(d);
+    }
+    void setDisplayRefresh(uint16_t minIntervalMs, bool partial)
+    {
+        renderer.setMinInterval(minIntervalMs);
+        renderer.setPartialRefresh(partial);
+    }
+    void begin()
+    {
+        if (display)
+        {
+            display->begin(SSD1306_SWITCHCAPVCC, 0x3c, -1);
+        }
+    }
+    void transferStarted(const String &)
+    {
+        renderer.reset();
+    }
+    void progress(const String &heading, int progress)
+    {
+        if (renderer.due(progress))
+        {
+            renderer.render(heading, progress);
+        }
+    }
+    void message(const char *line1, const char *line2)
+    {
+        if (!display)
+        {
+            return;
+        }
+        display->clearDisplay();
+        display->setTextSize(1);
+        display->setTextColor(SSD1306_WHITE);
+        display->setCursor(10, 10);
+        display->print(line1);
+        if (line2)
+        {
+            display->setCursor(10, 20);
+            display->print(line2);
+        }
+        display->display();
+    }
+    void transferFinished(bool)
+    {
+        if (display)
+        {
+            Serial.printf("🖥️ Display: %u frames (%u full), %u bytes, %lu ms of I/O\n",
+                          renderer.frames(), renderer.fullFrames(), (unsigned)renderer.bytesSent(),
+                          renderer.ioMicros() / 1000);
+        }
+    }
+    unsigned long ioMicros()
+    {
+        return renderer.ioMicros();
+    }
+
+private:
+    Adafruit_SSD1306 *display;
+    OTADisplayRenderer renderer;
+};
+#endif
+
+// Fans every call out to two sinks, e.g. Serial plus OLED
+template <class A, class B>
+class OTAMultiSink : public OTASinkBase
+{
+public:
+    static const bool enabled = A::enabled || B::enabled;
+    static const bool visual = A::visual || B::visual;
+
+    void begin() { first.begin(); second.begin(); }
+    void attachDisplay(Adafruit_SSD1306 &d) { first.attachDisplay(d); second.attachDisplay(d); }
+    void setCallback(OTAProgressCallback cb) { first.setCallback(cb); second.setCallback(cb); }
+    void setDisplayRefresh(uint16_t ms, bool partial) { first.setDisplayRefresh(ms, partial); second.setDisplayRefresh(ms, partial); }
+    void transferStarted(const String &heading) { first.transferStarted(heading); second.transferStarted(heading); }
+    void progress(const String &heading, int progress) { first.progress(heading, progress); second.progress(heading, progress); }
+    void message(const char *line1, const char *line2) { first.message(line1, line2); second.message(line1, line2); }
+    void transferFinished(bool ok) { first.transferFinished(ok); second.transferFinished(ok); }
+    unsigned long ioMicros() { return first.ioMicros() + second.ioMicros(); }
+
+private:
+    A first;
+    B second;
+};
+
+// Build with e.g. -DOTA_PROGRESS_SINK=OTANullSink for headless boards
+#ifndef OTA_PROGRESS_SINK
+#ifdef OTA_HAS_OLED
+#define OTA_PROGRESS_SINK OTAMultiSink<OTASerialSink, OTAOledSink>
+#else
+#define OTA_PROGRESS_SINK OTASerialSink
+#endif
+#endif
+
+typedef OTA_PROGRESS_SINK OTAProgressSink;
+
+// Private base so an empty sink adds no bytes to OTAUpdate
+template <class Sink>
+class OTASinkHolder : private Sink
+{
+protected:
+    Sink &sink()
+    {
+        return *this;
+    }
+};
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef OTA_RING_BUFFER_H
+#define OTA_RING_BUFFER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <atomic>
+
+// Single-producer / single-consumer byte ring used between the network task
+// and the flash task. The producer only moves `head`, the consumer only moves
+// `tail`, so no lock is needed. Both sides work on contiguous regions so data
+// is read from the socket and handed to the OTAPartitionWriter without extra
+// copies.
+class OTARingBuffer
+{
+public:
+    explicit OTARingBuffer(size_t requested)
+        : buffer(nullptr), capacity(0), head(0), tail(0)
+    {
+        // Round up to a power of two so the free-running counters wrap cleanly
+        size_t cap = 256;
+        while (cap < requested)
+        {
+            cap <<= 1;
+        }
+        buffer = (uint8_t *)malloc(cap);
+        if (buffer)
+        {
+            capacity = cap;
+        }
+    }
+
+    ~OTARingBuffer()
+    {
+        free(buffer);
+    }
+
+    bool valid() const { return buffer != nullptr; }
+    size_t size() const { return capacity; }
+
+    size_t used() const
+    {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    // Producer side: contiguous free space starting at `ptr`
+    size_t writable(uint8_t *&ptr) const
+    {
+        size_t h = head.load(std::memory_order_relaxed);
+        size_t t = tail.load(std::memory_order_acquire);
+        size_t free = capacity - (h - t);
+        size_t offset = h & (capacity - 1);
+        size_t untilEnd = capacity - offset;
+        ptr = buffer + offset;
+        return free < untilEnd ? free : untilEnd;
+    }
+
+    void commit(size_t n)
+    {
+        head.store(head.load(std::memory_order_relaxed) + n, std::memory_order_release);
+    }
+
+    // Consumer side: contiguous filled data starting at `ptr`
+    size_t readable(const uint8_t *&ptr) const
+    {
+        size_t t = tail.load(std::memory_order_relaxed);
+        size_t h = head.load(std::memory_order_acquire);
+        size_t filled = h - t;
+        size_t offset = t & (capacity - 1);
+        size_t untilEnd = capacity - offset;
+        ptr = buffer + offset;
+        return filled < untilEnd ? filled : untilEnd;
+    }
+
+    void consume(size_t n)
+    {
+        tail.store(tail.load(std::memory_order_relaxed) + n, std::memory_order_release);
+    }
+
+private:
+    OTARingBuffer(const OTARingBuffer &);
+    OTARingBuffer &operator=(const OTARingBuffer &);
+
+    uint8_t *buffer;
+    size_t capacity;
+    std::atomic<size_t> head;
+    std::atomic<size_t> tail;
+};
+
+#endif
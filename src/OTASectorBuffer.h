@@ -0,0 +1,148 @@
+#ifndef OTA_SECTOR_BUFFER_H
+#define OTA_SECTOR_BUFFER_H
+
+#include <Arduino.h>
+#include <functional>
+
+// Collects image bytes into whole 4 KB flash sectors before OTAPartitionWriter
+// erases and programs them into the partition. Each block it hands
+// on starts on a sector boundary of the image. Whole sectors that are already
+// contiguous in the caller's data go through in one call without being
+// copied. So do bytes read straight into space(). Only the pieces that
+// straddle a sector are gathered in the buffer. flush() writes the short tail
+// at the end of the image.
+class OTASectorBuffer
+{
+public:
+    typedef std::function<bool(const uint8_t *data, size_t len)> Output;
+
+    static const size_t SECTOR_SIZE = 4096;
+
+    explicit OTASectorBuffer(Output output)
+        : output(output), buffer(nullptr), external(nullptr), length(0), writeCalls(0), copiedBytes(0)
+    {
+    }
+
+    ~OTASectorBuffer()
+    {
+        release();
+    }
+
+    // A buffer of at least SECTOR_SIZE bytes to use instead of allocating one;
+    // it must outlive every image written through this object. Null goes back
+    // to allocating.
+    void useBuffer(uint8_t *sectorBuffer)
+    {
+        release();
+        external = sectorBuffer;
+    }
+
+    // Starts an image; the buffer is allocated once here and kept until release()
+    bool begin()
+    {
+        length = 0;
+        writeCalls = 0;
+        copiedBytes = 0;
+        if (!buffer)
+        {
+            buffer = external ? external : (uint8_t *)malloc(SECTOR_SIZE);
+        }
+        return buffer != nullptr;
+    }
+
+    // Room left in the sector being assembled. Bytes placed there and then
+    // passed to write() from that same address are taken without a copy.
+    uint8_t *space(size_t &room)
+    {
+        room = SECTOR_SIZE - length;
+        return buffer + length;
+    }
+
+    bool write(const uint8_t *data, size_t len)
+    {
+        if (data == buffer + length && len <= SECTOR_SIZE - length)
+        {
+            length += len;
+            if (length < SECTOR_SIZE)
+            {
+                return true;
+            }
+            length = 0;
+            return emit(buffer, SECTOR_SIZE);
+        }
+        if (length > 0)
+        {
+            size_t take = min(len, SECTOR_SIZE - length);
+            memcpy(buffer + length, data, take);
+            copiedBytes += take;
+            length += take;
+            data += take;
+            len -= take;
+            if (length < SECTOR_SIZE)
+            {
+                return true;
+            }
+            length = 0;
+            if (!emit(buffer, SECTOR_SIZE))
+            {
+                return false;
+            }
+        }
+
+        size_t whole = len - len % SECTOR_SIZE;
+        if (whole > 0 && !emit(data, whole))
+        {
+            return false;
+        }
+        if (len > whole)
+        {
+            memcpy(buffer, data + whole, len - whole);
+            copiedBytes += len - whole;
+            length = len - whole;
+        }
+        return true;
+    }
+
+    // Writes the partial sector left at the end of the image
+    bool flush()
+    {
+        size_t tail = length;
+        length = 0;
+        return tail == 0 || emit(buffer, tail);
+    }
+
+    // Drops buffered bytes and gives back an allocated buffer
+    void release()
+    {
+        if (buffer != external)
+        {
+            free(buffer);
+        }
+        buffer = nullptr;
+        length = 0;
+    }
+
+    size_t buffered() const { return length; }
+    // Calls into the flash layer and bytes gathered in the buffer since begin()
+    uint32_t writes() const { return writeCalls; }
+    uint32_t copied() const { return copiedBytes; }
+
+private:
+    OTASectorBuffer(const OTASectorBuffer &);
+    OTASectorBuffer &operator=(const OTASectorBuffer &);
+
+    bool emit(const uint8_t *data, size_t len)
+    {
+        writeCalls++;
+        return output(data, len);
+    }
+
+    Output output;
+    uint8_t *buffer;
+    uint8_t *external;
+    size_t length;
+    uint32_t writeCalls;
+    uint32_t copiedBytes;
+};
+
+#endif
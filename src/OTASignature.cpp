@@ -0,0 +1,94 @@
+#include "OTASignature.h"
+#include <mbedtls/ecp.h>
+
+// mbedtls 2.x (arduino-esp32 2.x) doesn't rename private struct members
+#ifndef MBEDTLS_PRIVATE
+#define MBEDTLS_PRIVATE(member) member
+#endif
+
+namespace
+{
+    int hexValue(char c)
+    {
+        if (c >= '0' && c <= '9')
+        {
+            return c - '0';
+        }
+        c |= 0x20; // lower case
+        if (c >= 'a' && c <= 'f')
+        {
+            return c - 'a' + 10;
+        }
+        return -1;
+    }
+}
+
+OTASignature::OTASignature() : hasKey(false), errorMessage("")
+{
+    mbedtls_pk_init(&key);
+}
+
+OTASignature::~OTASignature()
+{
+    mbedtls_pk_free(&key);
+}
+
+bool OTASignature::setPublicKey(const char *pem)
+{
+    mbedtls_pk_free(&key);
+    mbedtls_pk_init(&key);
+    hasKey = false;
+    // The PEM parser wants the terminating NUL counted in the length
+    if (mbedtls_pk_parse_public_key(&key, (const unsigned char *)pem, strlen(pem) + 1) != 0)
+    {
+        errorMessage = "public key could not be parsed";
+        return false;
+    }
+    if (!mbedtls_pk_can_do(&key, MBEDTLS_PK_ECDSA))
+    {
+        errorMessage = "public key is not an EC key";
+        return false;
+    }
+    if (mbedtls_pk_ec(key)->MBEDTLS_PRIVATE(grp).id != MBEDTLS_ECP_DP_SECP256R1)
+    {
+        errorMessage = "public key is not on the P-256 curve";
+        return false;
+    }
+    hasKey = true;
+    return true;
+}
+
+bool OTASignature::verify(const uint8_t digest[32], const String &signatureHex)
+{
+    if (!hasKey)
+    {
+        errorMessage = "no public key configured";
+        return false;
+    }
+
+    size_t length = signatureHex.length() / 2;
+    if (signatureHex.length() == 0 || signatureHex.length() % 2 != 0 || length > MAX_SIGNATURE_SIZE)
+    {
+        errorMessage = "missing or malformed signature";
+        return false;
+    }
+    uint8_t signature[MAX_SIGNATURE_SIZE];
+    for (size_t i = 0; i < length; i++)
+    {
+        int high = hexValue(signatureHex[i * 2]);
+        int low = hexValue(signatureHex[i * 2 + 1]);
+        if (high < 0 || low < 0)
+        {
+            errorMessage = "missing or malformed signature";
+            return false;
+        }
+        signature[i] = (high << 4) | low;
+    }
+
+    if (mbedtls_pk_verify(&key, MBEDTLS_MD_SHA256, digest, 32, signature, length) != 0)
+    {
+        errorMessage = "signature does not match the image";
+        return false;
+    }
+    return true;
+}
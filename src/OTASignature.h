@@ -0,0 +1,33 @@
+#ifndef OTA_SIGNATURE_H
+#define OTA_SIGNATURE_H
+
+#include <Arduino.h>
+#include <mbedtls/pk.h>
+
+// Checks a detached ECDSA P-256 signature against the SHA-256 an OTADigest
+// computed while the image was written, so no extra pass over flash is needed.
+// Signatures are DER encoded and passed around as hex, as produced by
+// tools/otasign.py (or `openssl dgst -sha256 -sign key.pem image.bin`).
+class OTASignature
+{
+public:
+    OTASignature();
+    ~OTASignature();
+
+    // PEM P-256 public key; other curves and RSA keys are refused. The string
+    // must stay valid only for the duration of the call.
+    bool setPublicKey(const char *pem);
+    bool configured() const { return hasKey; }
+    bool verify(const uint8_t digest[32], const String &signatureHex);
+    const char *error() const { return errorMessage; }
+
+    // Largest DER encoding of a P-256 signature
+    static const size_t MAX_SIGNATURE_SIZE = 72;
+
+private:
+    mbedtls_pk_context key;
+    bool hasKey;
+    const char *errorMessage;
+};
+
+#endif
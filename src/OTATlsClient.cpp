@@ -0,0 +1,379 @@
+#include "OTATlsClient.h"
+#include "OTADigest.h"
+
+namespace
+{
+    // Survives deep sleep but not a power cycle; zeroed on cold boot
+    RTC_DATA_ATTR uint8_t rtcSession[OTA_TLS_SESSION_CACHE_SIZE];
+    RTC_DATA_ATTR uint16_t rtcSessionLength;
+    RTC_DATA_ATTR uint16_t rtcSessionPort;
+    RTC_DATA_ATTR char rtcSessionHost[64];
+    // SHA-256 of the CA certificate and pinned key the session was verified under
+    RTC_DATA_ATTR uint8_t rtcSessionTrust[32];
+
+    const unsigned long DEFAULT_CONNECT_TIMEOUT = 5000;
+}
+
+OTATlsClient::OTATlsClient()
+    : configured(false), hasCA(false), sessionSaved(false), active(false), peerClosed(false), peeked(-1),
+      certificatesSeen(0), pinMatched(false), resumed(false), handshakeMs(0), errorMessage("")
+{
+    mbedtls_ssl_init(&ssl);
+    mbedtls_ssl_config_init(&conf);
+    mbedtls_entropy_init(&entropy);
+    mbedtls_ctr_drbg_init(&drbg);
+    mbedtls_x509_crt_init(&ca);
+    memset(caDigest, 0, sizeof(caDigest));
+}
+
+OTATlsClient::~OTATlsClient()
+{
+    stop();
+    mbedtls_ssl_free(&ssl);
+    mbedtls_ssl_config_free(&conf);
+    mbedtls_ctr_drbg_free(&drbg);
+    mbedtls_entropy_free(&entropy);
+    mbedtls_x509_crt_free(&ca);
+}
+
+bool OTATlsClient::setCACert(const char *pem)
+{
+    mbedtls_x509_crt_free(&ca);
+    mbedtls_x509_crt_init(&ca);
+    // The PEM parser wants the terminating NUL counted in the length
+    hasCA = mbedtls_x509_crt_parse(&ca, (const unsigned char *)pem, strlen(pem) + 1) == 0;
+    configured = false;
+    memset(caDigest, 0, sizeof(caDigest));
+    if (!hasCA)
+    {
+        errorMessage = "CA certificate could not be parsed";
+    }
+    else
+    {
+        OTADigest digest;
+        digest.begin();
+        digest.update((const uint8_t *)pem, strlen(pem));
+        memcpy(caDigest, digest.finish(), sizeof(caDigest));
+    }
+    if (sessionSaved)
+    {
+        forgetSession();
+    }
+    return hasCA;
+}
+
+void OTATlsClient::setPinnedKey(const String &sha256Hex)
+{
+    pinnedKey = sha256Hex;
+    pinnedKey.toLowerCase();
+    configured = false;
+    if (sessionSaved)
+    {
+        forgetSession();
+    }
+}
+
+void OTATlsClient::forgetSession()
+{
+    rtcSessionLength = 0;
+    sessionSaved = false;
+}
+
+// Identifies the trust settings, so a session verified under others isn't resumed
+void OTATlsClient::trustDigest(uint8_t digest[32])
+{
+    OTADigest trust;
+    trust.begin();
+    trust.update(caDigest, sizeof(caDigest));
+    trust.update((const uint8_t *)pinnedKey.c_str(), pinnedKey.length());
+    memcpy(digest, trust.finish(), 32);
+}
+
+int OTATlsClient::fail(const char *message)
+{
+    errorMessage = message;
+    stop();
+    return 0;
+}
+
+// Config and RNG are set up on first use and after the trust settings change
+bool OTATlsClient::prepare(const char *host)
+{
+    if (!configured)
+    {
+        mbedtls_ssl_config_free(&conf);
+        mbedtls_ssl_config_init(&conf);
+        if (mbedtls_ctr_drbg_seed(&drbg, mbedtls_entropy_func, &entropy, nullptr, 0) != 0 ||
+            mbedtls_ssl_config_defaults(&conf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                        MBEDTLS_SSL_PRESET_DEFAULT) != 0)
+        {
+            return false;
+        }
+        // With only a pin the chain can't verify; the pin is checked after the handshake instead
+        mbedtls_ssl_conf_authmode(&conf, hasCA ? MBEDTLS_SSL_VERIFY_REQUIRED : MBEDTLS_SSL_VERIFY_OPTIONAL);
+        if (hasCA)
+        {
+            mbedtls_ssl_conf_ca_chain(&conf, &ca, nullptr);
+        }
+        mbedtls_ssl_conf_rng(&conf, mbedtls_ctr_drbg_random, &drbg);
+        mbedtls_ssl_conf_verify(&conf, verifyCallback, this);
+        mbedtls_ssl_conf_session_tickets(&conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+        configured = true;
+    }
+
+    mbedtls_ssl_free(&ssl);
+    mbedtls_ssl_init(&ssl);
+    if (mbedtls_ssl_setup(&ssl, &conf) != 0 || mbedtls_ssl_set_hostname(&ssl, host) != 0)
+    {
+        return false;
+    }
+    mbedtls_ssl_set_bio(&ssl, this, sendCallback, recvCallback, nullptr);
+    return true;
+}
+
+int OTATlsClient::connect(IPAddress ip, uint16_t port)
+{
+    // The host name is needed for SNI and certificate checks
+    return fail("connect by address is not supported, use a host name");
+}
+
+int OTATlsClient::connect(const char *host, uint16_t port)
+{
+    return connect(host, port, DEFAULT_CONNECT_TIMEOUT);
+}
+
+int OTATlsClient::connect(const char *host, uint16_t port, int32_t timeout)
+{
+    stop();
+    if (!hasCA && pinnedKey.length() == 0)
+    {
+        return fail("no CA certificate or pinned key configured");
+    }
+    if (!WiFiClient::connect(host, port, timeout))
+    {
+        return fail("TCP connect failed");
+    }
+    if (!prepare(host))
+    {
+        return fail("TLS setup failed");
+    }
+
+    unsigned long start = millis();
+    bool offered = loadSession(host, port);
+    certificatesSeen = 0;
+    pinMatched = false;
+    int ret;
+    while ((ret = mbedtls_ssl_handshake(&ssl)) != 0)
+    {
+        if ((ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) ||
+            millis() - start > (unsigned long)timeout)
+        {
+            // A rejected or stale ticket shouldn't fail every later attempt too
+            forgetSession();
+            return fail("TLS handshake failed");
+        }
+        vTaskDelay(1);
+    }
+
+    // The server only sends (and we only verify) a certificate in a full handshake
+    resumed = offered && certificatesSeen == 0;
+    if (!resumed && pinnedKey.length() > 0 && !pinMatched)
+    {
+        forgetSession();
+        return fail("server key does not match the pinned key");
+    }
+    handshakeMs = millis() - start;
+    saveSession(host, port);
+    active = true;
+    peerClosed = false;
+    return 1;
+}
+
+bool OTATlsClient::loadSession(const char *host, uint16_t port)
+{
+    if (rtcSessionLength == 0 || rtcSessionPort != port || strncmp(rtcSessionHost, host, sizeof(rtcSessionHost)) != 0)
+    {
+        return false;
+    }
+    uint8_t trust[32];
+    trustDigest(trust);
+    if (memcmp(trust, rtcSessionTrust, sizeof(trust)) != 0)
+    {
+        forgetSession();
+        return false;
+    }
+    mbedtls_ssl_session session;
+    mbedtls_ssl_session_init(&session);
+    bool ok = mbedtls_ssl_session_load(&session, rtcSession, rtcSessionLength) == 0 &&
+              mbedtls_ssl_set_session(&ssl, &session) == 0;
+    mbedtls_ssl_session_free(&session);
+    if (!ok)
+    {
+        forgetSession();
+    }
+    return ok;
+}
+
+void OTATlsClient::saveSession(const char *host, uint16_t port)
+{
+    mbedtls_ssl_session session;
+    mbedtls_ssl_session_init(&session);
+    size_t length = 0;
+    rtcSessionLength = 0;
+    if (strlen(host) < sizeof(rtcSessionHost) && mbedtls_ssl_get_session(&ssl, &session) == 0 &&
+        mbedtls_ssl_session_save(&session, rtcSession, sizeof(rtcSession), &length) == 0)
+    {
+        strcpy(rtcSessionHost, host);
+        rtcSessionPort = port;
+        rtcSessionLength = length;
+        trustDigest(rtcSessionTrust);
+        sessionSaved = true;
+    }
+    mbedtls_ssl_session_free(&session);
+}
+
+int OTATlsClient::sendCallback(void *ctx, const unsigned char *buf, size_t len)
+{
+    OTATlsClient *self = static_cast<OTATlsClient *>(ctx);
+    size_t sent = self->WiFiClient::write(buf, len);
+    return sent > 0 ? (int)sent : MBEDTLS_ERR_NET_SEND_FAILED;
+}
+
+int OTATlsClient::recvCallback(void *ctx, unsigned char *buf, size_t len)
+{
+    OTATlsClient *self = static_cast<OTATlsClient *>(ctx);
+    int received = self->WiFiClient::read(buf, len);
+    if (received > 0)
+    {
+        return received;
+    }
+    return self->WiFiClient::connected() ? MBEDTLS_ERR_SSL_WANT_READ : MBEDTLS_ERR_NET_CONN_RESET;
+}
+
+int OTATlsClient::verifyCallback(void *ctx, mbedtls_x509_crt *crt, int depth, uint32_t *flags)
+{
+    OTATlsClient *self = static_cast<OTATlsClient *>(ctx);
+    self->certificatesSeen++;
+    if (depth == 0 && self->pinnedKey.length() > 0)
+    {
+        // The DER is written at the end of the buffer
+        uint8_t der[600];
+        int length = mbedtls_pk_write_pubkey_der(&crt->pk, der, sizeof(der));
+        if (length > 0)
+        {
+            OTADigest digest;
+            digest.begin();
+            digest.update(der + sizeof(der) - length, length);
+            self->pinMatched = digest.matches(self->pinnedKey);
+        }
+    }
+    return 0;
+}
+
+size_t OTATlsClient::write(uint8_t b)
+{
+    return write(&b, 1);
+}
+
+size_t OTATlsClient::write(const uint8_t *buf, size_t size)
+{
+    size_t written = 0;
+    while (active && written < size)
+    {
+        int ret = mbedtls_ssl_write(&ssl, buf + written, size - written);
+        if (ret > 0)
+        {
+            written += ret;
+        }
+        else if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE)
+        {
+            peerClosed = true;
+            break;
+        }
+    }
+    return written;
+}
+
+int OTATlsClient::available()
+{
+    if (!active)
+    {
+        return 0;
+    }
+    // A zero-length read pulls in and decrypts any record that has arrived
+    int ret = mbedtls_ssl_read(&ssl, nullptr, 0);
+    if (ret < 0 && ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE)
+    {
+        peerClosed = true;
+    }
+    return mbedtls_ssl_get_bytes_avail(&ssl) + (peeked >= 0 ? 1 : 0);
+}
+
+int OTATlsClient::read(uint8_t *buf, size_t size)
+{
+    if (!active || size == 0)
+    {
+        return -1;
+    }
+    size_t offset = 0;
+    if (peeked >= 0)
+    {
+        buf[offset++] = peeked;
+        peeked = -1;
+        if (offset == size)
+        {
+            return offset;
+        }
+    }
+    int ret = mbedtls_ssl_read(&ssl, buf + offset, size - offset);
+    if (ret > 0)
+    {
+        return offset + ret;
+    }
+    if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE)
+    {
+        peerClosed = true;
+    }
+    return offset > 0 ? (int)offset : -1;
+}
+
+int OTATlsClient::read()
+{
+    uint8_t b;
+    return read(&b, 1) == 1 ? b : -1;
+}
+
+int OTATlsClient::peek()
+{
+    if (peeked < 0)
+    {
+        peeked = read();
+    }
+    return peeked;
+}
+
+void OTATlsClient::flush()
+{
+    // WiFiClient::flush() would throw away undecrypted input
+}
+
+void OTATlsClient::stop()
+{
+    if (active)
+    {
+        mbedtls_ssl_close_notify(&ssl);
+    }
+    active = false;
+    peerClosed = false;
+    peeked = -1;
+    WiFiClient::stop();
+}
+
+uint8_t OTATlsClient::connected()
+{
+    if (!active)
+    {
+        return 0;
+    }
+    return peeked >= 0 || mbedtls_ssl_get_bytes_avail(&ssl) > 0 || (!peerClosed && WiFiClient::connected());
+}
@@ -0,0 +1,87 @@
+#ifndef OTA_TLS_CLIENT_H
+#define OTA_TLS_CLIENT_H
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/x509_crt.h>
+
+// Room in RTC slow memory for one serialized TLS session. It holds the
+// session ticket and, if mbedtls keeps it, the server certificate.
+#ifndef OTA_TLS_SESSION_CACHE_SIZE
+#define OTA_TLS_SESSION_CACHE_SIZE 2048
+#endif
+
+// HTTPS transport for HTTPClient that resumes the previous TLS session when it
+// reconnects to the same server. The session is kept in RTC memory, so a check
+// after waking from deep sleep skips the full handshake too.
+//
+// The server is authenticated by a CA certificate, by a pinned SHA-256 of its
+// public key (SubjectPublicKeyInfo DER), or by both; without either, connect()
+// refuses. TCP goes through the WiFiClient base, TLS records through mbedtls.
+class OTATlsClient : public WiFiClient
+{
+public:
+    OTATlsClient();
+    ~OTATlsClient();
+
+    // PEM; the string must stay valid while the client is in use. Changing
+    // the trust settings drops a session this client already saved; one
+    // cached before a sleep is only resumed under the same settings.
+    bool setCACert(const char *pem);
+    void setPinnedKey(const String &sha256Hex);
+    // Drops the cached session so the next connect does a full handshake
+    void forgetSession();
+
+    int connect(IPAddress ip, uint16_t port) override;
+    int connect(const char *host, uint16_t port) override;
+    int connect(const char *host, uint16_t port, int32_t timeout) override;
+    size_t write(uint8_t b) override;
+    size_t write(const uint8_t *buf, size_t size) override;
+    int available() override;
+    int read() override;
+    int read(uint8_t *buf, size_t size) override;
+    int peek() override;
+    void flush() override;
+    void stop() override;
+    uint8_t connected() override;
+
+    // Outcome of the last successful connect()
+    bool lastResumed() const { return resumed; }
+    unsigned long lastHandshakeMs() const { return handshakeMs; }
+    const char *error() const { return errorMessage; }
+
+private:
+    bool prepare(const char *host);
+    bool loadSession(const char *host, uint16_t port);
+    void saveSession(const char *host, uint16_t port);
+    void trustDigest(uint8_t digest[32]);
+    int fail(const char *message);
+    static int sendCallback(void *ctx, const unsigned char *buf, size_t len);
+    static int recvCallback(void *ctx, unsigned char *buf, size_t len);
+    static int verifyCallback(void *ctx, mbedtls_x509_crt *crt, int depth, uint32_t *flags);
+
+    mbedtls_ssl_context ssl;
+    mbedtls_ssl_config conf;
+    mbedtls_entropy_context entropy;
+    mbedtls_ctr_drbg_context drbg;
+    mbedtls_x509_crt ca;
+    bool configured;
+    bool hasCA;
+    uint8_t caDigest[32];
+    String pinnedKey;
+    bool sessionSaved; // by this client, under the current trust settings
+
+    bool active;
+    bool peerClosed;
+    int peeked;
+    uint16_t certificatesSeen;
+    bool pinMatched;
+    bool resumed;
+    unsigned long handshakeMs;
+    const char *errorMessage;
+};
+
+#endif
@@ -0,0 +1,120 @@
+#include "OTATransferReader.h"
+
+namespace
+{
+    // Smallest read; below this the per-call overhead dominates
+    const size_t MIN_READ_SIZE = 128;
+    // First read size, one full TCP segment
+    const size_t START_READ_SIZE = 1460;
+    // The read size is checked against the bytes that arrived in each window
+    const unsigned long RATE_WINDOW_MS = 250;
+}
+
+OTATransferReader::OTATransferReader(Stream &source, size_t length, size_t maxReadSize)
+    : source(source), total(length), left(length), maxChunk(max(maxReadSize, MIN_READ_SIZE)),
+      stallTimeoutMs(0), minRate(0), rateGraceMs(0), startedAt(millis()), idleSince(0),
+      windowStart(startedAt), windowBytes(0), state(length > 0 ? READING : DONE)
+{
+    chunk = min(START_READ_SIZE, maxChunk);
+    memset(&readStats, 0, sizeof(readStats));
+    readStats.minReadSize = chunk;
+    readStats.maxReadSize = chunk;
+}
+
+void OTATransferReader::setDeadlines(unsigned long stallTimeout, uint32_t rate, unsigned long graceMs)
+{
+    stallTimeoutMs = stallTimeout;
+    minRate = rate;
+    rateGraceMs = graceMs;
+}
+
+size_t OTATransferReader::read(uint8_t *dst, size_t maxLen)
+{
+    if (state != READING)
+    {
+        return 0;
+    }
+
+    unsigned long now = millis();
+    if (minRate > 0 && now - startedAt > rateGraceMs &&
+        (uint64_t)received() * 1000 < (uint64_t)minRate * (now - startedAt))
+    {
+        endGap(now);
+        state = TOO_SLOW;
+        return 0;
+    }
+
+    int ready = source.available();
+    if (ready <= 0)
+    {
+        if (idleSince == 0)
+        {
+            idleSince = now ? now : 1;
+        }
+        else if (stallTimeoutMs > 0 && now - idleSince > stallTimeoutMs)
+        {
+            endGap(now);
+            state = STALLED;
+            return 0;
+        }
+        // Let the network stack run instead of blocking in readBytes()
+        delay(1);
+        return 0;
+    }
+
+    size_t want = min(min(chunk, maxLen), min((size_t)ready, left));
+    size_t got = source.readBytes(dst, want);
+    if (got == 0)
+    {
+        return 0;
+    }
+    endGap(now);
+    left -= got;
+    readStats.reads++;
+    adapt(got, ready, now);
+    if (left == 0)
+    {
+        state = DONE;
+    }
+    return got;
+}
+
+void OTATransferReader::endGap(unsigned long now)
+{
+    if (idleSince == 0)
+    {
+        return;
+    }
+    uint32_t gap = now - idleSince;
+    idleSince = 0;
+    if (gap >= OTA_STALL_EVENT_MS)
+    {
+        readStats.stallEvents++;
+        readStats.stalledMs += gap;
+        readStats.longestGapMs = max(readStats.longestGapMs, gap);
+    }
+}
+
+void OTATransferReader::adapt(size_t got, size_t ready, unsigned long now)
+{
+    if (ready >= 2 * chunk && chunk < maxChunk)
+    {
+        // Data is piling up in the socket: take bigger bites
+        chunk = min(chunk * 2, maxChunk);
+    }
+
+    windowBytes += got;
+    if (now - windowStart >= RATE_WINDOW_MS)
+    {
+        // A slow link can't fill a big read in a window; smaller reads keep
+        // the flash writes and progress moving
+        if (windowBytes < chunk && chunk > MIN_READ_SIZE)
+        {
+            chunk = max(chunk / 2, MIN_READ_SIZE);
+        }
+        windowStart = now;
+        windowBytes = 0;
+    }
+    readStats.minReadSize = min(readStats.minReadSize, (uint32_t)chunk);
+    readStats.maxReadSize = max(readStats.maxReadSize, (uint32_t)chunk);
+}
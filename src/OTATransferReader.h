@@ -0,0 +1,78 @@
+#ifndef OTA_TRANSFER_READER_H
+#define OTA_TRANSFER_READER_H
+
+#include <Arduino.h>
+
+// A wait for data at least this long counts as a stall event, even if the
+// transfer recovers from it
+#ifndef OTA_STALL_EVENT_MS
+#define OTA_STALL_EVENT_MS 1000
+#endif
+
+// How the reads of the last transfer went
+struct OTAReadStats
+{
+    uint32_t reads;
+    uint32_t minReadSize; // range the adaptive read size moved through
+    uint32_t maxReadSize;
+    uint32_t stallEvents; // waits of OTA_STALL_EVENT_MS or more
+    uint32_t longestGapMs;
+    uint32_t stalledMs;   // summed over those waits
+};
+
+// Reads a response body in pieces sized to what the connection delivers. A
+// read only takes what available() reports, so it never sits in readBytes()
+// for the stream timeout. The read size doubles while data piles up faster
+// than it is taken and halves when a measuring window brings in less than
+// one read's worth. The reader gives up when no data arrives for the
+// inactivity deadline, or when the average rate since the start stays below
+// the floor after a grace period.
+class OTATransferReader
+{
+public:
+    enum Status
+    {
+        READING,
+        DONE,
+        STALLED, // no data for the inactivity deadline
+        TOO_SLOW // average rate below the floor
+    };
+
+    OTATransferReader(Stream &source, size_t length, size_t maxReadSize);
+
+    // A stallTimeout of 0 waits forever; a rate (bytes per second) of 0 disables the floor
+    void setDeadlines(unsigned long stallTimeout, uint32_t rate, unsigned long graceMs);
+
+    // Up to the current read size, at most maxLen, into dst. Returns 0 when
+    // nothing has arrived yet or the reader has stopped; see status().
+    size_t read(uint8_t *dst, size_t maxLen);
+
+    Status status() const { return state; }
+    bool done() const { return state != READING; }
+    bool failed() const { return state == STALLED || state == TOO_SLOW; }
+    size_t received() const { return total - left; }
+    size_t readSize() const { return chunk; }
+    unsigned long stallTimeout() const { return stallTimeoutMs; }
+    const OTAReadStats &stats() const { return readStats; }
+
+private:
+    void endGap(unsigned long now);
+    void adapt(size_t got, size_t ready, unsigned long now);
+
+    Stream &source;
+    size_t total;
+    size_t left;
+    size_t chunk;
+    size_t maxChunk;
+    unsigned long stallTimeoutMs;
+    uint32_t minRate;
+    unsigned long rateGraceMs;
+    unsigned long startedAt;
+    unsigned long idleSince; // first empty poll since the last data, 0 while data flows
+    unsigned long windowStart;
+    size_t windowBytes;
+    Status state;
+    OTAReadStats readStats;
+};
+
+#endif
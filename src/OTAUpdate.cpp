@@ -1,7 +1,202 @@
 #include "OTAUpdate.h"
+#include "OTARingBuffer.h"
+#include "OTADelta.h"
+#include "OTAInflate.h"
+#include "OTAPartitionWriter.h"
+#include "OTABundle.h"
+#include <Preferences.h>
+#include <ESPmDNS.h>
+#include <esp_ota_ops.h>
+#include <limits.h>
+
+namespace
+{
+    // State shared between the flash (consumer) task and the network (producer) task
+    struct PipelineJob
+    {
+        OTATransferReader *reader;
+        size_t produced;
+        OTARingBuffer *ring;
+        TaskHandle_t consumer;
+        std::atomic<bool> abort;
+        std::atomic<bool> finished;
+    };
+
+    // Host and port of an http:// or https:// URL; false for anything else
+    bool parseHttpUrl(const String &url, String &host, uint16_t &port, bool &secure)
+    {
+        secure = url.startsWith("https://");
+        if (!secure && !url.startsWith("http://"))
+        {
+            return false;
+        }
+        int start = secure ? 8 : 7;
+        int end = url.indexOf('/', start);
+        String authority = url.substring(start, end < 0 ? url.length() : end);
+        authority = authority.substring(authority.indexOf('@') + 1);
+        int colon = authority.indexOf(':');
+        port = (colon >= 0) ? authority.substring(colon + 1).toInt() : (secure ? 443 : 80);
+        host = (colon >= 0) ? authority.substring(0, colon) : authority;
+        return host.length() > 0;
+    }
+
+    // Longest Retry-After honoured, so a bad header can't park the fleet for good
+    const unsigned long MAX_RETRY_AFTER_MS = 24UL * 60 * 60 * 1000;
+
+    // Retry-After in delay-seconds form; an HTTP-date counts as absent
+    unsigned long parseRetryAfter(const String &value)
+    {
+        if (value.length() == 0)
+        {
+            return 0;
+        }
+        for (size_t i = 0; i < value.length(); i++)
+        {
+            if (!isDigit(value[i]))
+            {
+                return 0;
+            }
+        }
+        // More than five digits is past the cap anyway, and might overflow toInt()
+        if (value.length() > 5)
+        {
+            return MAX_RETRY_AFTER_MS;
+        }
+        return min((unsigned long)value.toInt() * 1000, MAX_RETRY_AFTER_MS);
+    }
+
+    // Fields of the manifest the device uses, at the top level or inside a
+    // channel; everything else is skipped by the parser without being stored
+    void addManifestFields(JsonVariant filter)
+    {
+        const char *images[] = {"firmware", "spiffs"};
+        const char *imageFields[] = {"url", "size", "sha256", "signature", "version", "sectors"};
+        const char *fields[] = {"firmware_version", "compression", "window_bits", "bundle",
+                                "spiffs_version", "spiffs_sectors", "sha256", "signature"};
+        for (const char *field : fields)
+        {
+            filter[field] = true;
+        }
+        for (const char *image : images)
+        {
+            for (const char *field : imageFields)
+            {
+                filter["images"][image][field] = true;
+            }
+        }
+        filter["deltas"][0]["from"] = true;
+        filter["deltas"][0]["url"] = true;
+    }
+
+    // The selected channel's entry for key, else the top-level one
+    JsonVariantConst manifestValue(JsonVariantConst root, JsonVariantConst channel, const char *key)
+    {
+        JsonVariantConst value = channel[key];
+        return value.isNull() ? root[key] : value;
+    }
+
+    // Result of the last good check. RTC_NOINIT memory survives software and
+    // watchdog resets as well as deep sleep; after power-on it holds garbage,
+    // which the magic and check word rule out.
+    struct StartupCache
+    {
+        uint32_t magic;
+        uint32_t version;
+        int64_t checkedAt; // system time in seconds, kept running by the RTC
+        uint32_t check;
+    };
+    RTC_NOINIT_ATTR StartupCache rtcStartupCache;
+    const uint32_t STARTUP_CACHE_MAGIC = 0x4f544143;
+
+    uint32_t startupCacheCheck(const StartupCache &cache)
+    {
+        return cache.magic ^ cache.version ^ (uint32_t)cache.checkedAt ^ (uint32_t)(cache.checkedAt >> 32) ^ 0x5a5a5a5a;
+    }
+
+    int64_t systemSeconds()
+    {
+        struct timeval now;
+        gettimeofday(&now, nullptr);
+        return now.tv_sec;
+    }
+
+    // Where an image starts in its partition; Update offsets FAT data images
+    size_t imageBase(int partitionType)
+    {
+        return partitionType == U_SPIFFS ? OTAFilesystem::imageOffset() : 0;
+    }
+
+    // Where sharing devices serve their running app image
+    const char *PEER_FIRMWARE_PATH = "/ota/firmware.bin";
+
+    // Checkpoints are written every this many committed bytes to spare NVS
+    const uint32_t CHECKPOINT_INTERVAL = 64 * 1024;
+
+    // Sector map: "OTAS", u8 version, u8 log2(sector size), 2 reserved, u32
+    // image length, then the SHA-256 of each sector (the last one may be short)
+    const size_t SECTOR_MAP_HEADER = 12;
+
+    uint32_t readLE32(const uint8_t *p)
+    {
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+
+    void pipelineProducerTask(void *arg)
+    {
+        PipelineJob *job = static_cast<PipelineJob *>(arg);
+
+        // The reader stops on its own once the body is in, or on a stall or a too slow link
+        while (!job->reader->done() && !job->abort.load())
+        {
+            uint8_t *dst;
+            size_t space = job->ring->writable(dst);
+            if (space == 0)
+            {
+                // Flash side is behind, give it a tick to drain
+                vTaskDelay(1);
+                continue;
+            }
+
+            size_t bytesRead = job->reader->read(dst, space);
+            if (bytesRead > 0)
+            {
+                job->ring->commit(bytesRead);
+                job->produced += bytesRead;
+                xTaskNotifyGive(job->consumer);
+            }
+        }
+
+        TaskHandle_t consumer = job->consumer;
+        job->finished.store(true);
+        xTaskNotifyGive(consumer);
+        vTaskDelete(NULL);
+    }
+}
+
 OTAUpdate::OTAUpdate(const String &serverUrl)
-    : serverUrl(serverUrl)
+    : serverUrl(serverUrl), pipelineBufferSize(16384), deltaPatcher(nullptr),
+      inflater(nullptr), inflateWindowBits(15), partitionWriter(nullptr), writerBase(0),
+      imagePartition(nullptr), imageLength(0),
+      stallTimeoutMs(15000),
+      minTransferRate(0), rateGraceMs(10000), maxResumeAttempts(3), transferStalled(false), peerFetch(false), hashing(false), digestVerified(false), imageHeadPending(false), imageHeadLength(0),
+      imagePartitionType(U_FLASH), transferStart(0), displayStart(0), transferRetries(0), connectionPort(0), state(OTA_IDLE),
+      asyncActive(false), autoReboot(true), eventQueue(nullptr), checkIntervalMs(0), checkJitterMs(0),
+      backoffMinMs(30000), backoffMaxMs(3600000), retryAfterMs(0), nextCheckAt(0), checkScheduled(false),
+      lastCheckFailed(false), checkFailures(0), startupMs(0)
 {
+    checkpoint.active = false;
+    checkpoint.headLength = 0;
+    memset(&manifestStats, 0, sizeof(manifestStats));
+    memset(&transferStats, 0, sizeof(transferStats));
+    memset(&syncStats, 0, sizeof(syncStats));
+    memset(&connectionStats, 0, sizeof(connectionStats));
+    memset(&requestTiming, 0, sizeof(requestTiming));
+    uploadState.inflater = nullptr;
+    uploadState.installed = false;
+    bundle.reader = nullptr;
+    bundle.writer = nullptr;
+    bundle.inflater = nullptr;
+    bundle.app = nullptr;
     firmwareUrl = serverUrl + "/firmware.bin";
     spiffsUrl = serverUrl + "/spiffs.bin";
 }
@@ -11,167 +206,1793 @@ void OTAUpdate::updateurl(const String &serve){
     spiffsUrl = serverUrl + "/spiffs.bin";
 }
 
+void OTAUpdate::setPipelineBufferSize(size_t bytes)
+{
+    pipelineBufferSize = bytes;
+}
+
+void OTAUpdate::setDecompressionWindowBits(uint8_t bits)
+{
+    inflateWindowBits = constrain(bits, 8, 15);
+}
+
+void OTAUpdate::setStallTimeout(unsigned long ms)
+{
+    stallTimeoutMs = ms;
+}
+
+void OTAUpdate::setMinTransferRate(uint32_t bytesPerSecond, unsigned long graceMs)
+{
+    minTransferRate = bytesPerSecond;
+    rateGraceMs = graceMs;
+}
+
+void OTAUpdate::setResumeAttempts(uint8_t attempts)
+{
+    maxResumeAttempts = attempts;
+}
+
+void OTAUpdate::setWriteBuffer(uint8_t *buffer)
+{
+    imageWriter.useBuffer(buffer);
+}
+
+bool OTAUpdate::setCACert(const char *pem)
+{
+    if (!tlsClient.setCACert(pem))
+    {
+        Serial.printf("❌ CA certificate rejected: %s\n", tlsClient.error());
+        return false;
+    }
+    return true;
+}
+
+void OTAUpdate::setPinnedKey(const String &sha256Hex)
+{
+    tlsClient.setPinnedKey(sha256Hex);
+}
+
+bool OTAUpdate::setSigningKey(const char *pem)
+{
+    if (!signatureCheck.setPublicKey(pem))
+    {
+        Serial.printf("❌ Signing key rejected: %s\n", signatureCheck.error());
+        return false;
+    }
+    return true;
+}
+
+void OTAUpdate::setDisplayRefresh(uint16_t minIntervalMs, bool partial)
+{
+    sink().setDisplayRefresh(minIntervalMs, partial);
+}
+
 void OTAUpdate::updateDisplayProgress(String heading, int progress)
 {
-    display.clearDisplay();
+    sink().progress(heading, progress);
+}
+
+void OTAUpdate::setFirmwareVersion(int major, int minor, int patch)
+{
+    currentFirmwareVersion[0] = major;
+    currentFirmwareVersion[1] = minor;
+    currentFirmwareVersion[2] = patch;
+}
+
+bool OTAUpdate::prepare()
+{
+    if (WiFi.status() != WL_CONNECTED)
+    {
+        Serial.println("❌ WiFi not connected. OTA update requires an active WiFi connection.");
+        return false;
+    }
+
+    if (!OTAFilesystem::mount(true))
+    {
+        Serial.printf("❌ %s Mount Failed\n", OTAFilesystem::name());
+    }
+    sink().begin();
+    return true;
+}
+
+void OTAUpdate::begin()
+{
+    unsigned long start = millis();
+    if (prepare())
+    {
+        runCheck();
+    }
+    startupMs = millis() - start;
+    Serial.printf("🚀 OTA startup took %lu ms\n", startupMs);
+}
+
+bool OTAUpdate::beginAsync()
+{
+    return prepare() && startUpdateCheck();
+}
+
+bool OTAUpdate::beginScheduled()
+{
+    if (!prepare())
+    {
+        return false;
+    }
+    nextCheckAt = millis() + (checkJitterMs ? random(checkJitterMs + 1) : 0);
+    checkScheduled = true;
+    return true;
+}
+
+void OTAUpdate::setCheckInterval(unsigned long intervalMs, unsigned long jitterMs)
+{
+    checkIntervalMs = intervalMs;
+    checkJitterMs = jitterMs;
+    if (intervalMs == 0)
+    {
+        checkScheduled = false;
+    }
+}
+
+void OTAUpdate::setRetryBackoff(unsigned long minMs, unsigned long maxMs)
+{
+    backoffMinMs = minMs;
+    backoffMaxMs = max(minMs, maxMs);
+}
+
+bool OTAUpdate::beginFast(uint32_t freshSeconds, unsigned long deferMs)
+{
+    unsigned long start = millis();
+    // Never format here: a mount failure is left for the application to handle
+    if (!OTAFilesystem::mount(false))
+    {
+        Serial.printf("⚠️ %s not mounted, leaving it unformatted.\n", OTAFilesystem::name());
+    }
+    sink().begin();
+
+    uint32_t age;
+    bool fresh = startupCacheAge(age) && age < freshSeconds;
+    // A fresh result only postpones the check until it goes stale
+    // (capped so the millis() comparison in loop() can't wrap)
+    unsigned long wait = fresh ? min(freshSeconds - age, (uint32_t)2000000) * 1000UL : deferMs;
+    nextCheckAt = millis() + wait;
+    checkScheduled = true;
+
+    startupMs = millis() - start;
+    if (fresh)
+    {
+        Serial.printf("🚀 OTA startup took %lu ms, last check %u s ago is still fresh\n", startupMs, age);
+    }
+    else
+    {
+        Serial.printf("🚀 OTA startup took %lu ms, checking in the background in %lu ms\n", startupMs, wait);
+    }
+    return !fresh;
+}
+
+uint32_t OTAUpdate::firmwareVersionKey() const
+{
+    return (currentFirmwareVersion[0] << 20) ^ (currentFirmwareVersion[1] << 10) ^ currentFirmwareVersion[2];
+}
+
+// Age of the cached result; false if there is none, it was for another firmware, or the clock went back
+bool OTAUpdate::startupCacheAge(uint32_t &ageSeconds) const
+{
+    int64_t now = systemSeconds();
+    if (rtcStartupCache.magic != STARTUP_CACHE_MAGIC || rtcStartupCache.check != startupCacheCheck(rtcStartupCache) ||
+        rtcStartupCache.version != firmwareVersionKey() || rtcStartupCache.checkedAt > now)
+    {
+        return false;
+    }
+    ageSeconds = now - rtcStartupCache.checkedAt;
+    return true;
+}
+
+// Called by every "nothing to do" outcome; anything else should be retried, so it isn't remembered
+void OTAUpdate::storeStartupCache()
+{
+    rtcStartupCache.magic = STARTUP_CACHE_MAGIC;
+    rtcStartupCache.version = firmwareVersionKey();
+    rtcStartupCache.checkedAt = systemSeconds();
+    rtcStartupCache.check = startupCacheCheck(rtcStartupCache);
+}
+
+unsigned long OTAUpdate::nextCheckIn() const
+{
+    if (!checkScheduled)
+    {
+        return ULONG_MAX;
+    }
+    long remaining = (long)(nextCheckAt - millis());
+    return remaining > 0 ? remaining : 0;
+}
+
+void OTAUpdate::runCheck()
+{
+    checkForUpdates();
+    scheduleNextCheck();
+}
+
+// Picks the time of the next periodic check from the outcome of the last one
+void OTAUpdate::scheduleNextCheck()
+{
+    if (checkIntervalMs == 0 || state == OTA_REBOOT_PENDING)
+    {
+        checkScheduled = false;
+        return;
+    }
+
+    unsigned long wait;
+    if (lastCheckFailed)
+    {
+        // Exponential backoff with half of each step random, so failed devices don't retry in step
+        checkFailures = min(checkFailures + 1, 31);
+        unsigned long step = backoffMinMs;
+        for (uint8_t i = 1; i < checkFailures && step < backoffMaxMs; i++)
+        {
+            step *= 2;
+        }
+        step = min(step, backoffMaxMs);
+        wait = step / 2 + random(step / 2 + 1);
+    }
+    else
+    {
+        checkFailures = 0;
+        wait = checkIntervalMs + (checkJitterMs ? random(checkJitterMs + 1) : 0);
+    }
+    wait = max(wait, retryAfterMs);
+
+    nextCheckAt = millis() + wait;
+    checkScheduled = true;
+    Serial.printf("⏰ Next update check in %lu s%s\n", wait / 1000,
+                  lastCheckFailed ? " (backing off)" : "");
+}
+
+// Runs checkForUpdates in a background task; phase changes are queued and
+// delivered to the state callback from loop() on the caller's task
+bool OTAUpdate::startUpdateCheck()
+{
+    if (asyncActive)
+    {
+        return false;
+    }
+    if (!eventQueue)
+    {
+        eventQueue = xQueueCreate(8, sizeof(OTAEvent));
+    }
+
+    asyncActive = true;
+    if (!eventQueue || xTaskCreate(updateTask, "ota_check", 8192, this, uxTaskPriorityGet(NULL), NULL) != pdPASS)
+    {
+        Serial.println("❌ Could not start update task.");
+        asyncActive = false;
+        return false;
+    }
+    return true;
+}
+
+void OTAUpdate::updateTask(void *arg)
+{
+    OTAUpdate *self = static_cast<OTAUpdate *>(arg);
+    self->runCheck();
+    self->asyncActive = false;
+    vTaskDelete(NULL);
+}
+
+// Cheap enough to call every loop(): drains at most one queue's worth of
+// events and never touches the network itself
+OTAState OTAUpdate::loop()
+{
+    OTAEvent event;
+    for (int i = 0; i < 8 && eventQueue && xQueueReceive(eventQueue, &event, 0) == pdTRUE; i++)
+    {
+        if (stateCallback)
+        {
+            stateCallback(event.state, event.progress);
+        }
+    }
+
+    if (state == OTA_REBOOT_PENDING && autoReboot && !asyncActive)
+    {
+        Serial.println("🔄 Rebooting ESP32 to apply updates...");
+        ESP.restart();
+    }
+    if (checkScheduled && !asyncActive && (long)(millis() - nextCheckAt) >= 0 && WiFi.status() == WL_CONNECTED)
+    {
+        checkScheduled = false;
+        startUpdateCheck();
+    }
+    return state;
+}
+
+void OTAUpdate::onStateChange(OTAStateCallback callback)
+{
+    stateCallback = callback;
+}
 
-    // Set text size and color
-    display.setTextSize(1);
-    display.setTextColor(SSD1306_WHITE);
+void OTAUpdate::setAutoReboot(bool enabled)
+{
+    autoReboot = enabled;
+}
 
-    // Calculate center position for heading
-    int16_t x, y;
-    uint16_t w, h;
-    display.getTextBounds(heading, 0, 0, &x, &y, &w, &h);
-    int centerX = (display.width() - w) / 2;
+void OTAUpdate::setState(OTAState newState, int progress)
+{
+    state = newState;
+    if (asyncActive)
+    {
+        // Dropped if the sketch isn't draining; the latest state is still in getState()
+        OTAEvent event = {newState, progress};
+        xQueueSend(eventQueue, &event, 0);
+    }
+    else if (stateCallback)
+    {
+        stateCallback(newState, progress);
+    }
+}
 
-    // Draw centered heading
-    display.setCursor(centerX, 10);
-    display.print(heading);
+// Short status message; the hold time only applies to blocking checks on a
+// visual sink so a background check never sleeps on the display's behalf
+void OTAUpdate::showMessage(const char *line1, const char *line2, uint16_t holdMs)
+{
+    sink().message(line1, line2);
+    if (OTAProgressSink::visual && !asyncActive && holdMs > 0)
+    {
+        delay(holdMs);
+    }
+}
 
-    // Draw progress bar
-    int barX = 10;
-    int barY = 30;
-    int barWidth = 100;
-    int barHeight = 10;
+// Parses "major.minor.patch" in place, so a version straight out of the
+// manifest arena costs no allocation; anything after the patch is ignored
+bool OTAUpdate::stringToFirmware(const char *Firmware, int arr[3])
+{
+    const char *p = Firmware;
+    for (int i = 0; i < 3; i++)
+    {
+        char *end;
+        long part = (p && isDigit(*p)) ? strtol(p, &end, 10) : -1;
+        if (part < 0 || part > INT_MAX || (i < 2 && *end != '.'))
+        {
+            Serial.println("❌ Invalid firmware version format received.");
+            return false;
+        }
+        arr[i] = (int)part;
+        p = end + 1;
+    }
+    return true;
+}
 
-    display.drawRect(barX, barY, barWidth, barHeight, SSD1306_WHITE);
-    display.fillRect(barX, barY, (progress * barWidth) / 100, barHeight, SSD1306_WHITE);
+bool OTAUpdate::checkUpgradedVersion(int arr[])
+{
+    return (arr[0] > currentFirmwareVersion[0]) ||
+           (arr[0] == currentFirmwareVersion[0] && arr[1] > currentFirmwareVersion[1]) ||
+           (arr[0] == currentFirmwareVersion[0] && arr[1] == currentFirmwareVersion[1] && arr[2] > currentFirmwareVersion[2]);
+}
 
-    // Draw progress percentage below bar
-    String progressText = String(progress) + "%";
-    display.getTextBounds(progressText, 0, 0, &x, &y, &w, &h);
-    int progressTextX = (display.width() - w) / 2;
+// Sends the validators of the last manifest, but only while that manifest
+// did not call for an update, so a 304 can safely mean "nothing to do"
+bool OTAUpdate::addManifestConditions(HTTPClient &client)
+{
+    Preferences prefs;
+    if (!prefs.begin("otaupdate", true))
+    {
+        return false;
+    }
+    String etag = prefs.getString("mf_etag");
+    String lastModified = prefs.getString("mf_lastmod");
+    String version = prefs.getString("mf_version");
+    String cachedChannel = prefs.getString("mf_channel");
+    prefs.end();
+
+    // The version was read from one channel; another may still have something newer
+    if (version.length() == 0 || cachedChannel != channel || (etag.length() == 0 && lastModified.length() == 0))
+    {
+        return false;
+    }
+    int arr[3] = {0, 0, 0};
+    if (!stringToFirmware(version.c_str(), arr) || checkUpgradedVersion(arr))
+    {
+        return false;
+    }
 
-    display.setCursor(progressTextX, barY + barHeight + 5);
-    display.print(progressText);
+    if (etag.length() > 0)
+    {
+        client.addHeader("If-None-Match", etag);
+    }
+    if (lastModified.length() > 0)
+    {
+        client.addHeader("If-Modified-Since", lastModified);
+    }
+    return true;
+}
+
+void OTAUpdate::storeManifestValidators(HTTPClient &client, const char *version)
+{
+    Preferences prefs;
+    if (!prefs.begin("otaupdate", false))
+    {
+        return;
+    }
+    prefs.putString("mf_etag", client.header("ETag"));
+    prefs.putString("mf_lastmod", client.header("Last-Modified"));
+    prefs.putString("mf_version", version ? version : "");
+    prefs.putString("mf_channel", channel);
+    prefs.end();
+}
+
+// Every transfer loop funnels its data through here so compressed images are
+// inflated and patches applied before the bytes reach the partition writer
+bool OTAUpdate::writeChunk(const uint8_t *data, size_t len)
+{
+    unsigned long start = micros();
+    bool ok = bundle.reader ? bundle.reader->write(data, len)
+              : inflater    ? inflater->write(data, len)
+                            : writeDecoded(data, len);
+    uint32_t elapsed = micros() - start;
+
+    transferStats.bytes += len;
+    transferStats.chunks++;
+    transferStats.writeMicros += elapsed;
+    transferStats.minChunkMicros = min(transferStats.minChunkMicros, elapsed);
+    transferStats.maxChunkMicros = max(transferStats.maxChunkMicros, elapsed);
+    uint8_t bucket = 0;
+    for (uint32_t limit = 1000; bucket < 4 && elapsed >= limit; limit *= 4)
+    {
+        bucket++;
+    }
+    transferStats.latency[bucket]++;
+    transferStats.minFreeHeap = min(transferStats.minFreeHeap, ESP.getFreeHeap());
+    return ok;
+}
+
+void OTAUpdate::beginTransferStats()
+{
+    memset(&transferStats, 0, sizeof(transferStats));
+    transferStats.dnsMs = requestTiming.dnsMs;
+    transferStats.connectMs = requestTiming.connectMs;
+    transferStats.firstByteMs = requestTiming.firstByteMs;
+    transferStats.retries = transferRetries;
+    transferStats.minChunkMicros = UINT32_MAX;
+    transferStats.minFreeHeap = ESP.getFreeHeap();
+    // Request timings belong to one transfer; a local source has none
+    memset(&requestTiming, 0, sizeof(requestTiming));
+    displayStart = sink().ioMicros();
+    transferStart = millis();
+}
+
+void OTAUpdate::logTransferStats()
+{
+    transferStats.elapsedMs = millis() - transferStart;
+    transferStats.displayMicros = sink().ioMicros() - displayStart;
+    if (transferStats.chunks == 0)
+    {
+        transferStats.minChunkMicros = 0;
+    }
+    Serial.printf("⏱️ Request: DNS %u ms, connect %u ms, first byte %u ms%s\n",
+                  transferStats.dnsMs, transferStats.connectMs, transferStats.firstByteMs,
+                  transferStats.retries ? " (after retries)" : "");
+    Serial.printf("⏱️ Transfer: %u bytes in %u ms (%.1f KB/s), %u chunks, %u ms writing (%u ms flash), %u ms display\n",
+                  transferStats.bytes, transferStats.elapsedMs, transferStats.throughput() / 1024,
+                  transferStats.chunks, transferStats.writeMicros / 1000, transferStats.flashMicros / 1000,
+                  transferStats.displayMicros / 1000);
+    Serial.printf("⏱️ Chunk write min/avg/max %u/%u/%u us\n", transferStats.minChunkMicros,
+                  transferStats.averageChunkMicros(), transferStats.maxChunkMicros);
+    Serial.printf("⏱️ Chunk write times <1/<4/<16/<64/more ms: %u/%u/%u/%u/%u, min free heap %u\n",
+                  transferStats.latency[0], transferStats.latency[1], transferStats.latency[2],
+                  transferStats.latency[3], transferStats.latency[4], transferStats.minFreeHeap);
+    Serial.printf("⏱️ Reads: %u of %u-%u bytes, %u waits over %u ms (longest %u ms, %u ms in total)\n",
+                  transferStats.reads.reads, transferStats.reads.minReadSize, transferStats.reads.maxReadSize,
+                  transferStats.reads.stallEvents, (unsigned)OTA_STALL_EVENT_MS, transferStats.reads.longestGapMs,
+                  transferStats.reads.stalledMs);
+    Serial.printf("⏱️ Flash: %u write calls, %u bytes copied to assemble sectors\n",
+                  transferStats.flashWrites, transferStats.copiedBytes);
+}
+
+// Takes over the reader's counters and says why it stopped early, if it did.
+// Either reason counts as an interruption, so raw images get resumed.
+void OTAUpdate::endRead(const OTATransferReader &reader)
+{
+    transferStats.reads = reader.stats();
+    transferStats.stalled = reader.status() == OTATransferReader::STALLED;
+    transferStats.tooSlow = reader.status() == OTATransferReader::TOO_SLOW;
+    transferStalled = reader.failed();
+    if (transferStats.stalled)
+    {
+        Serial.printf("⚠️ No data for %lu ms, transfer stalled at %u bytes.\n", stallTimeoutMs, (unsigned)reader.received());
+    }
+    else if (transferStats.tooSlow)
+    {
+        Serial.printf("⚠️ Transfer below %u B/s after %lu ms, stopped at %u bytes.\n",
+                      minTransferRate, rateGraceMs, (unsigned)reader.received());
+    }
+}
+
+bool OTAUpdate::writeDecoded(const uint8_t *data, size_t len)
+{
+    if (deltaPatcher)
+    {
+        return deltaPatcher->write(data, len);
+    }
+    return writeImage(data, len);
+}
+
+// A data image for another filesystem would leave the partition unmountable.
+// Its first bytes are gathered and checked before any of them reach flash; a
+// zero length checks what there is, for images shorter than the head. An app
+// image only needs its magic byte, as Update used to check.
+bool OTAUpdate::checkImageHead(const uint8_t *data, size_t len)
+{
+    if (imagePartitionType != U_SPIFFS)
+    {
+        imageHeadPending = false;
+        if (len == 0 || data[0] != ESP_IMAGE_HEADER_MAGIC)
+        {
+            Serial.println("❌ Wrong magic byte, not a firmware image.");
+            return false;
+        }
+        return true;
+    }
+    if (len > 0)
+    {
+        size_t take = min(len, sizeof(imageHead) - imageHeadLength);
+        memcpy(imageHead + imageHeadLength, data, take);
+        imageHeadLength += take;
+        if (imageHeadLength < sizeof(imageHead))
+        {
+            return true;
+        }
+    }
+    imageHeadPending = false;
+    if (!OTAFilesystem::imageMatches(imageHead, imageHeadLength))
+    {
+        Serial.printf("❌ Data image is not a %s image.\n", OTAFilesystem::name());
+        return false;
+    }
+    return true;
+}
+
+// Final image bytes, after any inflating or patching
+bool OTAUpdate::writeImage(const uint8_t *data, size_t len)
+{
+    if (imageHeadPending && !checkImageHead(data, len))
+    {
+        return false;
+    }
+    if (hashing)
+    {
+        imageDigest.update(data, len);
+    }
+
+    if (checkpoint.active && checkpoint.headLength < sizeof(checkpoint.head))
+    {
+        // The first bytes of an app image are held back until the end, a resume has to write them itself
+        size_t take = min(len, sizeof(checkpoint.head) - checkpoint.headLength);
+        memcpy(checkpoint.head + checkpoint.headLength, data, take);
+        checkpoint.headLength += take;
+    }
+
+    const OTASectorBuffer &sectors = writer().sectorBuffer();
+    uint32_t writes = sectors.writes();
+    uint32_t copied = sectors.copied();
+    unsigned long start = micros();
+    bool ok = writer().write(data, len);
+    transferStats.flashMicros += micros() - start;
+    transferStats.flashWrites += sectors.writes() - writes;
+    transferStats.copiedBytes += sectors.copied() - copied;
+    if (!ok)
+    {
+        Serial.printf("❌ Flash write failed at offset %u.\n", (unsigned)writer().offset());
+    }
+    if (ok && checkpoint.active)
+    {
+        updateCheckpoint(false);
+    }
+    return ok;
+}
+
+void OTAUpdate::beginDigest()
+{
+    digestVerified = false;
+    imageHeadPending = false;
+    imageHeadLength = 0;
+    hashing = expectedDigest.length() > 0 || signatureCheck.configured();
+    if (hashing)
+    {
+        imageDigest.begin();
+    }
+}
+
+// Must be checked before the app header goes in and the boot partition switches so a
+// corrupted or unsigned image is never activated
+bool OTAUpdate::imageVerified()
+{
+    if (!hashing)
+    {
+        return !signatureCheck.configured();
+    }
+    hashing = false;
+    imageDigest.finish();
+    if (expectedDigest.length() > 0 && !imageDigest.matches(expectedDigest))
+    {
+        Serial.printf("❌ SHA-256 mismatch: got %s, expected %s\n", imageDigest.hex(), expectedDigest.c_str());
+        return false;
+    }
+    if (signatureCheck.configured() && !signatureCheck.verify(imageDigest.digest(), expectedSignature))
+    {
+        Serial.printf("❌ Image rejected: %s\n", signatureCheck.error());
+        return false;
+    }
+    Serial.printf("🔐 Image %s over %u bytes (%lu ms hashing)\n",
+                  signatureCheck.configured() ? "signature verified" : "SHA-256 verified",
+                  (unsigned)imageDigest.hashed(), imageDigest.hashMicros() / 1000);
+    digestVerified = true;
+    return true;
+}
+
+// Digest of the image last written to a partition, kept so an unchanged image
+// can be skipped. The app's is only valid while we run from the slot it was written to.
+String OTAUpdate::installedDigest(int partitionType)
+{
+    Preferences prefs;
+    if (!prefs.begin("otaupdate", true))
+    {
+        return "";
+    }
+    String digest;
+    if (partitionType == U_SPIFFS)
+    {
+        digest = prefs.getString("dg_spiffs");
+    }
+    else
+    {
+        const esp_partition_t *running = esp_ota_get_running_partition();
+        if (running && prefs.getUInt("dg_app_part") == running->address)
+        {
+            digest = prefs.getString("dg_app");
+        }
+    }
+    prefs.end();
+    return digest;
+}
+
+// Records the digest verified for the image just written; does nothing if none was computed
+void OTAUpdate::storeInstalledDigest(int partitionType, const esp_partition_t *partition)
+{
+    if (!digestVerified)
+    {
+        return;
+    }
+    Preferences prefs;
+    if (!prefs.begin("otaupdate", false))
+    {
+        return;
+    }
+    if (partitionType == U_SPIFFS)
+    {
+        prefs.putString("dg_spiffs", imageDigest.hex());
+    }
+    else if (partition)
+    {
+        prefs.putString("dg_app", imageDigest.hex());
+        prefs.putUInt("dg_app_part", partition->address);
+    }
+    prefs.end();
+}
+
+// SPIFFS is rewritten in place, so its recorded digest is void as soon as a write starts
+void OTAUpdate::forgetInstalledDigest(int partitionType)
+{
+    Preferences prefs;
+    if (partitionType == U_SPIFFS && prefs.begin("otaupdate", false))
+    {
+        prefs.remove("dg_spiffs");
+        prefs.remove("vr_spiffs");
+        prefs.end();
+    }
+}
+
+// True if the manifest's digest (or, failing that, SPIFFS version) matches what is installed
+bool OTAUpdate::imageCurrent(int partitionType)
+{
+    const String &digest = (partitionType == U_SPIFFS) ? manifestChecks.spiffsDigest : manifestChecks.firmwareDigest;
+    if (digest.length() > 0)
+    {
+        return digest.equalsIgnoreCase(installedDigest(partitionType));
+    }
+    if (partitionType == U_SPIFFS && manifestChecks.spiffsVersion.length() > 0)
+    {
+        Preferences prefs;
+        String installed;
+        if (prefs.begin("otaupdate", true))
+        {
+            installed = prefs.getString("vr_spiffs");
+            prefs.end();
+        }
+        return installed == manifestChecks.spiffsVersion;
+    }
+    return false;
+}
+
+void OTAUpdate::storeSpiffsVersion()
+{
+    Preferences prefs;
+    if (manifestChecks.spiffsVersion.length() > 0 && prefs.begin("otaupdate", false))
+    {
+        prefs.putString("vr_spiffs", manifestChecks.spiffsVersion);
+        prefs.end();
+    }
+}
+
+// An image whose published size can't fit its partition fails before anything is erased
+bool OTAUpdate::imageFits(int partitionType, uint32_t size)
+{
+    const esp_partition_t *partition = updateTargetPartition(partitionType);
+    if (size == 0 || !partition || imageBase(partitionType) + size <= partition->size)
+    {
+        return true;
+    }
+    Serial.printf("❌ %s image is %u bytes, its partition only holds %u.\n",
+                  partitionType == U_SPIFFS ? "SPIFFS" : "Firmware", (unsigned)size,
+                  (unsigned)(partition->size - imageBase(partitionType)));
+    return false;
+}
+
+// Opens a new image; every source goes through here and finishImage(). Its
+// sectors go straight into the partition, the way resumes and bundles write,
+// rather than through Update, which copies every byte into a buffer of its own.
+bool OTAUpdate::beginImage(size_t imageSize, int partitionType)
+{
+    imagePartitionType = partitionType;
+    forgetInstalledDigest(partitionType);
+    beginDigest();
+    imageHeadPending = true;
+    imagePartition = updateTargetPartition(partitionType);
+    imageLength = imageSize;
+    writerBase = imageBase(partitionType);
+    if (!imagePartition || (imageSize != UPDATE_SIZE_UNKNOWN && writerBase + imageSize > imagePartition->size))
+    {
+        Serial.println("❌ Not enough space for update.");
+        return false;
+    }
+    if (!imageWriter.begin(imagePartition, writerBase))
+    {
+        Serial.println("❌ Not enough memory for the sector buffer.");
+        return false;
+    }
+    // An app image only becomes bootable once its header goes in, last
+    if (partitionType == U_FLASH)
+    {
+        imageWriter.holdHeader(OTAPartitionWriter::HEADER_HOLD);
+    }
+    return true;
+}
+
+// Discards the image being written along with the sector still being assembled.
+// A held-back app header never reaches flash, so nothing written can boot.
+void OTAUpdate::abortImage()
+{
+    imageWriter.release();
+}
+
+// Activates the image if it verified, discards it otherwise. evenIfRemaining
+// is for images whose decoded size wasn't known up front.
+bool OTAUpdate::finishImage(bool evenIfRemaining)
+{
+    if (imageHeadPending && !checkImageHead(nullptr, 0))
+    {
+        abortImage();
+        return false;
+    }
+    size_t written = imageWriter.position() - writerBase;
+    if (!evenIfRemaining && written != imageLength)
+    {
+        Serial.printf("❌ Image ended after %u of %u bytes.\n", (unsigned)written, (unsigned)imageLength);
+        abortImage();
+        return false;
+    }
+    if (!imageVerified())
+    {
+        abortImage();
+        return false;
+    }
+    // The image's last, partial sector is still in the buffer, the app header after it
+    if (!imageWriter.finish())
+    {
+        Serial.println("❌ Flash write failed.");
+        abortImage();
+        return false;
+    }
+    imageWriter.release();
+    // The bootloader's checks of the whole image decide whether it is activated
+    if (imagePartitionType == U_FLASH && esp_ota_set_boot_partition(imagePartition) != ESP_OK)
+    {
+        Serial.println("❌ Firmware image did not validate.");
+        return false;
+    }
+    storeInstalledDigest(imagePartitionType, imagePartition);
+    return true;
+}
+
+void OTAUpdate::reportProgress(const String &heading, size_t written, size_t contentLength, int &lastProgress)
+{
+    if (!OTAProgressSink::enabled && !stateCallback && !eventQueue)
+    {
+        return;
+    }
+    int progress = (written * 100) / contentLength;
+    if (progress > lastProgress) // Report only if progress changed
+    {
+        lastProgress = progress;
+        sink().progress(heading, progress);
+        setState(state, progress);
+    }
+}
+
+OTAEncoding OTAUpdate::responseEncoding(OTAEncoding fallback)
+{
+    String contentEncoding = http.header("Content-Encoding");
+    if (contentEncoding.equalsIgnoreCase("gzip"))
+    {
+        return OTA_ENCODING_GZIP;
+    }
+    return fallback;
+}
+
+// Moves contentLength bytes from source into the image, inflating them on the
+// way when the image is gzip compressed
+bool OTAUpdate::transferToUpdate(Stream &source, size_t contentLength, const String &heading, OTAEncoding encoding)
+{
+    transferStalled = false;
+    sink().transferStarted(heading);
+    beginTransferStats();
+
+    bool ok = (encoding == OTA_ENCODING_GZIP) ? transferInflated(source, contentLength, heading)
+                                              : transferPipelined(source, contentLength, heading);
+
+    sink().transferFinished(ok);
+    logTransferStats();
+    return ok;
+}
+
+bool OTAUpdate::transferInflated(Stream &source, size_t contentLength, const String &heading)
+{
+    OTAInflater decoder([this](const uint8_t *data, size_t len)
+                        { return writeDecoded(data, len); },
+                        inflateWindowBits, OTASectorBuffer::SECTOR_SIZE);
+    if (!decoder.begin())
+    {
+        Serial.printf("❌ %s\n", decoder.error());
+        return false;
+    }
+
+    inflater = &decoder;
+    bool ok = transferPipelined(source, contentLength, heading);
+    inflater = nullptr;
+
+    if (!decoder.finished())
+    {
+        Serial.printf("❌ Decompression error: %s\n", decoder.failed() ? decoder.error() : "stream ended early");
+        return false;
+    }
+    Serial.printf("🗜️ Inflated %u -> %u bytes with %u bytes of RAM\n",
+                  (unsigned)contentLength, (unsigned)decoder.produced(), (unsigned)decoder.memoryUsage());
+    return ok;
+}
+
+// With a pipeline buffer configured, a network task fills the ring while this
+// task drains it into flash, so TCP receive and flash erase/program overlap
+// instead of alternating.
+bool OTAUpdate::transferPipelined(Stream &source, size_t contentLength, const String &heading)
+{
+    if (pipelineBufferSize == 0)
+    {
+        return transferDirect(source, contentLength, heading);
+    }
+
+    OTARingBuffer ring(pipelineBufferSize);
+    if (!ring.valid())
+    {
+        Serial.println("⚠️ Not enough memory for pipeline buffer, using direct transfer.");
+        return transferDirect(source, contentLength, heading);
+    }
+
+    OTATransferReader reader(source, contentLength, ring.size());
+    reader.setDeadlines(stallTimeoutMs, minTransferRate, rateGraceMs);
+    PipelineJob job;
+    job.reader = &reader;
+    job.produced = 0;
+    job.ring = &ring;
+    job.consumer = xTaskGetCurrentTaskHandle();
+    job.abort.store(false);
+    job.finished.store(false);
+
+    BaseType_t core = (portNUM_PROCESSORS > 1) ? 0 : tskNO_AFFINITY;
+    if (xTaskCreatePinnedToCore(pipelineProducerTask, "ota_net", 4096, &job,
+                                uxTaskPriorityGet(NULL), NULL, core) != pdPASS)
+    {
+        Serial.println("⚠️ Could not start network task, using direct transfer.");
+        return transferDirect(source, contentLength, heading);
+    }
+
+    size_t written = 0;
+    int lastProgress = -1;
+    bool ok = true;
+    // The ring is a whole number of sectors and starts at image byte 0, so
+    // taking only whole sectors until the end lets them bypass the sector buffer
+    const size_t sectorSize = OTASectorBuffer::SECTOR_SIZE;
+    bool wholeSectors = ring.size() >= 2 * sectorSize;
+    while (true)
+    {
+        const uint8_t *chunk;
+        size_t bytesReady = ring.readable(chunk);
+        if (wholeSectors && !job.finished.load())
+        {
+            bytesReady -= bytesReady % sectorSize;
+        }
+        if (bytesReady == 0)
+        {
+            if (job.finished.load() && ring.used() == 0)
+            {
+                break;
+            }
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(10));
+            continue;
+        }
+
+        if (!writeChunk(chunk, bytesReady))
+        {
+            ok = false;
+            break;
+        }
+        ring.consume(bytesReady);
+        written += bytesReady;
+        reportProgress(heading, written, contentLength, lastProgress);
+    }
+
+    // The job lives on this stack frame; wait until the network task is gone
+    job.abort.store(true);
+    while (!job.finished.load())
+    {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(10));
+    }
+
+    endRead(reader);
+    return ok && written == contentLength;
+}
+
+bool OTAUpdate::transferDirect(Stream &source, size_t contentLength, const String &heading)
+{
+    size_t written = 0;
+    uint8_t buffer[OTA_DIRECT_BUFFER_SIZE];
+    int lastProgress = -1;
+    bool ok = true;
+    // A raw image is read straight into the sector being assembled
+    bool inPlace = !inflater && !deltaPatcher && !bundle.reader;
+    OTATransferReader reader(source, contentLength, inPlace ? OTASectorBuffer::SECTOR_SIZE : sizeof(buffer));
+    reader.setDeadlines(stallTimeoutMs, minTransferRate, rateGraceMs);
+    while (!reader.done())
+    {
+        size_t room = sizeof(buffer);
+        uint8_t *dst = inPlace ? writer().space(room) : buffer;
+        size_t bytesRead = reader.read(dst, room);
+        if (bytesRead == 0)
+        {
+            continue;
+        }
+        if (!writeChunk(dst, bytesRead))
+        {
+            ok = false;
+            break;
+        }
+        written += bytesRead;
+        reportProgress(heading, written, contentLength, lastProgress);
+    }
+    endRead(reader);
+    return ok && written == contentLength;
+}
+
+bool OTAUpdate::performUpdate(const char *updateUrl, int partitionType, OTAEncoding encoding)
+{
+    for (uint8_t attempt = 0;; attempt++)
+    {
+        transferRetries = attempt;
+        TransferResult result = downloadImage(updateUrl, partitionType, encoding);
+        if (result != TRANSFER_INTERRUPTED || attempt >= maxResumeAttempts)
+        {
+            transferRetries = 0;
+            return result == TRANSFER_OK;
+        }
+        Serial.printf("🔁 Transfer interrupted, retrying (%u/%u)...\n", attempt + 1, maxResumeAttempts);
+    }
+}
+
+OTAUpdate::TransferResult OTAUpdate::downloadImage(const char *updateUrl, int partitionType, OTAEncoding encoding)
+{
+    const char *headerKeys[] = {"Content-Encoding", "ETag", "Content-Range", "Retry-After"};
+    beginRequest(updateUrl);
+    http.collectHeaders(headerKeys, 4);
+
+    // Only raw images can be continued, decoder state does not survive a reset
+    bool resuming = encoding == OTA_ENCODING_IDENTITY && loadCheckpoint(updateUrl, partitionType);
+    if (resuming)
+    {
+        // If-Range makes the server send the whole image instead if it changed since
+        http.addHeader("Range", "bytes=" + String(checkpoint.offset) + "-");
+        http.addHeader("If-Range", checkpoint.etag);
+    }
+
+    int httpCode = sendGet();
+    if (resuming && httpCode == HTTP_CODE_PARTIAL_CONTENT)
+    {
+        return resumeImage(partitionType);
+    }
+    if (httpCode != HTTP_CODE_OK)
+    {
+        Serial.printf("❌ Failed to fetch update. HTTP Code: %d\n", httpCode);
+        endRequest(false);
+        return TRANSFER_FAILED;
+    }
+
+    int contentLength = http.getSize();
+    WiFiClient *stream = http.getStreamPtr();
+    encoding = responseEncoding(encoding);
+
+    if (contentLength <= 0)
+    {
+        Serial.println("❌ Invalid update file.");
+        endRequest(false);
+        return TRANSFER_FAILED;
+    }
+
+    // A checkpoint left by the other partition's image stays for that image
+    // to resume; this one goes without, rather than take its place
+    bool otherCheckpoint = checkpointForOther(partitionType);
+    if (!otherCheckpoint)
+    {
+        clearCheckpoint();
+    }
+    String etag = http.header("ETag");
+    if (!otherCheckpoint && encoding == OTA_ENCODING_IDENTITY && etag.length() > 0 && !etag.startsWith("W/"))
+    {
+        startCheckpoint(updateUrl, etag, contentLength, partitionType);
+    }
+
+    // A compressed image's real size is only known once it has been inflated
+    size_t imageSize = (encoding == OTA_ENCODING_GZIP) ? UPDATE_SIZE_UNKNOWN : contentLength;
+    if (!beginImage(imageSize, partitionType))
+    {
+        checkpoint.active = false;
+        endRequest(false);
+        return TRANSFER_FAILED;
+    }
+
+    Serial.println("⬇️ Downloading update...");
+    String heading = (partitionType == U_FLASH) ? "Firmware OTA" : "SPIFFS OTA";
+    if (!transferToUpdate(*stream, contentLength, heading, encoding))
+    {
+        Serial.println("❌ Download failed.");
+        bool interrupted = transferStalled;
+        if (interrupted && checkpoint.active)
+        {
+            updateCheckpoint(true);
+        }
+        checkpoint.active = false;
+        abortImage();
+        endRequest(false);
+        return interrupted ? TRANSFER_INTERRUPTED : TRANSFER_FAILED;
+    }
+
+    Serial.println("✅ Download complete. Finalizing update...");
+    if (!otherCheckpoint)
+    {
+        clearCheckpoint();
+    }
+
+    if (!finishImage(encoding == OTA_ENCODING_GZIP))
+    {
+        endRequest(true);
+        return TRANSFER_FAILED;
+    }
+
+    Serial.println("✅ Update successful!");
+    endRequest(true);
+    return TRANSFER_OK;
+}
+
+// Continues a checkpointed download from a 206 response, writing straight
+// into the partition that was being filled before the interruption
+OTAUpdate::TransferResult OTAUpdate::resumeImage(int partitionType)
+{
+    String contentRange = http.header("Content-Range");
+    int slash = contentRange.lastIndexOf('/');
+    uint32_t total = (slash >= 0) ? contentRange.substring(slash + 1).toInt() : 0;
+    int contentLength = http.getSize();
+    const esp_partition_t *partition = updateTargetPartition(partitionType);
+
+    if (http.header("ETag") != checkpoint.etag || total != checkpoint.total ||
+        !contentRange.startsWith("bytes " + String(checkpoint.offset) + "-") ||
+        contentLength <= 0 || checkpoint.offset + contentLength != total ||
+        !partition || partition->address != checkpoint.partitionAddress ||
+        (partitionType == U_FLASH && checkpoint.headLength != sizeof(checkpoint.head)))
+    {
+        Serial.println("⚠️ Image or partition changed since the checkpoint, starting over.");
+        clearCheckpoint();
+        endRequest(false);
+        return TRANSFER_INTERRUPTED;
+    }
+
+    size_t base = imageBase(partitionType);
+    OTAPartitionWriter writer(partition, base + checkpoint.offset);
+    if (!writer.begin())
+    {
+        Serial.println("❌ Could not prepare partition for resume.");
+        clearCheckpoint();
+        endRequest(false);
+        return TRANSFER_FAILED;
+    }
+
+    // The digest covers the whole image; catch up on the part written before the
+    // interruption (an app image's first bytes are still held back in the checkpoint)
+    beginDigest();
+    if (hashing)
+    {
+        size_t skip = (partitionType == U_FLASH) ? checkpoint.headLength : 0;
+        imageDigest.update(checkpoint.head, skip);
+        if (!imageDigest.updateFromPartition(partition, base + skip, checkpoint.offset - skip))
+        {
+            Serial.println("❌ Could not read back the partially written image.");
+            clearCheckpoint();
+            endRequest(false);
+            return TRANSFER_FAILED;
+        }
+    }
+
+    Serial.printf("⏩ Resuming download at %u of %u bytes...\n", (unsigned)checkpoint.offset, (unsigned)total);
+    String heading = (partitionType == U_FLASH) ? "Firmware OTA" : "SPIFFS OTA";
+    partitionWriter = &writer;
+    writerBase = base;
+    bool ok = transferToUpdate(*http.getStreamPtr(), contentLength, heading);
+    if (!ok && transferStalled)
+    {
+        updateCheckpoint(true);
+    }
+    partitionWriter = nullptr;
+
+    if (!ok)
+    {
+        Serial.println("❌ Resumed transfer failed.");
+        bool interrupted = transferStalled;
+        if (!interrupted)
+        {
+            clearCheckpoint();
+        }
+        checkpoint.active = false;
+        endRequest(false);
+        return interrupted ? TRANSFER_INTERRUPTED : TRANSFER_FAILED;
+    }
+
+    bool finished = writer.finish() && imageVerified();
+    if (finished && partitionType == U_FLASH)
+    {
+        // Put back the held-back header bytes, then let the bootloader checks validate the whole image
+        finished = checkpoint.headLength == sizeof(checkpoint.head) &&
+                   esp_partition_write(partition, 0, checkpoint.head, checkpoint.headLength) == ESP_OK &&
+                   esp_ota_set_boot_partition(partition) == ESP_OK;
+    }
+    if (finished)
+    {
+        storeInstalledDigest(partitionType, partition);
+    }
+    clearCheckpoint();
+    endRequest(true);
+
+    if (!finished)
+    {
+        Serial.println("❌ Resumed image failed verification.");
+        return TRANSFER_FAILED;
+    }
+    Serial.println("✅ Update successful!");
+    return TRANSFER_OK;
+}
+
+const esp_partition_t *OTAUpdate::updateTargetPartition(int partitionType)
+{
+    if (partitionType == U_FLASH)
+    {
+        return esp_ota_get_next_update_partition(NULL);
+    }
+    return OTAFilesystem::partition();
+}
+
+bool OTAUpdate::loadCheckpoint(const char *url, int partitionType)
+{
+    Preferences prefs;
+    if (!prefs.begin("otaupdate", true))
+    {
+        return false;
+    }
+    checkpoint.url = prefs.getString("rs_url");
+    checkpoint.etag = prefs.getString("rs_etag");
+    checkpoint.total = prefs.getUInt("rs_total");
+    checkpoint.offset = prefs.getUInt("rs_offset");
+    checkpoint.partitionAddress = prefs.getUInt("rs_part");
+    checkpoint.partitionType = prefs.getInt("rs_type", -1);
+    checkpoint.headLength = prefs.getBytes("rs_head", checkpoint.head, sizeof(checkpoint.head));
+    prefs.end();
+
+    checkpoint.active = checkpoint.url == url && checkpoint.partitionType == partitionType &&
+                        checkpoint.etag.length() > 0 && checkpoint.offset > 0 && checkpoint.offset < checkpoint.total;
+    return checkpoint.active;
+}
+
+void OTAUpdate::startCheckpoint(const char *url, const String &etag, uint32_t total, int partitionType)
+{
+    const esp_partition_t *partition = updateTargetPartition(partitionType);
+    checkpoint.active = partition != nullptr;
+    checkpoint.url = url;
+    checkpoint.etag = etag;
+    checkpoint.total = total;
+    checkpoint.offset = 0;
+    checkpoint.partitionAddress = partition ? partition->address : 0;
+    checkpoint.partitionType = partitionType;
+    checkpoint.headLength = 0;
+}
+
+void OTAUpdate::updateCheckpoint(bool force)
+{
+    size_t committed = writer().offset() - writerBase;
+    if (committed <= checkpoint.offset || (!force && committed < checkpoint.offset + CHECKPOINT_INTERVAL))
+    {
+        return;
+    }
+    checkpoint.offset = committed;
+    storeCheckpoint();
+}
+
+void OTAUpdate::storeCheckpoint()
+{
+    Preferences prefs;
+    if (!prefs.begin("otaupdate", false))
+    {
+        return;
+    }
+    prefs.putString("rs_url", checkpoint.url);
+    prefs.putString("rs_etag", checkpoint.etag);
+    prefs.putUInt("rs_total", checkpoint.total);
+    prefs.putUInt("rs_part", checkpoint.partitionAddress);
+    prefs.putInt("rs_type", checkpoint.partitionType);
+    prefs.putBytes("rs_head", checkpoint.head, checkpoint.headLength);
+    prefs.putUInt("rs_offset", checkpoint.offset);
+    prefs.end();
+}
+
+// True if NVS holds a checkpoint for an image bound for the other partition
+bool OTAUpdate::checkpointForOther(int partitionType)
+{
+    Preferences prefs;
+    if (!prefs.begin("otaupdate", true))
+    {
+        return false;
+    }
+    bool other = prefs.getUInt("rs_offset") > 0 && prefs.getInt("rs_type", -1) != partitionType;
+    prefs.end();
+    return other;
+}
+
+void OTAUpdate::clearCheckpoint()
+{
+    checkpoint.active = false;
+    Preferences prefs;
+    if (prefs.begin("otaupdate", false))
+    {
+        prefs.remove("rs_offset");
+        prefs.end();
+    }
+}
+
+// Opens url on the shared client. Requests to the same host reuse one
+// keep-alive connection, and a new HTTPS connection resumes the last TLS session.
+bool OTAUpdate::beginRequest(const String &url)
+{
+    http.setReuse(true);
+    http.setTimeout(5000);
+    connectionStats.requests++;
+
+    String host;
+    uint16_t port;
+    bool secure;
+    if (!parseHttpUrl(url, host, port, secure))
+    {
+        connectionStats.connects++;
+        return http.begin(url);
+    }
+
+    WiFiClient &client = secure ? static_cast<WiFiClient &>(tlsClient) : netClient;
+    memset(&requestTiming, 0, sizeof(requestTiming));
+    if (client.connected() && host == connectionHost && port == connectionPort)
+    {
+        connectionStats.reused++;
+    }
+    else
+    {
+        // Connect here rather than in HTTPClient so DNS and the handshake can be
+        // timed; on failure HTTPClient retries and reports the error from GET()
+        netClient.stop();
+        tlsClient.stop();
+        unsigned long start = millis();
+        IPAddress address;
+        bool resolved = WiFi.hostByName(host.c_str(), address) == 1;
+        requestTiming.dnsMs = millis() - start;
+        start = millis();
+        // TLS needs the name for SNI; the lookup is cached by then
+        bool connected = resolved && (secure ? tlsClient.connect(host.c_str(), port) : netClient.connect(address, port));
+        requestTiming.connectMs = millis() - start;
+        if (connected)
+        {
+            connectionStats.connects++;
+            connectionStats.connectMs += requestTiming.dnsMs + requestTiming.connectMs;
+            connectionHost = host;
+            connectionPort = port;
+            if (secure && tlsClient.lastResumed())
+            {
+                connectionStats.resumedHandshakes++;
+                connectionStats.resumedHandshakeMs += tlsClient.lastHandshakeMs();
+            }
+            else if (secure)
+            {
+                connectionStats.fullHandshakes++;
+                connectionStats.fullHandshakeMs += tlsClient.lastHandshakeMs();
+            }
+        }
+        else if (!resolved)
+        {
+            Serial.printf("❌ DNS lookup for %s failed.\n", host.c_str());
+        }
+        else if (secure)
+        {
+            Serial.printf("❌ TLS connection to %s failed: %s\n", host.c_str(), tlsClient.error());
+        }
+    }
+    return http.begin(client, url);
+}
+
+// GET on the request opened by beginRequest, timing how long the headers take to arrive.
+// Callers collect Retry-After along with their own headers.
+int OTAUpdate::sendGet()
+{
+    unsigned long start = millis();
+    int httpCode = http.GET();
+    requestTiming.firstByteMs = millis() - start;
+    // An overloaded server sends 503 or 429 with Retry-After to spread the fleet out;
+    // the longest wait any request of a check asked for holds off the next one
+    retryAfterMs = max(retryAfterMs, parseRetryAfter(http.header("Retry-After")));
+    return httpCode;
+}
+
+// Only a fully read response leaves the connection usable for the next request
+void OTAUpdate::endRequest(bool reusable)
+{
+    if (!reusable)
+    {
+        netClient.stop();
+        tlsClient.stop();
+    }
+    http.end();
+}
+
+// Streams an OTAB bundle straight into the partitions it contains. The app is
+// only made bootable once every section has been written and verified, so a
+// failed bundle never switches firmware. SPIFFS is rewritten in place, so it
+// is only touched once the app section has verified; the two partitions still
+// change at different times, which a reset in between can expose.
+bool OTAUpdate::performBundleUpdate(const String &bundleUrl)
+{
+    const char *headerKeys[] = {"Retry-After"};
+    beginRequest(bundleUrl);
+    http.collectHeaders(headerKeys, 1);
+    int httpCode = sendGet();
+    if (httpCode != HTTP_CODE_OK)
+    {
+        Serial.printf("❌ Failed to fetch update bundle. HTTP Code: %d\n", httpCode);
+        endRequest(false);
+        return false;
+    }
+
+    int contentLength = http.getSize();
+    if (contentLength <= 0)
+    {
+        Serial.println("❌ Invalid update bundle.");
+        endRequest(false);
+        return false;
+    }
+
+    clearCheckpoint();
+    Serial.println("⬇️ Downloading update bundle...");
+    OTABundleReader reader([this](const OTABundleReader::Section &section)
+                           { return beginSection(section); },
+                           [this](const uint8_t *data, size_t len)
+                           { return bundle.inflater ? bundle.inflater->write(data, len) : writeImage(data, len); },
+                           [this](const OTABundleReader::Section &section)
+                           { return endSection(section); });
+    bundle.reader = &reader;
+    bundle.app = nullptr;
+    bundle.appDigest = "";
+    bool ok = transferToUpdate(*http.getStreamPtr(), contentLength, "Bundle OTA");
+    bundle.reader = nullptr;
+    releaseSection();
+    endRequest(ok);
+
+    if (!ok || !reader.finished())
+    {
+        Serial.printf("❌ Bundle error: %s\n", reader.failed() ? reader.error() : "stream ended early");
+        return false;
+    }
+    if (bundle.app && esp_ota_set_boot_partition(bundle.app) != ESP_OK)
+    {
+        Serial.println("❌ Bundled app image failed verification.");
+        return false;
+    }
+    if (bundle.app && bundle.appDigest.length() > 0)
+    {
+        Preferences prefs;
+        if (prefs.begin("otaupdate", false))
+        {
+            prefs.putString("dg_app", bundle.appDigest);
+            prefs.putUInt("dg_app_part", bundle.app->address);
+            prefs.end();
+        }
+    }
+    Serial.printf("✅ Bundle of %u sections applied.\n", reader.sectionCount());
+    return true;
+}
+
+bool OTAUpdate::beginSection(const OTABundleReader::Section &section)
+{
+    bool app = section.type == OTABundleReader::SECTION_APP;
+    int partitionType = app ? U_FLASH : U_SPIFFS;
+    // Two sections means an app one too (each type appears at most once)
+    if (!app && bundle.reader->sectionCount() > 1 && !bundle.app)
+    {
+        Serial.println("❌ Bundle has SPIFFS before the app; SPIFFS is only written after the app verifies.");
+        return false;
+    }
+    // Written with OTAPartitionWriter rather than Update so the app isn't
+    // activated until the whole bundle is through
+    forgetInstalledDigest(partitionType);
+    bundle.writer = new OTAPartitionWriter(updateTargetPartition(partitionType), imageBase(partitionType));
+    if (!bundle.writer->begin())
+    {
+        Serial.println("❌ No partition for bundle section.");
+        return false;
+    }
+    partitionWriter = bundle.writer;
+
+    if (section.encoding == OTABundleReader::ENCODING_GZIP)
+    {
+        bundle.inflater = new OTAInflater([this](const uint8_t *data, size_t len)
+                                          { return writeImage(data, len); },
+                                          inflateWindowBits, OTASectorBuffer::SECTOR_SIZE);
+        if (!bundle.inflater->begin())
+        {
+            Serial.printf("❌ %s\n", bundle.inflater->error());
+            return false;
+        }
+    }
+
+    // A digest in the bundle itself takes precedence over the manifest's
+    expectedDigest = app ? manifestChecks.firmwareDigest : manifestChecks.spiffsDigest;
+    if (section.hasDigest)
+    {
+        char hex[65];
+        for (int i = 0; i < 32; i++)
+        {
+            snprintf(hex + i * 2, 3, "%02x", section.sha256[i]);
+        }
+        expectedDigest = hex;
+    }
+    expectedSignature = app ? manifestChecks.firmwareSignature : manifestChecks.spiffsSignature;
+    beginDigest();
+    imagePartitionType = partitionType;
+    imageHeadPending = true;
+
+    Serial.printf("📦 %s section: %u bytes%s\n", app ? "App" : "SPIFFS", (unsigned)section.length,
+                  section.encoding == OTABundleReader::ENCODING_GZIP ? " (gzip)" : "");
+    return true;
+}
+
+bool OTAUpdate::endSection(const OTABundleReader::Section &section)
+{
+    bool ok = true;
+    if (bundle.inflater && !bundle.inflater->finished())
+    {
+        Serial.printf("❌ Decompression error: %s\n", bundle.inflater->failed() ? bundle.inflater->error() : "section ended early");
+        ok = false;
+    }
+    ok = ok && (!imageHeadPending || checkImageHead(nullptr, 0)) && bundle.writer->finish() && imageVerified();
+    if (ok && section.type == OTABundleReader::SECTION_APP)
+    {
+        bundle.app = bundle.writer->target();
+        bundle.appDigest = digestVerified ? imageDigest.hex() : "";
+    }
+    else if (ok)
+    {
+        storeInstalledDigest(U_SPIFFS, nullptr);
+        storeSpiffsVersion();
+    }
+    releaseSection();
+    return ok;
+}
+
+void OTAUpdate::releaseSection()
+{
+    partitionWriter = nullptr;
+    delete bundle.writer;
+    bundle.writer = nullptr;
+    delete bundle.inflater;
+    bundle.inflater = nullptr;
+    expectedDigest = "";
+    expectedSignature = "";
+    hashing = false;
+}
+
+// Brings SPIFFS up to date by rewriting only the 4 KB sectors that differ from
+// the published image. The local partition is hashed sector by sector as the
+// map streams in; each run of changed sectors is then fetched with one Range
+// request. The whole image is checked against the manifest digest afterwards,
+// so a failed sync falls back to a full download.
+bool OTAUpdate::performSpiffsSync(const String &mapUrl, const String &imageUrl)
+{
+    memset(&syncStats, 0, sizeof(syncStats));
+    const esp_partition_t *partition = updateTargetPartition(U_SPIFFS);
+    if (!partition || expectedDigest.length() == 0)
+    {
+        Serial.println("⚠️ Sector sync needs a SPIFFS partition and the manifest's sha256.");
+        return false;
+    }
+
+    const char *headerKeys[] = {"Retry-After"};
+    beginRequest(mapUrl);
+    http.collectHeaders(headerKeys, 1);
+    int httpCode = sendGet();
+    if (httpCode != HTTP_CODE_OK)
+    {
+        Serial.printf("❌ Failed to fetch sector map. HTTP Code: %d\n", httpCode);
+        endRequest(false);
+        return false;
+    }
+
+    const size_t sectorSize = OTAPartitionWriter::SECTOR_SIZE;
+    const size_t base = imageBase(U_SPIFFS);
+    WiFiClient *stream = http.getStreamPtr();
+    uint8_t header[SECTOR_MAP_HEADER];
+    uint32_t imageLength = 0;
+    if (stream->readBytes(header, sizeof(header)) == sizeof(header) && memcmp(header, "OTAS", 4) == 0 &&
+        header[4] == 1 && (1u << header[5]) == sectorSize)
+    {
+        imageLength = readLE32(header + 8);
+    }
+    uint32_t sectors = (imageLength + sectorSize - 1) / sectorSize;
+    if (imageLength == 0 || imageLength > partition->size - base || http.getSize() != (int)(sizeof(header) + sectors * 32))
+    {
+        Serial.println("❌ Invalid sector map.");
+        endRequest(false);
+        return false;
+    }
+
+    // One bit per sector that has to be rewritten
+    uint8_t *changed = (uint8_t *)calloc((sectors + 7) / 8, 1);
+    uint8_t *sector = (uint8_t *)malloc(sectorSize);
+    bool ok = changed && sector;
+    syncStats.imageBytes = imageLength;
+    syncStats.sectors = sectors;
+    syncStats.mapBytes = http.getSize();
+
+    // While every sector still matches, the same pass yields the image digest
+    beginDigest();
+    for (uint32_t i = 0; ok && i < sectors; i++)
+    {
+        uint8_t expected[32];
+        size_t offset = i * sectorSize;
+        size_t len = min(sectorSize, (size_t)imageLength - offset);
+        if (stream->readBytes(expected, sizeof(expected)) != sizeof(expected) ||
+            esp_partition_read(partition, base + offset, sector, len) != ESP_OK)
+        {
+            ok = false;
+            break;
+        }
+        unsigned long start = micros();
+        OTADigest local;
+        local.begin();
+        local.update(sector, len);
+        imageDigest.update(sector, len);
+        syncStats.hashMs += (micros() - start) / 1000;
+        if (memcmp(local.finish(), expected, sizeof(expected)) != 0)
+        {
+            changed[i / 8] |= 1 << (i % 8);
+            syncStats.changedSectors++;
+        }
+    }
+    free(sector);
+    endRequest(ok);
+    if (!ok)
+    {
+        Serial.println("❌ Could not compare SPIFFS with the sector map.");
+        free(changed);
+        return false;
+    }
+
+    Serial.printf("🧩 SPIFFS: %u of %u sectors changed (%u ms hashing)\n",
+                  (unsigned)syncStats.changedSectors, (unsigned)sectors, (unsigned)syncStats.hashMs);
+    if (syncStats.changedSectors > 0)
+    {
+        forgetInstalledDigest(U_SPIFFS);
+        sink().transferStarted("SPIFFS sync");
+        for (uint32_t i = 0; ok && i < sectors;)
+        {
+            if (!(changed[i / 8] & (1 << (i % 8))))
+            {
+                i++;
+                continue;
+            }
+            uint32_t end = i;
+            while (end < sectors && (changed[end / 8] & (1 << (end % 8))))
+            {
+                end++;
+            }
+            ok = fetchSectors(partition, imageUrl, i * sectorSize, min((size_t)end * sectorSize, (size_t)imageLength));
+            i = end;
+        }
+        sink().transferFinished(ok);
 
-    // Display changes
-    display.display();
-}
+        beginDigest();
+        ok = ok && imageDigest.updateFromPartition(partition, base, imageLength);
+    }
+    free(changed);
 
-void OTAUpdate::setFirmwareVersion(int major, int minor, int patch)
-{
-    currentFirmwareVersion[0] = major;
-    currentFirmwareVersion[1] = minor;
-    currentFirmwareVersion[2] = patch;
+    if (!ok || !imageVerified())
+    {
+        Serial.println("❌ SPIFFS sector sync failed.");
+        return false;
+    }
+    storeInstalledDigest(U_SPIFFS, partition);
+    Serial.printf("✅ SPIFFS synced: %u sectors rewritten in %u requests, %u bytes fetched, %u bytes saved\n",
+                  (unsigned)syncStats.changedSectors, (unsigned)syncStats.requests,
+                  (unsigned)syncStats.bytesFetched, (unsigned)syncStats.bytesSaved());
+    return true;
 }
 
-void OTAUpdate::begin()
+// Fetches image bytes [from, to) of the raw SPIFFS image into the same place in the partition
+bool OTAUpdate::fetchSectors(const esp_partition_t *partition, const String &imageUrl, size_t from, size_t to)
 {
-    if (WiFi.status() != WL_CONNECTED)
+    const char *headerKeys[] = {"Content-Range", "Retry-After"};
+    String range = String(from) + "-" + String(to - 1);
+    beginRequest(imageUrl);
+    http.collectHeaders(headerKeys, 2);
+    http.addHeader("Range", "bytes=" + range);
+    syncStats.requests++;
+
+    int httpCode = sendGet();
+    if (httpCode != HTTP_CODE_PARTIAL_CONTENT || http.getSize() != (int)(to - from) ||
+        !http.header("Content-Range").startsWith("bytes " + range + "/"))
     {
-        Serial.println("❌ WiFi not connected. OTA update requires an active WiFi connection.");
-        return;
+        Serial.printf("❌ Range request for bytes %s failed. HTTP Code: %d\n", range.c_str(), httpCode);
+        endRequest(false);
+        return false;
     }
 
-    if (!SPIFFS.begin(true))
+    OTAPartitionWriter writer(partition, imageBase(U_SPIFFS) + from);
+    WiFiClient *stream = http.getStreamPtr();
+    uint8_t buffer[OTA_DIRECT_BUFFER_SIZE];
+    size_t written = 0;
+    OTATransferReader reader(*stream, to - from, sizeof(buffer));
+    reader.setDeadlines(stallTimeoutMs, minTransferRate, rateGraceMs);
+    bool ok = writer.begin();
+    while (ok && !reader.done())
+    {
+        size_t bytesRead = reader.read(buffer, sizeof(buffer));
+        if (bytesRead > 0)
+        {
+            ok = writer.write(buffer, bytesRead);
+            written += bytesRead;
+        }
+    }
+    if (reader.failed())
     {
-        Serial.println("❌ SPIFFS Mount Failed");
+        Serial.printf("⚠️ Sector fetch %s at %u of %u bytes.\n",
+                      reader.status() == OTATransferReader::STALLED ? "stalled" : "too slow",
+                      (unsigned)written, (unsigned)(to - from));
+        ok = false;
     }
-    display.begin(SSD1306_SWITCHCAPVCC, 0x3c, -1);
-    checkForUpdates();
+    ok = ok && writer.finish();
+    syncStats.bytesFetched += written;
+    endRequest(ok);
+    return ok;
 }
 
-void OTAUpdate::stringToFirmware(const String &Firmware, int arr[3])
+String OTAUpdate::resolveUrl(const String &path)
 {
-    int firstDot = Firmware.indexOf('.');
-    int secondDot = Firmware.lastIndexOf('.');
-
-    if (firstDot == -1 || secondDot == -1 || firstDot == secondDot)
+    if (path.startsWith("http://") || path.startsWith("https://"))
     {
-        Serial.println("❌ Invalid firmware version format received.");
-        return;
+        return path;
     }
-
-    arr[0] = Firmware.substring(0, firstDot).toInt();
-    arr[1] = Firmware.substring(firstDot + 1, secondDot).toInt();
-    arr[2] = Firmware.substring(secondDot + 1).toInt();
+    return serverUrl + (path.startsWith("/") ? "" : "/") + path;
 }
 
-bool OTAUpdate::checkUpgradedVersion(int arr[])
+// Picks the patch in "deltas" that was built from the version we are running
+String OTAUpdate::findDeltaUrl(JsonVariantConst deltas)
 {
-    return (arr[0] > currentFirmwareVersion[0]) ||
-           (arr[0] == currentFirmwareVersion[0] && arr[1] > currentFirmwareVersion[1]) ||
-           (arr[0] == currentFirmwareVersion[0] && arr[1] == currentFirmwareVersion[1] && arr[2] > currentFirmwareVersion[2]);
+    for (JsonVariantConst delta : deltas.as<JsonArrayConst>())
+    {
+        const char *from = delta["from"];
+        const char *url = delta["url"];
+        int version[3];
+        if (from && url && stringToFirmware(from, version) &&
+            memcmp(version, currentFirmwareVersion, sizeof(version)) == 0)
+        {
+            return resolveUrl(url);
+        }
+    }
+    return "";
 }
 
-bool OTAUpdate::performUpdate(const char *updateUrl, int partitionType)
+// Downloads an OTAD patch and rebuilds the new firmware on the fly from the
+// running app partition. Only the fixed patcher state is held in RAM.
+bool OTAUpdate::performDeltaUpdate(const String &patchUrl)
 {
-    
-    http.setTimeout(5000);
-    http.begin(updateUrl);
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    String runningMd5 = ESP.getSketchMD5();
 
-    int httpCode = http.GET();
+    const char *headerKeys[] = {"Content-Encoding", "Retry-After"};
+    beginRequest(patchUrl);
+    http.collectHeaders(headerKeys, 2);
+
+    int httpCode = sendGet();
     if (httpCode != HTTP_CODE_OK)
     {
-        Serial.printf("❌ Failed to fetch update. HTTP Code: %d\n", httpCode);
-        http.end();
+        Serial.printf("❌ Failed to fetch delta patch. HTTP Code: %d\n", httpCode);
+        endRequest(false);
         return false;
     }
 
     int contentLength = http.getSize();
-    WiFiClient *stream = http.getStreamPtr();
-
     if (contentLength <= 0)
     {
-        Serial.println("❌ Invalid update file.");
-        http.end();
+        Serial.println("❌ Invalid delta patch.");
+        endRequest(false);
         return false;
     }
 
-    if (!Update.begin(contentLength, partitionType))
+    clearCheckpoint();
+    if (!beginImage(UPDATE_SIZE_UNKNOWN, U_FLASH))
     {
-        Serial.println("❌ Not enough space for update.");
-        http.end();
+        endRequest(false);
         return false;
     }
 
-    Serial.println("⬇️ Downloading update...");
-    int written = 0;
-    uint8_t buffer[128];
-    int lastProgress = -1; // Store last progress to prevent duplicate prints
-    String heading;
-    if (partitionType == U_FLASH)
-    {
-        heading = "Firmware OTA";
-    }
-    if (partitionType == U_SPIFFS)
-    {
-        heading = "SPIFFS OTA";
-    }
-    while (written < contentLength)
-    {
-        int bytesRead = stream->readBytes(buffer, sizeof(buffer));
-        if (bytesRead > 0)
-        {
-            Update.write(buffer, bytesRead);
-            written += bytesRead;
+    Serial.println("⬇️ Applying delta patch...");
+    OTADeltaPatcher patcher(running, runningMd5, [this](const uint8_t *data, size_t len)
+                            { return writeImage(data, len); });
+    deltaPatcher = &patcher;
+    bool transferred = transferToUpdate(*http.getStreamPtr(), contentLength, "Delta OTA", responseEncoding(OTA_ENCODING_IDENTITY));
+    deltaPatcher = nullptr;
 
-            int progress = (written * 100) / contentLength;
-            if (progress > lastProgress) // Print only if progress changed
-            {
-                Serial.printf("📊 Progress: %d%%\n", progress);
-                lastProgress = progress;
-                updateDisplayProgress(heading, progress);
-            }
-        }
+    if (!transferred || !patcher.finished())
+    {
+        Serial.printf("❌ Delta patch error: %s\n", patcher.failed() ? patcher.error() : "patch ended early");
+        abortImage();
+        endRequest(false);
+        return false;
     }
 
-    Serial.println("✅ Download complete. Finalizing update...");
-
-    if (!Update.end() || Update.hasError())
+    if (!finishImage(true))
     {
-        Serial.printf("❌ Update error: %s\n", Update.errorString());
-        http.end();
+        endRequest(true);
         return false;
     }
 
-    Serial.println("✅ Update successful!");
-    http.end();
+    Serial.printf("✅ Delta update successful! %u patch bytes -> %u image bytes\n", (unsigned)contentLength, (unsigned)patcher.produced());
+    endRequest(true);
     return true;
 }
-bool OTAUpdate::performUpdateFromFile(Stream &updateStream, size_t contentLength, int partitionType)
+
+bool OTAUpdate::performUpdateFromFile(Stream &updateStream, size_t contentLength, int partitionType, OTAEncoding encoding)
 {
     if (contentLength <= 0)
     {
@@ -179,49 +2000,26 @@ bool OTAUpdate::performUpdateFromFile(Stream &updateStream, size_t contentLength
         return false;
     }
 
-    if (!Update.begin(contentLength, partitionType))
+    clearCheckpoint();
+    size_t imageSize = (encoding == OTA_ENCODING_GZIP) ? UPDATE_SIZE_UNKNOWN : contentLength;
+    if (!beginImage(imageSize, partitionType))
     {
-        Serial.println("❌ Not enough space for update.");
         return false;
     }
 
     Serial.println("⬇️ Applying update from stream...");
-    size_t written = 0;
-    uint8_t buffer[128];
-    int lastProgress = -1;
-    String heading;
-    if (partitionType == U_FLASH)
-    {
-        heading = "Firmware OTA";
-    }
-    if (partitionType == U_SPIFFS)
-    {
-        heading = "SPIFFS OTA";
-    }
-    while (written < contentLength)
+    String heading = (partitionType == U_FLASH) ? "Firmware OTA" : "SPIFFS OTA";
+    if (!transferToUpdate(updateStream, contentLength, heading, encoding))
     {
-        size_t bytesRead = updateStream.readBytes(buffer, sizeof(buffer));
-        if (bytesRead > 0)
-        {
-            Update.write(buffer, bytesRead);
-            written += bytesRead;
-
-            int progress = (written * 100) / contentLength;
-            if (progress > lastProgress)
-            {
-                Serial.printf("📊 Progress: %d%%\n", progress);
-                lastProgress = progress;
-                updateDisplayProgress(heading, progress);
-                display.display(); // Ensure update is pushed to OLED
-            }
-        }
+        Serial.println("❌ Update from stream failed.");
+        abortImage();
+        return false;
     }
 
     Serial.println("✅ File update complete. Finalizing...");
 
-    if (!Update.end() || Update.hasError())
+    if (!finishImage(encoding == OTA_ENCODING_GZIP))
     {
-        Serial.printf("❌ Update error: %s\n", Update.errorString());
         return false;
     }
 
@@ -341,6 +2139,7 @@ void OTAUpdate::checkForUpdates()
 {
     bool ESPUPGRADED = false;
     Serial.println("🔍 Checking for firmware update...");
+    setState(OTA_CHECKING);
 
     // display.clearDisplay();
     // display.setTextSize(1);
@@ -351,22 +2150,87 @@ void OTAUpdate::checkForUpdates()
     // display.print("Updates...");
     // display.display();
 
-    HTTPClient http;
-    http.setTimeout(5000);
-    http.begin(serverUrl + "/config.json");
+    const char *headerKeys[] = {"ETag", "Last-Modified", "Retry-After"};
+    beginRequest(serverUrl + "/config.json");
+    http.collectHeaders(headerKeys, 3);
+    addManifestConditions(http);
 
-    int httpCode = http.GET();
+    manifestStats.requests++;
+    retryAfterMs = 0;
+    int httpCode = sendGet();
+    lastCheckFailed = httpCode != HTTP_CODE_OK && httpCode != HTTP_CODE_NOT_MODIFIED;
+    if (httpCode == HTTP_CODE_NOT_MODIFIED)
+    {
+        manifestStats.notModified++;
+        Serial.printf("✅ Manifest unchanged, already up-to-date. (cache hits %u/%u)\n",
+                      manifestStats.notModified, manifestStats.requests);
+        setState(OTA_UP_TO_DATE);
+        storeStartupCache();
+        endRequest(true);
+        return;
+    }
     if (httpCode == HTTP_CODE_OK)
     {
-        String input = http.getString();
-        JsonDocument doc;
-
-        DeserializationError error = deserializeJson(doc, input);
-
-        if (error)
+        manifestStats.fullFetches++;
+        manifestStats.freeHeapBefore = ESP.getFreeHeap();
+        manifestStats.maxBlockBefore = ESP.getMaxAllocHeap();
+
+        // Both documents live in the fixed arena, and the filter keeps only
+        // the fields used below, so parsing leaves the heap as it found it
+        manifestArena.reset();
+        JsonDocument filter(&manifestArena);
+        addManifestFields(filter);
+        if (channel.length() > 0)
+        {
+            addManifestFields(filter["channels"][channel.c_str()]);
+        }
+        JsonDocument doc(&manifestArena);
+        DeserializationError error;
+        bool bodyRead = true;
+        int length = http.getSize();
+        if (length >= 0)
+        {
+            OTABodyStream body(*http.getStreamPtr(), length);
+            error = deserializeJson(doc, body, DeserializationOption::Filter(filter));
+            bodyRead = body.drain();
+        }
+        else
+        {
+            // A chunked body has to go through HTTPClient to lose its framing
+            error = deserializeJson(doc, http.getString(), DeserializationOption::Filter(filter));
+        }
+        manifestStats.arenaPeak = manifestArena.peak();
+        manifestStats.freeHeapAfter = ESP.getFreeHeap();
+        manifestStats.maxBlockAfter = ESP.getMaxAllocHeap();
+        Serial.printf("📄 Manifest parsed in %u of %u arena bytes. Heap free %u -> %u, largest block %u -> %u\n",
+                      (unsigned)manifestStats.arenaPeak, (unsigned)manifestArena.capacity(),
+                      manifestStats.freeHeapBefore, manifestStats.freeHeapAfter,
+                      manifestStats.maxBlockBefore, manifestStats.maxBlockAfter);
+
+        // A refused allocation means part of the manifest is missing
+        if (!error && manifestArena.failures() > 0)
+        {
+            error = DeserializationError::NoMemory;
+        }
+        JsonVariantConst root = doc;
+        JsonVariantConst selected = root["channels"][channel.c_str()];
+        const char *firmware_version = manifestValue(root, selected, "firmware_version");
+        int arr[3];
+        if (error || !stringToFirmware(firmware_version, arr))
         {
-            Serial.print("deserializeJson() failed: ");
-            Serial.println(error.c_str());
+            if (error)
+            {
+                Serial.print("deserializeJson() failed: ");
+                Serial.println(error.c_str());
+            }
+            if (error == DeserializationError::NoMemory)
+            {
+                Serial.println("⚠️ Manifest fields don't fit OTA_MANIFEST_ARENA_SIZE.");
+            }
+            manifestStats.failures++;
+            lastCheckFailed = true;
+            setState(OTA_FAILED);
+            endRequest(bodyRead);
 
             // display.clearDisplay();
             // display.setCursor(10, 10);
@@ -378,10 +2242,53 @@ void OTAUpdate::checkForUpdates()
             return;
         }
 
-        const char *firmware_version = doc["firmware_version"];
-        int arr[3];
-        stringToFirmware(firmware_version, arr);
-        Serial.printf("Found version: %s\n", firmware_version);
+        if (selected.isNull())
+        {
+            Serial.printf("Found version: %s\n", firmware_version);
+        }
+        else
+        {
+            Serial.printf("Found version: %s (channel %s)\n", firmware_version, channel.c_str());
+        }
+        storeManifestValidators(http, firmware_version);
+        // The body has been read; the image requests below reuse the connection
+        endRequest(bodyRead);
+        String deltaUrl = findDeltaUrl(manifestValue(root, selected, "deltas"));
+        // Per-image entries; the older top-level sha256/signature/spiffs_* fields still work
+        JsonVariantConst firmwareImage = manifestValue(root, selected, "images")["firmware"];
+        JsonVariantConst spiffsImage = manifestValue(root, selected, "images")["spiffs"];
+        // SHA-256 of the decoded images, checked whichever way they are delivered
+        manifestChecks.firmwareDigest = firmwareImage["sha256"] | (manifestValue(root, selected, "sha256")["firmware"] | "");
+        manifestChecks.spiffsDigest = spiffsImage["sha256"] | (manifestValue(root, selected, "sha256")["spiffs"] | "");
+        manifestChecks.firmwareSignature = firmwareImage["signature"] | (manifestValue(root, selected, "signature")["firmware"] | "");
+        manifestChecks.spiffsSignature = spiffsImage["signature"] | (manifestValue(root, selected, "signature")["spiffs"] | "");
+        manifestChecks.spiffsVersion = spiffsImage["version"] | (manifestValue(root, selected, "spiffs_version") | "");
+        String bundleUrl = manifestValue(root, selected, "bundle") | "";
+        String sectorsUrl = spiffsImage["sectors"] | (manifestValue(root, selected, "spiffs_sectors") | "");
+        uint32_t firmwareSize = firmwareImage["size"] | 0u;
+        uint32_t spiffsSize = spiffsImage["size"] | 0u;
+
+        // Images may be published gzip compressed next to the raw ones
+        OTAEncoding imageEncoding = OTA_ENCODING_IDENTITY;
+        String imageSuffix;
+        String compression = manifestValue(root, selected, "compression") | "";
+        if (compression == "gzip")
+        {
+            imageEncoding = OTA_ENCODING_GZIP;
+            imageSuffix = ".gz";
+            JsonVariantConst windowBits = manifestValue(root, selected, "window_bits");
+            if (windowBits.is<int>())
+            {
+                setDecompressionWindowBits(windowBits.as<int>());
+            }
+        }
+        // An image's own url replaces the default name, suffix included
+        const char *firmwarePath = firmwareImage["url"];
+        const char *spiffsPath = spiffsImage["url"];
+        String firmwareImageUrl = firmwarePath ? resolveUrl(firmwarePath) : firmwareUrl + imageSuffix;
+        String spiffsImageUrl = spiffsPath ? resolveUrl(spiffsPath) : spiffsUrl + imageSuffix;
+        // Sector sync reads the raw image, which a url only names when nothing is compressed
+        String spiffsRawUrl = (spiffsPath && imageEncoding == OTA_ENCODING_IDENTITY) ? spiffsImageUrl : spiffsUrl;
 
         // display.clearDisplay();
         // display.setCursor(10, 10);
@@ -393,111 +2300,203 @@ void OTAUpdate::checkForUpdates()
 
         if (checkUpgradedVersion(arr))
         {
-            Serial.println("🔍 Checking for SPIFFS update first...");
-
-            // display.clearDisplay();
-            // display.setCursor(10, 10);
-            // display.print("Checking");
-            // display.setCursor(10, 20);
-            // display.print("SPIFFS Update...");
-            // display.display();
-
-            if (performUpdate(spiffsUrl.c_str(), U_SPIFFS))
+            // Partitions whose published image is already installed are left alone
+            bool spiffsCurrent = imageCurrent(U_SPIFFS);
+            bool firmwareCurrent = imageCurrent(U_FLASH);
+            // A published size that is too big fails that image without a download
+            bool spiffsFits = spiffsCurrent || imageFits(U_SPIFFS, spiffsSize);
+            bool firmwareFits = firmwareCurrent || imageFits(U_FLASH, firmwareSize);
+            // One request for all images; falls back to fetching them one by one.
+            // A sector map beats the bundle, which always carries all of SPIFFS.
+            bool bundled = false;
+            if (bundleUrl.length() > 0 && sectorsUrl.length() == 0 && !spiffsCurrent && !firmwareCurrent &&
+                spiffsFits && firmwareFits)
             {
-                Serial.println("✅ SPIFFS updated successfully.");
-                ESPUPGRADED = true;
-
-                display.clearDisplay();
-                display.setCursor(10, 10);
-                display.print("SPIFFS Updated");
-                display.display();
-                delay(1000);
+                Serial.println("📦 Update bundle available...");
+                setState(OTA_UPDATING_FIRMWARE);
+                bundled = performBundleUpdate(resolveUrl(bundleUrl));
+                if (bundled)
+                {
+                    Serial.println("✅ Bundle applied successfully.");
+                    ESPUPGRADED = true;
+
+                    showMessage("Bundle Updated", nullptr, 1000);
+                }
+                else
+                {
+                    Serial.println("⚠️ Bundle update failed, falling back to separate images.");
+                }
             }
-            else
+
+            if (!bundled)
             {
-                Serial.println("⚠️ No SPIFFS update available.");
-
-                display.clearDisplay();
-                display.setCursor(10, 10);
-                display.print("No SPIFFS");
-                display.setCursor(10, 20);
-                display.print("Update Found");
-                display.display();
-                delay(1000);
-            }
+                Serial.println("🔍 Checking for SPIFFS update first...");
+                setState(OTA_UPDATING_SPIFFS);
+
+                // display.clearDisplay();
+                // display.setCursor(10, 10);
+                // display.print("Checking");
+                // display.setCursor(10, 20);
+                // display.print("SPIFFS Update...");
+                // display.display();
+
+                expectedDigest = manifestChecks.spiffsDigest;
+                expectedSignature = manifestChecks.spiffsSignature;
+                bool spiffsUpdated = false;
+                if (spiffsCurrent)
+                {
+                    Serial.println("✅ SPIFFS image unchanged, skipping download.");
+                }
+                else if (sectorsUrl.length() > 0 && spiffsFits)
+                {
+                    Serial.println("🔍 Sector map available, syncing changed SPIFFS sectors...");
+                    spiffsUpdated = performSpiffsSync(resolveUrl(sectorsUrl), spiffsRawUrl);
+                    if (spiffsUpdated && syncStats.changedSectors == 0)
+                    {
+                        // Nothing was rewritten, so there is nothing to reboot for
+                        spiffsUpdated = false;
+                        spiffsCurrent = true;
+                    }
+                    else if (!spiffsUpdated)
+                    {
+                        Serial.println("⚠️ Sector sync failed, falling back to full image.");
+                    }
+                }
+                if (!spiffsUpdated && !spiffsCurrent && spiffsFits)
+                {
+                    spiffsUpdated = performUpdate(spiffsImageUrl.c_str(), U_SPIFFS, imageEncoding);
+                }
 
-            Serial.println("🔍 Checking for Firmware update...");
+                if (spiffsUpdated)
+                {
+                    Serial.println("✅ SPIFFS updated successfully.");
+                    storeSpiffsVersion();
+                    ESPUPGRADED = true;
 
-            display.clearDisplay();
-            display.setCursor(10, 10);
-            display.print("Checking");
-            display.setCursor(10, 20);
-            display.print("Firmware Update...");
-            display.display();
+                    showMessage("SPIFFS Updated", nullptr, 1000);
+                }
+                else
+                {
+                    Serial.println("⚠️ No SPIFFS update available.");
 
-            if (performUpdate(firmwareUrl.c_str(), U_FLASH))
-            {
-                Serial.println("✅ Firmware updated successfully.");
-                ESPUPGRADED = true;
-
-                display.clearDisplay();
-                display.setCursor(10, 10);
-                display.print("Firmware Updated");
-                display.display();
-                delay(1000);
+                    showMessage("No SPIFFS", "Update Found", 1000);
+                }
+
+                Serial.println("🔍 Checking for Firmware update...");
+                setState(OTA_UPDATING_FIRMWARE);
+
+                showMessage("Checking", "Firmware Update...", 0);
+
+                bool firmwareUpdated = false;
+                expectedDigest = manifestChecks.firmwareDigest;
+                expectedSignature = manifestChecks.firmwareSignature;
+                if (firmwareCurrent)
+                {
+                    Serial.println("✅ Firmware image already installed, skipping download.");
+                }
+                else if (!firmwareFits)
+                {
+                    Serial.println("⚠️ Firmware image skipped.");
+                }
+                else if (peerFetch && manifestChecks.firmwareDigest.length() > 0)
+                {
+                    // The manifest digest is what makes an image from a peer trustworthy
+                    String peerUrl = findPeerUrl(firmware_version);
+                    if (peerUrl.length() > 0)
+                    {
+                        firmwareUpdated = performUpdate(peerUrl.c_str(), U_FLASH);
+                        if (!firmwareUpdated)
+                        {
+                            Serial.println("⚠️ Peer download failed, falling back to the server.");
+                        }
+                    }
+                }
+                if (!firmwareUpdated && !firmwareCurrent && firmwareFits && deltaUrl.length() > 0)
+                {
+                    Serial.println("🔍 Delta patch available for this version...");
+                    firmwareUpdated = performDeltaUpdate(deltaUrl);
+                    if (!firmwareUpdated)
+                    {
+                        Serial.println("⚠️ Delta update failed, falling back to full image.");
+                    }
+                }
+                if (!firmwareUpdated && !firmwareCurrent && firmwareFits)
+                {
+                    firmwareUpdated = performUpdate(firmwareImageUrl.c_str(), U_FLASH, imageEncoding);
+                }
+                expectedDigest = "";
+                expectedSignature = "";
+
+                if (firmwareUpdated)
+                {
+                    Serial.println("✅ Firmware updated successfully.");
+                    ESPUPGRADED = true;
+
+                    showMessage("Firmware Updated", nullptr, 1000);
+                }
+                else
+                {
+                    Serial.println("⚠️ No firmware update available.");
+
+                    showMessage("No Firmware", "Update Found", 1000);
+                }
             }
-            else
+
+            Serial.printf("🔌 Connections: %u requests, %u reused, ~%u ms of connection setup saved\n",
+                          connectionStats.requests, connectionStats.reused, connectionStats.savedMs());
+            if (connectionStats.fullHandshakes + connectionStats.resumedHandshakes > 0)
             {
-                Serial.println("⚠️ No firmware update available.");
-
-                display.clearDisplay();
-                display.setCursor(10, 10);
-                display.print("No Firmware");
-                display.setCursor(10, 20);
-                display.print("Update Found");
-                display.display();
-                delay(1000);
+                Serial.printf("🔒 TLS: %u full handshakes (avg %u ms), %u resumed (avg %u ms)\n",
+                              connectionStats.fullHandshakes, connectionStats.averageFullHandshakeMs(),
+                              connectionStats.resumedHandshakes, connectionStats.averageResumedHandshakeMs());
             }
 
             if (ESPUPGRADED)
             {
-                Serial.println("🔄 Rebooting ESP32 to apply updates...");
-
-                display.clearDisplay();
-                display.setCursor(10, 10);
-                display.print("Rebooting...");
-                display.display();
-                delay(1000);
+                showMessage("Rebooting...", nullptr, 1000);
+                setState(OTA_REBOOT_PENDING);
+
+                // A background check leaves the reboot to loop() so the sketch sees the phase first
+                if (!asyncActive)
+                {
+                    Serial.println("🔄 Rebooting ESP32 to apply updates...");
+                    ESP.restart();
+                }
+            }
+            else if (spiffsCurrent && firmwareCurrent)
+            {
+                // Every published image is already installed
+                Serial.println("✅ Everything is already up-to-date.");
 
-                ESP.restart();
+                showMessage("Already", "Up-to-date", 2000);
+                setState(OTA_UP_TO_DATE);
+                storeStartupCache();
             }
             else
             {
-                Serial.println("✅ Everything is already up-to-date.");
+                Serial.println("❌ Update failed, nothing was installed.");
+                // A download or integrity failure backs off like a failed manifest fetch
+                lastCheckFailed = true;
 
-                display.clearDisplay();
-                display.setCursor(10, 10);
-                display.print("Already");
-                display.setCursor(10, 20);
-                display.print("Up-to-date");
-                display.display();
-                delay(2000);
+                showMessage("Update Error", "Install Failed", 2000);
+                setState(OTA_FAILED);
             }
         }
+        else
+        {
+            setState(OTA_UP_TO_DATE);
+            storeStartupCache();
+        }
     }
     else
     {
         Serial.println("❌ Failed to fetch version info.");
+        manifestStats.failures++;
 
-        display.clearDisplay();
-        display.setCursor(10, 10);
-        display.print("Update Error");
-        display.setCursor(10, 20);
-        display.print("Network Failed");
-        display.display();
-        delay(2000);
+        showMessage("Update Error", "Network Failed", 2000);
+        setState(OTA_FAILED);
+        endRequest(false);
     }
-    http.end();
 }
 
 // Handles POST request: Begins the update process
@@ -569,6 +2568,173 @@ void OTAUpdate::setupManualOTA(WebServer &server)
     server.on("/update", HTTP_POST, [this, &server]()
               { handleUpdatePost(server); }, [this, &server]()
               { handleUpdateUpload(server); });
+    server.on("/update/metrics", HTTP_GET, [this, &server]()
+              { handleMetrics(server); });
+}
+
+void OTAUpdate::handleMetrics(WebServer &server)
+{
+    JsonDocument doc;
+    doc["state"] = (int)state;
+
+    JsonObject transfer = doc["transfer"].to<JsonObject>();
+    transfer["dns_ms"] = transferStats.dnsMs;
+    transfer["connect_ms"] = transferStats.connectMs;
+    transfer["first_byte_ms"] = transferStats.firstByteMs;
+    transfer["bytes"] = transferStats.bytes;
+    transfer["elapsed_ms"] = transferStats.elapsedMs;
+    transfer["throughput"] = transferStats.throughput();
+    transfer["write_us"] = transferStats.writeMicros;
+    transfer["flash_us"] = transferStats.flashMicros;
+    transfer["flash_writes"] = transferStats.flashWrites;
+    transfer["copied_bytes"] = transferStats.copiedBytes;
+    transfer["display_us"] = transferStats.displayMicros;
+    transfer["chunks"] = transferStats.chunks;
+    transfer["chunk_min_us"] = transferStats.minChunkMicros;
+    transfer["chunk_avg_us"] = transferStats.averageChunkMicros();
+    transfer["chunk_max_us"] = transferStats.maxChunkMicros;
+    JsonArray latency = transfer["latency"].to<JsonArray>();
+    for (uint32_t count : transferStats.latency)
+    {
+        latency.add(count);
+    }
+    transfer["min_free_heap"] = transferStats.minFreeHeap;
+    transfer["retries"] = transferStats.retries;
+    transfer["stalled"] = transferStats.stalled;
+    transfer["too_slow"] = transferStats.tooSlow;
+    transfer["reads"] = transferStats.reads.reads;
+    transfer["read_size_min"] = transferStats.reads.minReadSize;
+    transfer["read_size_max"] = transferStats.reads.maxReadSize;
+    transfer["stall_events"] = transferStats.reads.stallEvents;
+    transfer["longest_gap_ms"] = transferStats.reads.longestGapMs;
+    transfer["stalled_ms"] = transferStats.reads.stalledMs;
+
+    JsonObject connection = doc["connection"].to<JsonObject>();
+    connection["requests"] = connectionStats.requests;
+    connection["reused"] = connectionStats.reused;
+    connection["connects"] = connectionStats.connects;
+    connection["connect_avg_ms"] = connectionStats.averageConnectMs();
+    connection["tls_full"] = connectionStats.fullHandshakes;
+    connection["tls_full_avg_ms"] = connectionStats.averageFullHandshakeMs();
+    connection["tls_resumed"] = connectionStats.resumedHandshakes;
+    connection["tls_resumed_avg_ms"] = connectionStats.averageResumedHandshakeMs();
+
+    JsonObject manifest = doc["manifest"].to<JsonObject>();
+    manifest["requests"] = manifestStats.requests;
+    manifest["not_modified"] = manifestStats.notModified;
+    manifest["failures"] = manifestStats.failures;
+    manifest["arena_peak"] = manifestStats.arenaPeak;
+    manifest["arena_size"] = (uint32_t)manifestArena.capacity();
+    manifest["heap_before"] = manifestStats.freeHeapBefore;
+    manifest["heap_after"] = manifestStats.freeHeapAfter;
+    manifest["max_block_before"] = manifestStats.maxBlockBefore;
+    manifest["max_block_after"] = manifestStats.maxBlockAfter;
+
+    JsonObject sync = doc["sync"].to<JsonObject>();
+    sync["sectors"] = syncStats.sectors;
+    sync["changed"] = syncStats.changedSectors;
+    sync["bytes_saved"] = syncStats.bytesSaved();
+
+    JsonObject heap = doc["heap"].to<JsonObject>();
+    heap["free"] = ESP.getFreeHeap();
+    heap["min_free"] = ESP.getMinFreeHeap();
+
+    String body;
+    serializeJson(doc, body);
+    server.send(200, "application/json", body);
+}
+
+bool OTAUpdate::sharePeerFirmware(WebServer &server, uint16_t port)
+{
+    server.on(PEER_FIRMWARE_PATH, HTTP_GET, [this, &server]()
+              { handlePeerFirmware(server); });
+
+    String version = String(currentFirmwareVersion[0]) + "." + String(currentFirmwareVersion[1]) + "." + String(currentFirmwareVersion[2]);
+    String digest = installedDigest(U_FLASH);
+    if (!MDNS.addService("otaupdate", "tcp", port) ||
+        !MDNS.addServiceTxt("otaupdate", "tcp", "version", version.c_str()))
+    {
+        Serial.println("❌ Could not advertise firmware over mDNS, is MDNS.begin() called?");
+        return false;
+    }
+    if (digest.length() > 0)
+    {
+        MDNS.addServiceTxt("otaupdate", "tcp", "sha256", digest.c_str());
+    }
+    Serial.printf("📡 Sharing firmware %s with LAN peers on port %u\n", version.c_str(), port);
+    return true;
+}
+
+void OTAUpdate::setPeerFetch(bool enabled)
+{
+    peerFetch = enabled;
+}
+
+void OTAUpdate::setChannel(const String &name)
+{
+    channel = name;
+}
+
+// Streams the running app partition; the image is byte for byte the firmware.bin it was flashed from
+void OTAUpdate::handlePeerFirmware(WebServer &server)
+{
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    uint32_t size = ESP.getSketchSize();
+    if (!running || size == 0 || size > running->size)
+    {
+        server.send(503, "text/plain", "Firmware image unavailable");
+        return;
+    }
+
+    // Lets a peer resume an interrupted download with If-Range
+    String digest = installedDigest(U_FLASH);
+    if (digest.length() > 0)
+    {
+        server.sendHeader("ETag", "\"" + digest + "\"");
+    }
+    server.setContentLength(size);
+    server.send(200, "application/octet-stream", "");
+
+    uint8_t buffer[OTA_DIRECT_BUFFER_SIZE];
+    for (uint32_t offset = 0; offset < size;)
+    {
+        size_t chunk = min((size_t)(size - offset), sizeof(buffer));
+        if (esp_partition_read(running, offset, buffer, chunk) != ESP_OK)
+        {
+            break;
+        }
+        server.sendContent((const char *)buffer, chunk);
+        offset += chunk;
+    }
+}
+
+// A peer advertising the wanted version (and digest, if it knows its own).
+// mDNS only answers from the local link, so any match is close by; picking
+// one at random spreads a fleet over all the peers already updated.
+String OTAUpdate::findPeerUrl(const char *version)
+{
+    int count = MDNS.queryService("otaupdate", "tcp");
+    int chosen = -1;
+    int matches = 0;
+    for (int i = 0; i < count; i++)
+    {
+        String digest = MDNS.txt(i, "sha256");
+        if (MDNS.txt(i, "version") != version || MDNS.IP(i) == WiFi.localIP() ||
+            (digest.length() > 0 && !digest.equalsIgnoreCase(manifestChecks.firmwareDigest)))
+        {
+            continue;
+        }
+        if (random(++matches) == 0)
+        {
+            chosen = i;
+        }
+    }
+    if (chosen < 0)
+    {
+        return "";
+    }
+    Serial.printf("📡 %d peer(s) have %s, using %s\n", matches, version, MDNS.hostname(chosen).c_str());
+    return "http://" + MDNS.IP(chosen).toString() + ":" + String(MDNS.port(chosen)) + PEER_FIRMWARE_PATH;
 }
 
 void OTAUpdate::handleUpdateGet(WebServer &server)
@@ -646,7 +2812,7 @@ void OTAUpdate::handleUpdateGet(WebServer &server)
 
 void OTAUpdate::handleUpdatePost(WebServer &server)
 {
-    if (!Update.hasError())
+    if (uploadState.installed)
     {
         server.send(200, "text/plain", "Update Successful! Rebooting...");
         delay(1000);
@@ -658,89 +2824,117 @@ void OTAUpdate::handleUpdatePost(WebServer &server)
     }
 }
 
+// Upload chunks are pushed through the same inflate/verify/write chain as
+// the pulled images; gzip uploads are recognised by their magic bytes
 void OTAUpdate::handleUpdateUpload(WebServer &server)
 {
     HTTPUpload &upload = server.upload();
     int partitionType = (server.arg("update") == "spiffs") ? U_SPIFFS : U_FLASH;
+    String heading = (partitionType == U_FLASH) ? "Firmware OTA" : "SPIFFS OTA";
 
     if (upload.status == UPLOAD_FILE_START)
     {
         Serial.printf("Update: %s\n", upload.filename.c_str());
-        if (!Update.begin(UPDATE_SIZE_UNKNOWN, partitionType))
-        {
-            Update.printError(Serial);
-        }
+        clearCheckpoint();
+        releaseUpload();
+        // POST /update?sha256=<hex>&sig=<hex> has the upload checked before it is activated
+        expectedDigest = server.arg("sha256");
+        expectedSignature = server.arg("sig");
+        uploadState.written = 0;
+        uploadState.lastProgress = -1;
+        uploadState.started = false;
+        uploadState.installed = false;
+        uploadState.failed = !beginImage(UPDATE_SIZE_UNKNOWN, partitionType);
+        sink().transferStarted(heading);
+        beginTransferStats();
     }
     else if (upload.status == UPLOAD_FILE_WRITE)
     {
-        if (Update.write(upload.buf, upload.currentSize) != upload.currentSize)
+        if (!uploadState.started && !uploadState.failed)
+        {
+            uploadState.started = true;
+            if (upload.currentSize >= 2 && upload.buf[0] == 0x1f && upload.buf[1] == 0x8b)
+            {
+                uploadState.inflater = new OTAInflater([this](const uint8_t *data, size_t len)
+                                                       { return writeDecoded(data, len); },
+                                                       inflateWindowBits, OTASectorBuffer::SECTOR_SIZE);
+                uploadState.failed = !uploadState.inflater->begin();
+                inflater = uploadState.inflater;
+            }
+        }
+        if (!uploadState.failed && !writeChunk(upload.buf, upload.currentSize))
         {
-            Update.printError(Serial);
+            uploadState.failed = true;
+        }
+        uploadState.written += upload.currentSize;
+        // The request length includes the multipart framing, so this slightly under-reports
+        size_t requestLength = server.clientContentLength();
+        if (requestLength > 0)
+        {
+            reportProgress(heading, min(uploadState.written, requestLength), requestLength, uploadState.lastProgress);
         }
     }
     else if (upload.status == UPLOAD_FILE_END)
     {
-        if (Update.end(true))
+        bool ok = !uploadState.failed && (!uploadState.inflater || uploadState.inflater->finished());
+        if (uploadState.inflater && !uploadState.inflater->finished())
         {
-            Serial.println("Update Successful");
+            Serial.printf("❌ Decompression error: %s\n", uploadState.inflater->failed() ? uploadState.inflater->error() : "stream ended early");
         }
-        else
+        releaseUpload();
+        sink().transferFinished(ok);
+        logTransferStats();
+        if (!ok)
         {
-            Update.printError(Serial);
+            Serial.println("❌ Upload failed, nothing was installed.");
+            abortImage();
         }
+        else if (finishImage(true))
+        {
+            uploadState.installed = true;
+            Serial.println("Update Successful");
+        }
+        expectedDigest = "";
+        expectedSignature = "";
+    }
+    else if (upload.status == UPLOAD_FILE_ABORTED)
+    {
+        releaseUpload();
+        sink().transferFinished(false);
+        abortImage();
+        expectedDigest = "";
+        expectedSignature = "";
     }
 }
 
-bool OTAUpdate::performUpdateFromFile(File &updateFile, size_t contentLength, int partitionType)
+void OTAUpdate::releaseUpload()
 {
-    if (!updateFile || contentLength <= 0)
+    if (inflater == uploadState.inflater)
     {
-        Serial.println("❌ Invalid update file.");
-        return false;
+        inflater = nullptr;
     }
+    delete uploadState.inflater;
+    uploadState.inflater = nullptr;
+}
 
-    if (!Update.begin(contentLength, partitionType))
+bool OTAUpdate::performUpdateFromFile(File &updateFile, size_t contentLength, int partitionType)
+{
+    if (!updateFile || contentLength <= 0)
     {
-        Serial.println("❌ Not enough space for update.");
+        Serial.println("❌ Invalid update file.");
         return false;
     }
 
-    Serial.println("⬇️ Applying update from file...");
-    size_t written = 0;
-    uint8_t buffer[128];
-    int lastProgress = -1;
-    String heading = (partitionType == U_FLASH) ? "Firmware OTA" : "SPIFFS OTA";
-
-    while (updateFile.available())
-    {
-        size_t bytesRead = updateFile.read(buffer, sizeof(buffer));
-        if (bytesRead > 0)
-        {
-            Update.write(buffer, bytesRead);
-            written += bytesRead;
-
-            int progress = (written * 100) / contentLength;
-            if (progress > lastProgress)
-            {
-                Serial.printf("📊 Progress: %d%%\n", progress);
-                lastProgress = progress;
-                updateDisplayProgress(heading, progress);
-                display.display();
-            }
-        }
-    }
+    // gzip files are recognised by their magic bytes
+    uint8_t magic[2] = {0, 0};
+    updateFile.read(magic, sizeof(magic));
+    updateFile.seek(0);
+    OTAEncoding encoding = (magic[0] == 0x1f && magic[1] == 0x8b) ? OTA_ENCODING_GZIP : OTA_ENCODING_IDENTITY;
 
+    size_t fileLength = min(contentLength, (size_t)updateFile.available());
+    bool ok = performUpdateFromFile(updateFile, fileLength, partitionType, encoding);
     updateFile.close();
-    Serial.println("✅ File update complete. Finalizing...");
-
-    if (!Update.end() || Update.hasError())
-    {
-        Serial.printf("❌ Update error: %s\n", Update.errorString());
-        return false;
-    }
-
-    Serial.println("✅ Update successful!");
-    return true;
+    return ok;
 }
 
 // void OTAUpdate::handleUpdateUpload(WebServer &server)
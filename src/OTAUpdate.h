@@ -5,48 +5,480 @@
 #include <WiFi.h>
 #include <HTTPClient.h>
 #include <Update.h>
-#include <SPIFFS.h>
 #include <WebServer.h>
 #include <ArduinoJson.h>
-#include <Adafruit_GFX.h>
-#include <Adafruit_SSD1306.h>
-class OTAUpdate
+#include "OTAProgressSink.h"
+#include "OTAFilesystem.h"
+#include "OTADigest.h"
+#include "OTASignature.h"
+#include "OTATlsClient.h"
+#include "OTABundle.h"
+#include "OTAManifest.h"
+#include "OTATransferReader.h"
+#include "OTAPartitionWriter.h"
+#include <esp_partition.h>
+#include <freertos/queue.h>
+
+// Stack buffer of the transfer loop used when the pipeline is off or its ring
+// couldn't be allocated; the pipelined path reads straight into the ring
+#ifndef OTA_DIRECT_BUFFER_SIZE
+#define OTA_DIRECT_BUFFER_SIZE 512
+#endif
+
+class OTADeltaPatcher;
+class OTAInflater;
+
+enum OTAEncoding
+{
+    OTA_ENCODING_IDENTITY,
+    OTA_ENCODING_GZIP
+};
+
+// Phases reported by a (background) update check
+enum OTAState
+{
+    OTA_IDLE,
+    OTA_CHECKING,
+    OTA_UPDATING_SPIFFS,
+    OTA_UPDATING_FIRMWARE,
+    OTA_REBOOT_PENDING,
+    OTA_UP_TO_DATE,
+    OTA_FAILED
+};
+
+// Called on every phase change and progress percent; progress is 0 outside the transfer phases
+typedef std::function<void(OTAState state, int progress)> OTAStateCallback;
+
+// Outcome counters for config.json polls since boot
+struct OTAManifestStats
+{
+    uint32_t requests;
+    uint32_t notModified;
+    uint32_t fullFetches;
+    uint32_t failures;
+    // The last full manifest: arena bytes it needed, and the heap around parsing it
+    uint32_t arenaPeak;
+    uint32_t freeHeapBefore;
+    uint32_t freeHeapAfter;
+    uint32_t maxBlockBefore; // largest allocatable block
+    uint32_t maxBlockAfter;
+
+    float hitRatio() const
+    {
+        return requests ? (float)notModified / requests : 0.0f;
+    }
+};
+
+// Connection reuse across manifest and image requests since boot
+struct OTAConnectionStats
+{
+    uint32_t requests;
+    uint32_t reused;    // sent on an already open keep-alive connection
+    uint32_t connects;  // requests that needed a new connection
+    uint32_t connectMs; // time spent opening connections, DNS and TLS handshakes included
+    uint32_t fullHandshakes;
+    uint32_t fullHandshakeMs;
+    uint32_t resumedHandshakes; // TLS sessions resumed from the RTC cache
+    uint32_t resumedHandshakeMs;
+
+    uint32_t averageConnectMs() const
+    {
+        return connects ? connectMs / connects : 0;
+    }
+    uint32_t averageFullHandshakeMs() const
+    {
+        return fullHandshakes ? fullHandshakeMs / fullHandshakes : 0;
+    }
+    uint32_t averageResumedHandshakeMs() const
+    {
+        return resumedHandshakes ? resumedHandshakeMs / resumedHandshakes : 0;
+    }
+    // Estimated handshake time avoided by reuse
+    uint32_t savedMs() const
+    {
+        return reused * averageConnectMs();
+    }
+};
+
+// Data path measurements for the most recent transfer, for comparing buffer
+// sizes and settings on real hardware
+struct OTATransferStats
+{
+    // The request that fed the transfer; DNS and connect are 0 on a reused connection
+    uint32_t dnsMs;
+    uint32_t connectMs;      // TCP connect plus any TLS handshake
+    uint32_t firstByteMs;    // request sent until the response headers were in
+    uint32_t bytes;          // taken from the source
+    uint32_t chunks;         // pieces handed to the decode/write chain
+    uint32_t elapsedMs;
+    uint32_t writeMicros;    // spent inflating, patching, hashing and writing
+    uint32_t flashMicros;    // the part of writeMicros spent erasing and programming flash
+    uint32_t flashWrites;    // calls into the partition writer, one per run of whole sectors
+    uint32_t copiedBytes;    // gathered in the sector buffer because they straddled a sector
+    uint32_t displayMicros;  // progress output I/O, e.g. the OLED's I2C traffic
+    uint32_t minChunkMicros;
+    uint32_t maxChunkMicros;
+    uint32_t latency[5];     // chunks by write time: <1 ms, <4 ms, <16 ms, <64 ms, longer
+    uint32_t minFreeHeap;    // lowest free heap seen while chunks were written
+    uint8_t retries;         // earlier attempts at the same image that were interrupted
+    bool stalled;            // ended because no data arrived for the stall timeout
+    bool tooSlow;            // ended because the average rate stayed under setMinTransferRate()
+    OTAReadStats reads;      // read sizes and waits for data
+
+    // Bytes per second
+    float throughput() const
+    {
+        return elapsedMs ? bytes * 1000.0f / elapsedMs : 0.0f;
+    }
+    uint32_t averageChunkMicros() const
+    {
+        return chunks ? writeMicros / chunks : 0;
+    }
+};
+
+// Outcome of the last sector-level SPIFFS sync
+struct OTASyncStats
+{
+    uint32_t imageBytes;
+    uint32_t sectors;
+    uint32_t changedSectors; // erased, fetched and programmed
+    uint32_t requests;       // Range requests for the changed runs
+    uint32_t bytesFetched;   // sector data downloaded
+    uint32_t mapBytes;       // the sector hash list itself
+    uint32_t hashMs;         // hashing the local partition
+
+    uint32_t bytesSaved() const
+    {
+        uint32_t spent = bytesFetched + mapBytes;
+        return imageBytes > spent ? imageBytes - spent : 0;
+    }
+};
+
+// Progress and status output goes to the sink picked at build time with
+// OTA_PROGRESS_SINK (see OTAProgressSink.h)
+class OTAUpdate : private OTASinkHolder<OTAProgressSink>
 {
 public:
     OTAUpdate(const String &serverUrl);
     void setFirmwareVersion(int major, int minor, int patch);
     void begin();
+    // Non-blocking variant: the check runs in its own task, call loop() from the sketch's loop()
+    bool beginAsync();
+    bool startUpdateCheck();
+    OTAState loop();
+    OTAState getState() const
+    {
+        return state;
+    }
+    bool isBusy() const
+    {
+        return asyncActive;
+    }
+    void onStateChange(OTAStateCallback callback);
+    // When false, loop() leaves OTA_REBOOT_PENDING for the sketch to act on
+    void setAutoReboot(bool enabled);
+    // Periodic background checks started from loop(). Every wait gets a random
+    // 0..jitterMs added so a fleet that powered up together spreads out; 0 stops them.
+    void setCheckInterval(unsigned long intervalMs, unsigned long jitterMs = 0);
+    // Wait after a failed check: minMs doubling per consecutive failure up to maxMs, half of it random
+    void setRetryBackoff(unsigned long minMs, unsigned long maxMs);
+    // Like beginAsync(), but the first check also waits a random 0..jitterMs
+    bool beginScheduled();
+    // Fast boot: returns without touching the network and never formats SPIFFS.
+    // If the last good check (kept in RTC memory across resets and deep sleep) is
+    // younger than freshSeconds, none is made until it goes stale; otherwise
+    // loop() starts one deferMs later, once WiFi is up. Returns true if a check is due now.
+    bool beginFast(uint32_t freshSeconds = 3600, unsigned long deferMs = 0);
+    // Time the last begin*() call kept the caller waiting
+    unsigned long getStartupMs() const
+    {
+        return startupMs;
+    }
+    // Milliseconds until loop() starts the next scheduled check
+    unsigned long nextCheckIn() const;
+    // The display is referenced, not copied; it must outlive the OTAUpdate
     void setupdisplay(Adafruit_SSD1306 &d)
     {
-        display = d;
+        sink().attachDisplay(d);
+    }
+    // Only used when the sink is (or includes) OTACallbackSink
+    void onProgress(OTAProgressCallback callback)
+    {
+        sink().setCallback(callback);
     }
     void checkForUpdates();
+    // Also serves GET /update/metrics: transfer, connection, manifest and sync stats as JSON
     void setupManualOTA(WebServer &server);
+    // Serves the running firmware at /ota/firmware.bin and advertises its version
+    // over mDNS as _otaupdate._tcp. Call MDNS.begin() first; port is the server's.
+    bool sharePeerFirmware(WebServer &server, uint16_t port = 80);
+    // Look for a LAN peer already running the new version before downloading
+    // from serverUrl. Needs the manifest's sha256 to check what the peer sends.
+    void setPeerFetch(bool enabled);
+    // Manifest entries under "channels" -> name replace the top-level ones; empty uses the top level only
+    void setChannel(const String &name);
     void updateDisplayProgress(String heading, int progress);
+    // Progress frames are pushed at most every minIntervalMs; partial sends only the changed bar/percent columns
+    void setDisplayRefresh(uint16_t minIntervalMs, bool partial = true);
     // bool updateavailabe();
     // bool updateAvailable()
     // {
     //     return updateavailabe();
     // }
     void updateurl(const String &serve);
+    // Size of the ring buffer between the network and flash tasks; 0 disables the pipeline
+    void setPipelineBufferSize(size_t bytes);
+    // History window for gzip images, 2^bits bytes; must cover the window they were compressed with
+    void setDecompressionWindowBits(uint8_t bits);
+    // Abort a transfer when no data arrives for this long; interrupted raw images resume with a Range request
+    void setStallTimeout(unsigned long ms);
+    // Abort (and resume, for raw images) a transfer whose average rate is still
+    // below bytesPerSecond graceMs after it started; 0 turns the floor off
+    void setMinTransferRate(uint32_t bytesPerSecond, unsigned long graceMs = 10000);
+    void setResumeAttempts(uint8_t attempts);
+    // Assemble flash sectors in the sketch's buffer (OTASectorBuffer::SECTOR_SIZE
+    // bytes, kept alive as long as this object) instead of allocating one per image
+    void setWriteBuffer(uint8_t *buffer);
+    // Trust for HTTPS servers: a PEM CA certificate and/or the hex SHA-256 of the
+    // server's public key (SubjectPublicKeyInfo DER). HTTPS fails without either.
+    bool setCACert(const char *pem);
+    void setPinnedKey(const String &sha256Hex);
+    // PEM ECDSA P-256 public key. Once set, every image must carry a valid
+    // signature (manifest "signature", or ?sig= on uploads) or it isn't activated.
+    // SPIFFS images (full, sector sync, bundle section) are written in place and
+    // only verified afterwards; one that fails is fetched again on the next check.
+    bool setSigningKey(const char *pem);
+    const OTATransferStats &getTransferStats() const
+    {
+        return transferStats;
+    }
+    const OTAConnectionStats &getConnectionStats() const
+    {
+        return connectionStats;
+    }
+    const OTAManifestStats &getManifestStats() const
+    {
+        return manifestStats;
+    }
+    const OTASyncStats &getSyncStats() const
+    {
+        return syncStats;
+    }
 private:
+#ifdef OTA_HOST_TEST
+    // test/host drives the private transfer paths directly
+    friend struct OTAHostAccess;
+#endif
+
+    enum TransferResult
+    {
+        TRANSFER_OK,
+        TRANSFER_FAILED,
+        TRANSFER_INTERRUPTED
+    };
+
+    // Progress of a raw image download, persisted in NVS so it survives a reset
+    struct ResumeCheckpoint
+    {
+        bool active;
+        String url;
+        String etag;
+        uint32_t total;
+        uint32_t offset;
+        uint32_t partitionAddress;
+        int partitionType;
+        uint8_t head[16];
+        size_t headLength;
+    };
+
+    // A web upload arrives over several handler calls
+    struct UploadState
+    {
+        OTAInflater *inflater;
+        size_t written;
+        int lastProgress;
+        bool started;
+        bool failed;
+        bool installed;
+    };
+
+    // Digests and signatures the manifest publishes for each image
+    struct ImageChecks
+    {
+        String firmwareDigest;
+        String spiffsDigest;
+        String firmwareSignature;
+        String spiffsSignature;
+        String spiffsVersion;
+    };
+
+    // The bundle being streamed and its current section
+    struct BundleState
+    {
+        OTABundleReader *reader;
+        OTAPartitionWriter *writer;
+        OTAInflater *inflater;
+        const esp_partition_t *app;
+        String appDigest;
+    };
+
+    // Timings of the last request, picked up by the transfer that reads its body
+    struct RequestTiming
+    {
+        uint32_t dnsMs;
+        uint32_t connectMs;
+        uint32_t firstByteMs;
+    };
+
+    struct OTAEvent
+    {
+        OTAState state;
+        int progress;
+    };
+
+    // Keep-alive connection shared by every request made through http. Declared
+    // first so they outlive http, whose destructor stops the client it holds.
+    WiFiClient netClient;
+    OTATlsClient tlsClient;
     HTTPClient http;
-    Adafruit_SSD1306 display;
     const char *ssid;
     const char *password;
     String serverUrl;
     String firmwareUrl;
     String spiffsUrl;
     int currentFirmwareVersion[3];
+    size_t pipelineBufferSize;
+    OTADeltaPatcher *deltaPatcher;
+    OTAInflater *inflater;
+    uint8_t inflateWindowBits;
+    // Resumes and bundle sections bring their own writer; null while imageWriter is in use
+    OTAPartitionWriter *partitionWriter;
+    // Partition offset of image byte 0 for the writer in use
+    size_t writerBase;
+    // Whole sectors of a new image on their way into its partition
+    OTAPartitionWriter imageWriter;
+    const esp_partition_t *imagePartition;
+    size_t imageLength;
+    unsigned long stallTimeoutMs;
+    uint32_t minTransferRate;
+    unsigned long rateGraceMs;
+    uint8_t maxResumeAttempts;
+    bool transferStalled;
+    bool peerFetch;
+    ResumeCheckpoint checkpoint;
+    UploadState uploadState;
+    ImageChecks manifestChecks;
+    BundleState bundle;
+    // SHA-256 the image being flashed must have; empty skips the check
+    String expectedDigest;
+    String expectedSignature;
+    OTADigest imageDigest;
+    OTASignature signatureCheck;
+    bool hashing;
+    bool digestVerified;
+    // The start of a data image is still to be checked against the filesystem backend
+    bool imageHeadPending;
+    uint8_t imageHead[OTAFilesystem::IMAGE_HEAD_SIZE];
+    size_t imageHeadLength;
+    int imagePartitionType;
+    OTAManifestStats manifestStats;
+    OTAJsonArena manifestArena;
+    String channel;
+    OTATransferStats transferStats;
+    OTASyncStats syncStats;
+    unsigned long transferStart;
+    unsigned long displayStart;
+    uint8_t transferRetries;
+    RequestTiming requestTiming;
+    String connectionHost;
+    uint16_t connectionPort;
+    OTAConnectionStats connectionStats;
+    volatile OTAState state;
+    volatile bool asyncActive;
+    bool autoReboot;
+    QueueHandle_t eventQueue;
+    OTAStateCallback stateCallback;
+    unsigned long checkIntervalMs;
+    unsigned long checkJitterMs;
+    unsigned long backoffMinMs;
+    unsigned long backoffMaxMs;
+    // From the manifest response's Retry-After; a floor for the next wait
+    unsigned long retryAfterMs;
+    unsigned long nextCheckAt;
+    volatile bool checkScheduled;
+    bool lastCheckFailed;
+    uint8_t checkFailures;
+    unsigned long startupMs;
     //void connectWiFi();
-    void stringToFirmware(const String &Firmware, int arr[3]);
+    bool prepare();
+    static void updateTask(void *arg);
+    void runCheck();
+    void scheduleNextCheck();
+    uint32_t firmwareVersionKey() const;
+    bool startupCacheAge(uint32_t &ageSeconds) const;
+    void storeStartupCache();
+    void setState(OTAState newState, int progress = 0);
+    void showMessage(const char *line1, const char *line2, uint16_t holdMs);
+    bool stringToFirmware(const char *Firmware, int arr[3]);
     bool checkUpgradedVersion(int arr[]);
-    bool performUpdate(const char *updateUrl, int partitionType);
-    bool performUpdateFromFile(Stream &updateStream, size_t contentLength, int partitionType);
+    bool addManifestConditions(HTTPClient &client);
+    void storeManifestValidators(HTTPClient &client, const char *version);
+    bool performUpdate(const char *updateUrl, int partitionType, OTAEncoding encoding = OTA_ENCODING_IDENTITY);
+    TransferResult downloadImage(const char *updateUrl, int partitionType, OTAEncoding encoding);
+    TransferResult resumeImage(int partitionType);
+    const esp_partition_t *updateTargetPartition(int partitionType);
+    bool loadCheckpoint(const char *url, int partitionType);
+    void startCheckpoint(const char *url, const String &etag, uint32_t total, int partitionType);
+    void updateCheckpoint(bool force);
+    void storeCheckpoint();
+    void clearCheckpoint();
+    bool checkpointForOther(int partitionType);
+    bool performDeltaUpdate(const String &patchUrl);
+    bool performBundleUpdate(const String &bundleUrl);
+    bool beginSection(const OTABundleReader::Section &section);
+    bool endSection(const OTABundleReader::Section &section);
+    void releaseSection();
+    bool performSpiffsSync(const String &mapUrl, const String &imageUrl);
+    bool fetchSectors(const esp_partition_t *partition, const String &imageUrl, size_t from, size_t to);
+    String findDeltaUrl(JsonVariantConst deltas);
+    String findPeerUrl(const char *version);
+    void handlePeerFirmware(WebServer &server);
+    String resolveUrl(const String &path);
+    bool beginRequest(const String &url);
+    void endRequest(bool reusable);
+    int sendGet();
+    bool performUpdateFromFile(Stream &updateStream, size_t contentLength, int partitionType, OTAEncoding encoding = OTA_ENCODING_IDENTITY);
     bool performUpdateFromFile(File &updateFile, size_t contentLength, int partitionType);
+    OTAEncoding responseEncoding(OTAEncoding fallback);
+    bool transferToUpdate(Stream &source, size_t contentLength, const String &heading, OTAEncoding encoding = OTA_ENCODING_IDENTITY);
+    bool transferInflated(Stream &source, size_t contentLength, const String &heading);
+    bool transferPipelined(Stream &source, size_t contentLength, const String &heading);
+    bool transferDirect(Stream &source, size_t contentLength, const String &heading);
+    bool writeChunk(const uint8_t *data, size_t len);
+    void endRead(const OTATransferReader &reader);
+    void beginTransferStats();
+    void logTransferStats();
+    bool writeDecoded(const uint8_t *data, size_t len);
+    bool writeImage(const uint8_t *data, size_t len);
+    OTAPartitionWriter &writer() { return partitionWriter ? *partitionWriter : imageWriter; }
+    bool checkImageHead(const uint8_t *data, size_t len);
+    bool beginImage(size_t imageSize, int partitionType);
+    bool finishImage(bool evenIfRemaining);
+    void abortImage();
+    void beginDigest();
+    bool imageVerified();
+    String installedDigest(int partitionType);
+    void storeInstalledDigest(int partitionType, const esp_partition_t *partition);
+    void forgetInstalledDigest(int partitionType);
+    bool imageCurrent(int partitionType);
+    bool imageFits(int partitionType, uint32_t size);
+    void storeSpiffsVersion();
+    void reportProgress(const String &heading, size_t written, size_t contentLength, int &lastProgress);
     void handleUpdatePost(WebServer &server);
     void handleUpdateGet(WebServer &server);
     void handleUpdateUpload(WebServer &server);
+    void handleMetrics(WebServer &server);
+    void releaseUpload();
 };
 
 #endif
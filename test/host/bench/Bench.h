@@ -0,0 +1,47 @@
+#ifndef HOST_BENCH_H
+#define HOST_BENCH_H
+
+// Sections of the host bench. HOST_BENCH(name) { ... } registers one; each
+// starts from host::reset() and prints its own table. `quick` asks for a
+// short pass (ctest runs that to keep the bench building and working).
+
+#include <Arduino.h>
+#include <HostControl.h>
+#include <chrono>
+#include <string>
+
+struct BenchOptions
+{
+    bool quick;
+};
+
+typedef void (*BenchFunction)(const BenchOptions &options);
+
+struct BenchRegistrar
+{
+    BenchRegistrar(const char *name, BenchFunction function);
+};
+
+#define HOST_BENCH(name)                                                 \
+    static void name(const BenchOptions &options);                       \
+    static BenchRegistrar name##_registrar(#name, name);                 \
+    static void name(const BenchOptions &options)
+
+// Set when a section finds the code under test misbehaving (not for slow numbers)
+void benchFail(const std::string &message);
+
+// Wall time of a block of host CPU work, in seconds
+class BenchTimer
+{
+public:
+    BenchTimer() : start(std::chrono::steady_clock::now()) {}
+    double seconds() const
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point start;
+};
+
+#endif
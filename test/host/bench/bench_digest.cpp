@@ -0,0 +1,67 @@
+#include "Bench.h"
+#include <HostAccess.h>
+#include <HostImages.h>
+#include <HostStream.h>
+#include <OTADigest.h>
+#include <esp_ota_ops.h>
+
+// What the incremental SHA-256 costs per chunk size: the hash alone, and an
+// update through OTAUpdate with and without a digest to check. Host SHA-256
+// is software; parts with a SHA peripheral pay less per byte, but the per-call
+// overhead is what the chunk size decides.
+HOST_BENCH(digest)
+{
+    size_t imageSize = options.quick ? 256 * 1024 : 4 * 1024 * 1024;
+    std::string image = images::app(imageSize);
+
+    printf("%8s %10s %12s %10s\n", "chunk", "MB/s", "ns per call", "ms per MB");
+    for (size_t chunk : {64, 256, 512, 1460, 4096, 16384})
+    {
+        OTADigest digest;
+        BenchTimer timer;
+        digest.begin();
+        size_t calls = 0;
+        for (size_t offset = 0; offset < image.size(); offset += chunk, calls++)
+        {
+            digest.update((const uint8_t *)image.data() + offset, std::min(chunk, image.size() - offset));
+        }
+        if (!digest.matches(images::sha256Hex(image).c_str()))
+        {
+            benchFail("digest of " + std::to_string(chunk) + " byte chunks");
+        }
+        double seconds = timer.seconds();
+        double megabytes = image.size() / (1024.0 * 1024.0);
+        printf("%8u %10.1f %12.0f %10.2f\n", (unsigned)chunk, megabytes / seconds, seconds * 1e9 / calls,
+               seconds * 1000 / megabytes);
+    }
+
+    // Host CPU time of a whole update through the direct loop (best of five);
+    // the stream and flash cost nothing here, so the hash is all that differs
+    image.resize(std::min(imageSize, (size_t)1024 * 1024));
+    std::string digestHex = images::sha256Hex(image);
+    double times[2] = {1e9, 1e9};
+    for (int run = 0; run < 5; run++)
+    {
+        for (int verified = 0; verified < 2; verified++)
+        {
+            host::reset();
+            OTAUpdate ota("http://127.0.0.1");
+            ota.setPipelineBufferSize(0);
+            if (verified)
+            {
+                OTAHostAccess::expectImage(ota, digestHex.c_str());
+            }
+            HostStream stream(image);
+            stream.setSegment(1460);
+            BenchTimer timer;
+            if (!OTAHostAccess::updateFromStream(ota, stream, image.size()))
+            {
+                benchFail(verified ? "verified update" : "plain update");
+            }
+            times[verified] = std::min(times[verified], timer.seconds() * 1000);
+        }
+    }
+    printf("\nupdate of %u KB: %.1f ms plain, %.1f ms with SHA-256 (%.2f ms per MB hashed)\n",
+           (unsigned)(image.size() / 1024), times[0], times[1],
+           (times[1] - times[0]) * 1024 * 1024 / image.size());
+}
@@ -0,0 +1,99 @@
+#include "Bench.h"
+#include <HostAccess.h>
+#include <HostImages.h>
+#include <HostStream.h>
+#include <OTAInflate.h>
+#include <esp_ota_ops.h>
+
+namespace
+{
+    const uint32_t LINK_RATES[] = {50 * 1024, 400 * 1024};
+
+    // Virtual milliseconds to take `body` off the link and flash it
+    uint64_t timeUpdate(const std::string &image, const std::string &body, uint32_t rate, OTAEncoding encoding,
+                        int bits)
+    {
+        host::reset();
+        host::useVirtualClock(true);
+        host::setFlashTiming(30000, 8000);
+        OTAUpdate ota("http://127.0.0.1");
+        ota.setPipelineBufferSize(0);
+        ota.setDecompressionWindowBits(bits);
+        HostStream stream(body);
+        stream.setRate(rate);
+        stream.setSegment(1460);
+        uint64_t start = micros();
+        bool ok = OTAHostAccess::updateFromStream(ota, stream, body.size(), U_FLASH, encoding);
+        uint64_t elapsed = micros() - start;
+        host::useVirtualClock(false);
+        if (!ok || host::readPartition(esp_ota_get_next_update_partition(NULL), image.size()) != image)
+        {
+            benchFail("update with window 2^" + std::to_string(bits));
+        }
+        return elapsed / 1000;
+    }
+}
+
+// Window size against compression and decompressor cost. Images are gzip
+// made with deflateInit2(level 9, Z_DEFLATED, bits + 16, memLevel 9), as a
+// build step would. End to end times are virtual: a 50 or 400 KB/s link and
+// flash taking 30 ms to erase and 8 ms to program a sector. A quarter of each
+// sector of the image is random so it compresses about as well as firmware.
+HOST_BENCH(inflate)
+{
+    size_t imageSize = options.quick ? 128 * 1024 : 1024 * 1024;
+    std::string image;
+    while (image.size() < imageSize)
+    {
+        image += images::app(3072, image.size()) + images::random(1024, image.size());
+    }
+    image.resize(imageSize);
+    uint64_t raw[2];
+    for (int link = 0; link < 2; link++)
+    {
+        raw[link] = timeUpdate(image, image, LINK_RATES[link], OTA_ENCODING_IDENTITY, 15);
+        printf("raw image %u bytes, %llu ms end to end at %u KB/s\n", (unsigned)image.size(),
+               (unsigned long long)raw[link], LINK_RATES[link] / 1024);
+    }
+
+    // KB/s/KB: inflate throughput per KB of decompressor RAM
+    printf("%4s %10s %6s %8s %8s %9s %17s %17s\n", "bits", "gzip", "ratio", "RAM", "MB/s", "KB/s/KB",
+           "50 KB/s ms", "400 KB/s ms");
+    for (int bits = 9; bits <= 15; bits++)
+    {
+        std::string compressed = images::gzip(image, bits);
+
+        size_t produced = 0;
+        host::markHeap();
+        BenchTimer timer;
+        OTAInflater inflater([&produced](const uint8_t *, size_t len)
+                             {
+                                 produced += len;
+                                 return true; },
+                             bits);
+        inflater.begin();
+        for (size_t offset = 0; offset < compressed.size(); offset += 1460)
+        {
+            inflater.write((const uint8_t *)compressed.data() + offset, std::min((size_t)1460, compressed.size() - offset));
+        }
+        double seconds = timer.seconds();
+        size_t ram = host::heapStats().peak;
+        if (!inflater.finished() || produced != image.size())
+        {
+            benchFail("inflate with window 2^" + std::to_string(bits));
+            continue;
+        }
+
+        double kbPerSecond = image.size() / 1024.0 / seconds;
+        printf("%4d %10u %6.2f %8u %8.1f %9.1f", bits, (unsigned)compressed.size(),
+               (double)compressed.size() / image.size(), (unsigned)ram, kbPerSecond / 1024,
+               kbPerSecond / (ram / 1024.0));
+        for (int link = 0; link < 2; link++)
+        {
+            uint64_t e2e = timeUpdate(image, compressed, LINK_RATES[link], OTA_ENCODING_GZIP, bits);
+            printf(" %8llu %6.2fx", (unsigned long long)e2e, (double)raw[link] / e2e);
+        }
+        printf("\n");
+        fflush(stdout);
+    }
+}
@@ -0,0 +1,67 @@
+#include "Bench.h"
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+// Usage: ota_host_bench [--quick] [section]
+
+namespace
+{
+    struct Section
+    {
+        const char *name;
+        BenchFunction function;
+    };
+
+    std::vector<Section> &sections()
+    {
+        static std::vector<Section> all;
+        return all;
+    }
+
+    int failures = 0;
+}
+
+BenchRegistrar::BenchRegistrar(const char *name, BenchFunction function)
+{
+    sections().push_back(Section{name, function});
+}
+
+void benchFail(const std::string &message)
+{
+    failures++;
+    fprintf(stderr, "  FAILED: %s\n", message.c_str());
+}
+
+int main(int argc, char **argv)
+{
+    signal(SIGPIPE, SIG_IGN);
+    BenchOptions options = {false};
+    const char *filter = nullptr;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--quick") == 0)
+        {
+            options.quick = true;
+        }
+        else
+        {
+            filter = argv[i];
+        }
+    }
+
+    for (const Section &section : sections())
+    {
+        if (filter && !strstr(section.name, filter))
+        {
+            continue;
+        }
+        host::reset();
+        printf("\n== %s%s ==\n", section.name, options.quick ? " (quick)" : "");
+        fflush(stdout);
+        section.function(options);
+        fflush(stdout);
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,300 @@
+#include "Bench.h"
+#include <HostAccess.h>
+#include <HostImages.h>
+#include <HostStream.h>
+#include <OTADelta.h>
+#include <OTAInflate.h>
+#include <esp_ota_ops.h>
+#include <vector>
+
+namespace
+{
+    // How the body reaches the device
+    struct Arrival
+    {
+        const char *name;
+        uint32_t rate;
+        size_t segment;
+    };
+
+    // Erase of one sector and program of 4 KB; "typical" is in the range
+    // ESP32 modules' SPI NOR datasheets give
+    struct FlashTiming
+    {
+        const char *name;
+        uint32_t eraseMicros;
+        uint32_t programMicros;
+    };
+
+    const Arrival ARRIVALS[] = {
+        {"steady", 1024 * 1024, 1460},
+        {"bursty", 2 * 1024 * 1024, 16384},
+        {"slow", 200 * 1024, 536},
+    };
+
+    const FlashTiming FLASH_TIMINGS[] = {
+        {"none", 0, 0},
+        {"typical", 30000, 8000},
+    };
+
+    void printHistogram(const uint32_t latency[5])
+    {
+        printf("%5u %5u %5u %5u %5u", latency[0], latency[1], latency[2], latency[3], latency[4]);
+    }
+}
+
+// The transfer loops end to end: image bytes from a throttled stream through
+// OTAUpdate into the flash stand-in, for each pipeline buffer size
+HOST_BENCH(transfer)
+{
+    size_t imageSize = options.quick ? 48 * 1024 : 256 * 1024;
+    std::vector<size_t> buffers = {0, 4096, 16384, 65536};
+    std::vector<Arrival> arrivals(std::begin(ARRIVALS), std::end(ARRIVALS));
+    if (options.quick)
+    {
+        buffers = {0, 16384};
+        arrivals.resize(1);
+    }
+    std::string image = images::app(imageSize);
+
+    // Chunk write times are counted in the buckets of OTATransferStats::latency
+    printf("%-8s %-8s %7s %9s %9s %5s %5s %5s %5s %5s %8s %7s %7s %7s\n", "arrival", "flash", "buffer", "KB/s",
+           "max us", "<1ms", "<4ms", "<16ms", "<64ms", "more", "heap pk", "allocs", "writes", "copied");
+    for (const Arrival &arrival : arrivals)
+    {
+        for (const FlashTiming &flash : FLASH_TIMINGS)
+        {
+            for (size_t buffer : buffers)
+            {
+                host::reset();
+                host::setFlashTiming(flash.eraseMicros, flash.programMicros);
+                OTAUpdate ota("http://127.0.0.1");
+                ota.setPipelineBufferSize(buffer);
+                HostStream stream(image);
+                stream.setRate(arrival.rate);
+                stream.setSegment(arrival.segment);
+
+                host::markHeap();
+                bool ok = OTAHostAccess::updateFromStream(ota, stream, image.size());
+                host::HeapStats heap = host::heapStats();
+                if (!ok || host::readPartition(esp_ota_get_next_update_partition(NULL), image.size()) != image)
+                {
+                    benchFail(std::string("transfer ") + arrival.name + "/" + flash.name + "/" + std::to_string(buffer));
+                    continue;
+                }
+
+                const OTATransferStats &stats = ota.getTransferStats();
+                printf("%-8s %-8s %7u %9.1f %9u ", arrival.name, flash.name, (unsigned)buffer,
+                       stats.throughput() / 1024, stats.maxChunkMicros);
+                printHistogram(stats.latency);
+                printf(" %8u %7u %7u %7u\n", (unsigned)heap.peak, heap.allocations, stats.flashWrites,
+                       stats.copiedBytes);
+                fflush(stdout);
+            }
+        }
+    }
+}
+
+// Calls into the flash layer and bytes copied per MB of image, for each
+// network read size. "Update" is how images used to be written, every piece
+// into Update.write(), which copies it into a sector buffer of its own;
+// "partition" is OTAUpdate's direct loop writing whole sectors itself.
+HOST_BENCH(flash_writes)
+{
+    size_t imageSize = options.quick ? 256 * 1024 : 1024 * 1024;
+    std::vector<size_t> reads = {128, 512, 1460, 4096};
+    if (options.quick)
+    {
+        reads = {1460};
+    }
+    std::string image = images::app(imageSize);
+    std::string compressed = images::gzip(image, 15);
+    const esp_partition_t *target = esp_ota_get_next_update_partition(NULL);
+    double mb = (double)imageSize / (1024 * 1024);
+
+    printf("%-10s %-5s %6s %10s %10s %10s %10s\n", "path", "body", "read", "calls/MB", "copied KB", "programs",
+           "erases");
+    auto report = [&](const char *path, bool gzip, size_t read, uint32_t calls, uint64_t copied)
+    {
+        host::FlashStats flash = host::flashStats();
+        if (host::readPartition(target, imageSize) != image)
+        {
+            benchFail(std::string("flash_writes ") + path + " " + std::to_string(read));
+        }
+        printf("%-10s %-5s %6u %10.0f %10.1f %10.0f %10.0f\n", path, gzip ? "gzip" : "raw", (unsigned)read,
+               calls / mb, copied / 1024.0 / mb, flash.writeCalls / mb, flash.eraseCalls / mb);
+        fflush(stdout);
+    };
+
+    for (bool gzip : {false, true})
+    {
+        const std::string &body = gzip ? compressed : image;
+        for (size_t read : reads)
+        {
+            host::reset();
+            Update.begin(imageSize, U_FLASH);
+            OTAInflater inflater([](const uint8_t *data, size_t len)
+                                 { return Update.write(const_cast<uint8_t *>(data), len) == len; });
+            inflater.begin();
+            for (size_t offset = 0; offset < body.size(); offset += read)
+            {
+                const uint8_t *piece = (const uint8_t *)body.data() + offset;
+                size_t len = std::min(read, body.size() - offset);
+                if (gzip)
+                {
+                    inflater.write(piece, len);
+                }
+                else
+                {
+                    Update.write(const_cast<uint8_t *>(piece), len);
+                }
+            }
+            Update.end();
+            report("Update", gzip, read, host::updateStats().writes, host::updateStats().copiedBytes);
+
+            host::reset();
+            OTAUpdate ota("http://127.0.0.1");
+            ota.setPipelineBufferSize(0);
+            HostStream stream(body);
+            stream.setSegment(read);
+            if (!OTAHostAccess::updateFromStream(ota, stream, body.size(), U_FLASH,
+                                                 gzip ? OTA_ENCODING_GZIP : OTA_ENCODING_IDENTITY))
+            {
+                benchFail("flash_writes update " + std::to_string(read));
+            }
+            const OTATransferStats &stats = ota.getTransferStats();
+            report("partition", gzip, read, stats.flashWrites, stats.copiedBytes + host::updateStats().copiedBytes);
+        }
+    }
+}
+
+// The pieces of the data path on their own: host CPU time per MB and the heap each needs
+HOST_BENCH(components)
+{
+    size_t imageSize = options.quick ? 256 * 1024 : 2 * 1024 * 1024;
+    std::string image = images::app(imageSize);
+    printf("%-34s %10s %9s %8s\n", "component", "ms per MB", "heap pk", "allocs");
+
+    auto report = [&](const std::string &name, double seconds, size_t bytes)
+    {
+        host::HeapStats heap = host::heapStats();
+        printf("%-34s %10.2f %9u %8u\n", name.c_str(), seconds * 1000 * 1024 * 1024 / bytes, (unsigned)heap.peak,
+               heap.allocations);
+    };
+
+    host::useVirtualClock(true);
+    for (size_t maxRead : {512, 4096, 16384})
+    {
+        HostStream stream(image);
+        stream.setSegment(1460);
+        std::vector<uint8_t> buffer(maxRead);
+        host::markHeap();
+        BenchTimer timer;
+        OTATransferReader reader(stream, image.size(), maxRead);
+        while (!reader.done())
+        {
+            reader.read(buffer.data(), buffer.size());
+        }
+        report("OTATransferReader max " + std::to_string(maxRead), timer.seconds(), image.size());
+    }
+    host::useVirtualClock(false);
+
+    for (size_t piece : {512, 1460, 4096, 16384})
+    {
+        size_t sink = 0;
+        OTASectorBuffer sectors([&sink](const uint8_t *, size_t len)
+                                {
+                                    sink += len;
+                                    return true; });
+        host::markHeap();
+        BenchTimer timer;
+        sectors.begin();
+        for (size_t offset = 0; offset < image.size(); offset += piece)
+        {
+            sectors.write((const uint8_t *)image.data() + offset, std::min(piece, image.size() - offset));
+        }
+        sectors.flush();
+        report("OTASectorBuffer pieces of " + std::to_string(piece), timer.seconds(), image.size());
+    }
+
+    for (int bits : {10, 15})
+    {
+        std::string compressed = images::gzip(image, bits);
+        size_t produced = 0;
+        host::markHeap();
+        BenchTimer timer;
+        OTAInflater inflater([&produced](const uint8_t *, size_t len)
+                             {
+                                 produced += len;
+                                 return true; },
+                             bits);
+        inflater.begin();
+        for (size_t offset = 0; offset < compressed.size(); offset += 1460)
+        {
+            inflater.write((const uint8_t *)compressed.data() + offset, std::min((size_t)1460, compressed.size() - offset));
+        }
+        double seconds = timer.seconds();
+        if (!inflater.finished() || produced != image.size())
+        {
+            benchFail("OTAInflater window " + std::to_string(bits));
+        }
+        report("OTAInflater window 2^" + std::to_string(bits), seconds, image.size());
+    }
+
+    {
+        // The source has to fit the running app partition
+        std::string source = image.substr(0, std::min(imageSize, (size_t)1024 * 1024));
+        std::string target = source;
+        for (size_t i = 0; i < target.size(); i += 9973)
+        {
+            target[i] ^= 0x20;
+        }
+        std::string patch = images::delta(source, target);
+        host::writePartition(esp_ota_get_running_partition(), source);
+        host::setSketchSize(source.size());
+        String md5 = ESP.getSketchMD5();
+        size_t produced = 0;
+        host::markHeap();
+        BenchTimer timer;
+        OTADeltaPatcher patcher(esp_ota_get_running_partition(), md5, [&produced](const uint8_t *, size_t len)
+                                {
+                                    produced += len;
+                                    return true; });
+        for (size_t offset = 0; offset < patch.size(); offset += 1460)
+        {
+            patcher.write((const uint8_t *)patch.data() + offset, std::min((size_t)1460, patch.size() - offset));
+        }
+        double seconds = timer.seconds();
+        if (!patcher.finished() || produced != target.size())
+        {
+            benchFail("OTADeltaPatcher");
+        }
+        report("OTADeltaPatcher", seconds, target.size());
+    }
+
+    {
+        std::string bundle = images::bundle({images::section(OTABundleReader::SECTION_APP, image),
+                                             images::section(OTABundleReader::SECTION_SPIFFS, images::spiffs(imageSize / 2))});
+        size_t produced = 0;
+        host::markHeap();
+        BenchTimer timer;
+        OTABundleReader reader([](const OTABundleReader::Section &)
+                               { return true; },
+                               [&produced](const uint8_t *, size_t len)
+                               {
+                                   produced += len;
+                                   return true; },
+                               [](const OTABundleReader::Section &)
+                               { return true; });
+        for (size_t offset = 0; offset < bundle.size(); offset += 1460)
+        {
+            reader.write((const uint8_t *)bundle.data() + offset, std::min((size_t)1460, bundle.size() - offset));
+        }
+        double seconds = timer.seconds();
+        if (!reader.finished())
+        {
+            benchFail("OTABundleReader");
+        }
+        report("OTABundleReader", seconds, bundle.size());
+    }
+}
@@ -0,0 +1,836 @@
+#define OPENSSL_SUPPRESS_DEPRECATED
+#include <Arduino.h>
+#include <malloc.h>
+#include <openssl/md5.h>
+#include <esp_ota_ops.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <new>
+#include <random>
+#include <thread>
+#include <unordered_set>
+#include "Host.h"
+
+HardwareSerial Serial;
+EspClass ESP;
+
+// ---------------------------------------------------------------- heap
+
+// Every block carries a header with its size, so frees are counted exactly.
+// The blocks handed out here are kept in a set, so blocks libc allocated on
+// its own can be told apart and passed through without looking before them.
+extern "C"
+{
+    void *__real_malloc(size_t size);
+    void __real_free(void *ptr);
+    void *__real_calloc(size_t count, size_t size);
+    void *__real_realloc(void *ptr, size_t size);
+}
+
+namespace
+{
+    struct BlockHeader
+    {
+        uint64_t size; // top bit set when the block is not counted
+        uint64_t reserved; // keeps the block 16-byte aligned
+    };
+    const uint64_t UNCOUNTED = 1ull << 63;
+
+    std::atomic<int64_t> heapLive(0);
+    std::atomic<int64_t> heapPeak(0);
+    std::atomic<uint32_t> heapAllocations(0);
+    std::atomic<uint32_t> heapFrees(0);
+    std::atomic<size_t> failMinSize(0);
+    std::atomic<int64_t> failSkip(-1);
+    thread_local bool heapIgnored = false;
+
+    // Bookkeeping of the stand-ins themselves stays off the device's heap figures
+    class HeapPause
+    {
+    public:
+        HeapPause() : saved(heapIgnored) { heapIgnored = true; }
+        ~HeapPause() { heapIgnored = saved; }
+
+    private:
+        bool saved;
+    };
+
+    // The set's own nodes come straight from libc, or tracking would recurse
+    template <class T>
+    struct RealAllocator
+    {
+        typedef T value_type;
+        RealAllocator() {}
+        template <class U>
+        RealAllocator(const RealAllocator<U> &) {}
+        T *allocate(size_t n)
+        {
+            void *ptr = __real_malloc(n * sizeof(T));
+            if (!ptr)
+            {
+                throw std::bad_alloc();
+            }
+            return static_cast<T *>(ptr);
+        }
+        void deallocate(T *ptr, size_t) { __real_free(ptr); }
+        template <class U>
+        bool operator==(const RealAllocator<U> &) const { return true; }
+        template <class U>
+        bool operator!=(const RealAllocator<U> &) const { return false; }
+    };
+    typedef std::unordered_set<void *, std::hash<void *>, std::equal_to<void *>, RealAllocator<void *> > BlockSet;
+
+    std::mutex blocksMutex;
+
+    // Never destroyed: frees keep arriving while static objects are torn down
+    BlockSet &blocks()
+    {
+        static BlockSet *set = new (__real_malloc(sizeof(BlockSet))) BlockSet();
+        return *set;
+    }
+
+    void track(void *ptr)
+    {
+        std::lock_guard<std::mutex> lock(blocksMutex);
+        blocks().insert(ptr);
+    }
+
+    // The header of a block handed out here, null for any other pointer
+    BlockHeader *headerOf(void *ptr)
+    {
+        std::lock_guard<std::mutex> lock(blocksMutex);
+        return blocks().count(ptr) ? static_cast<BlockHeader *>(ptr) - 1 : nullptr;
+    }
+
+    void untrack(void *ptr)
+    {
+        std::lock_guard<std::mutex> lock(blocksMutex);
+        blocks().erase(ptr);
+    }
+
+    void *countedAlloc(size_t size)
+    {
+        if (failSkip.load() >= 0 && size >= failMinSize.load() && failSkip.fetch_sub(1) == 0)
+        {
+            failSkip = -1;
+            return nullptr;
+        }
+        BlockHeader *header = static_cast<BlockHeader *>(__real_malloc(sizeof(BlockHeader) + size));
+        if (!header)
+        {
+            return nullptr;
+        }
+        header->size = size | (heapIgnored ? UNCOUNTED : 0);
+        track(header + 1);
+        if (!heapIgnored)
+        {
+            int64_t live = heapLive += size;
+            int64_t peak = heapPeak.load();
+            while (live > peak && !heapPeak.compare_exchange_weak(peak, live))
+            {
+            }
+            heapAllocations++;
+        }
+        return header + 1;
+    }
+
+    void countedFree(void *ptr)
+    {
+        if (!ptr)
+        {
+            return;
+        }
+        BlockHeader *header = headerOf(ptr);
+        if (!header)
+        {
+            __real_free(ptr);
+            return;
+        }
+        if (!(header->size & UNCOUNTED))
+        {
+            heapLive -= header->size;
+            heapFrees++;
+        }
+        untrack(ptr);
+        __real_free(header);
+    }
+}
+
+extern "C"
+{
+    void *__wrap_malloc(size_t size)
+    {
+        return countedAlloc(size);
+    }
+
+    void __wrap_free(void *ptr)
+    {
+        countedFree(ptr);
+    }
+
+    void *__wrap_calloc(size_t count, size_t size)
+    {
+        void *ptr = countedAlloc(count * size);
+        if (ptr)
+        {
+            memset(ptr, 0, count * size);
+        }
+        return ptr;
+    }
+
+    void *__wrap_realloc(void *ptr, size_t size)
+    {
+        if (!ptr)
+        {
+            return countedAlloc(size);
+        }
+        BlockHeader *header = headerOf(ptr);
+        if (!header)
+        {
+            return __real_realloc(ptr, size);
+        }
+        void *moved = countedAlloc(size);
+        if (moved)
+        {
+            memcpy(moved, ptr, min((size_t)(header->size & ~UNCOUNTED), size));
+            countedFree(ptr);
+        }
+        return moved;
+    }
+}
+
+void *operator new(size_t size)
+{
+    void *ptr = countedAlloc(size ? size : 1);
+    if (!ptr)
+    {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    return countedAlloc(size ? size : 1);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+    return countedAlloc(size ? size : 1);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    countedFree(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    countedFree(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    countedFree(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept
+{
+    countedFree(ptr);
+}
+
+namespace host
+{
+    void markHeap()
+    {
+        heapLive = 0;
+        heapPeak = 0;
+        heapAllocations = 0;
+        heapFrees = 0;
+    }
+
+    HeapStats heapStats()
+    {
+        HeapStats stats;
+        stats.live = (size_t)max<int64_t>(heapLive.load(), 0);
+        stats.peak = (size_t)max<int64_t>(heapPeak.load(), 0);
+        stats.allocations = heapAllocations;
+        stats.frees = heapFrees;
+        return stats;
+    }
+
+    void ignoreHeap()
+    {
+        heapIgnored = true;
+    }
+
+    void failAllocations(size_t minSize, uint32_t skip)
+    {
+        failMinSize = minSize;
+        failSkip = skip;
+    }
+
+    void resetHeap()
+    {
+        failSkip = -1;
+        markHeap();
+    }
+}
+
+// ---------------------------------------------------------------- clock
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    std::atomic<bool> clockVirtual(false);
+    std::atomic<uint64_t> virtualMicros(0);
+    Clock::time_point realStart = Clock::now();
+
+    uint64_t nowMicros()
+    {
+        if (clockVirtual)
+        {
+            return virtualMicros;
+        }
+        return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - realStart).count();
+    }
+
+    // What a core loop does while it waits for a byte
+    void idle()
+    {
+        if (clockVirtual)
+        {
+            virtualMicros += 1000;
+        }
+        else
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+}
+
+namespace host
+{
+    void useVirtualClock(bool on)
+    {
+        virtualMicros = nowMicros();
+        clockVirtual = on;
+        realStart = Clock::now() - std::chrono::microseconds(virtualMicros.load());
+    }
+
+    bool virtualClock()
+    {
+        return clockVirtual;
+    }
+
+    void spend(uint64_t micros)
+    {
+        if (clockVirtual)
+        {
+            virtualMicros += micros;
+        }
+        else if (micros > 0)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(micros));
+        }
+    }
+
+    void resetClock()
+    {
+        clockVirtual = false;
+        virtualMicros = 0;
+        realStart = Clock::now();
+    }
+}
+
+unsigned long millis()
+{
+    return nowMicros() / 1000;
+}
+
+unsigned long micros()
+{
+    return nowMicros();
+}
+
+void delay(uint32_t ms)
+{
+    host::spend((uint64_t)ms * 1000);
+}
+
+void delayMicroseconds(uint32_t us)
+{
+    host::spend(us);
+}
+
+void yield()
+{
+    if (!clockVirtual)
+    {
+        std::this_thread::yield();
+    }
+}
+
+// ---------------------------------------------------------------- random
+
+namespace
+{
+    std::mutex randomLock;
+    std::mt19937 randomEngine(1);
+}
+
+namespace host
+{
+    void seedRandom(uint32_t seed)
+    {
+        std::lock_guard<std::mutex> lock(randomLock);
+        randomEngine.seed(seed);
+    }
+
+    uint32_t nextRandom()
+    {
+        std::lock_guard<std::mutex> lock(randomLock);
+        return randomEngine();
+    }
+}
+
+long random(long howBig)
+{
+    return howBig <= 0 ? 0 : (long)(host::nextRandom() % (uint32_t)howBig);
+}
+
+long random(long howSmall, long howBig)
+{
+    return howSmall >= howBig ? howSmall : howSmall + random(howBig - howSmall);
+}
+
+void randomSeed(unsigned long seed)
+{
+    host::seedRandom(seed);
+}
+
+uint32_t esp_random()
+{
+    return host::nextRandom();
+}
+
+// ---------------------------------------------------------------- String
+
+std::string String::format(unsigned long long v, unsigned char base)
+{
+    if (base < 2 || base > 36)
+    {
+        base = 10;
+    }
+    std::string out;
+    do
+    {
+        out.insert(out.begin(), "0123456789abcdefghijklmnopqrstuvwxyz"[v % base]);
+        v /= base;
+    } while (v > 0);
+    return out;
+}
+
+std::string String::formatSigned(long long v, unsigned char base)
+{
+    if (v < 0 && base == 10)
+    {
+        return "-" + format(0ull - (unsigned long long)v, base);
+    }
+    return format((unsigned long long)v, base);
+}
+
+std::string String::formatFloat(double v, unsigned int decimals)
+{
+    char text[64];
+    snprintf(text, sizeof(text), "%.*f", (int)decimals, v);
+    return text;
+}
+
+bool String::equalsIgnoreCase(const String &s) const
+{
+    return text.size() == s.text.size() && strncasecmp(text.c_str(), s.text.c_str(), text.size()) == 0;
+}
+
+String String::substring(unsigned int from, unsigned int to) const
+{
+    if (from > to)
+    {
+        std::swap(from, to);
+    }
+    if (from >= text.size())
+    {
+        return String();
+    }
+    to = min(to, (unsigned int)text.size());
+    return String(text.substr(from, to - from));
+}
+
+void String::trim()
+{
+    size_t first = 0;
+    while (first < text.size() && isSpace(text[first]))
+    {
+        first++;
+    }
+    size_t last = text.size();
+    while (last > first && isSpace(text[last - 1]))
+    {
+        last--;
+    }
+    text = text.substr(first, last - first);
+}
+
+void String::toLowerCase()
+{
+    for (char &c : text)
+    {
+        c = tolower((unsigned char)c);
+    }
+}
+
+void String::toUpperCase()
+{
+    for (char &c : text)
+    {
+        c = toupper((unsigned char)c);
+    }
+}
+
+void String::remove(unsigned int index, unsigned int count)
+{
+    if (index < text.size())
+    {
+        text.erase(index, count);
+    }
+}
+
+void String::replace(const String &from, const String &to)
+{
+    if (from.text.empty())
+    {
+        return;
+    }
+    size_t pos = 0;
+    while ((pos = text.find(from.text, pos)) != std::string::npos)
+    {
+        text.replace(pos, from.text.size(), to.text);
+        pos += to.text.size();
+    }
+}
+
+String operator+(const String &a, const String &b)
+{
+    return String(a.str() + b.str());
+}
+
+String operator+(const String &a, const char *b)
+{
+    return String(a.str() + (b ? b : ""));
+}
+
+String operator+(const char *a, const String &b)
+{
+    return String((a ? a : "") + b.str());
+}
+
+String operator+(const String &a, char b)
+{
+    return String(a.str() + b);
+}
+
+String operator+(const String &a, int b)
+{
+    return a + String(b);
+}
+
+String operator+(const String &a, unsigned int b)
+{
+    return a + String(b);
+}
+
+String operator+(const String &a, long b)
+{
+    return a + String(b);
+}
+
+String operator+(const String &a, unsigned long b)
+{
+    return a + String(b);
+}
+
+// ---------------------------------------------------------------- Print, Stream
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+    size_t n = 0;
+    while (size--)
+    {
+        if (!write(*buffer++))
+        {
+            break;
+        }
+        n++;
+    }
+    return n;
+}
+
+size_t Print::printf(const char *format, ...)
+{
+    char small[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(small, sizeof(small), format, args);
+    va_end(args);
+    if (length < 0)
+    {
+        return 0;
+    }
+    if ((size_t)length < sizeof(small))
+    {
+        return write((const uint8_t *)small, length);
+    }
+    std::string large(length + 1, '\0');
+    va_start(args, format);
+    vsnprintf(&large[0], large.size(), format, args);
+    va_end(args);
+    return write((const uint8_t *)large.data(), length);
+}
+
+int Stream::timedRead()
+{
+    unsigned long start = millis();
+    do
+    {
+        int c = read();
+        if (c >= 0)
+        {
+            return c;
+        }
+        idle();
+    } while (millis() - start < timeoutMs);
+    return -1;
+}
+
+int Stream::timedPeek()
+{
+    unsigned long start = millis();
+    do
+    {
+        int c = peek();
+        if (c >= 0)
+        {
+            return c;
+        }
+        idle();
+    } while (millis() - start < timeoutMs);
+    return -1;
+}
+
+size_t Stream::readBytes(char *buffer, size_t length)
+{
+    size_t count = 0;
+    while (count < length)
+    {
+        int c = timedRead();
+        if (c < 0)
+        {
+            break;
+        }
+        *buffer++ = (char)c;
+        count++;
+    }
+    return count;
+}
+
+String Stream::readString()
+{
+    std::string out;
+    int c;
+    while ((c = timedRead()) >= 0)
+    {
+        out += (char)c;
+    }
+    return String(out);
+}
+
+String Stream::readStringUntil(char terminator)
+{
+    std::string out;
+    int c;
+    while ((c = timedRead()) >= 0 && c != terminator)
+    {
+        out += (char)c;
+    }
+    return String(out);
+}
+
+// ---------------------------------------------------------------- Serial
+
+namespace
+{
+    std::mutex serialLock;
+    std::string serialCapture;
+    bool serialEcho = getenv("HOST_VERBOSE") != nullptr;
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+    return write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size)
+{
+    std::lock_guard<std::mutex> lock(serialLock);
+    HeapPause pause;
+    serialCapture.append((const char *)buffer, size);
+    if (serialEcho)
+    {
+        fwrite(buffer, 1, size, stdout);
+        fflush(stdout);
+    }
+    return size;
+}
+
+namespace host
+{
+    std::string serialOutput()
+    {
+        std::lock_guard<std::mutex> lock(serialLock);
+        return serialCapture;
+    }
+
+    void clearSerial()
+    {
+        std::lock_guard<std::mutex> lock(serialLock);
+        serialCapture.clear();
+    }
+
+    bool serialContains(const std::string &text)
+    {
+        std::lock_guard<std::mutex> lock(serialLock);
+        return serialCapture.find(text) != std::string::npos;
+    }
+
+    void resetSerial()
+    {
+        clearSerial();
+    }
+}
+
+// ---------------------------------------------------------------- IPAddress
+
+String IPAddress::toString() const
+{
+    char text[16];
+    snprintf(text, sizeof(text), "%u.%u.%u.%u", address[0], address[1], address[2], address[3]);
+    return String(text);
+}
+
+bool IPAddress::fromString(const char *text)
+{
+    unsigned a, b, c, d;
+    char tail;
+    if (sscanf(text, "%u.%u.%u.%u%c", &a, &b, &c, &d, &tail) != 4 || a > 255 || b > 255 || c > 255 || d > 255)
+    {
+        return false;
+    }
+    *this = IPAddress(a, b, c, d);
+    return true;
+}
+
+// ---------------------------------------------------------------- ESP
+
+namespace
+{
+    std::atomic<uint32_t> restartCount(0);
+    uint32_t sketchSize = 0;
+}
+
+namespace host
+{
+    uint32_t restarts()
+    {
+        return restartCount;
+    }
+
+    void setSketchSize(uint32_t size)
+    {
+        sketchSize = size;
+    }
+
+    void resetEsp()
+    {
+        restartCount = 0;
+        sketchSize = 0;
+    }
+
+    void reset()
+    {
+        resetClock();
+        resetSerial();
+        resetEsp();
+        resetFlash();
+        resetUpdate();
+        resetPreferences();
+        resetFilesystems();
+        resetNetwork();
+        resetTls();
+        seedRandom(1);
+        resetHeap();
+    }
+}
+
+void EspClass::restart()
+{
+    restartCount++;
+}
+
+uint32_t EspClass::getHeapSize()
+{
+    return host::HEAP_SIZE;
+}
+
+uint32_t EspClass::getFreeHeap()
+{
+    return host::HEAP_SIZE - min(host::heapStats().live, host::HEAP_SIZE);
+}
+
+uint32_t EspClass::getMinFreeHeap()
+{
+    return host::HEAP_SIZE - min(host::heapStats().peak, host::HEAP_SIZE);
+}
+
+uint32_t EspClass::getMaxAllocHeap()
+{
+    return getFreeHeap();
+}
+
+uint32_t EspClass::getSketchSize()
+{
+    return sketchSize;
+}
+
+String EspClass::getSketchMD5()
+{
+    if (sketchSize == 0)
+    {
+        return String();
+    }
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    unsigned char digest[MD5_DIGEST_LENGTH];
+    MD5(host::flash(running), min(sketchSize, running->size), digest);
+    char hex[2 * MD5_DIGEST_LENGTH + 1];
+    for (int i = 0; i < MD5_DIGEST_LENGTH; i++)
+    {
+        snprintf(hex + 2 * i, 3, "%02x", digest[i]);
+    }
+    return String(hex);
+}
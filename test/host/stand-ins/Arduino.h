@@ -0,0 +1,279 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Host stand-in for the parts of the ESP32 Arduino core the library uses.
+// Behaviour follows arduino-esp32 where the library depends on it; see
+// HostControl.h for the knobs tests turn.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include <sys/time.h>
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+using std::max;
+using std::min;
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+#define IRAM_ATTR
+#define ARDUINO_RUNNING_CORE 1
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+class __FlashStringHelper;
+#define F(string_literal) (string_literal)
+
+class String
+{
+public:
+    String(const char *s = "") : text(s ? s : "") {}
+    String(const std::string &s) : text(s) {}
+    String(const String &other) = default;
+    String(String &&other) = default;
+    explicit String(char c) : text(1, c) {}
+    explicit String(unsigned char v, unsigned char base = 10) : text(format((unsigned long long)v, base)) {}
+    explicit String(int v, unsigned char base = 10) : text(formatSigned(v, base)) {}
+    explicit String(unsigned int v, unsigned char base = 10) : text(format(v, base)) {}
+    explicit String(long v, unsigned char base = 10) : text(formatSigned(v, base)) {}
+    explicit String(unsigned long v, unsigned char base = 10) : text(format(v, base)) {}
+    explicit String(long long v, unsigned char base = 10) : text(formatSigned(v, base)) {}
+    explicit String(unsigned long long v, unsigned char base = 10) : text(format(v, base)) {}
+    explicit String(float v, unsigned int decimals = 2) : text(formatFloat(v, decimals)) {}
+    explicit String(double v, unsigned int decimals = 2) : text(formatFloat(v, decimals)) {}
+
+    String &operator=(const String &other) = default;
+    String &operator=(String &&other) = default;
+    String &operator=(const char *s)
+    {
+        text = s ? s : "";
+        return *this;
+    }
+
+    String &operator+=(const String &s) { text += s.text; return *this; }
+    String &operator+=(const char *s) { text += s ? s : ""; return *this; }
+    String &operator+=(char c) { text += c; return *this; }
+    String &operator+=(int v) { text += formatSigned(v, 10); return *this; }
+    String &operator+=(unsigned int v) { text += format(v, 10); return *this; }
+    String &operator+=(long v) { text += formatSigned(v, 10); return *this; }
+    String &operator+=(unsigned long v) { text += format(v, 10); return *this; }
+    bool concat(const String &s) { text += s.text; return true; }
+    bool concat(const char *s) { text += s ? s : ""; return true; }
+    bool concat(const char *s, unsigned int len) { text.append(s, len); return true; }
+    bool concat(char c) { text += c; return true; }
+
+    bool operator==(const String &s) const { return text == s.text; }
+    bool operator==(const char *s) const { return text == (s ? s : ""); }
+    bool operator!=(const String &s) const { return text != s.text; }
+    bool operator!=(const char *s) const { return !(*this == s); }
+    bool operator<(const String &s) const { return text < s.text; }
+    bool equals(const String &s) const { return text == s.text; }
+    bool equals(const char *s) const { return *this == s; }
+    bool equalsIgnoreCase(const String &s) const;
+
+    const char *c_str() const { return text.c_str(); }
+    unsigned int length() const { return text.size(); }
+    bool isEmpty() const { return text.empty(); }
+    bool reserve(unsigned int size)
+    {
+        text.reserve(size);
+        return true;
+    }
+    explicit operator bool() const { return true; }
+
+    char operator[](unsigned int index) const { return index < text.size() ? text[index] : 0; }
+    char &operator[](unsigned int index) { return text[index]; }
+    char charAt(unsigned int index) const { return (*this)[index]; }
+    void setCharAt(unsigned int index, char c)
+    {
+        if (index < text.size())
+        {
+            text[index] = c;
+        }
+    }
+
+    int indexOf(char c, unsigned int from = 0) const { return find(text.find(c, from)); }
+    int indexOf(const char *s, unsigned int from = 0) const { return find(text.find(s, from)); }
+    int indexOf(const String &s, unsigned int from = 0) const { return find(text.find(s.text, from)); }
+    int lastIndexOf(char c) const { return find(text.rfind(c)); }
+    int lastIndexOf(const char *s) const { return find(text.rfind(s)); }
+    String substring(unsigned int from) const { return from < text.size() ? String(text.substr(from)) : String(); }
+    String substring(unsigned int from, unsigned int to) const;
+
+    bool startsWith(const String &s) const { return text.compare(0, s.text.size(), s.text) == 0; }
+    bool startsWith(const char *s) const { return startsWith(String(s)); }
+    bool startsWith(const String &s, unsigned int offset) const
+    {
+        return offset <= text.size() && text.compare(offset, s.text.size(), s.text) == 0;
+    }
+    bool endsWith(const String &s) const
+    {
+        return s.text.size() <= text.size() && text.compare(text.size() - s.text.size(), s.text.size(), s.text) == 0;
+    }
+    bool endsWith(const char *s) const { return endsWith(String(s)); }
+
+    long toInt() const { return atol(text.c_str()); }
+    float toFloat() const { return atof(text.c_str()); }
+    double toDouble() const { return atof(text.c_str()); }
+    void trim();
+    void toLowerCase();
+    void toUpperCase();
+    void remove(unsigned int index) { remove(index, text.size()); }
+    void remove(unsigned int index, unsigned int count);
+    void replace(const String &from, const String &to);
+
+    // Host only
+    const std::string &str() const { return text; }
+
+private:
+    static std::string format(unsigned long long v, unsigned char base);
+    static std::string formatSigned(long long v, unsigned char base);
+    static std::string formatFloat(double v, unsigned int decimals);
+    static int find(size_t pos) { return pos == std::string::npos ? -1 : (int)pos; }
+
+    std::string text;
+};
+
+String operator+(const String &a, const String &b);
+String operator+(const String &a, const char *b);
+String operator+(const char *a, const String &b);
+String operator+(const String &a, char b);
+String operator+(const String &a, int b);
+String operator+(const String &a, unsigned int b);
+String operator+(const String &a, long b);
+String operator+(const String &a, unsigned long b);
+
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size);
+    size_t write(const char *s) { return s ? write((const uint8_t *)s, strlen(s)) : 0; }
+    size_t write(const char *buffer, size_t size) { return write((const uint8_t *)buffer, size); }
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+    size_t print(const String &s) { return write(s.c_str()); }
+    size_t print(const char *s) { return write(s); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int v) { return print(String(v)); }
+    size_t print(unsigned int v) { return print(String(v)); }
+    size_t print(long v) { return print(String(v)); }
+    size_t print(unsigned long v) { return print(String(v)); }
+    size_t print(double v, int decimals = 2) { return print(String(v, decimals)); }
+    size_t println() { return write("\r\n"); }
+    template <typename T>
+    size_t println(const T &v)
+    {
+        size_t n = print(v);
+        return n + println();
+    }
+    virtual void flush() {}
+};
+
+class Stream : public Print
+{
+public:
+    Stream() : timeoutMs(1000) {}
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long timeout) { timeoutMs = timeout; }
+    unsigned long getTimeout() const { return timeoutMs; }
+
+    // Waits up to the timeout for each byte, like the core
+    virtual size_t readBytes(char *buffer, size_t length);
+    size_t readBytes(uint8_t *buffer, size_t length) { return readBytes((char *)buffer, length); }
+    String readString();
+    String readStringUntil(char terminator);
+
+protected:
+    int timedRead();
+    int timedPeek();
+
+    unsigned long timeoutMs;
+};
+
+class HardwareSerial : public Stream
+{
+public:
+    void begin(unsigned long) {}
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+class IPAddress
+{
+public:
+    IPAddress() : address{0, 0, 0, 0} {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : address{a, b, c, d} {}
+    explicit IPAddress(uint32_t value) { memcpy(address, &value, 4); }
+    operator uint32_t() const
+    {
+        uint32_t value;
+        memcpy(&value, address, 4);
+        return value;
+    }
+    bool operator==(const IPAddress &other) const { return memcmp(address, other.address, 4) == 0; }
+    bool operator!=(const IPAddress &other) const { return !(*this == other); }
+    uint8_t operator[](int index) const { return address[index]; }
+    uint8_t &operator[](int index) { return address[index]; }
+    String toString() const;
+    bool fromString(const char *text);
+
+private:
+    uint8_t address[4];
+};
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+long random(long howBig);
+long random(long howSmall, long howBig);
+void randomSeed(unsigned long seed);
+uint32_t esp_random();
+
+inline bool isDigit(int c)
+{
+    return c >= '0' && c <= '9';
+}
+
+inline bool isSpace(int c)
+{
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+class EspClass
+{
+public:
+    // Records the restart for the test instead of resetting the process
+    void restart();
+    uint32_t getFreeHeap();
+    uint32_t getMinFreeHeap();
+    uint32_t getMaxAllocHeap();
+    uint32_t getHeapSize();
+    uint32_t getSketchSize();
+    String getSketchMD5();
+};
+
+extern EspClass ESP;
+
+#endif
@@ -0,0 +1,960 @@
+#include <ArduinoJson.h>
+#include <ctype.h>
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+
+namespace ArduinoJson
+{
+    namespace detail
+    {
+        namespace
+        {
+            class MallocAllocator : public Allocator
+            {
+            public:
+                void *allocate(size_t size) override { return malloc(size); }
+                void deallocate(void *ptr) override { free(ptr); }
+                void *reallocate(void *ptr, size_t new_size) override { return realloc(ptr, new_size); }
+            };
+        }
+
+        Allocator *defaultAllocator()
+        {
+            static MallocAllocator allocator;
+            return &allocator;
+        }
+
+        void *Pool::allocate(size_t size)
+        {
+            Block *block = static_cast<Block *>(allocator->allocate(sizeof(Block) + size));
+            if (!block)
+            {
+                failed = true;
+                return nullptr;
+            }
+            block->previous = newest;
+            newest = block;
+            return block + 1;
+        }
+
+        void *Pool::reallocate(void *payload, size_t size)
+        {
+            Block *block = static_cast<Block *>(payload) - 1;
+            if (block != newest)
+            {
+                return nullptr;
+            }
+            Block *moved = static_cast<Block *>(allocator->reallocate(block, sizeof(Block) + size));
+            if (!moved)
+            {
+                failed = true;
+                return nullptr;
+            }
+            newest = moved;
+            return moved + 1;
+        }
+
+        void Pool::clear()
+        {
+            // Newest first, so a stack-like allocator gets every block back
+            while (newest)
+            {
+                Block *previous = newest->previous;
+                allocator->deallocate(newest);
+                newest = previous;
+            }
+            failed = false;
+        }
+
+        Node *Pool::node()
+        {
+            Node *node = static_cast<Node *>(allocate(sizeof(Node)));
+            if (node)
+            {
+                reset(node, NODE_NULL);
+                node->key = nullptr;
+                node->next = nullptr;
+            }
+            return node;
+        }
+
+        const char *Pool::copy(const char *text, size_t length)
+        {
+            char *out = static_cast<char *>(allocate(length + 1));
+            if (out)
+            {
+                memcpy(out, text, length);
+                out[length] = '\0';
+            }
+            return out;
+        }
+
+        void reset(Node *node, NodeType type)
+        {
+            if (node)
+            {
+                node->type = type;
+                node->integer = 0;
+            }
+        }
+
+        const Node *member(const Node *object, const char *key)
+        {
+            if (!object || object->type != NODE_OBJECT || !key)
+            {
+                return nullptr;
+            }
+            for (const Node *child = object->first; child; child = child->next)
+            {
+                if (strcmp(child->key, key) == 0)
+                {
+                    return child;
+                }
+            }
+            return nullptr;
+        }
+
+        const Node *element(const Node *array, size_t index)
+        {
+            if (!array || array->type != NODE_ARRAY)
+            {
+                return nullptr;
+            }
+            const Node *child = array->first;
+            while (child && index-- > 0)
+            {
+                child = child->next;
+            }
+            return child;
+        }
+
+        namespace
+        {
+            void link(Node *parent, Node *child)
+            {
+                Node **slot = &parent->first;
+                while (*slot)
+                {
+                    slot = &(*slot)->next;
+                }
+                *slot = child;
+            }
+        }
+
+        Node *memberOrAdd(Pool *pool, Node *node, const char *key)
+        {
+            if (!node || !key)
+            {
+                return nullptr;
+            }
+            if (node->type == NODE_NULL)
+            {
+                reset(node, NODE_OBJECT);
+            }
+            if (node->type != NODE_OBJECT)
+            {
+                return nullptr;
+            }
+            Node *found = const_cast<Node *>(member(node, key));
+            if (found)
+            {
+                return found;
+            }
+            const char *name = pool->copy(key, strlen(key));
+            Node *added = name ? pool->node() : nullptr;
+            if (!added)
+            {
+                return nullptr;
+            }
+            added->key = name;
+            link(node, added);
+            return added;
+        }
+
+        Node *append(Pool *pool, Node *array)
+        {
+            if (!array)
+            {
+                return nullptr;
+            }
+            if (array->type == NODE_NULL)
+            {
+                reset(array, NODE_ARRAY);
+            }
+            if (array->type != NODE_ARRAY)
+            {
+                return nullptr;
+            }
+            Node *added = pool->node();
+            if (added)
+            {
+                link(array, added);
+            }
+            return added;
+        }
+
+        Node *elementOrAdd(Pool *pool, Node *node, size_t index)
+        {
+            if (!node)
+            {
+                return nullptr;
+            }
+            if (node->type == NODE_NULL)
+            {
+                reset(node, NODE_ARRAY);
+            }
+            while (count(node) <= index)
+            {
+                if (!append(pool, node))
+                {
+                    return nullptr;
+                }
+            }
+            return const_cast<Node *>(element(node, index));
+        }
+
+        size_t count(const Node *node)
+        {
+            if (!node || (node->type != NODE_ARRAY && node->type != NODE_OBJECT))
+            {
+                return 0;
+            }
+            size_t n = 0;
+            for (const Node *child = node->first; child; child = child->next)
+            {
+                n++;
+            }
+            return n;
+        }
+
+        void setString(Pool *pool, Node *node, const char *text)
+        {
+            if (!text)
+            {
+                reset(node, NODE_NULL);
+                return;
+            }
+            const char *copy = pool->copy(text, strlen(text));
+            reset(node, copy ? NODE_STRING : NODE_NULL);
+            if (copy)
+            {
+                node->string = copy;
+            }
+        }
+
+        namespace
+        {
+            void writeString(String &out, const char *text)
+            {
+                out += '"';
+                for (const char *p = text; *p; p++)
+                {
+                    switch (*p)
+                    {
+                    case '"':
+                        out += "\\\"";
+                        break;
+                    case '\\':
+                        out += "\\\\";
+                        break;
+                    case '\n':
+                        out += "\\n";
+                        break;
+                    case '\r':
+                        out += "\\r";
+                        break;
+                    case '\t':
+                        out += "\\t";
+                        break;
+                    case '\b':
+                        out += "\\b";
+                        break;
+                    case '\f':
+                        out += "\\f";
+                        break;
+                    default:
+                        if ((uint8_t)*p < 0x20)
+                        {
+                            char escaped[8];
+                            snprintf(escaped, sizeof(escaped), "\\u%04x", *p);
+                            out += escaped;
+                        }
+                        else
+                        {
+                            out += *p;
+                        }
+                    }
+                }
+                out += '"';
+            }
+
+            void write(String &out, const Node *node)
+            {
+                if (!node)
+                {
+                    out += "null";
+                    return;
+                }
+                char number[32];
+                switch (node->type)
+                {
+                case NODE_NULL:
+                    out += "null";
+                    break;
+                case NODE_BOOL:
+                    out += node->boolean ? "true" : "false";
+                    break;
+                case NODE_INT:
+                    snprintf(number, sizeof(number), "%lld", (long long)node->integer);
+                    out += number;
+                    break;
+                case NODE_FLOAT:
+                    if (isnan(node->real) || isinf(node->real))
+                    {
+                        out += "null";
+                    }
+                    else
+                    {
+                        snprintf(number, sizeof(number), "%.9g", node->real);
+                        out += number;
+                    }
+                    break;
+                case NODE_STRING:
+                    writeString(out, node->string);
+                    break;
+                case NODE_ARRAY:
+                case NODE_OBJECT:
+                {
+                    bool object = node->type == NODE_OBJECT;
+                    out += object ? '{' : '[';
+                    for (const Node *child = node->first; child; child = child->next)
+                    {
+                        if (child != node->first)
+                        {
+                            out += ',';
+                        }
+                        if (object)
+                        {
+                            writeString(out, child->key);
+                            out += ':';
+                        }
+                        write(out, child);
+                    }
+                    out += object ? '}' : ']';
+                    break;
+                }
+                }
+            }
+        }
+
+        String toJson(const Node *node)
+        {
+            String out;
+            write(out, node);
+            return out;
+        }
+
+        namespace
+        {
+            class Reader
+            {
+            public:
+                Reader() : peeked(-2) {}
+                virtual ~Reader() {}
+
+                int peek()
+                {
+                    if (peeked == -2)
+                    {
+                        peeked = next();
+                    }
+                    return peeked;
+                }
+                int read()
+                {
+                    int c = peek();
+                    peeked = -2;
+                    return c;
+                }
+
+            protected:
+                virtual int next() = 0; // -1 at the end
+
+            private:
+                int peeked;
+            };
+
+            class StreamReader : public Reader
+            {
+            public:
+                explicit StreamReader(Stream &stream) : stream(stream) {}
+
+            protected:
+                int next() override
+                {
+                    char c;
+                    return stream.readBytes(&c, 1) == 1 ? (uint8_t)c : -1;
+                }
+
+            private:
+                Stream &stream;
+            };
+
+            class BufferReader : public Reader
+            {
+            public:
+                BufferReader(const char *data, size_t length) : data(data), left(length) {}
+
+            protected:
+                int next() override
+                {
+                    if (left == 0)
+                    {
+                        return -1;
+                    }
+                    left--;
+                    return (uint8_t)*data++;
+                }
+
+            private:
+                const char *data;
+                size_t left;
+            };
+
+            // What the filter lets through at one place in the document
+            struct Filter
+            {
+                const Node *node;
+                bool all;
+
+                static Filter everything() { return Filter{nullptr, true}; }
+                bool allowValue() const { return all || (node && node->type == NODE_BOOL && node->boolean); }
+                bool allowObject() const { return allowValue() || (node && node->type == NODE_OBJECT); }
+                bool allowArray() const { return allowValue() || (node && node->type == NODE_ARRAY); }
+                Filter member(const char *key) const
+                {
+                    if (allowValue())
+                    {
+                        return everything();
+                    }
+                    const Node *found = detail::member(node, key);
+                    return Filter{found ? found : detail::member(node, "*"), false};
+                }
+                Filter element() const
+                {
+                    return allowValue() ? everything() : Filter{detail::element(node, 0), false};
+                }
+            };
+
+            class Parser
+            {
+            public:
+                Parser(Reader &reader, Pool &pool, uint8_t nestingLimit)
+                    : reader(reader), pool(pool), depthLeft(nestingLimit)
+                {
+                }
+
+                DeserializationError::Code parse(Node *root, Filter filter)
+                {
+                    skipSpace();
+                    if (reader.peek() < 0)
+                    {
+                        return DeserializationError::EmptyInput;
+                    }
+                    return value(root, filter);
+                }
+
+            private:
+                typedef DeserializationError::Code Code;
+
+                void skipSpace()
+                {
+                    while (true)
+                    {
+                        int c = reader.peek();
+                        if (c != ' ' && c != '\t' && c != '\r' && c != '\n')
+                        {
+                            return;
+                        }
+                        reader.read();
+                    }
+                }
+
+                // node is null when the value is filtered out
+                Code value(Node *node, Filter filter)
+                {
+                    skipSpace();
+                    int c = reader.peek();
+                    switch (c)
+                    {
+                    case -1:
+                        return DeserializationError::IncompleteInput;
+                    case '{':
+                        return object(filter.allowObject() ? node : nullptr, filter);
+                    case '[':
+                        return array(filter.allowArray() ? node : nullptr, filter);
+                    case '"':
+                    case '\'':
+                        return stringValue(filter.allowValue() ? node : nullptr);
+                    default:
+                        return scalar(filter.allowValue() ? node : nullptr);
+                    }
+                }
+
+                Code object(Node *node, Filter filter)
+                {
+                    if (depthLeft == 0)
+                    {
+                        return DeserializationError::TooDeep;
+                    }
+                    depthLeft--;
+                    reader.read();
+                    if (node)
+                    {
+                        reset(node, NODE_OBJECT);
+                    }
+                    skipSpace();
+                    if (reader.peek() == '}')
+                    {
+                        reader.read();
+                        depthLeft++;
+                        return DeserializationError::Ok;
+                    }
+                    while (true)
+                    {
+                        skipSpace();
+                        int c = reader.peek();
+                        if (c < 0)
+                        {
+                            return DeserializationError::IncompleteInput;
+                        }
+                        if (c != '"' && c != '\'')
+                        {
+                            return DeserializationError::InvalidInput;
+                        }
+                        const char *key = nullptr;
+                        String scratch;
+                        Code code = string(scratch);
+                        if (code != DeserializationError::Ok)
+                        {
+                            return code;
+                        }
+                        skipSpace();
+                        c = reader.read();
+                        if (c != ':')
+                        {
+                            return c < 0 ? DeserializationError::IncompleteInput : DeserializationError::InvalidInput;
+                        }
+                        Filter memberFilter = filter.member(scratch.c_str());
+                        Node *child = nullptr;
+                        bool keep = node && (memberFilter.allowValue() || memberFilter.allowObject() ||
+                                             memberFilter.allowArray());
+                        if (keep)
+                        {
+                            Node *existing = const_cast<Node *>(member(node, scratch.c_str()));
+                            if (existing)
+                            {
+                                child = existing;
+                            }
+                            else
+                            {
+                                key = pool.copy(scratch.c_str(), scratch.length());
+                                child = key ? pool.node() : nullptr;
+                                if (!child)
+                                {
+                                    return DeserializationError::NoMemory;
+                                }
+                                child->key = key;
+                                link(node, child);
+                            }
+                        }
+                        code = value(child, memberFilter);
+                        if (code != DeserializationError::Ok)
+                        {
+                            return code;
+                        }
+                        skipSpace();
+                        c = reader.read();
+                        if (c == '}')
+                        {
+                            depthLeft++;
+                            return DeserializationError::Ok;
+                        }
+                        if (c != ',')
+                        {
+                            return c < 0 ? DeserializationError::IncompleteInput : DeserializationError::InvalidInput;
+                        }
+                    }
+                }
+
+                Code array(Node *node, Filter filter)
+                {
+                    if (depthLeft == 0)
+                    {
+                        return DeserializationError::TooDeep;
+                    }
+                    depthLeft--;
+                    reader.read();
+                    if (node)
+                    {
+                        reset(node, NODE_ARRAY);
+                    }
+                    skipSpace();
+                    if (reader.peek() == ']')
+                    {
+                        reader.read();
+                        depthLeft++;
+                        return DeserializationError::Ok;
+                    }
+                    Filter elementFilter = filter.element();
+                    bool keep = node && (elementFilter.allowValue() || elementFilter.allowObject() ||
+                                         elementFilter.allowArray());
+                    while (true)
+                    {
+                        Node *child = nullptr;
+                        if (keep)
+                        {
+                            child = pool.node();
+                            if (!child)
+                            {
+                                return DeserializationError::NoMemory;
+                            }
+                            link(node, child);
+                        }
+                        Code code = value(child, elementFilter);
+                        if (code != DeserializationError::Ok)
+                        {
+                            return code;
+                        }
+                        skipSpace();
+                        int c = reader.read();
+                        if (c == ']')
+                        {
+                            depthLeft++;
+                            return DeserializationError::Ok;
+                        }
+                        if (c != ',')
+                        {
+                            return c < 0 ? DeserializationError::IncompleteInput : DeserializationError::InvalidInput;
+                        }
+                    }
+                }
+
+                Code stringValue(Node *node)
+                {
+                    if (!node)
+                    {
+                        String skipped;
+                        return string(skipped);
+                    }
+                    // Built in a block that grows in place, then shrinks to fit
+                    size_t capacity = 32;
+                    size_t length = 0;
+                    char *text = static_cast<char *>(pool.allocate(capacity));
+                    if (!text)
+                    {
+                        return DeserializationError::NoMemory;
+                    }
+                    String scratch;
+                    Code code = string(scratch);
+                    if (code != DeserializationError::Ok)
+                    {
+                        return code;
+                    }
+                    length = scratch.length();
+                    if (length + 1 > capacity)
+                    {
+                        while (length + 1 > capacity)
+                        {
+                            capacity *= 2;
+                        }
+                        text = static_cast<char *>(pool.reallocate(text, capacity));
+                        if (!text)
+                        {
+                            return DeserializationError::NoMemory;
+                        }
+                    }
+                    memcpy(text, scratch.c_str(), length + 1);
+                    text = static_cast<char *>(pool.reallocate(text, length + 1));
+                    if (!text)
+                    {
+                        return DeserializationError::NoMemory;
+                    }
+                    reset(node, NODE_STRING);
+                    node->string = text;
+                    return DeserializationError::Ok;
+                }
+
+                static int hexDigit(int c)
+                {
+                    if (c >= '0' && c <= '9')
+                    {
+                        return c - '0';
+                    }
+                    c |= 0x20;
+                    return c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+                }
+
+                Code codepoint(uint32_t &value)
+                {
+                    value = 0;
+                    for (int i = 0; i < 4; i++)
+                    {
+                        int c = reader.read();
+                        if (c < 0)
+                        {
+                            return DeserializationError::IncompleteInput;
+                        }
+                        int digit = hexDigit(c);
+                        if (digit < 0)
+                        {
+                            return DeserializationError::InvalidInput;
+                        }
+                        value = (value << 4) | digit;
+                    }
+                    return DeserializationError::Ok;
+                }
+
+                static void appendUtf8(String &out, uint32_t cp)
+                {
+                    if (cp < 0x80)
+                    {
+                        out += (char)cp;
+                    }
+                    else if (cp < 0x800)
+                    {
+                        out += (char)(0xC0 | (cp >> 6));
+                        out += (char)(0x80 | (cp & 0x3F));
+                    }
+                    else if (cp < 0x10000)
+                    {
+                        out += (char)(0xE0 | (cp >> 12));
+                        out += (char)(0x80 | ((cp >> 6) & 0x3F));
+                        out += (char)(0x80 | (cp & 0x3F));
+                    }
+                    else
+                    {
+                        out += (char)(0xF0 | (cp >> 18));
+                        out += (char)(0x80 | ((cp >> 12) & 0x3F));
+                        out += (char)(0x80 | ((cp >> 6) & 0x3F));
+                        out += (char)(0x80 | (cp & 0x3F));
+                    }
+                }
+
+                Code string(String &out)
+                {
+                    int quote = reader.read();
+                    while (true)
+                    {
+                        int c = reader.read();
+                        if (c < 0)
+                        {
+                            return DeserializationError::IncompleteInput;
+                        }
+                        if (c == quote)
+                        {
+                            return DeserializationError::Ok;
+                        }
+                        if (c != '\\')
+                        {
+                            out += (char)c;
+                            continue;
+                        }
+                        c = reader.read();
+                        switch (c)
+                        {
+                        case -1:
+                            return DeserializationError::IncompleteInput;
+                        case 'b':
+                            out += '\b';
+                            break;
+                        case 'f':
+                            out += '\f';
+                            break;
+                        case 'n':
+                            out += '\n';
+                            break;
+                        case 'r':
+                            out += '\r';
+                            break;
+                        case 't':
+                            out += '\t';
+                            break;
+                        case 'u':
+                        {
+                            uint32_t cp;
+                            Code code = codepoint(cp);
+                            if (code != DeserializationError::Ok)
+                            {
+                                return code;
+                            }
+                            if (cp >= 0xD800 && cp < 0xDC00)
+                            {
+                                uint32_t low;
+                                if (reader.read() != '\\' || reader.read() != 'u')
+                                {
+                                    return DeserializationError::InvalidInput;
+                                }
+                                code = codepoint(low);
+                                if (code != DeserializationError::Ok)
+                                {
+                                    return code;
+                                }
+                                cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                            }
+                            appendUtf8(out, cp);
+                            break;
+                        }
+                        default:
+                            out += (char)c;
+                        }
+                    }
+                }
+
+                Code scalar(Node *node)
+                {
+                    String token;
+                    while (true)
+                    {
+                        int c = reader.peek();
+                        if (c < 0 || !(isalnum(c) || c == '-' || c == '+' || c == '.'))
+                        {
+                            break;
+                        }
+                        token += (char)reader.read();
+                    }
+                    if (token.length() == 0)
+                    {
+                        return reader.peek() < 0 ? DeserializationError::IncompleteInput
+                                                 : DeserializationError::InvalidInput;
+                    }
+                    Node parsed;
+                    parsed.key = nullptr;
+                    parsed.next = nullptr;
+                    if (token == "true" || token == "false")
+                    {
+                        reset(&parsed, NODE_BOOL);
+                        parsed.boolean = token == "true";
+                    }
+                    else if (token == "null")
+                    {
+                        reset(&parsed, NODE_NULL);
+                    }
+                    else
+                    {
+                        const char *text = token.c_str();
+                        char *end = nullptr;
+                        errno = 0;
+                        long long integer = strtoll(text, &end, 10);
+                        if (*end == '\0' && errno == 0)
+                        {
+                            reset(&parsed, NODE_INT);
+                            parsed.integer = integer;
+                        }
+                        else
+                        {
+                            double real = strtod(text, &end);
+                            if (*end != '\0')
+                            {
+                                return DeserializationError::InvalidInput;
+                            }
+                            reset(&parsed, NODE_FLOAT);
+                            parsed.real = real;
+                        }
+                    }
+                    if (node)
+                    {
+                        node->type = parsed.type;
+                        node->integer = parsed.integer;
+                    }
+                    return DeserializationError::Ok;
+                }
+
+                Reader &reader;
+                Pool &pool;
+                uint8_t depthLeft;
+            };
+
+            DeserializationError run(JsonDocument &doc, Reader &reader, Filter filter)
+            {
+                doc.clear();
+                Parser parser(reader, doc.hostPool(), DeserializationOption::NestingLimit().value());
+                DeserializationError::Code code = parser.parse(&doc.hostRoot(), filter);
+                if (code == DeserializationError::Ok && doc.overflowed())
+                {
+                    code = DeserializationError::NoMemory;
+                }
+                return code;
+            }
+
+            Filter toFilter(DeserializationOption::Filter filter)
+            {
+                return Filter{filter.value().raw(), false};
+            }
+        }
+    }
+
+    const char *DeserializationError::c_str() const
+    {
+        static const char *const NAMES[] = {"Ok", "EmptyInput", "IncompleteInput", "InvalidInput", "NoMemory", "TooDeep"};
+        return NAMES[value];
+    }
+
+    DeserializationError deserializeJson(JsonDocument &doc, Stream &input)
+    {
+        detail::StreamReader reader(input);
+        return detail::run(doc, reader, detail::Filter::everything());
+    }
+
+    DeserializationError deserializeJson(JsonDocument &doc, Stream &input, DeserializationOption::Filter filter)
+    {
+        detail::StreamReader reader(input);
+        return detail::run(doc, reader, detail::toFilter(filter));
+    }
+
+    DeserializationError deserializeJson(JsonDocument &doc, const String &input)
+    {
+        return deserializeJson(doc, input.c_str(), input.length());
+    }
+
+    DeserializationError deserializeJson(JsonDocument &doc, const String &input, DeserializationOption::Filter filter)
+    {
+        return deserializeJson(doc, input.c_str(), input.length(), filter);
+    }
+
+    DeserializationError deserializeJson(JsonDocument &doc, const char *input)
+    {
+        return deserializeJson(doc, input, input ? strlen(input) : 0);
+    }
+
+    DeserializationError deserializeJson(JsonDocument &doc, const char *input, size_t length)
+    {
+        detail::BufferReader reader(input, length);
+        return detail::run(doc, reader, detail::Filter::everything());
+    }
+
+    DeserializationError deserializeJson(JsonDocument &doc, const char *input, size_t length,
+                                         DeserializationOption::Filter filter)
+    {
+        detail::BufferReader reader(input, length);
+        return detail::run(doc, reader, detail::toFilter(filter));
+    }
+
+    size_t serializeJson(JsonVariantConst source, String &output)
+    {
+        output = detail::toJson(source.raw());
+        return output.length();
+    }
+
+    size_t serializeJson(JsonVariantConst source, Print &output)
+    {
+        String text = detail::toJson(source.raw());
+        return output.write((const uint8_t *)text.c_str(), text.length());
+    }
+
+    size_t measureJson(JsonVariantConst source)
+    {
+        return detail::toJson(source.raw()).length();
+    }
+}
@@ -0,0 +1,560 @@
+#ifndef HOST_ARDUINOJSON_H
+#define HOST_ARDUINOJSON_H
+
+// The part of the ArduinoJson 7 API the library uses: documents on a custom
+// Allocator, filtered parsing from a Stream or String, and building and
+// serializing the metrics document. Every node and string goes through the
+// document's allocator, so an arena sized for the device is exercised as it
+// would be there. Unlike ArduinoJson, indexing a JsonVariant or JsonDocument
+// creates the member right away; read through JsonVariantConst.
+
+#include <Arduino.h>
+#include <limits>
+#include <type_traits>
+
+namespace ArduinoJson
+{
+    class Allocator
+    {
+    public:
+        virtual void *allocate(size_t size) = 0;
+        virtual void deallocate(void *ptr) = 0;
+        virtual void *reallocate(void *ptr, size_t new_size) = 0;
+
+    protected:
+        ~Allocator() = default;
+    };
+
+    namespace detail
+    {
+        enum NodeType : uint8_t
+        {
+            NODE_NULL,
+            NODE_BOOL,
+            NODE_INT,
+            NODE_FLOAT,
+            NODE_STRING,
+            NODE_ARRAY,
+            NODE_OBJECT
+        };
+
+        struct Node
+        {
+            NodeType type;
+            const char *key;
+            union
+            {
+                bool boolean;
+                int64_t integer;
+                double real;
+                const char *string;
+                Node *first;
+            };
+            Node *next;
+        };
+
+        Allocator *defaultAllocator();
+
+        // Every allocation of one document, newest first, so they can all be
+        // given back; only the newest block is ever reallocated
+        class Pool
+        {
+        public:
+            explicit Pool(Allocator *allocator) : allocator(allocator), newest(nullptr), failed(false) {}
+            ~Pool() { clear(); }
+
+            void *allocate(size_t size);
+            void *reallocate(void *payload, size_t size);
+            void clear();
+            Node *node();
+            const char *copy(const char *text, size_t length);
+            bool overflowed() const { return failed; }
+
+        private:
+            struct Block
+            {
+                Block *previous;
+                size_t pad; // keeps the payload 8-byte aligned on 32-bit hosts too
+            };
+
+            Allocator *allocator;
+            Block *newest;
+            bool failed;
+        };
+
+        const Node *member(const Node *object, const char *key);
+        const Node *element(const Node *array, size_t index);
+        Node *memberOrAdd(Pool *pool, Node *node, const char *key);
+        Node *elementOrAdd(Pool *pool, Node *node, size_t index);
+        Node *append(Pool *pool, Node *array);
+        void reset(Node *node, NodeType type);
+        size_t count(const Node *node);
+        void setString(Pool *pool, Node *node, const char *text);
+        String toJson(const Node *node);
+
+        template <typename T, typename Enable = void>
+        struct Converter;
+
+        template <typename T>
+        struct Converter<T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type>
+        {
+            static bool fits(int64_t value)
+            {
+                if (std::is_signed<T>::value)
+                {
+                    return value >= (int64_t)std::numeric_limits<T>::min() &&
+                           value <= (int64_t)std::numeric_limits<T>::max();
+                }
+                return value >= 0 && (uint64_t)value <= (uint64_t)std::numeric_limits<T>::max();
+            }
+            static bool is(const Node *node) { return node && node->type == NODE_INT && fits(node->integer); }
+            static T as(const Node *node)
+            {
+                if (!node)
+                {
+                    return 0;
+                }
+                switch (node->type)
+                {
+                case NODE_INT:
+                    return fits(node->integer) ? (T)node->integer : 0;
+                case NODE_FLOAT:
+                    return node->real >= (double)std::numeric_limits<T>::min() &&
+                                   node->real <= (double)std::numeric_limits<T>::max()
+                               ? (T)node->real
+                               : 0;
+                case NODE_BOOL:
+                    return node->boolean;
+                default:
+                    return 0;
+                }
+            }
+            static void set(Pool *, Node *node, T value)
+            {
+                reset(node, NODE_INT);
+                node->integer = (int64_t)value;
+            }
+        };
+
+        template <typename T>
+        struct Converter<T, typename std::enable_if<std::is_floating_point<T>::value>::type>
+        {
+            static bool is(const Node *node) { return node && (node->type == NODE_INT || node->type == NODE_FLOAT); }
+            static T as(const Node *node)
+            {
+                if (!node)
+                {
+                    return 0;
+                }
+                return node->type == NODE_INT ? (T)node->integer : node->type == NODE_FLOAT ? (T)node->real : 0;
+            }
+            static void set(Pool *, Node *node, T value)
+            {
+                reset(node, NODE_FLOAT);
+                node->real = value;
+            }
+        };
+
+        template <>
+        struct Converter<bool>
+        {
+            static bool is(const Node *node) { return node && node->type == NODE_BOOL; }
+            static bool as(const Node *node)
+            {
+                if (!node)
+                {
+                    return false;
+                }
+                return node->type == NODE_BOOL ? node->boolean : node->type == NODE_INT ? node->integer != 0 : false;
+            }
+            static void set(Pool *, Node *node, bool value)
+            {
+                reset(node, NODE_BOOL);
+                node->boolean = value;
+            }
+        };
+
+        template <>
+        struct Converter<const char *>
+        {
+            static bool is(const Node *node) { return node && node->type == NODE_STRING; }
+            static const char *as(const Node *node) { return is(node) ? node->string : nullptr; }
+            static void set(Pool *pool, Node *node, const char *value) { setString(pool, node, value); }
+        };
+
+        template <>
+        struct Converter<String>
+        {
+            static bool is(const Node *node) { return node && node->type == NODE_STRING; }
+            static String as(const Node *node) { return is(node) ? String(node->string) : toJson(node); }
+            static void set(Pool *pool, Node *node, const String &value) { setString(pool, node, value.c_str()); }
+        };
+    }
+
+    class JsonArrayConst;
+    class JsonObjectConst;
+    class JsonArray;
+    class JsonObject;
+
+    class JsonVariantConst
+    {
+    public:
+        JsonVariantConst() : node(nullptr) {}
+        explicit JsonVariantConst(const detail::Node *node) : node(node) {}
+
+        bool isNull() const { return !node || node->type == detail::NODE_NULL; }
+        size_t size() const { return detail::count(node); }
+
+        JsonVariantConst operator[](const char *key) const { return JsonVariantConst(detail::member(node, key)); }
+        JsonVariantConst operator[](const String &key) const { return (*this)[key.c_str()]; }
+        template <typename T>
+        typename std::enable_if<std::is_integral<T>::value, JsonVariantConst>::type operator[](T index) const
+        {
+            return JsonVariantConst(detail::element(node, index));
+        }
+
+        template <typename T>
+        typename std::enable_if<!std::is_same<T, JsonArrayConst>::value && !std::is_same<T, JsonObjectConst>::value,
+                                bool>::type
+        is() const
+        {
+            return detail::Converter<T>::is(node);
+        }
+        template <typename T>
+        typename std::enable_if<std::is_same<T, JsonArrayConst>::value, bool>::type is() const
+        {
+            return node && node->type == detail::NODE_ARRAY;
+        }
+        template <typename T>
+        typename std::enable_if<std::is_same<T, JsonObjectConst>::value, bool>::type is() const
+        {
+            return node && node->type == detail::NODE_OBJECT;
+        }
+
+        template <typename T>
+        typename std::enable_if<!std::is_same<T, JsonArrayConst>::value && !std::is_same<T, JsonObjectConst>::value,
+                                T>::type
+        as() const
+        {
+            return detail::Converter<T>::as(node);
+        }
+        template <typename T>
+        typename std::enable_if<std::is_same<T, JsonArrayConst>::value, T>::type as() const;
+        template <typename T>
+        typename std::enable_if<std::is_same<T, JsonObjectConst>::value, T>::type as() const;
+
+        template <typename T>
+        operator T() const
+        {
+            return as<T>();
+        }
+
+        const detail::Node *raw() const { return node; }
+
+    private:
+        const detail::Node *node;
+    };
+
+    // Default when the value is missing or of another type
+    inline const char *operator|(JsonVariantConst variant, const char *fallback)
+    {
+        return variant.is<const char *>() ? variant.as<const char *>() : fallback;
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_arithmetic<T>::value, T>::type operator|(JsonVariantConst variant, T fallback)
+    {
+        return variant.is<T>() ? variant.as<T>() : fallback;
+    }
+
+    class JsonArrayConst
+    {
+    public:
+        class iterator
+        {
+        public:
+            explicit iterator(const detail::Node *node) : node(node) {}
+            JsonVariantConst operator*() const { return JsonVariantConst(node); }
+            iterator &operator++()
+            {
+                node = node->next;
+                return *this;
+            }
+            bool operator!=(const iterator &other) const { return node != other.node; }
+
+        private:
+            const detail::Node *node;
+        };
+
+        JsonArrayConst() : node(nullptr) {}
+        explicit JsonArrayConst(const detail::Node *node) : node(node) {}
+
+        iterator begin() const { return iterator(node ? node->first : nullptr); }
+        iterator end() const { return iterator(nullptr); }
+        size_t size() const { return detail::count(node); }
+        bool isNull() const { return !node; }
+        JsonVariantConst operator[](size_t index) const { return JsonVariantConst(detail::element(node, index)); }
+
+    private:
+        const detail::Node *node;
+    };
+
+    class JsonObjectConst
+    {
+    public:
+        JsonObjectConst() : node(nullptr) {}
+        explicit JsonObjectConst(const detail::Node *node) : node(node) {}
+
+        size_t size() const { return detail::count(node); }
+        bool isNull() const { return !node; }
+        JsonVariantConst operator[](const char *key) const { return JsonVariantConst(detail::member(node, key)); }
+
+    private:
+        const detail::Node *node;
+    };
+
+    template <typename T>
+    typename std::enable_if<std::is_same<T, JsonArrayConst>::value, T>::type JsonVariantConst::as() const
+    {
+        return JsonArrayConst(is<JsonArrayConst>() ? node : nullptr);
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_same<T, JsonObjectConst>::value, T>::type JsonVariantConst::as() const
+    {
+        return JsonObjectConst(is<JsonObjectConst>() ? node : nullptr);
+    }
+
+    class JsonVariant
+    {
+    public:
+        JsonVariant() : pool(nullptr), node(nullptr) {}
+        JsonVariant(detail::Pool *pool, detail::Node *node) : pool(pool), node(node) {}
+
+        bool isNull() const { return !node || node->type == detail::NODE_NULL; }
+        size_t size() const { return detail::count(node); }
+
+        JsonVariant operator[](const char *key) const
+        {
+            return JsonVariant(pool, detail::memberOrAdd(pool, node, key));
+        }
+        JsonVariant operator[](const String &key) const { return (*this)[key.c_str()]; }
+        template <typename T>
+        typename std::enable_if<std::is_integral<T>::value, JsonVariant>::type operator[](T index) const
+        {
+            return JsonVariant(pool, detail::elementOrAdd(pool, node, index));
+        }
+
+        template <typename T>
+        JsonVariant &operator=(const T &value)
+        {
+            set(value);
+            return *this;
+        }
+        JsonVariant &operator=(const char *value)
+        {
+            set(value);
+            return *this;
+        }
+
+        template <typename T>
+        void set(const T &value)
+        {
+            if (node)
+            {
+                detail::Converter<T>::set(pool, node, value);
+            }
+        }
+        void set(const char *value)
+        {
+            if (node)
+            {
+                detail::setString(pool, node, value);
+            }
+        }
+
+        // Replaces the value with an empty object or array
+        template <typename T>
+        T to() const
+        {
+            detail::reset(node, std::is_same<T, JsonArray>::value ? detail::NODE_ARRAY : detail::NODE_OBJECT);
+            return T(pool, node);
+        }
+
+        template <typename T>
+        bool is() const
+        {
+            return JsonVariantConst(node).is<T>();
+        }
+        template <typename T>
+        T as() const
+        {
+            return JsonVariantConst(node).as<T>();
+        }
+
+        operator JsonVariantConst() const { return JsonVariantConst(node); }
+
+    protected:
+        detail::Pool *pool;
+        detail::Node *node;
+    };
+
+    class JsonObject : public JsonVariant
+    {
+    public:
+        JsonObject() {}
+        JsonObject(detail::Pool *pool, detail::Node *node) : JsonVariant(pool, node) {}
+    };
+
+    class JsonArray : public JsonVariant
+    {
+    public:
+        JsonArray() {}
+        JsonArray(detail::Pool *pool, detail::Node *node) : JsonVariant(pool, node) {}
+
+        template <typename T>
+        bool add(const T &value)
+        {
+            detail::Node *added = detail::append(pool, node);
+            if (!added)
+            {
+                return false;
+            }
+            JsonVariant(pool, added).set(value);
+            return true;
+        }
+        bool add(const char *value) { return add<const char *>(value); }
+    };
+
+    class JsonDocument
+    {
+    public:
+        explicit JsonDocument(Allocator *allocator = detail::defaultAllocator()) : pool(allocator)
+        {
+            detail::reset(&root, detail::NODE_NULL);
+            root.key = nullptr;
+            root.next = nullptr;
+        }
+        JsonDocument(const JsonDocument &) = delete;
+        JsonDocument &operator=(const JsonDocument &) = delete;
+
+        void clear()
+        {
+            detail::reset(&root, detail::NODE_NULL);
+            pool.clear();
+        }
+        bool overflowed() const { return pool.overflowed(); }
+        bool isNull() const { return root.type == detail::NODE_NULL; }
+        size_t size() const { return detail::count(&root); }
+
+        JsonVariant operator[](const char *key) { return JsonVariant(&pool, &root)[key]; }
+        JsonVariant operator[](const String &key) { return (*this)[key.c_str()]; }
+        template <typename T>
+        typename std::enable_if<std::is_integral<T>::value, JsonVariant>::type operator[](T index)
+        {
+            return JsonVariant(&pool, &root)[index];
+        }
+        JsonVariantConst operator[](const char *key) const { return JsonVariantConst(&root)[key]; }
+
+        template <typename T>
+        T to()
+        {
+            return JsonVariant(&pool, &root).to<T>();
+        }
+        template <typename T>
+        T as() const
+        {
+            return JsonVariantConst(&root).as<T>();
+        }
+        template <typename T>
+        bool is() const
+        {
+            return JsonVariantConst(&root).is<T>();
+        }
+
+        operator JsonVariant() { return JsonVariant(&pool, &root); }
+        operator JsonVariantConst() const { return JsonVariantConst(&root); }
+
+        detail::Pool &hostPool() { return pool; }
+        detail::Node &hostRoot() { return root; }
+
+    private:
+        detail::Pool pool;
+        detail::Node root;
+    };
+
+    class DeserializationError
+    {
+    public:
+        enum Code
+        {
+            Ok,
+            EmptyInput,
+            IncompleteInput,
+            InvalidInput,
+            NoMemory,
+            TooDeep
+        };
+
+        DeserializationError() : value(Ok) {}
+        DeserializationError(Code code) : value(code) {}
+
+        bool operator==(Code code) const { return value == code; }
+        bool operator!=(Code code) const { return value != code; }
+        explicit operator bool() const { return value != Ok; }
+        Code code() const { return value; }
+        const char *c_str() const;
+
+    private:
+        Code value;
+    };
+
+    namespace DeserializationOption
+    {
+        class Filter
+        {
+        public:
+            explicit Filter(JsonVariantConst variant) : variant(variant) {}
+            JsonVariantConst value() const { return variant; }
+
+        private:
+            JsonVariantConst variant;
+        };
+
+        class NestingLimit
+        {
+        public:
+            explicit NestingLimit(uint8_t limit = 10) : limit(limit) {}
+            uint8_t value() const { return limit; }
+
+        private:
+            uint8_t limit;
+        };
+    }
+
+    DeserializationError deserializeJson(JsonDocument &doc, Stream &input);
+    DeserializationError deserializeJson(JsonDocument &doc, Stream &input, DeserializationOption::Filter filter);
+    DeserializationError deserializeJson(JsonDocument &doc, const String &input);
+    DeserializationError deserializeJson(JsonDocument &doc, const String &input, DeserializationOption::Filter filter);
+    DeserializationError deserializeJson(JsonDocument &doc, const char *input);
+    DeserializationError deserializeJson(JsonDocument &doc, const char *input, size_t length);
+    DeserializationError deserializeJson(JsonDocument &doc, const char *input, size_t length,
+                                         DeserializationOption::Filter filter);
+
+    size_t serializeJson(JsonVariantConst source, String &output);
+    size_t serializeJson(JsonVariantConst source, Print &output);
+    size_t measureJson(JsonVariantConst source);
+    inline size_t serializeJson(const JsonDocument &doc, String &output)
+    {
+        return serializeJson(JsonVariantConst(doc), output);
+    }
+    inline size_t serializeJson(const JsonDocument &doc, Print &output)
+    {
+        return serializeJson(JsonVariantConst(doc), output);
+    }
+    inline size_t measureJson(const JsonDocument &doc) { return measureJson(JsonVariantConst(doc)); }
+}
+
+using namespace ArduinoJson;
+
+#endif
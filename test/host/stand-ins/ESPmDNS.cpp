@@ -0,0 +1,82 @@
+#include <ESPmDNS.h>
+#include "Host.h"
+
+MDNSResponder MDNS;
+
+namespace
+{
+    std::vector<host::MdnsService> services;
+
+    const host::MdnsService *at(int idx)
+    {
+        return idx >= 0 && (size_t)idx < services.size() ? &services[idx] : nullptr;
+    }
+}
+
+namespace host
+{
+    void setMdnsServices(const std::vector<MdnsService> &list)
+    {
+        services = list;
+    }
+
+    const std::vector<MdnsService> &mdnsServices()
+    {
+        return services;
+    }
+}
+
+bool MDNSResponder::begin(const char *hostName)
+{
+    return host::wifiConnected();
+}
+
+bool MDNSResponder::addService(const char *service, const char *proto, uint16_t port)
+{
+    return true;
+}
+
+bool MDNSResponder::addServiceTxt(const char *name, const char *proto, const char *key, const char *value)
+{
+    return true;
+}
+
+int MDNSResponder::queryService(const char *service, const char *proto)
+{
+    return services.size();
+}
+
+String MDNSResponder::hostname(int idx)
+{
+    return at(idx) ? String(at(idx)->host) : String();
+}
+
+IPAddress MDNSResponder::IP(int idx)
+{
+    return at(idx) ? IPAddress(at(idx)->ip) : IPAddress();
+}
+
+uint16_t MDNSResponder::port(int idx)
+{
+    return at(idx) ? at(idx)->port : 0;
+}
+
+String MDNSResponder::txt(int idx, const char *key)
+{
+    if (at(idx))
+    {
+        for (const auto &entry : at(idx)->txt)
+        {
+            if (entry.first == key)
+            {
+                return String(entry.second);
+            }
+        }
+    }
+    return String();
+}
+
+bool MDNSResponder::hasTxt(int idx, const char *key)
+{
+    return txt(idx, key).length() > 0;
+}
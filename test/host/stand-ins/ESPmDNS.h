@@ -0,0 +1,26 @@
+#ifndef HOST_ESPMDNS_H
+#define HOST_ESPMDNS_H
+
+// Browse results come from host::setMdnsServices()
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+
+class MDNSResponder
+{
+public:
+    bool begin(const char *hostName);
+    void end() {}
+    bool addService(const char *service, const char *proto, uint16_t port);
+    bool addServiceTxt(const char *name, const char *proto, const char *key, const char *value);
+    int queryService(const char *service, const char *proto);
+    String hostname(int idx);
+    IPAddress IP(int idx);
+    uint16_t port(int idx);
+    String txt(int idx, const char *key);
+    bool hasTxt(int idx, const char *key);
+};
+
+extern MDNSResponder MDNS;
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef HOST_FFAT_H
+#define HOST_FFAT_H
+
+#include "FS.h"
+
+namespace fs
+{
+    class F_Fat : public FS
+    {
+    public:
+        bool begin(bool formatOnFail = false, const char *basePath = "/ffat", uint8_t maxOpenFiles = 10,
+                   const char *partitionLabel = "ffat")
+        {
+            return mount();
+        }
+        void end() { unmount(); }
+        bool format();
+        size_t totalBytes();
+        size_t usedBytes() { return used(); }
+    };
+}
+
+extern fs::F_Fat FFat;
+
+#endif
@@ -0,0 +1,280 @@
+#include <FS.h>
+#include <SPIFFS.h>
+#include <LittleFS.h>
+#include <FFat.h>
+#include <esp_partition.h>
+#include <atomic>
+#include "Host.h"
+
+fs::SPIFFSFS SPIFFS;
+fs::LittleFSFS LittleFS;
+fs::F_Fat FFat;
+
+namespace
+{
+    std::atomic<bool> mountable(true);
+
+    std::string baseName(const std::string &path)
+    {
+        size_t slash = path.rfind('/');
+        return slash == std::string::npos ? path : path.substr(slash + 1);
+    }
+
+    std::string normalize(const char *path)
+    {
+        std::string out = path ? path : "";
+        return out.empty() || out[0] != '/' ? "/" + out : out;
+    }
+}
+
+namespace host
+{
+    void setFilesystemMountable(bool on)
+    {
+        mountable = on;
+    }
+
+    void resetFilesystems()
+    {
+        mountable = true;
+        for (fs::FS *filesystem : {(fs::FS *)&SPIFFS, (fs::FS *)&LittleFS, (fs::FS *)&FFat})
+        {
+            filesystem->hostStore()->files.clear();
+            filesystem->hostStore()->mounted = false;
+        }
+    }
+}
+
+namespace fs
+{
+    struct File::Handle
+    {
+        std::shared_ptr<HostStore> store;
+        std::string path;
+        std::string name;
+        bool directory = false;
+        bool writable = false;
+        bool open = true;
+        size_t pos = 0;
+        std::map<std::string, std::string>::iterator next;
+
+        std::string *data()
+        {
+            auto found = store->files.find(path);
+            return found == store->files.end() ? nullptr : &found->second;
+        }
+    };
+
+    bool FS::mount()
+    {
+        store->mounted = mountable;
+        return store->mounted;
+    }
+
+    size_t FS::used()
+    {
+        size_t total = 0;
+        for (const auto &file : store->files)
+        {
+            total += file.second.size();
+        }
+        return total;
+    }
+
+    File FS::open(const char *path, const char *mode, const bool create)
+    {
+        File file;
+        if (!store->mounted)
+        {
+            return file;
+        }
+        std::string name = normalize(path);
+        bool isRoot = name == "/";
+        bool exists = store->files.count(name) > 0;
+        if (mode[0] == 'r' && !exists && !isRoot)
+        {
+            return file;
+        }
+        file.handle = std::make_shared<File::Handle>();
+        file.handle->store = store;
+        file.handle->path = name;
+        file.handle->name = baseName(name);
+        if (isRoot)
+        {
+            file.handle->directory = true;
+            file.handle->next = store->files.begin();
+            return file;
+        }
+        if (mode[0] == 'w')
+        {
+            store->files[name].clear();
+        }
+        else if (mode[0] == 'a')
+        {
+            file.handle->pos = store->files[name].size();
+        }
+        file.handle->writable = mode[0] != 'r' || strchr(mode, '+') != nullptr;
+        return file;
+    }
+
+    bool FS::exists(const char *path)
+    {
+        return store->mounted && store->files.count(normalize(path)) > 0;
+    }
+
+    bool FS::remove(const char *path)
+    {
+        return store->mounted && store->files.erase(normalize(path)) > 0;
+    }
+
+    size_t File::write(uint8_t data)
+    {
+        return write(&data, 1);
+    }
+
+    size_t File::write(const uint8_t *buf, size_t size)
+    {
+        std::string *data = handle && handle->open && handle->writable ? handle->data() : nullptr;
+        if (!data)
+        {
+            return 0;
+        }
+        if (handle->pos > data->size())
+        {
+            data->resize(handle->pos);
+        }
+        data->replace(handle->pos, min(size, data->size() - handle->pos), (const char *)buf, size);
+        handle->pos += size;
+        return size;
+    }
+
+    int File::available()
+    {
+        std::string *data = handle && handle->open ? handle->data() : nullptr;
+        return data && handle->pos < data->size() ? data->size() - handle->pos : 0;
+    }
+
+    int File::read()
+    {
+        uint8_t c;
+        return read(&c, 1) == 1 ? c : -1;
+    }
+
+    int File::peek()
+    {
+        std::string *data = handle && handle->open ? handle->data() : nullptr;
+        return data && handle->pos < data->size() ? (uint8_t)(*data)[handle->pos] : -1;
+    }
+
+    size_t File::read(uint8_t *buf, size_t size)
+    {
+        std::string *data = handle && handle->open ? handle->data() : nullptr;
+        if (!data || handle->pos >= data->size())
+        {
+            return 0;
+        }
+        size_t n = min(size, data->size() - handle->pos);
+        memcpy(buf, data->data() + handle->pos, n);
+        handle->pos += n;
+        return n;
+    }
+
+    bool File::seek(uint32_t pos)
+    {
+        std::string *data = handle && handle->open ? handle->data() : nullptr;
+        if (!data || pos > data->size())
+        {
+            return false;
+        }
+        handle->pos = pos;
+        return true;
+    }
+
+    size_t File::position() const
+    {
+        return handle ? handle->pos : 0;
+    }
+
+    size_t File::size() const
+    {
+        std::string *data = handle && handle->open ? handle->data() : nullptr;
+        return data ? data->size() : 0;
+    }
+
+    void File::close()
+    {
+        if (handle)
+        {
+            handle->open = false;
+        }
+    }
+
+    File::operator bool() const
+    {
+        return handle && handle->open;
+    }
+
+    const char *File::name() const
+    {
+        return handle ? handle->name.c_str() : "";
+    }
+
+    const char *File::path() const
+    {
+        return handle ? handle->path.c_str() : "";
+    }
+
+    bool File::isDirectory()
+    {
+        return handle && handle->directory;
+    }
+
+    File File::openNextFile(const char *mode)
+    {
+        File file;
+        if (!handle || !handle->directory || handle->next == handle->store->files.end())
+        {
+            return file;
+        }
+        file.handle = std::make_shared<File::Handle>();
+        file.handle->store = handle->store;
+        file.handle->path = handle->next->first;
+        file.handle->name = baseName(handle->next->first);
+        ++handle->next;
+        return file;
+    }
+
+    bool SPIFFSFS::format()
+    {
+        store->files.clear();
+        return true;
+    }
+
+    size_t SPIFFSFS::totalBytes()
+    {
+        return host::dataPartition()->size;
+    }
+
+    bool LittleFSFS::format()
+    {
+        store->files.clear();
+        return true;
+    }
+
+    size_t LittleFSFS::totalBytes()
+    {
+        return host::dataPartition()->size;
+    }
+
+    bool F_Fat::format()
+    {
+        store->files.clear();
+        return true;
+    }
+
+    size_t F_Fat::totalBytes()
+    {
+        // The first sector holds the wear-levelling state
+        return host::dataPartition()->size - 0x1000;
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef HOST_FS_H
+#define HOST_FS_H
+
+// File systems kept in memory. Each mounted FS is a map of paths to contents;
+// the partition bytes behind it are not interpreted.
+
+#include <Arduino.h>
+#include <map>
+#include <memory>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+namespace fs
+{
+    struct HostStore
+    {
+        std::map<std::string, std::string> files;
+        bool mounted = false;
+    };
+
+    class File : public Stream
+    {
+    public:
+        File() {}
+        size_t write(uint8_t data) override;
+        size_t write(const uint8_t *buf, size_t size) override;
+        int available() override;
+        int read() override;
+        int peek() override;
+        size_t read(uint8_t *buf, size_t size);
+        bool seek(uint32_t pos);
+        size_t position() const;
+        size_t size() const;
+        void close();
+        operator bool() const;
+        const char *name() const;
+        const char *path() const;
+        bool isDirectory();
+        File openNextFile(const char *mode = FILE_READ);
+
+        using Print::write;
+
+    private:
+        friend class FS;
+        struct Handle;
+        std::shared_ptr<Handle> handle;
+    };
+
+    class FS
+    {
+    public:
+        FS() : store(std::make_shared<HostStore>()) {}
+        File open(const char *path, const char *mode = FILE_READ, const bool create = false);
+        File open(const String &path, const char *mode = FILE_READ, const bool create = false)
+        {
+            return open(path.c_str(), mode, create);
+        }
+        bool exists(const char *path);
+        bool exists(const String &path) { return exists(path.c_str()); }
+        bool remove(const char *path);
+        bool remove(const String &path) { return remove(path.c_str()); }
+
+        // Host only
+        std::shared_ptr<HostStore> hostStore() { return store; }
+
+    protected:
+        bool mount();
+        void unmount() { store->mounted = false; }
+        size_t used();
+
+        std::shared_ptr<HostStore> store;
+    };
+}
+
+using fs::File;
+using fs::FS;
+
+#endif
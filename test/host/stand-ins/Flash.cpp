@@ -0,0 +1,248 @@
+#include <Arduino.h>
+#include <esp_partition.h>
+#include <esp_ota_ops.h>
+#include <atomic>
+#include <mutex>
+#include "Host.h"
+
+namespace
+{
+    const size_t FLASH_SIZE = 4 * 1024 * 1024;
+    const size_t SECTOR = SPI_FLASH_SEC_SIZE;
+
+    // Static, so the chip is not on the counted heap
+    uint8_t chip[FLASH_SIZE];
+
+    esp_partition_t partitions[] = {
+        {ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_NVS, 0x9000, 0x5000, "nvs", false},
+        {ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_OTA, 0xe000, 0x2000, "otadata", false},
+        {ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_APP_OTA_0, 0x10000, 0x140000, "app0", false},
+        {ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_APP_OTA_1, 0x150000, 0x140000, "app1", false},
+        {ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_SPIFFS, 0x290000, 0x160000, "spiffs", false},
+    };
+    esp_partition_t *const APP0 = &partitions[2];
+    esp_partition_t *const APP1 = &partitions[3];
+    esp_partition_t *const DATA = &partitions[4];
+
+    std::mutex flashLock;
+    host::FlashStats stats;
+    uint32_t eraseMicros = 0;
+    uint32_t programMicros = 0;
+    std::atomic<int> busy(0);
+    const esp_partition_t *running = APP0;
+    const esp_partition_t *boot = APP0;
+
+    bool inside(const esp_partition_t *partition, size_t offset, size_t size)
+    {
+        return partition && offset <= partition->size && size <= partition->size - offset;
+    }
+
+    void spendFlash(uint64_t micros)
+    {
+        if (micros > 0)
+        {
+            busy++;
+            host::spend(micros);
+            busy--;
+        }
+    }
+}
+
+namespace host
+{
+    FlashStats flashStats()
+    {
+        std::lock_guard<std::mutex> lock(flashLock);
+        return stats;
+    }
+
+    void clearFlashStats()
+    {
+        std::lock_guard<std::mutex> lock(flashLock);
+        stats = FlashStats();
+    }
+
+    void setFlashTiming(uint32_t eraseMicrosPerSector, uint32_t programMicrosPer4K)
+    {
+        eraseMicros = eraseMicrosPerSector;
+        programMicros = programMicrosPer4K;
+    }
+
+    bool flashBusy()
+    {
+        return busy > 0;
+    }
+
+    void setDataPartition(uint8_t subtype)
+    {
+        DATA->subtype = (esp_partition_subtype_t)subtype;
+        strcpy(DATA->label, subtype == ESP_PARTITION_SUBTYPE_DATA_FAT ? "ffat" : "spiffs");
+    }
+
+    uint8_t *flash(const esp_partition_t *partition)
+    {
+        return chip + partition->address;
+    }
+
+    const esp_partition_t *appPartition(int slot)
+    {
+        return slot == 0 ? APP0 : APP1;
+    }
+
+    const esp_partition_t *dataPartition()
+    {
+        return DATA;
+    }
+
+    std::string readPartition(const esp_partition_t *partition, size_t length)
+    {
+        return std::string((const char *)flash(partition), min(length, (size_t)partition->size));
+    }
+
+    void writePartition(const esp_partition_t *partition, const std::string &data)
+    {
+        memset(flash(partition), 0xff, partition->size);
+        memcpy(flash(partition), data.data(), min(data.size(), (size_t)partition->size));
+    }
+
+    void rebootIntoBootPartition()
+    {
+        running = boot;
+    }
+
+    void resetFlash()
+    {
+        memset(chip, 0xff, sizeof(chip));
+        clearFlashStats();
+        setFlashTiming(0, 0);
+        setDataPartition(ESP_PARTITION_SUBTYPE_DATA_SPIFFS);
+        running = APP0;
+        boot = APP0;
+    }
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size)
+{
+    if (!inside(partition, src_offset, size))
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(dst, host::flash(partition) + src_offset, size);
+    std::lock_guard<std::mutex> lock(flashLock);
+    stats.readBytes += size;
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size)
+{
+    if (!inside(partition, dst_offset, size))
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    uint8_t *to = host::flash(partition) + dst_offset;
+    const uint8_t *from = static_cast<const uint8_t *>(src);
+    bool unerased = false;
+    for (size_t i = 0; i < size; i++)
+    {
+        // NOR flash programming only clears bits
+        unerased |= (from[i] & ~to[i]) != 0;
+        to[i] &= from[i];
+    }
+    {
+        std::lock_guard<std::mutex> lock(flashLock);
+        stats.writeCalls++;
+        stats.writtenBytes += size;
+        stats.unerasedWrites += unerased;
+    }
+    spendFlash((uint64_t)programMicros * size / SECTOR);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size)
+{
+    if (offset % SECTOR != 0 || size % SECTOR != 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!inside(partition, offset, size))
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memset(host::flash(partition) + offset, 0xff, size);
+    {
+        std::lock_guard<std::mutex> lock(flashLock);
+        stats.eraseCalls++;
+        stats.erases += size / SECTOR;
+    }
+    spendFlash((uint64_t)eraseMicros * (size / SECTOR));
+    return ESP_OK;
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label)
+{
+    for (const esp_partition_t &partition : partitions)
+    {
+        if (partition.type == type && (subtype == ESP_PARTITION_SUBTYPE_ANY || partition.subtype == subtype) &&
+            (!label || strcmp(label, partition.label) == 0))
+        {
+            return &partition;
+        }
+    }
+    return nullptr;
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code)
+    {
+    case ESP_OK:
+        return "ESP_OK";
+    case ESP_FAIL:
+        return "ESP_FAIL";
+    case ESP_ERR_NO_MEM:
+        return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG:
+        return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE:
+        return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE:
+        return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND:
+        return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_OTA_VALIDATE_FAILED:
+        return "ESP_ERR_OTA_VALIDATE_FAILED";
+    default:
+        return "UNKNOWN ERROR";
+    }
+}
+
+const esp_partition_t *esp_ota_get_running_partition(void)
+{
+    return running;
+}
+
+const esp_partition_t *esp_ota_get_boot_partition(void)
+{
+    return boot;
+}
+
+const esp_partition_t *esp_ota_get_next_update_partition(const esp_partition_t *start_from)
+{
+    const esp_partition_t *from = start_from ? start_from : running;
+    return from == APP0 ? APP1 : APP0;
+}
+
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t *partition)
+{
+    if (!partition || partition->type != ESP_PARTITION_TYPE_APP)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (host::flash(partition)[0] != ESP_IMAGE_HEADER_MAGIC)
+    {
+        return ESP_ERR_OTA_VALIDATE_FAILED;
+    }
+    boot = partition;
+    return ESP_OK;
+}
@@ -0,0 +1,210 @@
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Host.h"
+
+namespace
+{
+    struct HostTask
+    {
+        std::mutex lock;
+        std::condition_variable wake;
+        uint32_t notified = 0;
+    };
+
+    // Lives in the thread's static TLS, not on the counted heap
+    thread_local HostTask currentTask;
+
+    // Waits on cv for up to ticks; true if woken by ready()
+    template <typename Ready>
+    bool waitTicks(std::condition_variable &cv, std::unique_lock<std::mutex> &lock, TickType_t ticks, Ready ready)
+    {
+        if (ticks == portMAX_DELAY)
+        {
+            cv.wait(lock, ready);
+            return true;
+        }
+        bool woken = cv.wait_for(lock, std::chrono::milliseconds(ticks), ready);
+        if (!woken && host::virtualClock())
+        {
+            host::spend((uint64_t)ticks * 1000);
+        }
+        return woken;
+    }
+
+    struct HostQueue
+    {
+        std::mutex lock;
+        std::condition_variable changed;
+        std::deque<std::vector<uint8_t> > items;
+        size_t length;
+        size_t itemSize;
+    };
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task, const char *name, uint32_t stackDepth, void *parameter,
+                                   UBaseType_t priority, TaskHandle_t *created, BaseType_t core)
+{
+    void *stack = malloc(stackDepth);
+    if (!stack)
+    {
+        return pdFAIL;
+    }
+    std::thread([task, parameter, stack]()
+                {
+                    task(parameter);
+                    free(stack);
+                })
+        .detach();
+    if (created)
+    {
+        // Handles of other tasks are only used to tell them apart here
+        *created = stack;
+    }
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t task, const char *name, uint32_t stackDepth, void *parameter,
+                       UBaseType_t priority, TaskHandle_t *created)
+{
+    return xTaskCreatePinnedToCore(task, name, stackDepth, parameter, priority, created, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    delay(ticks);
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task)
+{
+    return 1;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+    return &currentTask;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticksToWait)
+{
+    HostTask &self = currentTask;
+    std::unique_lock<std::mutex> lock(self.lock);
+    waitTicks(self.wake, lock, ticksToWait, [&self]()
+              { return self.notified > 0; });
+    uint32_t value = self.notified;
+    if (value > 0)
+    {
+        self.notified = clearOnExit ? 0 : value - 1;
+    }
+    return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    HostTask *target = static_cast<HostTask *>(task);
+    {
+        std::lock_guard<std::mutex> lock(target->lock);
+        target->notified++;
+    }
+    target->wake.notify_all();
+    return pdPASS;
+}
+
+TickType_t xTaskGetTickCount()
+{
+    return millis();
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task)
+{
+    return 0;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize)
+{
+    HostQueue *queue = new HostQueue();
+    queue->length = length;
+    queue->itemSize = itemSize;
+    return queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t handle, const void *item, TickType_t ticksToWait)
+{
+    HostQueue *queue = static_cast<HostQueue *>(handle);
+    std::unique_lock<std::mutex> lock(queue->lock);
+    if (!waitTicks(queue->changed, lock, ticksToWait, [queue]()
+                   { return queue->items.size() < queue->length; }))
+    {
+        return pdFALSE;
+    }
+    const uint8_t *bytes = static_cast<const uint8_t *>(item);
+    queue->items.emplace_back(bytes, bytes + queue->itemSize);
+    queue->changed.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t handle, void *item, TickType_t ticksToWait)
+{
+    HostQueue *queue = static_cast<HostQueue *>(handle);
+    std::unique_lock<std::mutex> lock(queue->lock);
+    if (!waitTicks(queue->changed, lock, ticksToWait, [queue]()
+                   { return !queue->items.empty(); }))
+    {
+        return pdFALSE;
+    }
+    memcpy(item, queue->items.front().data(), queue->itemSize);
+    queue->items.pop_front();
+    queue->changed.notify_all();
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t handle)
+{
+    HostQueue *queue = static_cast<HostQueue *>(handle);
+    std::lock_guard<std::mutex> lock(queue->lock);
+    return queue->items.size();
+}
+
+void vQueueDelete(QueueHandle_t handle)
+{
+    delete static_cast<HostQueue *>(handle);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+    return new std::timed_mutex();
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticksToWait)
+{
+    std::timed_mutex *mutex = static_cast<std::timed_mutex *>(semaphore);
+    if (ticksToWait == portMAX_DELAY)
+    {
+        mutex->lock();
+        return pdTRUE;
+    }
+    return mutex->try_lock_for(std::chrono::milliseconds(ticksToWait)) ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+{
+    static_cast<std::timed_mutex *>(semaphore)->unlock();
+    return pdTRUE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore)
+{
+    delete static_cast<std::timed_mutex *>(semaphore);
+}
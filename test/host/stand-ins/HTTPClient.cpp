@@ -0,0 +1,436 @@
+#include <HTTPClient.h>
+
+HTTPClient::HTTPClient()
+    : client(nullptr), port(80), reuse(true), canReuse(false), http10(false), tcpTimeout(HTTPCLIENT_DEFAULT_TCP_TIMEOUT),
+      connectTimeout(HTTPCLIENT_DEFAULT_TCP_TIMEOUT), userAgent("ESP32HTTPClient"), returnCode(0), size(-1),
+      chunked(false)
+{
+}
+
+HTTPClient::~HTTPClient()
+{
+    if (client)
+    {
+        client->stop();
+    }
+}
+
+void HTTPClient::clear()
+{
+    returnCode = 0;
+    size = -1;
+    headers = "";
+}
+
+bool HTTPClient::parseUrl(const String &url, bool secureAllowed)
+{
+    int index = url.indexOf("://");
+    String scheme = index > 0 ? url.substring(0, index) : String();
+    if (scheme != "http" && !(secureAllowed && scheme == "https"))
+    {
+        return false;
+    }
+    String rest = url.substring(index + 3);
+    index = rest.indexOf('/');
+    if (index < 0)
+    {
+        index = rest.length();
+        rest += '/';
+    }
+    String hostPort = rest.substring(0, index);
+    uri = rest.substring(index);
+    index = hostPort.indexOf(':');
+    host = index >= 0 ? hostPort.substring(0, index) : hostPort;
+    port = index >= 0 ? hostPort.substring(index + 1).toInt() : (scheme == "https" ? 443 : 80);
+    return host.length() > 0;
+}
+
+// Without a client only plain HTTP works
+bool HTTPClient::begin(String url)
+{
+    client = &ownClient;
+    clear();
+    return parseUrl(url, false);
+}
+
+// The given client does TLS if it is a TLS client; the scheme only sets the port
+bool HTTPClient::begin(WiFiClient &client, String url)
+{
+    this->client = &client;
+    clear();
+    return parseUrl(url, true);
+}
+
+bool HTTPClient::connected()
+{
+    return client && (client->available() > 0 || client->connected());
+}
+
+void HTTPClient::setTimeout(uint16_t timeout)
+{
+    tcpTimeout = timeout;
+    if (connected())
+    {
+        client->setTimeout(timeout);
+    }
+}
+
+bool HTTPClient::connect()
+{
+    if (connected())
+    {
+        // Leftovers of the last response
+        while (client->available() > 0)
+        {
+            client->read();
+        }
+        return true;
+    }
+    if (!client || !client->connect(host.c_str(), port, connectTimeout))
+    {
+        return false;
+    }
+    client->setTimeout(tcpTimeout);
+    return true;
+}
+
+void HTTPClient::disconnect(bool preserveClient)
+{
+    if (connected())
+    {
+        if (client->available() > 0)
+        {
+            client->flush();
+        }
+        if (!(reuse && canReuse))
+        {
+            client->stop();
+        }
+    }
+}
+
+void HTTPClient::end()
+{
+    disconnect(false);
+    clear();
+}
+
+void HTTPClient::addHeader(const String &name, const String &value, bool first, bool replace)
+{
+    // Headers the client writes itself can't be set
+    if (name.equalsIgnoreCase("Connection") || name.equalsIgnoreCase("User-Agent") || name.equalsIgnoreCase("Host"))
+    {
+        return;
+    }
+    String line = name + ": ";
+    if (replace)
+    {
+        int start = headers.indexOf(line);
+        if (start >= 0 && (start == 0 || headers[start - 1] == '\n'))
+        {
+            int end = headers.indexOf('\n', start);
+            headers = headers.substring(0, start) + headers.substring(end + 1);
+        }
+    }
+    line += value + "\r\n";
+    headers = first ? line + headers : headers + line;
+}
+
+void HTTPClient::collectHeaders(const char *headerKeys[], const size_t headerKeysCount)
+{
+    collected.clear();
+    for (size_t i = 0; i < headerKeysCount; i++)
+    {
+        collected.push_back(std::make_pair(String(headerKeys[i]), String()));
+    }
+}
+
+String HTTPClient::header(const char *name)
+{
+    for (const auto &entry : collected)
+    {
+        if (entry.first.equalsIgnoreCase(name))
+        {
+            return entry.second;
+        }
+    }
+    return String();
+}
+
+bool HTTPClient::hasHeader(const char *name)
+{
+    return header(name).length() > 0;
+}
+
+int HTTPClient::GET()
+{
+    return sendRequest("GET");
+}
+
+int HTTPClient::sendRequest(const char *type, uint8_t *payload, size_t size)
+{
+    if (!connect())
+    {
+        return HTTPC_ERROR_CONNECTION_REFUSED;
+    }
+    String request = String(type) + " " + (uri.length() ? uri : String("/")) + (http10 ? " HTTP/1.0" : " HTTP/1.1");
+    request += "\r\nHost: " + host;
+    if (port != 80 && port != 443)
+    {
+        request += ":" + String(port);
+    }
+    request += "\r\nUser-Agent: " + userAgent + "\r\nConnection: " + (reuse ? "keep-alive" : "close") + "\r\n";
+    if (!http10)
+    {
+        request += "Accept-Encoding: identity;q=1,chunked;q=0.1,*;q=0\r\n";
+    }
+    if (payload && size > 0)
+    {
+        request += "Content-Length: " + String((unsigned)size) + "\r\n";
+    }
+    request += headers + "\r\n";
+    if (client->write((const uint8_t *)request.c_str(), request.length()) != request.length())
+    {
+        client->stop();
+        return HTTPC_ERROR_SEND_HEADER_FAILED;
+    }
+    if (payload && size > 0 && client->write(payload, size) != size)
+    {
+        client->stop();
+        return HTTPC_ERROR_SEND_PAYLOAD_FAILED;
+    }
+    int code = handleHeaderResponse();
+    if (code < 0)
+    {
+        client->stop();
+    }
+    return code;
+}
+
+int HTTPClient::handleHeaderResponse()
+{
+    canReuse = reuse;
+    chunked = false;
+    String transferEncoding;
+    unsigned long lastData = millis();
+    bool firstLine = true;
+    while (connected())
+    {
+        if (client->available() > 0)
+        {
+            String line = client->readStringUntil('\n');
+            lastData = millis();
+            if (firstLine)
+            {
+                firstLine = false;
+                if (canReuse && line.startsWith("HTTP/1."))
+                {
+                    canReuse = line[7] != '0';
+                }
+                int codePos = line.indexOf(' ') + 1;
+                returnCode = line.substring(codePos, line.indexOf(' ', codePos)).toInt();
+            }
+            else
+            {
+                int separator = line.indexOf(':');
+                if (separator > 0)
+                {
+                    String name = line.substring(0, separator);
+                    String value = line.substring(separator + 1);
+                    value.trim();
+                    if (name.equalsIgnoreCase("Content-Length"))
+                    {
+                        size = value.toInt();
+                    }
+                    if (canReuse && name.equalsIgnoreCase("Connection") && value.indexOf("close") >= 0 &&
+                        value.indexOf("keep-alive") < 0)
+                    {
+                        canReuse = false;
+                    }
+                    if (name.equalsIgnoreCase("Transfer-Encoding"))
+                    {
+                        transferEncoding = value;
+                    }
+                    // Values of collected headers stay until collectHeaders() is called again
+                    for (auto &entry : collected)
+                    {
+                        if (entry.first.equalsIgnoreCase(name))
+                        {
+                            entry.second = value;
+                            break;
+                        }
+                    }
+                }
+            }
+            line.trim();
+            if (line.length() == 0)
+            {
+                if (transferEncoding.length() > 0)
+                {
+                    if (!transferEncoding.equalsIgnoreCase("chunked"))
+                    {
+                        return returnCode = HTTPC_ERROR_ENCODING;
+                    }
+                    chunked = true;
+                }
+                return returnCode ? returnCode : HTTPC_ERROR_NO_HTTP_SERVER;
+            }
+        }
+        else
+        {
+            if (millis() - lastData > tcpTimeout)
+            {
+                return HTTPC_ERROR_READ_TIMEOUT;
+            }
+            delay(10);
+        }
+    }
+    return HTTPC_ERROR_CONNECTION_LOST;
+}
+
+WiFiClient *HTTPClient::getStreamPtr()
+{
+    return connected() ? client : nullptr;
+}
+
+// Reads the body as the core does: Content-Length bytes, chunks, or until close
+int HTTPClient::readBody(std::string &out)
+{
+    if (!connected())
+    {
+        return HTTPC_ERROR_NOT_CONNECTED;
+    }
+    uint8_t buffer[1460];
+    auto readBlock = [&](size_t length) -> int
+    {
+        unsigned long lastData = millis();
+        while (length > 0 && connected())
+        {
+            int n = client->read(buffer, min(length, sizeof(buffer)));
+            if (n > 0)
+            {
+                out.append((const char *)buffer, n);
+                length -= n;
+                lastData = millis();
+            }
+            else if (millis() - lastData > tcpTimeout)
+            {
+                return HTTPC_ERROR_READ_TIMEOUT;
+            }
+            else
+            {
+                delay(1);
+            }
+        }
+        return length == 0 ? 0 : HTTPC_ERROR_CONNECTION_LOST;
+    };
+    if (!chunked)
+    {
+        if (size > 0)
+        {
+            return readBlock(size);
+        }
+        while (connected())
+        {
+            int n = client->read(buffer, sizeof(buffer));
+            if (n > 0)
+            {
+                out.append((const char *)buffer, n);
+            }
+            else
+            {
+                delay(1);
+            }
+        }
+        return 0;
+    }
+    while (true)
+    {
+        if (!connected())
+        {
+            return HTTPC_ERROR_CONNECTION_LOST;
+        }
+        String line = client->readStringUntil('\n');
+        line.trim();
+        size_t length = strtoul(line.c_str(), nullptr, 16);
+        if (length == 0)
+        {
+            // Last chunk; drop the empty line after it
+            client->readStringUntil('\n');
+            return 0;
+        }
+        int error = readBlock(length);
+        if (error)
+        {
+            return error;
+        }
+        char crlf[2];
+        if (client->readBytes(crlf, 2) != 2 || crlf[0] != '\r' || crlf[1] != '\n')
+        {
+            return HTTPC_ERROR_READ_TIMEOUT;
+        }
+    }
+}
+
+int HTTPClient::writeToStream(Stream *stream)
+{
+    if (!stream)
+    {
+        return HTTPC_ERROR_NO_STREAM;
+    }
+    std::string body;
+    int error = readBody(body);
+    if (error == 0 && stream->write((const uint8_t *)body.data(), body.size()) != body.size())
+    {
+        error = HTTPC_ERROR_STREAM_WRITE;
+    }
+    if (error < 0 && client)
+    {
+        client->stop();
+    }
+    end();
+    return error < 0 ? error : (int)body.size();
+}
+
+String HTTPClient::getString()
+{
+    std::string body;
+    int error = readBody(body);
+    if (error < 0 && client)
+    {
+        client->stop();
+    }
+    end();
+    return String(body);
+}
+
+String HTTPClient::errorToString(int error)
+{
+    switch (error)
+    {
+    case HTTPC_ERROR_CONNECTION_REFUSED:
+        return "connection refused";
+    case HTTPC_ERROR_SEND_HEADER_FAILED:
+        return "send header failed";
+    case HTTPC_ERROR_SEND_PAYLOAD_FAILED:
+        return "send payload failed";
+    case HTTPC_ERROR_NOT_CONNECTED:
+        return "not connected";
+    case HTTPC_ERROR_CONNECTION_LOST:
+        return "connection lost";
+    case HTTPC_ERROR_NO_STREAM:
+        return "no stream";
+    case HTTPC_ERROR_NO_HTTP_SERVER:
+        return "no HTTP server";
+    case HTTPC_ERROR_TOO_LESS_RAM:
+        return "too less ram";
+    case HTTPC_ERROR_ENCODING:
+        return "Transfer-Encoding not supported";
+    case HTTPC_ERROR_STREAM_WRITE:
+        return "Stream write error";
+    case HTTPC_ERROR_READ_TIMEOUT:
+        return "read Timeout";
+    default:
+        return String();
+    }
+}
@@ -0,0 +1,102 @@
+#ifndef HOST_HTTP_CLIENT_H
+#define HOST_HTTP_CLIENT_H
+
+// The core's HTTPClient, reduced to what it does on the wire: keep-alive
+// reuse, the headers it adds and collects, and how it reads a response.
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+#include <vector>
+
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED (-2)
+#define HTTPC_ERROR_SEND_PAYLOAD_FAILED (-3)
+#define HTTPC_ERROR_NOT_CONNECTED (-4)
+#define HTTPC_ERROR_CONNECTION_LOST (-5)
+#define HTTPC_ERROR_NO_STREAM (-6)
+#define HTTPC_ERROR_NO_HTTP_SERVER (-7)
+#define HTTPC_ERROR_TOO_LESS_RAM (-8)
+#define HTTPC_ERROR_ENCODING (-9)
+#define HTTPC_ERROR_STREAM_WRITE (-10)
+#define HTTPC_ERROR_READ_TIMEOUT (-11)
+
+#define HTTPCLIENT_DEFAULT_TCP_TIMEOUT (5000)
+
+typedef enum
+{
+    HTTP_CODE_CONTINUE = 100,
+    HTTP_CODE_OK = 200,
+    HTTP_CODE_NO_CONTENT = 204,
+    HTTP_CODE_PARTIAL_CONTENT = 206,
+    HTTP_CODE_MOVED_PERMANENTLY = 301,
+    HTTP_CODE_FOUND = 302,
+    HTTP_CODE_NOT_MODIFIED = 304,
+    HTTP_CODE_BAD_REQUEST = 400,
+    HTTP_CODE_UNAUTHORIZED = 401,
+    HTTP_CODE_FORBIDDEN = 403,
+    HTTP_CODE_NOT_FOUND = 404,
+    HTTP_CODE_PRECONDITION_FAILED = 412,
+    HTTP_CODE_RANGE_NOT_SATISFIABLE = 416,
+    HTTP_CODE_TOO_MANY_REQUESTS = 429,
+    HTTP_CODE_INTERNAL_SERVER_ERROR = 500,
+    HTTP_CODE_SERVICE_UNAVAILABLE = 503,
+} t_http_codes;
+
+class HTTPClient
+{
+public:
+    HTTPClient();
+    ~HTTPClient();
+
+    bool begin(String url);
+    bool begin(WiFiClient &client, String url);
+    void end();
+    bool connected();
+
+    void setReuse(bool reuse) { this->reuse = reuse; }
+    void setTimeout(uint16_t timeout);
+    void setConnectTimeout(int32_t timeout) { connectTimeout = timeout; }
+    void useHTTP10(bool http10) { this->http10 = http10; }
+    void setUserAgent(const String &userAgent) { this->userAgent = userAgent; }
+
+    void addHeader(const String &name, const String &value, bool first = false, bool replace = true);
+    void collectHeaders(const char *headerKeys[], const size_t headerKeysCount);
+    String header(const char *name);
+    bool hasHeader(const char *name);
+
+    int GET();
+    int sendRequest(const char *type, uint8_t *payload = NULL, size_t size = 0);
+    int getSize() { return size; }
+    String getString();
+    WiFiClient &getStream() { return *client; }
+    WiFiClient *getStreamPtr();
+    int writeToStream(Stream *stream);
+    static String errorToString(int error);
+
+private:
+    bool parseUrl(const String &url, bool secureAllowed);
+    bool connect();
+    void disconnect(bool preserveClient);
+    void clear();
+    int handleHeaderResponse();
+    int readBody(std::string &out);
+
+    WiFiClient *client;
+    WiFiClient ownClient;
+    String host;
+    uint16_t port;
+    String uri;
+    bool reuse;
+    bool canReuse;
+    bool http10;
+    uint16_t tcpTimeout;
+    int32_t connectTimeout;
+    String userAgent;
+    String headers;
+    std::vector<std::pair<String, String> > collected;
+    int returnCode;
+    int size;
+    bool chunked;
+};
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef HOST_INTERNAL_H
+#define HOST_INTERNAL_H
+
+// Hooks between the stand-ins; tests use HostControl.h
+
+#include "HostControl.h"
+
+namespace host
+{
+    void resetClock();
+    void resetHeap();
+    void resetSerial();
+    void resetEsp();
+    void resetFlash();
+    void resetUpdate();
+    void resetFilesystems();
+    void resetNetwork();
+    void resetTls();
+    bool wifiConnected();
+    uint32_t nextRandom();
+    const std::vector<MdnsService> &mdnsServices();
+}
+
+#endif
@@ -0,0 +1,129 @@
+#ifndef HOST_CONTROL_H
+#define HOST_CONTROL_H
+
+// Knobs and counters of the host stand-ins, for tests and the bench. Nothing
+// in src/ includes this.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct esp_partition_t;
+
+namespace host
+{
+    // Puts every stand-in back to its power-on state
+    void reset();
+
+    // Clock. The virtual clock only moves when delay() or spend() is called,
+    // so single-threaded tests of timeouts and rates run instantly and
+    // deterministically. Threads (pipeline, servers) need the real clock.
+    void useVirtualClock(bool on);
+    bool virtualClock();
+    // Time the code under test spends working: advances the virtual clock,
+    // or sleeps on the real one
+    void spend(uint64_t micros);
+
+    // Heap. Every malloc and new of the process is counted, except on threads
+    // that call ignoreHeap() (test servers). Free heap is reported against a
+    // nominal ESP32 heap of HEAP_SIZE bytes, from the live bytes at mark().
+    const size_t HEAP_SIZE = 320 * 1024;
+    struct HeapStats
+    {
+        size_t live;        // bytes allocated since mark() and not freed
+        size_t peak;        // high-water mark of live since mark()
+        uint32_t allocations;
+        uint32_t frees;
+    };
+    void markHeap();
+    HeapStats heapStats();
+    void ignoreHeap();
+    // Fails allocations of at least minSize bytes after the next skip of them
+    void failAllocations(size_t minSize, uint32_t skip = 0);
+
+    // Serial output since the last clearSerial(); HOST_VERBOSE=1 also echoes it
+    std::string serialOutput();
+    void clearSerial();
+    bool serialContains(const std::string &text);
+
+    // Random numbers from random() and esp_random()
+    void seedRandom(uint32_t seed);
+
+    // ESP.restart() calls and the running sketch's size for getSketchMD5()
+    uint32_t restarts();
+    void setSketchSize(uint32_t size);
+
+    // Wi-Fi link state
+    void setWifiConnected(bool connected);
+
+    // Flash: a 4 MB chip with nvs, otadata, app0, app1 and a data partition.
+    // Writes can only clear bits, like NOR flash; erases must be whole sectors.
+    struct FlashStats
+    {
+        uint32_t erases;        // sectors erased
+        uint32_t eraseCalls;
+        uint32_t writeCalls;
+        uint64_t writtenBytes;
+        uint64_t readBytes;
+        uint32_t unerasedWrites; // writes that tried to set a cleared bit
+    };
+    FlashStats flashStats();
+    void clearFlashStats();
+    // Time an erase of one sector and a program of 4 KB take
+    void setFlashTiming(uint32_t eraseMicrosPerSector, uint32_t programMicrosPer4K);
+    // True while an erase or program is taking its set time, on any thread
+    bool flashBusy();
+    // Data partition subtype: 0x82 SPIFFS (also LittleFS) or 0x81 FAT
+    void setDataPartition(uint8_t subtype);
+    uint8_t *flash(const esp_partition_t *partition);
+    const esp_partition_t *appPartition(int slot);
+    const esp_partition_t *dataPartition();
+    std::string readPartition(const esp_partition_t *partition, size_t length);
+    void writePartition(const esp_partition_t *partition, const std::string &data);
+    // Boots whatever esp_ota_set_boot_partition() chose, as a restart would
+    void rebootIntoBootPartition();
+
+    // Update (the core's UpdateClass) calls
+    struct UpdateStats
+    {
+        uint32_t begins;
+        uint32_t writes;
+        uint32_t ends;
+        uint32_t aborts;
+        uint64_t copiedBytes; // bytes Update copied into its own sector buffer
+    };
+    UpdateStats updateStats();
+
+    // Preferences (NVS) contents survive until reset()
+    void resetPreferences();
+
+    // File systems: contents and whether begin() succeeds
+    void setFilesystemMountable(bool mountable);
+
+    // mDNS browse results
+    struct MdnsService
+    {
+        std::string host;
+        uint32_t ip;
+        uint16_t port;
+        std::vector<std::pair<std::string, std::string> > txt;
+    };
+    void setMdnsServices(const std::vector<MdnsService> &services);
+
+    // TLS stand-in. Connections carry plain HTTP, but the handshake is modelled:
+    // the server key the verify callback sees, whether the CA chain accepts it,
+    // and the session tickets the server still honours.
+    struct TlsStats
+    {
+        uint32_t fullHandshakes;
+        uint32_t resumedHandshakes;
+        uint32_t verifyCalls;
+    };
+    void setTlsServerCertificate(const std::string &pem, bool trustedByCa);
+    void dropTlsTickets();
+    TlsStats tlsStats();
+}
+
+#endif
@@ -0,0 +1,121 @@
+#include <Preferences.h>
+#include <map>
+#include <mutex>
+#include "Host.h"
+
+namespace
+{
+    std::mutex nvsLock;
+    std::map<std::string, std::map<std::string, std::string> > nvs;
+    // NVS keys and namespaces are at most 15 characters
+    const size_t MAX_KEY = 15;
+}
+
+namespace host
+{
+    void resetPreferences()
+    {
+        std::lock_guard<std::mutex> lock(nvsLock);
+        nvs.clear();
+    }
+}
+
+bool Preferences::begin(const char *name, bool readOnly, const char *partition_label)
+{
+    if (started || !name || strlen(name) > MAX_KEY)
+    {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(nvsLock);
+    // Opening a namespace that doesn't exist read-only fails, as in NVS
+    if (readOnly && nvs.count(name) == 0)
+    {
+        return false;
+    }
+    nvs[name];
+    space = name;
+    this->readOnly = readOnly;
+    started = true;
+    return true;
+}
+
+void Preferences::end()
+{
+    started = false;
+}
+
+bool Preferences::clear()
+{
+    if (!started || readOnly)
+    {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(nvsLock);
+    nvs[space].clear();
+    return true;
+}
+
+bool Preferences::remove(const char *key)
+{
+    if (!started || readOnly)
+    {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(nvsLock);
+    return nvs[space].erase(key) > 0;
+}
+
+bool Preferences::isKey(const char *key)
+{
+    return find(key) != nullptr;
+}
+
+size_t Preferences::put(const char *key, const void *value, size_t len)
+{
+    if (!started || readOnly || !key || strlen(key) > MAX_KEY)
+    {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(nvsLock);
+    nvs[space][key] = std::string((const char *)value, len);
+    return len;
+}
+
+const std::string *Preferences::find(const char *key)
+{
+    if (!started || !key)
+    {
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(nvsLock);
+    auto entries = nvs.find(space);
+    if (entries == nvs.end())
+    {
+        return nullptr;
+    }
+    auto found = entries->second.find(key);
+    return found == entries->second.end() ? nullptr : &found->second;
+}
+
+String Preferences::getString(const char *key, String defaultValue)
+{
+    const std::string *value = find(key);
+    return value ? String(*value) : defaultValue;
+}
+
+size_t Preferences::getBytesLength(const char *key)
+{
+    const std::string *value = find(key);
+    return value ? value->size() : 0;
+}
+
+size_t Preferences::getBytes(const char *key, void *buf, size_t maxLen)
+{
+    const std::string *value = find(key);
+    if (!value || value->size() > maxLen)
+    {
+        return 0;
+    }
+    memcpy(buf, value->data(), value->size());
+    return value->size();
+}
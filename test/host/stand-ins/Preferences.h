@@ -0,0 +1,66 @@
+#ifndef HOST_PREFERENCES_H
+#define HOST_PREFERENCES_H
+
+// NVS kept in memory until host::resetPreferences()
+
+#include <Arduino.h>
+
+class Preferences
+{
+public:
+    Preferences() : started(false), readOnly(false) {}
+    ~Preferences() { end(); }
+
+    bool begin(const char *name, bool readOnly = false, const char *partition_label = NULL);
+    void end();
+    bool clear();
+    bool remove(const char *key);
+    bool isKey(const char *key);
+
+    size_t putUChar(const char *key, uint8_t value) { return put(key, &value, sizeof(value)); }
+    size_t putBool(const char *key, bool value) { return putUChar(key, value); }
+    size_t putInt(const char *key, int32_t value) { return put(key, &value, sizeof(value)); }
+    size_t putUInt(const char *key, uint32_t value) { return put(key, &value, sizeof(value)); }
+    size_t putLong(const char *key, int32_t value) { return putInt(key, value); }
+    size_t putULong(const char *key, uint32_t value) { return putUInt(key, value); }
+    size_t putLong64(const char *key, int64_t value) { return put(key, &value, sizeof(value)); }
+    size_t putULong64(const char *key, uint64_t value) { return put(key, &value, sizeof(value)); }
+    size_t putString(const char *key, const char *value) { return put(key, value, strlen(value)) ? strlen(value) : 0; }
+    size_t putString(const char *key, const String &value) { return putString(key, value.c_str()); }
+    size_t putBytes(const char *key, const void *value, size_t len) { return put(key, value, len); }
+
+    uint8_t getUChar(const char *key, uint8_t defaultValue = 0) { return get(key, defaultValue); }
+    bool getBool(const char *key, bool defaultValue = false) { return getUChar(key, defaultValue) != 0; }
+    int32_t getInt(const char *key, int32_t defaultValue = 0) { return get(key, defaultValue); }
+    uint32_t getUInt(const char *key, uint32_t defaultValue = 0) { return get(key, defaultValue); }
+    int32_t getLong(const char *key, int32_t defaultValue = 0) { return getInt(key, defaultValue); }
+    uint32_t getULong(const char *key, uint32_t defaultValue = 0) { return getUInt(key, defaultValue); }
+    int64_t getLong64(const char *key, int64_t defaultValue = 0) { return get(key, defaultValue); }
+    uint64_t getULong64(const char *key, uint64_t defaultValue = 0) { return get(key, defaultValue); }
+    String getString(const char *key, String defaultValue = String());
+    size_t getBytesLength(const char *key);
+    size_t getBytes(const char *key, void *buf, size_t maxLen);
+
+private:
+    size_t put(const char *key, const void *value, size_t len);
+    const std::string *find(const char *key);
+
+    template <typename T>
+    T get(const char *key, T defaultValue)
+    {
+        const std::string *value = find(key);
+        if (!value || value->size() != sizeof(T))
+        {
+            return defaultValue;
+        }
+        T out;
+        memcpy(&out, value->data(), sizeof(T));
+        return out;
+    }
+
+    std::string space;
+    bool started;
+    bool readOnly;
+};
+
+#endif
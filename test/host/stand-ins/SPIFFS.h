@@ -0,0 +1,25 @@
+#ifndef HOST_SPIFFS_H
+#define HOST_SPIFFS_H
+
+#include "FS.h"
+
+namespace fs
+{
+    class SPIFFSFS : public FS
+    {
+    public:
+        bool begin(bool formatOnFail = false, const char *basePath = "/spiffs", uint8_t maxOpenFiles = 10,
+                   const char *partitionLabel = NULL)
+        {
+            return mount();
+        }
+        void end() { unmount(); }
+        bool format();
+        size_t totalBytes();
+        size_t usedBytes() { return used(); }
+    };
+}
+
+extern fs::SPIFFSFS SPIFFS;
+
+#endif
@@ -0,0 +1,252 @@
+#include <Update.h>
+#include <esp_ota_ops.h>
+#include <new>
+#include "Host.h"
+
+UpdateClass Update;
+
+namespace
+{
+    const size_t SECTOR = SPI_FLASH_SEC_SIZE;
+    const size_t HEADER_HOLD = 16;
+    host::UpdateStats updateStats;
+
+    const char *const ERROR_TEXT[] = {"No Error", "Flash Write Failed", "Flash Erase Failed", "Flash Read Failed",
+                                      "Not Enough Space", "Bad Size Given", "Stream Read Timeout", "MD5 Check Failed",
+                                      "Wrong Magic Byte", "Could Not Activate The Firmware",
+                                      "Partition Could Not be Found", "Bad Argument", "Aborted"};
+}
+
+namespace host
+{
+    UpdateStats updateStats()
+    {
+        return ::updateStats;
+    }
+
+    void resetUpdate()
+    {
+        // Back to power-on: no buffer and no error left from the last test
+        Update.abort();
+        new (&Update) UpdateClass();
+        ::updateStats = UpdateStats();
+    }
+}
+
+UpdateClass::UpdateClass()
+    : partition(nullptr), command(U_FLASH), offset(0), totalSize(0), position(0), buffer(nullptr), bufferLength(0),
+      skipping(false), error(UPDATE_ERROR_OK)
+{
+}
+
+bool UpdateClass::begin(size_t size, int command, int ledPin, uint8_t ledOn, const char *label)
+{
+    if (totalSize > 0)
+    {
+        return false;
+    }
+    release();
+    error = UPDATE_ERROR_OK;
+    if (size == 0)
+    {
+        error = UPDATE_ERROR_SIZE;
+        return false;
+    }
+    offset = 0;
+    if (command == U_FLASH)
+    {
+        partition = esp_ota_get_next_update_partition(NULL);
+    }
+    else if (command == U_SPIFFS)
+    {
+        partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_SPIFFS, label);
+        if (!partition)
+        {
+            partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_FAT, NULL);
+            offset = 0x1000;
+        }
+    }
+    else
+    {
+        error = UPDATE_ERROR_BAD_ARGUMENT;
+        return false;
+    }
+    if (!partition)
+    {
+        error = UPDATE_ERROR_NO_PARTITION;
+        return false;
+    }
+    if (size == UPDATE_SIZE_UNKNOWN)
+    {
+        size = partition->size - offset;
+    }
+    else if (size > partition->size - offset)
+    {
+        error = UPDATE_ERROR_SIZE;
+        return false;
+    }
+    buffer = (uint8_t *)malloc(SECTOR);
+    if (!buffer)
+    {
+        return false;
+    }
+    this->command = command;
+    totalSize = size;
+    position = 0;
+    bufferLength = 0;
+    skipping = false;
+    updateStats.begins++;
+    return true;
+}
+
+bool UpdateClass::writeBuffer()
+{
+    size_t skip = 0;
+    if (position == 0 && command == U_FLASH)
+    {
+        if (buffer[0] != ESP_IMAGE_HEADER_MAGIC)
+        {
+            fail(UPDATE_ERROR_MAGIC_BYTE);
+            return false;
+        }
+        // The header goes in last, so a half-written image can never boot
+        memcpy(skipped, buffer, HEADER_HOLD);
+        skipping = true;
+        skip = HEADER_HOLD;
+    }
+    size_t at = offset + position;
+    if (at % SECTOR == 0 && esp_partition_erase_range(partition, at, SECTOR) != ESP_OK)
+    {
+        fail(UPDATE_ERROR_ERASE);
+        return false;
+    }
+    if (esp_partition_write(partition, at + skip, buffer + skip, bufferLength - skip) != ESP_OK)
+    {
+        fail(UPDATE_ERROR_WRITE);
+        return false;
+    }
+    position += bufferLength;
+    bufferLength = 0;
+    return true;
+}
+
+size_t UpdateClass::write(uint8_t *data, size_t len)
+{
+    if (hasError() || !isRunning())
+    {
+        return 0;
+    }
+    if (len > remaining())
+    {
+        fail(UPDATE_ERROR_SPACE);
+        return 0;
+    }
+    updateStats.writes++;
+    size_t done = 0;
+    while (done < len)
+    {
+        size_t take = min(len - done, SECTOR - bufferLength);
+        memcpy(buffer + bufferLength, data + done, take);
+        updateStats.copiedBytes += take;
+        bufferLength += take;
+        done += take;
+        if ((bufferLength == SECTOR || bufferLength == remaining()) && !writeBuffer())
+        {
+            return done - take;
+        }
+    }
+    return len;
+}
+
+size_t UpdateClass::writeStream(Stream &data)
+{
+    size_t written = 0;
+    uint8_t chunk[1024];
+    while (remaining() > 0)
+    {
+        size_t n = data.readBytes(chunk, min(remaining(), sizeof(chunk)));
+        if (n == 0)
+        {
+            fail(UPDATE_ERROR_STREAM);
+            break;
+        }
+        if (write(chunk, n) != n)
+        {
+            break;
+        }
+        written += n;
+    }
+    return written;
+}
+
+bool UpdateClass::end(bool evenIfRemaining)
+{
+    if (hasError() || totalSize == 0)
+    {
+        return false;
+    }
+    if (!isFinished() && !evenIfRemaining)
+    {
+        fail(UPDATE_ERROR_ABORT);
+        return false;
+    }
+    if (evenIfRemaining)
+    {
+        if (bufferLength > 0 && !writeBuffer())
+        {
+            return false;
+        }
+        totalSize = position;
+    }
+    updateStats.ends++;
+    if (command == U_FLASH)
+    {
+        if (skipping && esp_partition_write(partition, 0, skipped, HEADER_HOLD) != ESP_OK)
+        {
+            fail(UPDATE_ERROR_WRITE);
+            return false;
+        }
+        if (esp_ota_set_boot_partition(partition) != ESP_OK)
+        {
+            fail(UPDATE_ERROR_ACTIVATE);
+            return false;
+        }
+    }
+    release();
+    return true;
+}
+
+void UpdateClass::abort()
+{
+    if (totalSize > 0)
+    {
+        updateStats.aborts++;
+    }
+    fail(UPDATE_ERROR_ABORT);
+}
+
+void UpdateClass::fail(uint8_t code)
+{
+    release();
+    error = code;
+}
+
+void UpdateClass::release()
+{
+    free(buffer);
+    buffer = nullptr;
+    bufferLength = 0;
+    totalSize = 0;
+    position = 0;
+    skipping = false;
+}
+
+const char *UpdateClass::errorString()
+{
+    return error < sizeof(ERROR_TEXT) / sizeof(ERROR_TEXT[0]) ? ERROR_TEXT[error] : "UNKNOWN";
+}
+
+void UpdateClass::printError(Print &out)
+{
+    out.printf("%s\n", errorString());
+}
@@ -0,0 +1,70 @@
+#ifndef HOST_UPDATE_H
+#define HOST_UPDATE_H
+
+// The core's UpdateClass: bytes are copied into a 4 KB buffer and each full
+// sector is erased and programmed. The first 16 bytes of an app image are held
+// back and written by end(), just before the partition is made bootable.
+
+#include <Arduino.h>
+#include <esp_partition.h>
+
+#define UPDATE_ERROR_OK (0)
+#define UPDATE_ERROR_WRITE (1)
+#define UPDATE_ERROR_ERASE (2)
+#define UPDATE_ERROR_READ (3)
+#define UPDATE_ERROR_SPACE (4)
+#define UPDATE_ERROR_SIZE (5)
+#define UPDATE_ERROR_STREAM (6)
+#define UPDATE_ERROR_MD5 (7)
+#define UPDATE_ERROR_MAGIC_BYTE (8)
+#define UPDATE_ERROR_ACTIVATE (9)
+#define UPDATE_ERROR_NO_PARTITION (10)
+#define UPDATE_ERROR_BAD_ARGUMENT (11)
+#define UPDATE_ERROR_ABORT (12)
+
+#define UPDATE_SIZE_UNKNOWN 0xFFFFFFFF
+
+#define U_FLASH 0
+#define U_SPIFFS 100
+#define U_AUTH 200
+
+class UpdateClass
+{
+public:
+    UpdateClass();
+    bool begin(size_t size = UPDATE_SIZE_UNKNOWN, int command = U_FLASH, int ledPin = -1, uint8_t ledOn = 0,
+               const char *label = NULL);
+    size_t write(uint8_t *data, size_t len);
+    size_t writeStream(Stream &data);
+    bool end(bool evenIfRemaining = false);
+    void abort();
+    void printError(Print &out);
+    const char *errorString();
+    bool hasError() { return error != UPDATE_ERROR_OK; }
+    bool isRunning() { return totalSize > 0; }
+    bool isFinished() { return position == totalSize; }
+    size_t size() { return totalSize; }
+    size_t progress() { return position; }
+    size_t remaining() { return totalSize - position; }
+    uint8_t getError() { return error; }
+
+private:
+    void fail(uint8_t code);
+    void release();
+    bool writeBuffer();
+
+    const esp_partition_t *partition;
+    int command;
+    size_t offset; // FAT images start after the wear-levelling sector
+    size_t totalSize;
+    size_t position;
+    uint8_t *buffer;
+    size_t bufferLength;
+    uint8_t skipped[16];
+    bool skipping;
+    uint8_t error;
+};
+
+extern UpdateClass Update;
+
+#endif
@@ -0,0 +1,148 @@
+#include <WebServer.h>
+
+namespace
+{
+    // Boundary lines and part headers around the file in a browser's form post
+    const size_t MULTIPART_OVERHEAD = 190;
+}
+
+void WebServer::on(const String &uri, HTTPMethod method, THandlerFunction fn)
+{
+    on(uri, method, fn, nullptr);
+}
+
+void WebServer::on(const String &uri, HTTPMethod method, THandlerFunction fn, THandlerFunction ufn)
+{
+    Route route = {uri, method, fn, ufn};
+    routes.push_back(route);
+}
+
+WebServer::Route *WebServer::find(HTTPMethod method, const String &uri)
+{
+    for (Route &route : routes)
+    {
+        if (route.uri == uri && (route.method == HTTP_ANY || route.method == method))
+        {
+            return &route;
+        }
+    }
+    return nullptr;
+}
+
+void WebServer::start(const Args &args, size_t length)
+{
+    requestArgs = args;
+    requestLength = length;
+    contentLength = CONTENT_LENGTH_NOT_SET;
+    pendingHeaders.clear();
+    last = Response();
+    last.code = 0;
+    last.sent = false;
+}
+
+bool WebServer::request(HTTPMethod method, const String &uri, const Args &args)
+{
+    Route *route = find(method, uri);
+    if (!route)
+    {
+        return false;
+    }
+    start(args, 0);
+    route->fn();
+    return true;
+}
+
+bool WebServer::postUpload(const String &uri, const std::string &data, const Args &args, size_t piece,
+                           const String &filename)
+{
+    Route *route = find(HTTP_POST, uri);
+    if (!route)
+    {
+        return false;
+    }
+    start(args, data.size() + MULTIPART_OVERHEAD);
+    piece = constrain(piece, (size_t)1, (size_t)HTTP_UPLOAD_BUFLEN);
+    currentUpload.status = UPLOAD_FILE_START;
+    currentUpload.filename = filename;
+    currentUpload.name = "update";
+    currentUpload.type = "application/octet-stream";
+    currentUpload.totalSize = 0;
+    currentUpload.currentSize = 0;
+    if (route->ufn)
+    {
+        route->ufn();
+        for (size_t offset = 0; offset < data.size(); offset += piece)
+        {
+            currentUpload.status = UPLOAD_FILE_WRITE;
+            currentUpload.currentSize = min(piece, data.size() - offset);
+            memcpy(currentUpload.buf, data.data() + offset, currentUpload.currentSize);
+            route->ufn();
+            currentUpload.totalSize += currentUpload.currentSize;
+        }
+        currentUpload.status = UPLOAD_FILE_END;
+        currentUpload.currentSize = 0;
+        route->ufn();
+    }
+    route->fn();
+    return true;
+}
+
+void WebServer::send(int code, const char *content_type, const String &content)
+{
+    last.code = code;
+    last.contentType = content_type ? content_type : "";
+    last.body = content.str();
+    last.headers = pendingHeaders;
+    last.sent = true;
+}
+
+void WebServer::send(int code, const String &content_type, const String &content)
+{
+    send(code, content_type.c_str(), content);
+}
+
+void WebServer::sendHeader(const String &name, const String &value, bool first)
+{
+    if (first)
+    {
+        pendingHeaders.insert(pendingHeaders.begin(), std::make_pair(name, value));
+    }
+    else
+    {
+        pendingHeaders.push_back(std::make_pair(name, value));
+    }
+}
+
+void WebServer::sendContent(const String &content)
+{
+    last.body += content.str();
+}
+
+void WebServer::sendContent(const char *content, size_t contentLength)
+{
+    last.body.append(content, contentLength);
+}
+
+String WebServer::arg(const String &name)
+{
+    for (const auto &entry : requestArgs)
+    {
+        if (entry.first == name)
+        {
+            return entry.second;
+        }
+    }
+    return String();
+}
+
+bool WebServer::hasArg(const String &name)
+{
+    for (const auto &entry : requestArgs)
+    {
+        if (entry.first == name)
+        {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,111 @@
+#ifndef HOST_WEB_SERVER_H
+#define HOST_WEB_SERVER_H
+
+// The core's WebServer without a socket: tests hand requests and uploads to
+// the registered handlers and read back the response.
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+#include <functional>
+#include <vector>
+
+#define HTTP_UPLOAD_BUFLEN 1436
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+#define CONTENT_LENGTH_NOT_SET ((size_t)-2)
+
+enum HTTPMethod
+{
+    HTTP_ANY,
+    HTTP_GET,
+    HTTP_HEAD,
+    HTTP_POST,
+    HTTP_PUT,
+    HTTP_PATCH,
+    HTTP_DELETE,
+    HTTP_OPTIONS
+};
+
+enum HTTPUploadStatus
+{
+    UPLOAD_FILE_START,
+    UPLOAD_FILE_WRITE,
+    UPLOAD_FILE_END,
+    UPLOAD_FILE_ABORTED
+};
+
+struct HTTPUpload
+{
+    HTTPUploadStatus status;
+    String filename;
+    String name;
+    String type;
+    size_t totalSize;
+    size_t currentSize;
+    uint8_t buf[HTTP_UPLOAD_BUFLEN];
+};
+
+class WebServer
+{
+public:
+    typedef std::function<void(void)> THandlerFunction;
+    typedef std::vector<std::pair<String, String> > Args;
+
+    explicit WebServer(int port = 80) {}
+    void begin() {}
+    void handleClient() {}
+
+    void on(const String &uri, HTTPMethod method, THandlerFunction fn);
+    void on(const String &uri, HTTPMethod method, THandlerFunction fn, THandlerFunction ufn);
+
+    void send(int code, const char *content_type = NULL, const String &content = String(""));
+    void send(int code, const String &content_type, const String &content);
+    void setContentLength(const size_t length) { contentLength = length; }
+    void sendHeader(const String &name, const String &value, bool first = false);
+    void sendContent(const String &content);
+    void sendContent(const char *content, size_t contentLength);
+
+    String arg(const String &name);
+    bool hasArg(const String &name);
+    String header(const String &name) { return String(); }
+    bool hasHeader(const String &name) { return false; }
+    void collectHeaders(const char *headerKeys[], const size_t headerKeysCount) {}
+    HTTPUpload &upload() { return currentUpload; }
+    size_t clientContentLength() { return requestLength; }
+
+    // Host only
+    struct Response
+    {
+        int code;
+        String contentType;
+        std::string body;
+        Args headers;
+        bool sent;
+    };
+    // Runs the handler for uri; false if none is registered
+    bool request(HTTPMethod method, const String &uri, const Args &args = Args());
+    // A multipart form upload of data in pieces of up to piece bytes, then the handler
+    bool postUpload(const String &uri, const std::string &data, const Args &args = Args(),
+                    size_t piece = HTTP_UPLOAD_BUFLEN, const String &filename = "firmware.bin");
+    const Response &response() const { return last; }
+
+private:
+    struct Route
+    {
+        String uri;
+        HTTPMethod method;
+        THandlerFunction fn;
+        THandlerFunction ufn;
+    };
+    Route *find(HTTPMethod method, const String &uri);
+    void start(const Args &args, size_t length);
+
+    std::vector<Route> routes;
+    Args requestArgs;
+    size_t requestLength = 0;
+    size_t contentLength = CONTENT_LENGTH_NOT_SET;
+    HTTPUpload currentUpload;
+    Args pendingHeaders;
+    Response last;
+};
+
+#endif
@@ -0,0 +1,280 @@
+#include <WiFi.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include "Host.h"
+
+WiFiClass WiFi;
+
+namespace
+{
+    std::atomic<bool> linkUp(true);
+}
+
+namespace host
+{
+    void setWifiConnected(bool connected)
+    {
+        linkUp = connected;
+    }
+
+    bool wifiConnected()
+    {
+        return linkUp;
+    }
+
+    void resetNetwork()
+    {
+        linkUp = true;
+    }
+}
+
+wl_status_t WiFiClass::status()
+{
+    return linkUp ? WL_CONNECTED : WL_DISCONNECTED;
+}
+
+IPAddress WiFiClass::localIP()
+{
+    return linkUp ? IPAddress(192, 168, 4, 2) : IPAddress();
+}
+
+int8_t WiFiClass::RSSI()
+{
+    return linkUp ? -55 : 0;
+}
+
+int WiFiClass::hostByName(const char *host, IPAddress &address)
+{
+    if (!linkUp)
+    {
+        return 0;
+    }
+    if (address.fromString(host))
+    {
+        return 1;
+    }
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *found = nullptr;
+    if (getaddrinfo(host, nullptr, &hints, &found) != 0 || !found)
+    {
+        return 0;
+    }
+    address = IPAddress(((sockaddr_in *)found->ai_addr)->sin_addr.s_addr);
+    freeaddrinfo(found);
+    return 1;
+}
+
+struct WiFiClient::Socket
+{
+    explicit Socket(int fd) : fd(fd), closed(false) {}
+    ~Socket() { close(fd); }
+    int fd;
+    bool closed; // the peer closed or the connection failed
+};
+
+WiFiClient::WiFiClient()
+{
+}
+
+WiFiClient::~WiFiClient()
+{
+}
+
+int WiFiClient::connect(IPAddress ip, uint16_t port)
+{
+    return connect(ip, port, 3000);
+}
+
+int WiFiClient::connect(IPAddress ip, uint16_t port, int32_t timeout)
+{
+    stop();
+    if (!host::wifiConnected())
+    {
+        return 0;
+    }
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        return 0;
+    }
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = (uint32_t)ip;
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    int result = ::connect(fd, (sockaddr *)&address, sizeof(address));
+    if (result < 0 && errno == EINPROGRESS)
+    {
+        pollfd waiting = {fd, POLLOUT, 0};
+        int error = 0;
+        socklen_t length = sizeof(error);
+        if (poll(&waiting, 1, timeout) == 1 && getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) == 0 && error == 0)
+        {
+            result = 0;
+        }
+    }
+    if (result < 0)
+    {
+        close(fd);
+        return 0;
+    }
+    socket = std::make_shared<Socket>(fd);
+    return 1;
+}
+
+int WiFiClient::connect(const char *host, uint16_t port)
+{
+    return connect(host, port, 3000);
+}
+
+int WiFiClient::connect(const char *host, uint16_t port, int32_t timeout)
+{
+    IPAddress address;
+    if (!WiFi.hostByName(host, address))
+    {
+        return 0;
+    }
+    return connect(address, port, timeout);
+}
+
+size_t WiFiClient::write(uint8_t data)
+{
+    return write(&data, 1);
+}
+
+size_t WiFiClient::write(const uint8_t *buf, size_t size)
+{
+    if (!socket || socket->closed)
+    {
+        return 0;
+    }
+    size_t sent = 0;
+    while (sent < size)
+    {
+        ssize_t n = send(socket->fd, buf + sent, size - sent, MSG_NOSIGNAL);
+        if (n > 0)
+        {
+            sent += n;
+        }
+        else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            pollfd waiting = {socket->fd, POLLOUT, 0};
+            poll(&waiting, 1, 100);
+        }
+        else
+        {
+            socket->closed = true;
+            break;
+        }
+    }
+    return sent;
+}
+
+int WiFiClient::available()
+{
+    if (!socket)
+    {
+        return 0;
+    }
+    int count = 0;
+    if (ioctl(socket->fd, FIONREAD, &count) < 0)
+    {
+        return 0;
+    }
+    return count;
+}
+
+int WiFiClient::read()
+{
+    uint8_t data;
+    return read(&data, 1) == 1 ? data : -1;
+}
+
+int WiFiClient::read(uint8_t *buf, size_t size)
+{
+    if (!socket || size == 0)
+    {
+        return -1;
+    }
+    ssize_t n = recv(socket->fd, buf, size, MSG_DONTWAIT);
+    if (n > 0)
+    {
+        return n;
+    }
+    if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+    {
+        socket->closed = true;
+    }
+    return -1;
+}
+
+int WiFiClient::peek()
+{
+    if (!socket)
+    {
+        return -1;
+    }
+    uint8_t data;
+    return recv(socket->fd, &data, 1, MSG_PEEK | MSG_DONTWAIT) == 1 ? data : -1;
+}
+
+void WiFiClient::flush()
+{
+    // Throws away unread input, as the core does
+    uint8_t scratch[1024];
+    int left = available();
+    while (left > 0)
+    {
+        int n = read(scratch, min((size_t)left, sizeof(scratch)));
+        if (n <= 0)
+        {
+            break;
+        }
+        left -= n;
+    }
+}
+
+void WiFiClient::stop()
+{
+    socket.reset();
+}
+
+uint8_t WiFiClient::connected()
+{
+    if (!socket || socket->closed)
+    {
+        return 0;
+    }
+    uint8_t data;
+    ssize_t n = recv(socket->fd, &data, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+    {
+        socket->closed = true;
+        return 0;
+    }
+    return 1;
+}
+
+int WiFiClient::fd() const
+{
+    return socket ? socket->fd : -1;
+}
+
+int WiFiClient::setNoDelay(bool nodelay)
+{
+    int flag = nodelay;
+    return socket ? setsockopt(socket->fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag)) : -1;
+}
@@ -0,0 +1,30 @@
+#ifndef HOST_WIFI_H
+#define HOST_WIFI_H
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+
+typedef enum
+{
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_SCAN_COMPLETED = 2,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_DISCONNECTED = 6,
+} wl_status_t;
+
+class WiFiClass
+{
+public:
+    wl_status_t status();
+    IPAddress localIP();
+    int8_t RSSI();
+    // 1 on success, like the core
+    int hostByName(const char *host, IPAddress &address);
+};
+
+extern WiFiClass WiFi;
+
+#endif
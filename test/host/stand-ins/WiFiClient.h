@@ -0,0 +1,58 @@
+#ifndef HOST_WIFI_CLIENT_H
+#define HOST_WIFI_CLIENT_H
+
+// TCP over host sockets. Reads never block, like the core's WiFiClient;
+// readBytes() waits up to the stream timeout.
+
+#include <Arduino.h>
+#include <memory>
+
+class Client : public Stream
+{
+public:
+    virtual int connect(IPAddress ip, uint16_t port) = 0;
+    virtual int connect(const char *host, uint16_t port) = 0;
+    virtual size_t write(uint8_t) = 0;
+    virtual size_t write(const uint8_t *buf, size_t size) = 0;
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int read(uint8_t *buf, size_t size) = 0;
+    virtual int peek() = 0;
+    virtual void flush() = 0;
+    virtual void stop() = 0;
+    virtual uint8_t connected() = 0;
+    virtual operator bool() = 0;
+};
+
+class WiFiClient : public Client
+{
+public:
+    WiFiClient();
+    virtual ~WiFiClient();
+
+    int connect(IPAddress ip, uint16_t port) override;
+    int connect(IPAddress ip, uint16_t port, int32_t timeout);
+    int connect(const char *host, uint16_t port) override;
+    virtual int connect(const char *host, uint16_t port, int32_t timeout);
+    size_t write(uint8_t data) override;
+    size_t write(const uint8_t *buf, size_t size) override;
+    int available() override;
+    int read() override;
+    int read(uint8_t *buf, size_t size) override;
+    int peek() override;
+    void flush() override;
+    void stop() override;
+    uint8_t connected() override;
+    operator bool() override { return connected(); }
+    int fd() const;
+    int setNoDelay(bool nodelay);
+
+    using Print::write;
+
+private:
+    struct Socket;
+    // Shared between copies, as in the core
+    std::shared_ptr<Socket> socket;
+};
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef HOST_ESP_OTA_OPS_H
+#define HOST_ESP_OTA_OPS_H
+
+#include "esp_partition.h"
+
+#define ESP_IMAGE_HEADER_MAGIC 0xE9
+
+const esp_partition_t *esp_ota_get_running_partition(void);
+const esp_partition_t *esp_ota_get_boot_partition(void);
+const esp_partition_t *esp_ota_get_next_update_partition(const esp_partition_t *start_from);
+// Checks the image's magic byte, the part of image validation the host can do
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t *partition);
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef HOST_ESP_ROM_CRC_H
+#define HOST_ESP_ROM_CRC_H
+
+#include <stdint.h>
+#include <zlib.h>
+
+// The ROM's little-endian CRC-32 is the zlib/gzip one
+static inline uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len)
+{
+    return crc32(crc, buf, len);
+}
+
+#endif
@@ -0,0 +1,600 @@
+#define OPENSSL_SUPPRESS_DEPRECATED
+#include <mbedtls/sha256.h>
+#include <mbedtls/pk.h>
+#include <mbedtls/x509_crt.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/ctr_drbg.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/rsa.h>
+#include <openssl/sha.h>
+#include <openssl/x509.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mutex>
+#include <string>
+#include "Host.h"
+
+struct mbedtls_pk_info_t
+{
+    mbedtls_pk_type_t type;
+};
+
+namespace
+{
+    const mbedtls_pk_info_t RSA_INFO = {MBEDTLS_PK_RSA};
+    const mbedtls_pk_info_t ECKEY_INFO = {MBEDTLS_PK_ECKEY};
+
+    // What pk_ctx points at; EC keys start with the keypair like in mbedtls
+    struct HostKey
+    {
+        mbedtls_ecp_keypair keypair;
+        EVP_PKEY *pkey;
+    };
+
+    EVP_PKEY *evpKey(const mbedtls_pk_context *ctx)
+    {
+        return ctx->MBEDTLS_PRIVATE(pk_ctx) ? static_cast<HostKey *>(ctx->MBEDTLS_PRIVATE(pk_ctx))->pkey : nullptr;
+    }
+
+    mbedtls_ecp_group_id curveOf(EVP_PKEY *pkey)
+    {
+        char name[64];
+        size_t length = 0;
+        if (!EVP_PKEY_get_group_name(pkey, name, sizeof(name), &length))
+        {
+            return MBEDTLS_ECP_DP_NONE;
+        }
+        const struct
+        {
+            const char *name;
+            mbedtls_ecp_group_id id;
+        } curves[] = {{"prime256v1", MBEDTLS_ECP_DP_SECP256R1}, {"secp384r1", MBEDTLS_ECP_DP_SECP384R1},
+                      {"secp521r1", MBEDTLS_ECP_DP_SECP521R1},  {"secp224r1", MBEDTLS_ECP_DP_SECP224R1},
+                      {"secp256k1", MBEDTLS_ECP_DP_SECP256K1},  {"prime192v1", MBEDTLS_ECP_DP_SECP192R1}};
+        for (const auto &curve : curves)
+        {
+            if (strcmp(name, curve.name) == 0)
+            {
+                return curve.id;
+            }
+        }
+        return MBEDTLS_ECP_DP_NONE;
+    }
+
+    // Takes ownership of pkey
+    int adopt(mbedtls_pk_context *ctx, EVP_PKEY *pkey)
+    {
+        const mbedtls_pk_info_t *info = nullptr;
+        switch (EVP_PKEY_get_base_id(pkey))
+        {
+        case EVP_PKEY_RSA:
+            info = &RSA_INFO;
+            break;
+        case EVP_PKEY_EC:
+            info = &ECKEY_INFO;
+            break;
+        default:
+            EVP_PKEY_free(pkey);
+            return MBEDTLS_ERR_PK_KEY_INVALID_FORMAT;
+        }
+        HostKey *key = new HostKey();
+        key->keypair.MBEDTLS_PRIVATE(grp).id = info == &ECKEY_INFO ? curveOf(pkey) : MBEDTLS_ECP_DP_NONE;
+        key->pkey = pkey;
+        ctx->MBEDTLS_PRIVATE(pk_info) = info;
+        ctx->MBEDTLS_PRIVATE(pk_ctx) = key;
+        return 0;
+    }
+
+    // The server end of the TLS stand-in
+    std::mutex tlsLock;
+    std::string serverPem;
+    bool serverTrusted = false;
+    uint32_t ticketGeneration = 1;
+    host::TlsStats tlsStats;
+}
+
+namespace host
+{
+    void setTlsServerCertificate(const std::string &pem, bool trustedByCa)
+    {
+        std::lock_guard<std::mutex> lock(tlsLock);
+        serverPem = pem;
+        serverTrusted = trustedByCa;
+    }
+
+    void dropTlsTickets()
+    {
+        std::lock_guard<std::mutex> lock(tlsLock);
+        ticketGeneration++;
+    }
+
+    TlsStats tlsStats()
+    {
+        std::lock_guard<std::mutex> lock(tlsLock);
+        return ::tlsStats;
+    }
+
+    void resetTls()
+    {
+        std::lock_guard<std::mutex> lock(tlsLock);
+        serverPem.clear();
+        serverTrusted = false;
+        ticketGeneration++;
+        ::tlsStats = TlsStats();
+    }
+}
+
+// SHA-256
+
+static_assert(sizeof(SHA256_CTX) <= sizeof(mbedtls_sha256_context), "SHA256_CTX does not fit");
+
+void mbedtls_sha256_init(mbedtls_sha256_context *ctx)
+{
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+void mbedtls_sha256_free(mbedtls_sha256_context *ctx)
+{
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+int mbedtls_sha256_starts(mbedtls_sha256_context *ctx, int is224)
+{
+    SHA256_CTX *sha = reinterpret_cast<SHA256_CTX *>(ctx->MBEDTLS_PRIVATE(state));
+    return (is224 ? SHA224_Init(sha) : SHA256_Init(sha)) == 1 ? 0 : -1;
+}
+
+int mbedtls_sha256_update(mbedtls_sha256_context *ctx, const unsigned char *input, size_t ilen)
+{
+    return SHA256_Update(reinterpret_cast<SHA256_CTX *>(ctx->MBEDTLS_PRIVATE(state)), input, ilen) == 1 ? 0 : -1;
+}
+
+int mbedtls_sha256_finish(mbedtls_sha256_context *ctx, unsigned char *output)
+{
+    return SHA256_Final(output, reinterpret_cast<SHA256_CTX *>(ctx->MBEDTLS_PRIVATE(state))) == 1 ? 0 : -1;
+}
+
+int mbedtls_sha256(const unsigned char *input, size_t ilen, unsigned char *output, int is224)
+{
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    int ret = mbedtls_sha256_starts(&ctx, is224);
+    if (ret == 0)
+    {
+        ret = mbedtls_sha256_update(&ctx, input, ilen);
+    }
+    if (ret == 0)
+    {
+        ret = mbedtls_sha256_finish(&ctx, output);
+    }
+    mbedtls_sha256_free(&ctx);
+    return ret;
+}
+
+// Public keys
+
+void mbedtls_pk_init(mbedtls_pk_context *ctx)
+{
+    ctx->MBEDTLS_PRIVATE(pk_info) = nullptr;
+    ctx->MBEDTLS_PRIVATE(pk_ctx) = nullptr;
+}
+
+void mbedtls_pk_free(mbedtls_pk_context *ctx)
+{
+    HostKey *key = static_cast<HostKey *>(ctx->MBEDTLS_PRIVATE(pk_ctx));
+    if (key)
+    {
+        EVP_PKEY_free(key->pkey);
+        delete key;
+    }
+    mbedtls_pk_init(ctx);
+}
+
+mbedtls_pk_type_t mbedtls_pk_get_type(const mbedtls_pk_context *ctx)
+{
+    return ctx->MBEDTLS_PRIVATE(pk_info) ? ctx->MBEDTLS_PRIVATE(pk_info)->type : MBEDTLS_PK_NONE;
+}
+
+int mbedtls_pk_can_do(const mbedtls_pk_context *ctx, mbedtls_pk_type_t type)
+{
+    switch (mbedtls_pk_get_type(ctx))
+    {
+    case MBEDTLS_PK_RSA:
+        return type == MBEDTLS_PK_RSA;
+    case MBEDTLS_PK_ECKEY:
+        return type == MBEDTLS_PK_ECKEY || type == MBEDTLS_PK_ECKEY_DH || type == MBEDTLS_PK_ECDSA;
+    default:
+        return 0;
+    }
+}
+
+int mbedtls_pk_parse_public_key(mbedtls_pk_context *ctx, const unsigned char *key, size_t keylen)
+{
+    if (mbedtls_pk_get_type(ctx) != MBEDTLS_PK_NONE)
+    {
+        return MBEDTLS_ERR_PK_BAD_INPUT_DATA;
+    }
+    EVP_PKEY *pkey = nullptr;
+    if (keylen > 0 && key[keylen - 1] == '\0')
+    {
+        BIO *bio = BIO_new_mem_buf(key, keylen - 1);
+        pkey = PEM_read_bio_PUBKEY(bio, nullptr, nullptr, nullptr);
+        BIO_free(bio);
+    }
+    else
+    {
+        const unsigned char *p = key;
+        pkey = d2i_PUBKEY(nullptr, &p, keylen);
+    }
+    if (!pkey)
+    {
+        return MBEDTLS_ERR_PK_KEY_INVALID_FORMAT;
+    }
+    return adopt(ctx, pkey);
+}
+
+int mbedtls_pk_verify(mbedtls_pk_context *ctx, mbedtls_md_type_t md_alg, const unsigned char *hash, size_t hash_len,
+                      const unsigned char *sig, size_t sig_len)
+{
+    EVP_PKEY *pkey = evpKey(ctx);
+    if (!pkey || md_alg != MBEDTLS_MD_SHA256 || hash_len != 32)
+    {
+        return MBEDTLS_ERR_PK_BAD_INPUT_DATA;
+    }
+    bool rsa = mbedtls_pk_get_type(ctx) == MBEDTLS_PK_RSA;
+    EVP_PKEY_CTX *verify = EVP_PKEY_CTX_new(pkey, nullptr);
+    bool ok = verify && EVP_PKEY_verify_init(verify) == 1 &&
+              (!rsa || (EVP_PKEY_CTX_set_rsa_padding(verify, RSA_PKCS1_PADDING) == 1 &&
+                        EVP_PKEY_CTX_set_signature_md(verify, EVP_sha256()) == 1)) &&
+              EVP_PKEY_verify(verify, sig, sig_len, hash, hash_len) == 1;
+    EVP_PKEY_CTX_free(verify);
+    if (!ok)
+    {
+        return rsa ? MBEDTLS_ERR_RSA_VERIFY_FAILED : MBEDTLS_ERR_ECP_VERIFY_FAILED;
+    }
+    return 0;
+}
+
+int mbedtls_pk_write_pubkey_der(const mbedtls_pk_context *ctx, unsigned char *buf, size_t size)
+{
+    EVP_PKEY *pkey = evpKey(ctx);
+    int length = pkey ? i2d_PUBKEY(pkey, nullptr) : -1;
+    if (length <= 0)
+    {
+        return MBEDTLS_ERR_PK_BAD_INPUT_DATA;
+    }
+    if ((size_t)length > size)
+    {
+        return MBEDTLS_ERR_ASN1_BUF_TOO_SMALL;
+    }
+    // Written at the end of the buffer, as mbedtls does
+    unsigned char *p = buf + size - length;
+    i2d_PUBKEY(pkey, &p);
+    return length;
+}
+
+// Certificates
+
+void mbedtls_x509_crt_init(mbedtls_x509_crt *crt)
+{
+    mbedtls_pk_init(&crt->pk);
+    crt->next = nullptr;
+}
+
+void mbedtls_x509_crt_free(mbedtls_x509_crt *crt)
+{
+    mbedtls_pk_free(&crt->pk);
+    crt->next = nullptr;
+}
+
+int mbedtls_x509_crt_parse(mbedtls_x509_crt *chain, const unsigned char *buf, size_t buflen)
+{
+    if (buflen == 0 || buf[buflen - 1] != '\0')
+    {
+        return MBEDTLS_ERR_X509_INVALID_FORMAT;
+    }
+    BIO *bio = BIO_new_mem_buf(buf, buflen - 1);
+    X509 *cert = PEM_read_bio_X509(bio, nullptr, nullptr, nullptr);
+    BIO_free(bio);
+    if (!cert)
+    {
+        return MBEDTLS_ERR_X509_INVALID_FORMAT;
+    }
+    EVP_PKEY *pkey = X509_get_pubkey(cert);
+    X509_free(cert);
+    mbedtls_x509_crt_free(chain);
+    return pkey ? adopt(&chain->pk, pkey) : MBEDTLS_ERR_X509_INVALID_FORMAT;
+}
+
+// Randomness
+
+void mbedtls_entropy_init(mbedtls_entropy_context *ctx)
+{
+    ctx->MBEDTLS_PRIVATE(initialized) = 1;
+}
+
+void mbedtls_entropy_free(mbedtls_entropy_context *ctx)
+{
+    ctx->MBEDTLS_PRIVATE(initialized) = 0;
+}
+
+int mbedtls_entropy_func(void *data, unsigned char *output, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        output[i] = host::nextRandom();
+    }
+    return 0;
+}
+
+void mbedtls_ctr_drbg_init(mbedtls_ctr_drbg_context *ctx)
+{
+    ctx->MBEDTLS_PRIVATE(seeded) = 0;
+}
+
+void mbedtls_ctr_drbg_free(mbedtls_ctr_drbg_context *ctx)
+{
+    ctx->MBEDTLS_PRIVATE(seeded) = 0;
+}
+
+int mbedtls_ctr_drbg_seed(mbedtls_ctr_drbg_context *ctx, int (*f_entropy)(void *, unsigned char *, size_t),
+                          void *p_entropy, const unsigned char *custom, size_t len)
+{
+    ctx->MBEDTLS_PRIVATE(seeded) = 1;
+    return 0;
+}
+
+int mbedtls_ctr_drbg_random(void *p_rng, unsigned char *output, size_t output_len)
+{
+    return mbedtls_entropy_func(nullptr, output, output_len);
+}
+
+// TLS
+
+void mbedtls_ssl_config_init(mbedtls_ssl_config *conf)
+{
+    memset(conf, 0, sizeof(*conf));
+}
+
+void mbedtls_ssl_config_free(mbedtls_ssl_config *conf)
+{
+    memset(conf, 0, sizeof(*conf));
+}
+
+int mbedtls_ssl_config_defaults(mbedtls_ssl_config *conf, int endpoint, int transport, int preset)
+{
+    conf->MBEDTLS_PRIVATE(authmode) = MBEDTLS_SSL_VERIFY_REQUIRED;
+    conf->MBEDTLS_PRIVATE(tickets) = MBEDTLS_SSL_SESSION_TICKETS_ENABLED;
+    return 0;
+}
+
+void mbedtls_ssl_conf_authmode(mbedtls_ssl_config *conf, int authmode)
+{
+    conf->MBEDTLS_PRIVATE(authmode) = authmode;
+}
+
+void mbedtls_ssl_conf_ca_chain(mbedtls_ssl_config *conf, mbedtls_x509_crt *ca_chain, void *ca_crl)
+{
+    conf->MBEDTLS_PRIVATE(ca_chain) = ca_chain;
+}
+
+void mbedtls_ssl_conf_rng(mbedtls_ssl_config *conf, int (*f_rng)(void *, unsigned char *, size_t), void *p_rng)
+{
+    conf->MBEDTLS_PRIVATE(f_rng) = f_rng;
+    conf->MBEDTLS_PRIVATE(p_rng) = p_rng;
+}
+
+void mbedtls_ssl_conf_verify(mbedtls_ssl_config *conf, int (*f_vrfy)(void *, mbedtls_x509_crt *, int, uint32_t *),
+                             void *p_vrfy)
+{
+    conf->MBEDTLS_PRIVATE(f_vrfy) = f_vrfy;
+    conf->MBEDTLS_PRIVATE(p_vrfy) = p_vrfy;
+}
+
+void mbedtls_ssl_conf_session_tickets(mbedtls_ssl_config *conf, int use_tickets)
+{
+    conf->MBEDTLS_PRIVATE(tickets) = use_tickets;
+}
+
+void mbedtls_ssl_init(mbedtls_ssl_context *ssl)
+{
+    memset(ssl, 0, sizeof(*ssl));
+}
+
+void mbedtls_ssl_free(mbedtls_ssl_context *ssl)
+{
+    free(ssl->MBEDTLS_PRIVATE(in_buf));
+    free(ssl->MBEDTLS_PRIVATE(out_buf));
+    free(ssl->MBEDTLS_PRIVATE(hostname));
+    memset(ssl, 0, sizeof(*ssl));
+}
+
+int mbedtls_ssl_setup(mbedtls_ssl_context *ssl, const mbedtls_ssl_config *conf)
+{
+    // The record buffers dominate a TLS connection's heap, so they are allocated as on the device
+    ssl->MBEDTLS_PRIVATE(conf) = conf;
+    ssl->MBEDTLS_PRIVATE(in_buf) = (unsigned char *)malloc(MBEDTLS_SSL_IN_CONTENT_LEN);
+    ssl->MBEDTLS_PRIVATE(out_buf) = (unsigned char *)malloc(MBEDTLS_SSL_OUT_CONTENT_LEN);
+    if (!ssl->MBEDTLS_PRIVATE(in_buf) || !ssl->MBEDTLS_PRIVATE(out_buf))
+    {
+        return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+    }
+    return 0;
+}
+
+int mbedtls_ssl_set_hostname(mbedtls_ssl_context *ssl, const char *hostname)
+{
+    free(ssl->MBEDTLS_PRIVATE(hostname));
+    ssl->MBEDTLS_PRIVATE(hostname) = strdup(hostname);
+    return ssl->MBEDTLS_PRIVATE(hostname) ? 0 : MBEDTLS_ERR_SSL_ALLOC_FAILED;
+}
+
+void mbedtls_ssl_set_bio(mbedtls_ssl_context *ssl, void *p_bio, mbedtls_ssl_send_t *f_send, mbedtls_ssl_recv_t *f_recv,
+                         mbedtls_ssl_recv_timeout_t *f_recv_timeout)
+{
+    ssl->MBEDTLS_PRIVATE(p_bio) = p_bio;
+    ssl->MBEDTLS_PRIVATE(f_send) = f_send;
+    ssl->MBEDTLS_PRIVATE(f_recv) = f_recv;
+}
+
+int mbedtls_ssl_handshake(mbedtls_ssl_context *ssl)
+{
+    if (ssl->MBEDTLS_PRIVATE(handshake_done))
+    {
+        return 0;
+    }
+    const mbedtls_ssl_config *conf = ssl->MBEDTLS_PRIVATE(conf);
+    if (!conf || !ssl->MBEDTLS_PRIVATE(in_buf))
+    {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+    std::string pem;
+    bool trusted;
+    uint32_t generation;
+    {
+        std::lock_guard<std::mutex> lock(tlsLock);
+        generation = ticketGeneration;
+        uint32_t offered = ssl->MBEDTLS_PRIVATE(session_negotiate).MBEDTLS_PRIVATE(ticket);
+        if (offered != 0 && offered == generation && conf->MBEDTLS_PRIVATE(tickets))
+        {
+            // Resumed: no certificate is sent, so nothing is verified
+            tlsStats.resumedHandshakes++;
+            ssl->MBEDTLS_PRIVATE(session).MBEDTLS_PRIVATE(ticket) = generation;
+            ssl->MBEDTLS_PRIVATE(handshake_done) = 1;
+            return 0;
+        }
+        tlsStats.fullHandshakes++;
+        pem = serverPem;
+        trusted = serverTrusted;
+    }
+
+    mbedtls_x509_crt crt;
+    mbedtls_x509_crt_init(&crt);
+    if (mbedtls_x509_crt_parse(&crt, (const unsigned char *)pem.c_str(), pem.size() + 1) != 0)
+    {
+        mbedtls_x509_crt_free(&crt);
+        return MBEDTLS_ERR_X509_CERT_VERIFY_FAILED;
+    }
+    uint32_t flags = trusted && conf->MBEDTLS_PRIVATE(ca_chain) ? 0 : MBEDTLS_X509_BADCERT_NOT_TRUSTED;
+    int ret = 0;
+    if (conf->MBEDTLS_PRIVATE(f_vrfy))
+    {
+        {
+            std::lock_guard<std::mutex> lock(tlsLock);
+            tlsStats.verifyCalls++;
+        }
+        ret = conf->MBEDTLS_PRIVATE(f_vrfy)(conf->MBEDTLS_PRIVATE(p_vrfy), &crt, 0, &flags);
+    }
+    mbedtls_x509_crt_free(&crt);
+    if (ret != 0)
+    {
+        return ret;
+    }
+    if (flags != 0 && conf->MBEDTLS_PRIVATE(authmode) == MBEDTLS_SSL_VERIFY_REQUIRED)
+    {
+        return MBEDTLS_ERR_X509_CERT_VERIFY_FAILED;
+    }
+    ssl->MBEDTLS_PRIVATE(session).MBEDTLS_PRIVATE(ticket) = conf->MBEDTLS_PRIVATE(tickets) ? generation : 0;
+    ssl->MBEDTLS_PRIVATE(handshake_done) = 1;
+    return 0;
+}
+
+int mbedtls_ssl_read(mbedtls_ssl_context *ssl, unsigned char *buf, size_t len)
+{
+    if (!ssl->MBEDTLS_PRIVATE(handshake_done))
+    {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+    if (ssl->MBEDTLS_PRIVATE(in_left) == 0)
+    {
+        // One "record" is whatever the transport has, up to the record size
+        int received = ssl->MBEDTLS_PRIVATE(f_recv)(ssl->MBEDTLS_PRIVATE(p_bio), ssl->MBEDTLS_PRIVATE(in_buf),
+                                                    MBEDTLS_SSL_IN_CONTENT_LEN);
+        if (received <= 0)
+        {
+            return received < 0 ? received : MBEDTLS_ERR_NET_CONN_RESET;
+        }
+        ssl->MBEDTLS_PRIVATE(in_offset) = 0;
+        ssl->MBEDTLS_PRIVATE(in_left) = received;
+    }
+    size_t n = len < ssl->MBEDTLS_PRIVATE(in_left) ? len : ssl->MBEDTLS_PRIVATE(in_left);
+    memcpy(buf, ssl->MBEDTLS_PRIVATE(in_buf) + ssl->MBEDTLS_PRIVATE(in_offset), n);
+    ssl->MBEDTLS_PRIVATE(in_offset) += n;
+    ssl->MBEDTLS_PRIVATE(in_left) -= n;
+    return n;
+}
+
+int mbedtls_ssl_write(mbedtls_ssl_context *ssl, const unsigned char *buf, size_t len)
+{
+    if (!ssl->MBEDTLS_PRIVATE(handshake_done))
+    {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+    size_t n = len < MBEDTLS_SSL_OUT_CONTENT_LEN ? len : MBEDTLS_SSL_OUT_CONTENT_LEN;
+    memcpy(ssl->MBEDTLS_PRIVATE(out_buf), buf, n);
+    return ssl->MBEDTLS_PRIVATE(f_send)(ssl->MBEDTLS_PRIVATE(p_bio), ssl->MBEDTLS_PRIVATE(out_buf), n);
+}
+
+size_t mbedtls_ssl_get_bytes_avail(const mbedtls_ssl_context *ssl)
+{
+    return ssl->MBEDTLS_PRIVATE(in_left);
+}
+
+int mbedtls_ssl_close_notify(mbedtls_ssl_context *ssl)
+{
+    return 0;
+}
+
+void mbedtls_ssl_session_init(mbedtls_ssl_session *session)
+{
+    session->MBEDTLS_PRIVATE(ticket) = 0;
+}
+
+void mbedtls_ssl_session_free(mbedtls_ssl_session *session)
+{
+    session->MBEDTLS_PRIVATE(ticket) = 0;
+}
+
+int mbedtls_ssl_get_session(const mbedtls_ssl_context *ssl, mbedtls_ssl_session *session)
+{
+    if (!ssl->MBEDTLS_PRIVATE(handshake_done) || ssl->MBEDTLS_PRIVATE(session).MBEDTLS_PRIVATE(ticket) == 0)
+    {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+    *session = ssl->MBEDTLS_PRIVATE(session);
+    return 0;
+}
+
+int mbedtls_ssl_set_session(mbedtls_ssl_context *ssl, const mbedtls_ssl_session *session)
+{
+    if (ssl->MBEDTLS_PRIVATE(handshake_done))
+    {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+    ssl->MBEDTLS_PRIVATE(session_negotiate) = *session;
+    return 0;
+}
+
+int mbedtls_ssl_session_save(const mbedtls_ssl_session *session, unsigned char *buf, size_t buf_len, size_t *olen)
+{
+    *olen = 8;
+    if (buf_len < *olen)
+    {
+        return MBEDTLS_ERR_SSL_BUFFER_TOO_SMALL;
+    }
+    memcpy(buf, "HSES", 4);
+    memcpy(buf + 4, &session->MBEDTLS_PRIVATE(ticket), 4);
+    return 0;
+}
+
+int mbedtls_ssl_session_load(mbedtls_ssl_session *session, const unsigned char *buf, size_t len)
+{
+    if (len != 8 || memcmp(buf, "HSES", 4) != 0)
+    {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+    memcpy(&session->MBEDTLS_PRIVATE(ticket), buf + 4, 4);
+    return 0;
+}
@@ -0,0 +1,36 @@
+#ifndef HOST_MBEDTLS_ECP_H
+#define HOST_MBEDTLS_ECP_H
+
+#include "private_access.h"
+
+#define MBEDTLS_ERR_ECP_VERIFY_FAILED -0x4E00
+
+typedef enum
+{
+    MBEDTLS_ECP_DP_NONE = 0,
+    MBEDTLS_ECP_DP_SECP192R1,
+    MBEDTLS_ECP_DP_SECP224R1,
+    MBEDTLS_ECP_DP_SECP256R1,
+    MBEDTLS_ECP_DP_SECP384R1,
+    MBEDTLS_ECP_DP_SECP521R1,
+    MBEDTLS_ECP_DP_BP256R1,
+    MBEDTLS_ECP_DP_BP384R1,
+    MBEDTLS_ECP_DP_BP512R1,
+    MBEDTLS_ECP_DP_CURVE25519,
+    MBEDTLS_ECP_DP_SECP192K1,
+    MBEDTLS_ECP_DP_SECP224K1,
+    MBEDTLS_ECP_DP_SECP256K1,
+    MBEDTLS_ECP_DP_CURVE448,
+} mbedtls_ecp_group_id;
+
+typedef struct mbedtls_ecp_group
+{
+    mbedtls_ecp_group_id id;
+} mbedtls_ecp_group;
+
+typedef struct mbedtls_ecp_keypair
+{
+    mbedtls_ecp_group MBEDTLS_PRIVATE(grp);
+} mbedtls_ecp_keypair;
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef HOST_MBEDTLS_ENTROPY_H
+#define HOST_MBEDTLS_ENTROPY_H
+
+#include <stddef.h>
+#include "private_access.h"
+
+typedef struct mbedtls_entropy_context
+{
+    int MBEDTLS_PRIVATE(initialized);
+} mbedtls_entropy_context;
+
+void mbedtls_entropy_init(mbedtls_entropy_context *ctx);
+void mbedtls_entropy_free(mbedtls_entropy_context *ctx);
+int mbedtls_entropy_func(void *data, unsigned char *output, size_t len);
+
+#endif
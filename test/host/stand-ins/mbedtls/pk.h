@@ -0,0 +1,67 @@
+#ifndef HOST_MBEDTLS_PK_H
+#define HOST_MBEDTLS_PK_H
+
+// mbedtls public-key API over OpenSSL EVP keys
+
+#include <stddef.h>
+#include "private_access.h"
+#include "ecp.h"
+
+#define MBEDTLS_ERR_PK_ALLOC_FAILED -0x3F80
+#define MBEDTLS_ERR_PK_TYPE_MISMATCH -0x3F00
+#define MBEDTLS_ERR_PK_BAD_INPUT_DATA -0x3E80
+#define MBEDTLS_ERR_PK_KEY_INVALID_FORMAT -0x3D00
+#define MBEDTLS_ERR_PK_SIG_LEN_MISMATCH -0x3900
+#define MBEDTLS_ERR_RSA_VERIFY_FAILED -0x4380
+#define MBEDTLS_ERR_ASN1_BUF_TOO_SMALL -0x006C
+
+typedef enum
+{
+    MBEDTLS_MD_NONE = 0,
+    MBEDTLS_MD_MD5,
+    MBEDTLS_MD_SHA1,
+    MBEDTLS_MD_SHA224,
+    MBEDTLS_MD_SHA256,
+} mbedtls_md_type_t;
+
+typedef enum
+{
+    MBEDTLS_PK_NONE = 0,
+    MBEDTLS_PK_RSA,
+    MBEDTLS_PK_ECKEY,
+    MBEDTLS_PK_ECKEY_DH,
+    MBEDTLS_PK_ECDSA,
+} mbedtls_pk_type_t;
+
+typedef struct mbedtls_pk_info_t mbedtls_pk_info_t;
+
+typedef struct mbedtls_pk_context
+{
+    const mbedtls_pk_info_t *MBEDTLS_PRIVATE(pk_info);
+    void *MBEDTLS_PRIVATE(pk_ctx);
+} mbedtls_pk_context;
+
+void mbedtls_pk_init(mbedtls_pk_context *ctx);
+void mbedtls_pk_free(mbedtls_pk_context *ctx);
+mbedtls_pk_type_t mbedtls_pk_get_type(const mbedtls_pk_context *ctx);
+int mbedtls_pk_can_do(const mbedtls_pk_context *ctx, mbedtls_pk_type_t type);
+int mbedtls_pk_parse_public_key(mbedtls_pk_context *ctx, const unsigned char *key, size_t keylen);
+int mbedtls_pk_verify(mbedtls_pk_context *ctx, mbedtls_md_type_t md_alg, const unsigned char *hash, size_t hash_len,
+                      const unsigned char *sig, size_t sig_len);
+int mbedtls_pk_write_pubkey_der(const mbedtls_pk_context *ctx, unsigned char *buf, size_t size);
+
+// EC keys keep the keypair at the start of pk_ctx, as mbedtls does
+static inline mbedtls_ecp_keypair *mbedtls_pk_ec(const mbedtls_pk_context pk)
+{
+    switch (mbedtls_pk_get_type(&pk))
+    {
+    case MBEDTLS_PK_ECKEY:
+    case MBEDTLS_PK_ECKEY_DH:
+    case MBEDTLS_PK_ECDSA:
+        return (mbedtls_ecp_keypair *)pk.MBEDTLS_PRIVATE(pk_ctx);
+    default:
+        return NULL;
+    }
+}
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef HOST_MBEDTLS_PRIVATE_ACCESS_H
+#define HOST_MBEDTLS_PRIVATE_ACCESS_H
+
+// As in mbedtls 3.x (ESP-IDF 5), private members are renamed so code that
+// uses them has to say so
+
+#define MBEDTLS_PRIVATE(member) private_##member
+
+#endif
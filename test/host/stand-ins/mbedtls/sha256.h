@@ -0,0 +1,23 @@
+#ifndef HOST_MBEDTLS_SHA256_H
+#define HOST_MBEDTLS_SHA256_H
+
+// mbedtls SHA-256 API over OpenSSL's software implementation
+
+#include <stddef.h>
+#include <stdint.h>
+#include "private_access.h"
+
+typedef struct mbedtls_sha256_context
+{
+    // Holds an OpenSSL SHA256_CTX
+    alignas(8) unsigned char MBEDTLS_PRIVATE(state)[112];
+} mbedtls_sha256_context;
+
+void mbedtls_sha256_init(mbedtls_sha256_context *ctx);
+void mbedtls_sha256_free(mbedtls_sha256_context *ctx);
+int mbedtls_sha256_starts(mbedtls_sha256_context *ctx, int is224);
+int mbedtls_sha256_update(mbedtls_sha256_context *ctx, const unsigned char *input, size_t ilen);
+int mbedtls_sha256_finish(mbedtls_sha256_context *ctx, unsigned char *output);
+int mbedtls_sha256(const unsigned char *input, size_t ilen, unsigned char *output, int is224);
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef HOST_MBEDTLS_X509_CRT_H
+#define HOST_MBEDTLS_X509_CRT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "pk.h"
+
+#define MBEDTLS_ERR_X509_INVALID_FORMAT -0x2180
+#define MBEDTLS_ERR_X509_CERT_VERIFY_FAILED -0x2700
+#define MBEDTLS_X509_BADCERT_NOT_TRUSTED 0x08
+
+typedef struct mbedtls_x509_crt
+{
+    mbedtls_pk_context pk;
+    struct mbedtls_x509_crt *next;
+} mbedtls_x509_crt;
+
+void mbedtls_x509_crt_init(mbedtls_x509_crt *crt);
+void mbedtls_x509_crt_free(mbedtls_x509_crt *crt);
+// PEM only; the length counts the terminating NUL
+int mbedtls_x509_crt_parse(mbedtls_x509_crt *chain, const unsigned char *buf, size_t buflen);
+
+#endif
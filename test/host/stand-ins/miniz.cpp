@@ -0,0 +1,601 @@
+#include <rom/miniz.h>
+#include <string.h>
+#include <new>
+
+// A resumable inflater in the style of zlib's puff: bits are pulled one byte
+// at a time, so input is consumed exactly up to the end of the deflate stream
+// (the gzip trailer after it is left to the caller). Each step that needs
+// several codes (a length/distance pair, a dynamic block header) runs as one
+// transaction: if the input runs out part way, the step is rolled back and
+// the bytes it had read are kept in a carry buffer for the next call.
+
+namespace
+{
+    const int MAXBITS = 15;
+    const int MAXLCODES = 286;
+    const int MAXDCODES = 30;
+    const int FIXLCODES = 288;
+    const size_t CARRY = 1024;
+
+    const uint16_t LENGTH_BASE[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                      31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    const uint8_t LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                      2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    const uint16_t DIST_BASE[30] = {1,   2,   3,   4,   5,   7,    9,    13,   17,   25,   33,   49,   65,    97,    129,
+                                    193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+    const uint8_t DIST_EXTRA[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+                                    6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+    const uint8_t CODE_ORDER[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+    enum Mode
+    {
+        MODE_HEADER,
+        MODE_STORED_LENGTH,
+        MODE_STORED,
+        MODE_CODES,
+        MODE_DONE,
+        MODE_FAILED
+    };
+
+    enum Step
+    {
+        STEP_OK,
+        STEP_SHORT, // ran out of input
+        STEP_BAD
+    };
+
+    struct Huffman
+    {
+        uint16_t count[MAXBITS + 1];
+        uint16_t symbol[FIXLCODES];
+    };
+
+    struct Inflate
+    {
+        Mode mode;
+        bool last;
+        uint32_t bitBuffer;
+        int bitCount;
+        uint32_t pendingLength; // match or stored bytes still to copy
+        uint32_t pendingDistance;
+        Huffman lengths;
+        Huffman distances;
+
+        const uint8_t *in;
+        size_t inLength;
+        size_t inPos;
+        uint8_t carry[CARRY];
+        size_t carryLength;
+        size_t carryPos;
+
+        size_t savedInPos;
+        size_t savedCarryPos;
+        uint32_t savedBitBuffer;
+        int savedBitCount;
+
+        bool nextByte(uint8_t &b)
+        {
+            if (carryPos < carryLength)
+            {
+                b = carry[carryPos++];
+                return true;
+            }
+            if (inPos < inLength)
+            {
+                b = in[inPos++];
+                return true;
+            }
+            return false;
+        }
+
+        bool need(int n)
+        {
+            uint8_t b;
+            while (bitCount < n)
+            {
+                if (!nextByte(b))
+                {
+                    return false;
+                }
+                bitBuffer |= (uint32_t)b << bitCount;
+                bitCount += 8;
+            }
+            return true;
+        }
+
+        uint32_t take(int n)
+        {
+            uint32_t value = bitBuffer & ((1u << n) - 1);
+            bitBuffer >>= n;
+            bitCount -= n;
+            return value;
+        }
+
+        bool bits(int n, uint32_t &value)
+        {
+            if (!need(n))
+            {
+                return false;
+            }
+            value = take(n);
+            return true;
+        }
+
+        void checkpoint()
+        {
+            savedInPos = inPos;
+            savedCarryPos = carryPos;
+            savedBitBuffer = bitBuffer;
+            savedBitCount = bitCount;
+        }
+
+        // Rolls back to the checkpoint and moves the unread input into the carry buffer
+        bool stash()
+        {
+            inPos = savedInPos;
+            carryPos = savedCarryPos;
+            bitBuffer = savedBitBuffer;
+            bitCount = savedBitCount;
+            size_t left = carryLength - carryPos;
+            if (left + (inLength - inPos) > CARRY)
+            {
+                return false;
+            }
+            memmove(carry, carry + carryPos, left);
+            memcpy(carry + left, in + inPos, inLength - inPos);
+            carryLength = left + (inLength - inPos);
+            carryPos = 0;
+            inPos = inLength;
+            return true;
+        }
+
+        // Symbol, -1 for an invalid code, -2 when the input runs out
+        int decode(const Huffman &h)
+        {
+            int code = 0;
+            int first = 0;
+            int index = 0;
+            for (int len = 1; len <= MAXBITS; len++)
+            {
+                if (!need(1))
+                {
+                    return -2;
+                }
+                code |= take(1);
+                int count = h.count[len];
+                if (code - count < first)
+                {
+                    return h.symbol[index + (code - first)];
+                }
+                index += count;
+                first += count;
+                first <<= 1;
+                code <<= 1;
+            }
+            return -1;
+        }
+    };
+
+    // 0 for a complete code, > 0 for an incomplete one, < 0 if over-subscribed
+    int construct(Huffman &h, const uint16_t *length, int n)
+    {
+        memset(h.count, 0, sizeof(h.count));
+        for (int symbol = 0; symbol < n; symbol++)
+        {
+            h.count[length[symbol]]++;
+        }
+        if (h.count[0] == n)
+        {
+            return 0;
+        }
+        int left = 1;
+        for (int len = 1; len <= MAXBITS; len++)
+        {
+            left <<= 1;
+            left -= h.count[len];
+            if (left < 0)
+            {
+                return left;
+            }
+        }
+        uint16_t offsets[MAXBITS + 1];
+        offsets[1] = 0;
+        for (int len = 1; len < MAXBITS; len++)
+        {
+            offsets[len + 1] = offsets[len] + h.count[len];
+        }
+        for (int symbol = 0; symbol < n; symbol++)
+        {
+            if (length[symbol] != 0)
+            {
+                h.symbol[offsets[length[symbol]]++] = symbol;
+            }
+        }
+        return left;
+    }
+
+    void buildFixed(Inflate &s)
+    {
+        uint16_t lengths[FIXLCODES];
+        int symbol = 0;
+        for (; symbol < 144; symbol++)
+        {
+            lengths[symbol] = 8;
+        }
+        for (; symbol < 256; symbol++)
+        {
+            lengths[symbol] = 9;
+        }
+        for (; symbol < 280; symbol++)
+        {
+            lengths[symbol] = 7;
+        }
+        for (; symbol < FIXLCODES; symbol++)
+        {
+            lengths[symbol] = 8;
+        }
+        construct(s.lengths, lengths, FIXLCODES);
+        for (symbol = 0; symbol < MAXDCODES; symbol++)
+        {
+            lengths[symbol] = 5;
+        }
+        construct(s.distances, lengths, MAXDCODES);
+    }
+
+    Step readDynamic(Inflate &s)
+    {
+        uint32_t nlen, ndist, ncode;
+        if (!s.bits(5, nlen) || !s.bits(5, ndist) || !s.bits(4, ncode))
+        {
+            return STEP_SHORT;
+        }
+        nlen += 257;
+        ndist += 1;
+        ncode += 4;
+        if (nlen > MAXLCODES || ndist > MAXDCODES)
+        {
+            return STEP_BAD;
+        }
+        uint16_t lengths[MAXLCODES + MAXDCODES];
+        uint32_t value;
+        uint32_t index;
+        for (index = 0; index < ncode; index++)
+        {
+            if (!s.bits(3, value))
+            {
+                return STEP_SHORT;
+            }
+            lengths[CODE_ORDER[index]] = value;
+        }
+        for (; index < 19; index++)
+        {
+            lengths[CODE_ORDER[index]] = 0;
+        }
+        // The code-length code is built in the length table and replaced below
+        if (construct(s.lengths, lengths, 19) != 0)
+        {
+            return STEP_BAD;
+        }
+        index = 0;
+        while (index < nlen + ndist)
+        {
+            int symbol = s.decode(s.lengths);
+            if (symbol == -2)
+            {
+                return STEP_SHORT;
+            }
+            if (symbol < 0)
+            {
+                return STEP_BAD;
+            }
+            if (symbol < 16)
+            {
+                lengths[index++] = symbol;
+                continue;
+            }
+            uint16_t repeated = 0;
+            uint32_t times;
+            if (symbol == 16)
+            {
+                if (index == 0)
+                {
+                    return STEP_BAD;
+                }
+                repeated = lengths[index - 1];
+                if (!s.bits(2, times))
+                {
+                    return STEP_SHORT;
+                }
+                times += 3;
+            }
+            else if (symbol == 17)
+            {
+                if (!s.bits(3, times))
+                {
+                    return STEP_SHORT;
+                }
+                times += 3;
+            }
+            else
+            {
+                if (!s.bits(7, times))
+                {
+                    return STEP_SHORT;
+                }
+                times += 11;
+            }
+            if (index + times > nlen + ndist)
+            {
+                return STEP_BAD;
+            }
+            while (times--)
+            {
+                lengths[index++] = repeated;
+            }
+        }
+        if (lengths[256] == 0)
+        {
+            return STEP_BAD;
+        }
+        int err = construct(s.lengths, lengths, nlen);
+        if (err < 0 || (err > 0 && nlen != (uint32_t)s.lengths.count[0] + s.lengths.count[1]))
+        {
+            return STEP_BAD;
+        }
+        err = construct(s.distances, lengths + nlen, ndist);
+        if (err < 0 || (err > 0 && ndist != (uint32_t)s.distances.count[0] + s.distances.count[1]))
+        {
+            return STEP_BAD;
+        }
+        return STEP_OK;
+    }
+
+    // One literal, end of block, or length/distance pair
+    Step readSymbol(Inflate &s, int &literal)
+    {
+        int symbol = s.decode(s.lengths);
+        if (symbol == -2)
+        {
+            return STEP_SHORT;
+        }
+        if (symbol < 0)
+        {
+            return STEP_BAD;
+        }
+        literal = symbol;
+        if (symbol <= 256)
+        {
+            return STEP_OK;
+        }
+        symbol -= 257;
+        if (symbol >= 29)
+        {
+            return STEP_BAD;
+        }
+        uint32_t extra;
+        if (!s.bits(LENGTH_EXTRA[symbol], extra))
+        {
+            return STEP_SHORT;
+        }
+        uint32_t length = LENGTH_BASE[symbol] + extra;
+        symbol = s.decode(s.distances);
+        if (symbol == -2)
+        {
+            return STEP_SHORT;
+        }
+        if (symbol < 0 || symbol >= MAXDCODES)
+        {
+            return STEP_BAD;
+        }
+        if (!s.bits(DIST_EXTRA[symbol], extra))
+        {
+            return STEP_SHORT;
+        }
+        s.pendingLength = length;
+        s.pendingDistance = DIST_BASE[symbol] + extra;
+        return STEP_OK;
+    }
+}
+
+static_assert(sizeof(Inflate) <= sizeof(((tinfl_decompressor *)0)->m_host), "host inflater does not fit");
+
+tinfl_status tinfl_decompress(tinfl_decompressor *r, const mz_uint8 *pIn_buf_next, size_t *pIn_buf_size,
+                              mz_uint8 *pOut_buf_start, mz_uint8 *pOut_buf_next, size_t *pOut_buf_size,
+                              const mz_uint32 decomp_flags)
+{
+    bool wrapping = !(decomp_flags & TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF);
+    size_t mask = wrapping ? (size_t)(pOut_buf_next - pOut_buf_start) + *pOut_buf_size - 1 : (size_t)-1;
+    if (!pIn_buf_size || !pOut_buf_size || pOut_buf_next < pOut_buf_start || ((mask + 1) & mask) != 0 ||
+        (decomp_flags & (TINFL_FLAG_PARSE_ZLIB_HEADER | TINFL_FLAG_COMPUTE_ADLER32)))
+    {
+        if (pIn_buf_size)
+        {
+            *pIn_buf_size = 0;
+        }
+        if (pOut_buf_size)
+        {
+            *pOut_buf_size = 0;
+        }
+        return TINFL_STATUS_BAD_PARAM;
+    }
+
+    Inflate &s = *reinterpret_cast<Inflate *>(r->m_host);
+    if (r->m_state == 0)
+    {
+        new (&s) Inflate();
+        s.mode = MODE_HEADER;
+        r->m_state = 1;
+    }
+    s.in = pIn_buf_next;
+    s.inLength = *pIn_buf_size;
+    s.inPos = 0;
+
+    size_t pos = pOut_buf_next - pOut_buf_start;
+    size_t room = *pOut_buf_size;
+    size_t produced = 0;
+    bool moreInput = decomp_flags & TINFL_FLAG_HAS_MORE_INPUT;
+    tinfl_status status = TINFL_STATUS_DONE;
+
+    auto put = [&](uint8_t b)
+    {
+        pOut_buf_start[pos & mask] = b;
+        pos++;
+        produced++;
+        room--;
+    };
+    auto shortInput = [&]() -> tinfl_status
+    {
+        if (!s.stash() || !moreInput)
+        {
+            s.mode = MODE_FAILED;
+            return TINFL_STATUS_FAILED;
+        }
+        return TINFL_STATUS_NEEDS_MORE_INPUT;
+    };
+
+    while (true)
+    {
+        if (s.mode == MODE_DONE)
+        {
+            status = TINFL_STATUS_DONE;
+            break;
+        }
+        if (s.mode == MODE_FAILED)
+        {
+            status = TINFL_STATUS_FAILED;
+            break;
+        }
+
+        if (s.mode == MODE_HEADER)
+        {
+            s.checkpoint();
+            uint32_t header;
+            if (!s.bits(3, header))
+            {
+                status = shortInput();
+                break;
+            }
+            s.last = header & 1;
+            header >>= 1;
+            if (header == 0)
+            {
+                // Stored blocks start on a byte boundary
+                s.take(s.bitCount & 7);
+                s.mode = MODE_STORED_LENGTH;
+            }
+            else if (header == 1)
+            {
+                buildFixed(s);
+                s.mode = MODE_CODES;
+            }
+            else if (header == 2)
+            {
+                Step step = readDynamic(s);
+                if (step == STEP_SHORT)
+                {
+                    status = shortInput();
+                    break;
+                }
+                s.mode = step == STEP_OK ? MODE_CODES : MODE_FAILED;
+            }
+            else
+            {
+                s.mode = MODE_FAILED;
+            }
+            continue;
+        }
+
+        if (s.mode == MODE_STORED_LENGTH)
+        {
+            s.checkpoint();
+            uint32_t length, complement;
+            if (!s.bits(16, length) || !s.bits(16, complement))
+            {
+                status = shortInput();
+                break;
+            }
+            if (length != (~complement & 0xffff))
+            {
+                s.mode = MODE_FAILED;
+                continue;
+            }
+            s.pendingLength = length;
+            s.mode = MODE_STORED;
+            continue;
+        }
+
+        if (s.mode == MODE_STORED)
+        {
+            if (s.pendingLength == 0)
+            {
+                s.mode = s.last ? MODE_DONE : MODE_HEADER;
+                continue;
+            }
+            if (room == 0)
+            {
+                status = TINFL_STATUS_HAS_MORE_OUTPUT;
+                break;
+            }
+            uint8_t b;
+            if (!s.nextByte(b))
+            {
+                s.checkpoint();
+                status = shortInput();
+                break;
+            }
+            put(b);
+            s.pendingLength--;
+            continue;
+        }
+
+        // MODE_CODES
+        if (s.pendingLength > 0)
+        {
+            if (!wrapping && s.pendingDistance > pos)
+            {
+                s.mode = MODE_FAILED;
+                continue;
+            }
+            while (s.pendingLength > 0 && room > 0)
+            {
+                put(pOut_buf_start[(pos - s.pendingDistance) & mask]);
+                s.pendingLength--;
+            }
+            if (s.pendingLength > 0)
+            {
+                status = TINFL_STATUS_HAS_MORE_OUTPUT;
+                break;
+            }
+        }
+        if (room == 0)
+        {
+            status = TINFL_STATUS_HAS_MORE_OUTPUT;
+            break;
+        }
+        s.checkpoint();
+        int literal;
+        Step step = readSymbol(s, literal);
+        if (step == STEP_SHORT)
+        {
+            status = shortInput();
+            break;
+        }
+        if (step == STEP_BAD)
+        {
+            s.mode = MODE_FAILED;
+        }
+        else if (literal < 256)
+        {
+            put(literal);
+        }
+        else if (literal == 256)
+        {
+            s.mode = s.last ? MODE_DONE : MODE_HEADER;
+        }
+    }
+
+    // Bytes carried over count as consumed in the call that supplied them
+    *pIn_buf_size = s.inPos;
+    *pOut_buf_size = produced;
+    return status;
+}
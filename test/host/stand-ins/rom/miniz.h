@@ -0,0 +1,54 @@
+#ifndef HOST_ROM_MINIZ_H
+#define HOST_ROM_MINIZ_H
+
+// The tinfl part of the ROM miniz. Same statuses, flags, wrapping-window
+// semantics and decompressor size as the ROM copy; the decoder behind it is
+// the host's own.
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef unsigned char mz_uint8;
+typedef uint32_t mz_uint32;
+
+enum
+{
+    TINFL_FLAG_PARSE_ZLIB_HEADER = 1,
+    TINFL_FLAG_HAS_MORE_INPUT = 2,
+    TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF = 4,
+    TINFL_FLAG_COMPUTE_ADLER32 = 8
+};
+
+typedef enum
+{
+    TINFL_STATUS_FAILED_CANNOT_MAKE_PROGRESS = -4,
+    TINFL_STATUS_BAD_PARAM = -3,
+    TINFL_STATUS_ADLER32_MISMATCH = -2,
+    TINFL_STATUS_FAILED = -1,
+    TINFL_STATUS_DONE = 0,
+    TINFL_STATUS_NEEDS_MORE_INPUT = 1,
+    TINFL_STATUS_HAS_MORE_OUTPUT = 2
+} tinfl_status;
+
+struct tinfl_decompressor_tag
+{
+    mz_uint32 m_state;
+    // Pads the struct to the ROM decompressor's size; holds the host decoder
+    alignas(8) mz_uint8 m_host[10872];
+};
+typedef struct tinfl_decompressor_tag tinfl_decompressor;
+
+#define tinfl_init(r)       \
+    do                      \
+    {                       \
+        (r)->m_state = 0;   \
+    } while (0)
+
+// Without TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF the output buffer is a
+// power-of-two window from pOut_buf_start, and pOut_buf_next + *pOut_buf_size
+// must not pass its end.
+tinfl_status tinfl_decompress(tinfl_decompressor *r, const mz_uint8 *pIn_buf_next, size_t *pIn_buf_size,
+                              mz_uint8 *pOut_buf_start, mz_uint8 *pOut_buf_next, size_t *pOut_buf_size,
+                              const mz_uint32 decomp_flags);
+
+#endif
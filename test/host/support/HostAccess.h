@@ -0,0 +1,65 @@
+#ifndef HOST_ACCESS_H
+#define HOST_ACCESS_H
+
+// Reaches into OTAUpdate's private transfer paths, which OTAUpdate.h opens to
+// this struct when built with OTA_HOST_TEST.
+
+#include <OTAUpdate.h>
+
+struct OTAHostAccess
+{
+    // The paths the public entry points end up in
+    static bool updateFromStream(OTAUpdate &ota, Stream &source, size_t length, int partitionType = U_FLASH,
+                                 OTAEncoding encoding = OTA_ENCODING_IDENTITY)
+    {
+        return ota.performUpdateFromFile(source, length, partitionType, encoding);
+    }
+    static bool updateFromFile(OTAUpdate &ota, File &file, size_t length, int partitionType = U_FLASH)
+    {
+        return ota.performUpdateFromFile(file, length, partitionType);
+    }
+    static bool performUpdate(OTAUpdate &ota, const String &url, int partitionType = U_FLASH,
+                              OTAEncoding encoding = OTA_ENCODING_IDENTITY)
+    {
+        return ota.performUpdate(url.c_str(), partitionType, encoding);
+    }
+    static bool performDeltaUpdate(OTAUpdate &ota, const String &url)
+    {
+        return ota.performDeltaUpdate(url);
+    }
+    static bool performBundleUpdate(OTAUpdate &ota, const String &url)
+    {
+        return ota.performBundleUpdate(url);
+    }
+    static bool performSpiffsSync(OTAUpdate &ota, const String &mapUrl, const String &imageUrl)
+    {
+        return ota.performSpiffsSync(mapUrl, imageUrl);
+    }
+
+    // A check the way begin() and loop() run it, scheduling the next one
+    static void runCheck(OTAUpdate &ota)
+    {
+        ota.runCheck();
+    }
+    static bool lastCheckFailed(const OTAUpdate &ota)
+    {
+        return ota.lastCheckFailed;
+    }
+    static uint8_t checkFailures(const OTAUpdate &ota)
+    {
+        return ota.checkFailures;
+    }
+    static unsigned long retryAfterMs(const OTAUpdate &ota)
+    {
+        return ota.retryAfterMs;
+    }
+
+    // What the manifest would have said about the next image
+    static void expectImage(OTAUpdate &ota, const String &sha256, const String &signature = "")
+    {
+        ota.expectedDigest = sha256;
+        ota.expectedSignature = signature;
+    }
+};
+
+#endif
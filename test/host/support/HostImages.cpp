@@ -0,0 +1,324 @@
+#include "HostImages.h"
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+#include <stdio.h>
+#include <string.h>
+#include <zlib.h>
+#include <memory>
+#include <random>
+#include <stdexcept>
+
+namespace
+{
+    void putLE32(std::string &out, uint32_t value)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            out += (char)((value >> (8 * i)) & 0xff);
+        }
+    }
+
+    std::string bioText(BIO *bio)
+    {
+        char *data;
+        long length = BIO_get_mem_data(bio, &data);
+        std::string text(data, length);
+        BIO_free(bio);
+        return text;
+    }
+
+    images::KeyPair describe(EVP_PKEY *pkey)
+    {
+        if (!pkey)
+        {
+            throw std::runtime_error("key generation failed");
+        }
+        images::KeyPair key;
+        BIO *bio = BIO_new(BIO_s_mem());
+        PEM_write_bio_PrivateKey(bio, pkey, nullptr, nullptr, 0, nullptr, nullptr);
+        key.privatePem = bioText(bio);
+        bio = BIO_new(BIO_s_mem());
+        PEM_write_bio_PUBKEY(bio, pkey);
+        key.publicPem = bioText(bio);
+        unsigned char *der = nullptr;
+        int length = i2d_PUBKEY(pkey, &der);
+        key.publicDer.assign((const char *)der, length);
+        OPENSSL_free(der);
+        EVP_PKEY_free(pkey);
+        return key;
+    }
+
+    EVP_PKEY *privateKey(const images::KeyPair &key)
+    {
+        BIO *bio = BIO_new_mem_buf(key.privatePem.data(), key.privatePem.size());
+        EVP_PKEY *pkey = PEM_read_bio_PrivateKey(bio, nullptr, nullptr, nullptr);
+        BIO_free(bio);
+        return pkey;
+    }
+
+    // Runs of the target that equal the source at the same offset are copied,
+    // runs that differ in a few bytes are added, the rest is inserted
+    const size_t DELTA_BLOCK = 256;
+}
+
+namespace images
+{
+    std::string app(size_t size, uint32_t seed)
+    {
+        static const char *words[] = {"esp32", "partition", "update", "sector", "flash", "stream",
+                                      "manifest", "digest", "window", "chunk", "\x00\x00\x00\x00",
+                                      "\xff\xff", "ota", "bundle"};
+        std::mt19937 random(seed);
+        std::string image;
+        image.reserve(size);
+        image += (char)0xE9;
+        while (image.size() < size)
+        {
+            uint32_t pick = random();
+            if (pick % 5 == 0)
+            {
+                // Some noise so the image doesn't compress unrealistically well
+                image += (char)(pick >> 8);
+                image += (char)(pick >> 16);
+                continue;
+            }
+            const char *word = words[(pick >> 4) % (sizeof(words) / sizeof(words[0]))];
+            size_t length = word[0] ? strlen(word) : 4;
+            image.append(word, length);
+        }
+        image.resize(size);
+        return image;
+    }
+
+    std::string random(size_t size, uint32_t seed)
+    {
+        std::mt19937 random(seed);
+        std::string data(size, '\0');
+        for (size_t i = 0; i < size; i++)
+        {
+            data[i] = (char)random();
+        }
+        return data;
+    }
+
+    std::string littlefs(size_t size, uint32_t seed)
+    {
+        std::string image = app(size, seed);
+        // Superblock: revision count, tag, then the magic
+        memset(&image[0], 0, 8);
+        memcpy(&image[8], "littlefs", 8);
+        return image;
+    }
+
+    std::string spiffs(size_t size, uint32_t seed)
+    {
+        std::string image = app(size, seed);
+        // SPIFFS has no superblock; keep clear of the other backends' signatures
+        image[0] = 0x01;
+        memset(&image[8], 0, 8);
+        if (size >= 512)
+        {
+            image[510] = 0;
+            image[511] = 0;
+        }
+        return image;
+    }
+
+    std::string fat(size_t size, uint32_t seed)
+    {
+        std::string image = app(size, seed);
+        memset(&image[0], 0, 512);
+        memcpy(&image[0], "\xeb\x3c\x90MSDOS5.0", 11);
+        image[11] = 0x00; // 4096 bytes per sector
+        image[12] = 0x10;
+        image[510] = 0x55;
+        image[511] = (char)0xaa;
+        return image;
+    }
+
+    std::string gzip(const std::string &data, int windowBits, int level)
+    {
+        z_stream stream;
+        memset(&stream, 0, sizeof(stream));
+        // zlib refuses 8 for deflate; 9 is the smallest window it writes
+        if (deflateInit2(&stream, level, Z_DEFLATED, windowBits + 16, 9, Z_DEFAULT_STRATEGY) != Z_OK)
+        {
+            throw std::runtime_error("deflateInit2 failed");
+        }
+        std::string out(deflateBound(&stream, data.size()) + 64, '\0');
+        stream.next_in = (Bytef *)data.data();
+        stream.avail_in = data.size();
+        stream.next_out = (Bytef *)&out[0];
+        stream.avail_out = out.size();
+        int result = deflate(&stream, Z_FINISH);
+        out.resize(stream.total_out);
+        deflateEnd(&stream);
+        if (result != Z_STREAM_END)
+        {
+            throw std::runtime_error("deflate failed");
+        }
+        return out;
+    }
+
+    std::string sha256(const std::string &data)
+    {
+        unsigned char digest[32];
+        unsigned int length = sizeof(digest);
+        EVP_Digest(data.data(), data.size(), digest, &length, EVP_sha256(), nullptr);
+        return std::string((const char *)digest, sizeof(digest));
+    }
+
+    std::string sha256Hex(const std::string &data)
+    {
+        return hex(sha256(data));
+    }
+
+    std::string md5Hex(const std::string &data)
+    {
+        unsigned char digest[16];
+        unsigned int length = sizeof(digest);
+        EVP_Digest(data.data(), data.size(), digest, &length, EVP_md5(), nullptr);
+        return hex(std::string((const char *)digest, sizeof(digest)));
+    }
+
+    std::string hex(const std::string &bytes)
+    {
+        std::string text;
+        char pair[3];
+        for (unsigned char c : bytes)
+        {
+            snprintf(pair, sizeof(pair), "%02x", c);
+            text += pair;
+        }
+        return text;
+    }
+
+    std::string delta(const std::string &source, const std::string &target)
+    {
+        std::string patch = "OTAD";
+        patch += '\x01';
+        patch.append(3, '\0');
+        putLE32(patch, target.size());
+        putLE32(patch, source.size());
+        std::string md5 = md5Hex(source);
+        for (size_t i = 0; i < 16; i++)
+        {
+            patch += (char)strtoul(md5.substr(i * 2, 2).c_str(), nullptr, 16);
+        }
+
+        for (size_t offset = 0; offset < target.size();)
+        {
+            size_t length = std::min(DELTA_BLOCK, target.size() - offset);
+            bool overlaps = offset + length <= source.size();
+            if (overlaps && source.compare(offset, length, target, offset, length) == 0)
+            {
+                // Extend the copy over every following identical block
+                size_t end = offset + length;
+                while (end < target.size() && end < source.size() && source[end] == target[end])
+                {
+                    end++;
+                }
+                patch += '\x01';
+                putLE32(patch, offset);
+                putLE32(patch, end - offset);
+                offset = end;
+                continue;
+            }
+            if (overlaps)
+            {
+                patch += '\x03';
+                putLE32(patch, offset);
+                putLE32(patch, length);
+                for (size_t i = 0; i < length; i++)
+                {
+                    patch += (char)(target[offset + i] - source[offset + i]);
+                }
+            }
+            else
+            {
+                patch += '\x02';
+                putLE32(patch, length);
+                patch.append(target, offset, length);
+            }
+            offset += length;
+        }
+        patch += '\0';
+        return patch;
+    }
+
+    Section section(uint8_t type, const std::string &data, bool gzip, bool digest, int windowBits)
+    {
+        return Section{type, gzip, data, digest, windowBits};
+    }
+
+    std::string bundle(const std::vector<Section> &sections)
+    {
+        std::string entries;
+        std::string payload;
+        for (const Section &section : sections)
+        {
+            std::string stored = section.gzip ? gzip(section.data, section.windowBits) : section.data;
+            entries += (char)section.type;
+            entries += (char)(section.gzip ? 1 : 0);
+            entries.append(2, '\0');
+            putLE32(entries, stored.size());
+            entries += section.digest ? sha256(section.data) : std::string(32, '\0');
+            payload += stored;
+        }
+        std::string out = "OTAB";
+        out += '\x01';
+        out += (char)sections.size();
+        out.append(2, '\0');
+        return out + entries + payload;
+    }
+
+    KeyPair ecKey(const char *curve)
+    {
+        return describe(EVP_PKEY_Q_keygen(nullptr, nullptr, "EC", curve));
+    }
+
+    KeyPair rsaKey(int bits)
+    {
+        return describe(EVP_PKEY_Q_keygen(nullptr, nullptr, "RSA", (size_t)bits));
+    }
+
+    std::string sign(const KeyPair &key, const std::string &data)
+    {
+        EVP_PKEY *pkey = privateKey(key);
+        EVP_MD_CTX *context = EVP_MD_CTX_new();
+        size_t length = 0;
+        std::string signature;
+        if (pkey && EVP_DigestSignInit(context, nullptr, EVP_sha256(), nullptr, pkey) == 1 &&
+            EVP_DigestSign(context, nullptr, &length, (const unsigned char *)data.data(), data.size()) == 1)
+        {
+            signature.resize(length);
+            EVP_DigestSign(context, (unsigned char *)&signature[0], &length, (const unsigned char *)data.data(),
+                           data.size());
+            signature.resize(length);
+        }
+        EVP_MD_CTX_free(context);
+        EVP_PKEY_free(pkey);
+        return hex(signature);
+    }
+
+    std::string certificate(const KeyPair &key, const char *commonName)
+    {
+        EVP_PKEY *pkey = privateKey(key);
+        X509 *cert = X509_new();
+        X509_set_version(cert, 2);
+        ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+        X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+        X509_gmtime_adj(X509_getm_notAfter(cert), 365L * 24 * 3600);
+        X509_set_pubkey(cert, pkey);
+        X509_NAME *name = X509_get_subject_name(cert);
+        X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char *)commonName, -1, -1, 0);
+        X509_set_issuer_name(cert, name);
+        X509_sign(cert, pkey, EVP_sha256());
+        BIO *bio = BIO_new(BIO_s_mem());
+        PEM_write_bio_X509(bio, cert);
+        X509_free(cert);
+        EVP_PKEY_free(pkey);
+        return bioText(bio);
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef HOST_IMAGES_H
+#define HOST_IMAGES_H
+
+// Builders for what the server side publishes: app and data images, gzip at
+// a given window size, OTAD patches, OTAB bundles, digests, keys and
+// signatures. They mirror the tools/ scripts so tests need no Python.
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace images
+{
+    // An app image: the 0xE9 magic, then deterministic, moderately compressible bytes
+    std::string app(size_t size, uint32_t seed = 1);
+    // Incompressible bytes
+    std::string random(size_t size, uint32_t seed = 1);
+    // Data images whose first block each backend would recognise
+    std::string littlefs(size_t size, uint32_t seed = 1);
+    std::string spiffs(size_t size, uint32_t seed = 1);
+    std::string fat(size_t size, uint32_t seed = 1);
+
+    // gzip with a 2^windowBits window, as tools/otacompress.py does
+    std::string gzip(const std::string &data, int windowBits = 15, int level = 9);
+
+    std::string sha256(const std::string &data); // raw 32 bytes
+    std::string sha256Hex(const std::string &data);
+    std::string md5Hex(const std::string &data);
+    std::string hex(const std::string &bytes);
+
+    // An OTAD patch rebuilding target from source (tools/otadelta.py's format)
+    std::string delta(const std::string &source, const std::string &target);
+
+    struct Section
+    {
+        uint8_t type;     // OTABundleReader::SECTION_APP or SECTION_SPIFFS
+        bool gzip;
+        std::string data; // decoded image
+        bool digest;      // store its SHA-256
+        int windowBits;
+    };
+    Section section(uint8_t type, const std::string &data, bool gzip = false, bool digest = true, int windowBits = 15);
+    std::string bundle(const std::vector<Section> &sections);
+
+    struct KeyPair
+    {
+        std::string privatePem;
+        std::string publicPem;
+        std::string publicDer; // SubjectPublicKeyInfo
+    };
+    // curve is an OpenSSL group name: "prime256v1", "secp384r1", "secp256k1"
+    KeyPair ecKey(const char *curve = "prime256v1");
+    KeyPair rsaKey(int bits = 2048);
+    // DER signature over SHA-256(data), hex encoded like tools/otasign.py
+    std::string sign(const KeyPair &key, const std::string &data);
+    // A self-signed certificate for key, PEM
+    std::string certificate(const KeyPair &key, const char *commonName = "127.0.0.1");
+}
+
+#endif
@@ -0,0 +1,443 @@
+#include "HostServer.h"
+#include <HostControl.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+    const size_t PIECE_SIZE = 1460;
+
+    std::string lower(std::string s)
+    {
+        std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c)
+                       { return (char)tolower(c); });
+        return s;
+    }
+
+    std::string trim(const std::string &s)
+    {
+        size_t start = s.find_first_not_of(" \t\r\n");
+        size_t end = s.find_last_not_of(" \t\r\n");
+        return start == std::string::npos ? std::string() : s.substr(start, end - start + 1);
+    }
+
+    // FNV-1a of the content, so a changed file gets a new ETag
+    std::string contentEtag(const std::string &content)
+    {
+        uint64_t hash = 1469598103934665603ULL;
+        for (unsigned char c : content)
+        {
+            hash = (hash ^ c) * 1099511628211ULL;
+        }
+        char text[24];
+        snprintf(text, sizeof(text), "\"%016llx\"", (unsigned long long)hash);
+        return text;
+    }
+
+    const char *reason(int status)
+    {
+        switch (status)
+        {
+        case 200:
+            return "OK";
+        case 206:
+            return "Partial Content";
+        case 304:
+            return "Not Modified";
+        case 404:
+            return "Not Found";
+        case 416:
+            return "Range Not Satisfiable";
+        case 429:
+            return "Too Many Requests";
+        case 503:
+            return "Service Unavailable";
+        default:
+            return "Status";
+        }
+    }
+
+    bool sendAll(int fd, const char *data, size_t len)
+    {
+        while (len > 0)
+        {
+            ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+            if (n <= 0)
+            {
+                return false;
+            }
+            data += n;
+            len -= n;
+        }
+        return true;
+    }
+}
+
+std::string HostServer::Request::header(const std::string &name) const
+{
+    auto found = headers.find(lower(name));
+    return found == headers.end() ? std::string() : found->second;
+}
+
+HostServer::HostServer() : listenFd(-1), listenPort(0), stopping(false), rate(0), acceptCount(0), requestCount(0)
+{
+    listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    int on = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0;
+    socklen_t length = sizeof(address);
+    if (bind(listenFd, (sockaddr *)&address, sizeof(address)) != 0 || listen(listenFd, 16) != 0 ||
+        getsockname(listenFd, (sockaddr *)&address, &length) != 0)
+    {
+        perror("HostServer");
+        abort();
+    }
+    listenPort = ntohs(address.sin_port);
+    acceptor = std::thread([this]()
+                           { acceptLoop(); });
+}
+
+HostServer::~HostServer()
+{
+    stopping = true;
+    acceptor.join();
+    close(listenFd);
+    std::vector<std::thread> running;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        for (int fd : connections)
+        {
+            shutdown(fd, SHUT_RDWR);
+        }
+        running.swap(workers);
+    }
+    for (std::thread &worker : running)
+    {
+        worker.join();
+    }
+}
+
+std::string HostServer::url(const std::string &path) const
+{
+    return "http://127.0.0.1:" + std::to_string(listenPort) + path;
+}
+
+void HostServer::setFile(const std::string &path, const std::string &content)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    Entry &entry = files[path];
+    entry.content = content;
+    entry.status = 200;
+    if (!entry.ownEtag)
+    {
+        entry.etag = contentEtag(content);
+    }
+}
+
+void HostServer::setEtag(const std::string &path, const std::string &etag)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    files[path].etag = etag;
+    files[path].ownEtag = true;
+}
+
+void HostServer::setHeader(const std::string &path, const std::string &name, const std::string &value)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    auto &headers = files[path].headers;
+    for (auto &header : headers)
+    {
+        if (lower(header.first) == lower(name))
+        {
+            header.second = value;
+            return;
+        }
+    }
+    headers.push_back(std::make_pair(name, value));
+}
+
+void HostServer::setStatus(const std::string &path, int status)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    files[path].status = status;
+}
+
+void HostServer::remove(const std::string &path)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    files.erase(path);
+}
+
+void HostServer::onRequest(std::function<void(const Request &)> callback)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    hook = callback;
+}
+
+void HostServer::dropAt(const std::string &path, size_t offset)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    auto &faults = files[path].faults;
+    faults.push_back(Fault{offset, 0});
+    std::sort(faults.begin(), faults.end(), [](const Fault &a, const Fault &b)
+              { return a.offset < b.offset; });
+}
+
+void HostServer::stallAt(const std::string &path, size_t offset, uint32_t ms)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    auto &faults = files[path].faults;
+    faults.push_back(Fault{offset, ms});
+    std::sort(faults.begin(), faults.end(), [](const Fault &a, const Fault &b)
+              { return a.offset < b.offset; });
+}
+
+void HostServer::setRate(uint32_t bytesPerSecond)
+{
+    rate = bytesPerSecond;
+}
+
+std::vector<HostServer::Request> HostServer::log() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return requestLog;
+}
+
+void HostServer::clearLog()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    requestLog.clear();
+}
+
+void HostServer::acceptLoop()
+{
+    host::ignoreHeap();
+    while (!stopping)
+    {
+        pollfd waiting = {listenFd, POLLIN, 0};
+        if (poll(&waiting, 1, 20) <= 0)
+        {
+            continue;
+        }
+        int fd = accept(listenFd, nullptr, nullptr);
+        if (fd < 0)
+        {
+            continue;
+        }
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        acceptCount++;
+        std::lock_guard<std::mutex> guard(lock);
+        connections.push_back(fd);
+        workers.push_back(std::thread([this, fd]()
+                                      { serve(fd); }));
+    }
+}
+
+void HostServer::serve(int fd)
+{
+    host::ignoreHeap();
+    std::string pending;
+    char buffer[2048];
+    bool open = true;
+    while (open && !stopping)
+    {
+        size_t end = pending.find("\r\n\r\n");
+        if (end == std::string::npos)
+        {
+            ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+            if (n <= 0)
+            {
+                break;
+            }
+            pending.append(buffer, n);
+            continue;
+        }
+
+        Request request;
+        std::string head = pending.substr(0, end);
+        pending.erase(0, end + 4);
+        size_t lineEnd = head.find("\r\n");
+        std::string line = head.substr(0, lineEnd);
+        size_t space = line.find(' ');
+        request.method = line.substr(0, space);
+        request.target = line.substr(space + 1, line.find(' ', space + 1) - space - 1);
+        request.path = request.target.substr(0, request.target.find('?'));
+        while (lineEnd != std::string::npos)
+        {
+            size_t next = head.find("\r\n", lineEnd + 2);
+            std::string field = head.substr(lineEnd + 2, next == std::string::npos ? std::string::npos : next - lineEnd - 2);
+            size_t colon = field.find(':');
+            if (colon != std::string::npos)
+            {
+                request.headers[lower(trim(field.substr(0, colon)))] = trim(field.substr(colon + 1));
+            }
+            lineEnd = next;
+        }
+        // Request bodies are read and ignored
+        size_t bodyLength = strtoul(request.header("Content-Length").c_str(), nullptr, 10);
+        while (pending.size() < bodyLength)
+        {
+            ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+            if (n <= 0)
+            {
+                bodyLength = 0;
+                open = false;
+                break;
+            }
+            pending.append(buffer, n);
+        }
+        pending.erase(0, bodyLength);
+
+        requestCount++;
+        std::function<void(const Request &)> callback;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            requestLog.push_back(request);
+            callback = hook;
+        }
+        if (callback)
+        {
+            callback(request);
+        }
+        open = open && answer(fd, request) && lower(request.header("Connection")) != "close";
+    }
+    std::lock_guard<std::mutex> guard(lock);
+    connections.erase(std::find(connections.begin(), connections.end(), fd));
+    close(fd);
+}
+
+bool HostServer::answer(int fd, const Request &request)
+{
+    Entry entry;
+    bool found;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        auto it = files.find(request.path);
+        found = it != files.end();
+        if (found)
+        {
+            entry = it->second;
+        }
+    }
+
+    int status = found ? entry.status : 404;
+    size_t start = 0;
+    size_t end = entry.content.size();
+    std::string headers;
+    if (status == 200 && !entry.etag.empty())
+    {
+        headers += "ETag: " + entry.etag + "\r\n";
+        if (request.header("If-None-Match") == entry.etag)
+        {
+            status = 304;
+        }
+    }
+    std::string range = request.header("Range");
+    std::string ifRange = request.header("If-Range");
+    if (status == 200 && range.compare(0, 6, "bytes=") == 0 && (ifRange.empty() || ifRange == entry.etag))
+    {
+        size_t dash = range.find('-');
+        start = strtoul(range.substr(6, dash - 6).c_str(), nullptr, 10);
+        if (dash + 1 < range.size())
+        {
+            end = std::min(end, (size_t)strtoul(range.substr(dash + 1).c_str(), nullptr, 10) + 1);
+        }
+        if (start >= end)
+        {
+            status = 416;
+            headers += "Content-Range: bytes */" + std::to_string(entry.content.size()) + "\r\n";
+        }
+        else
+        {
+            status = 206;
+            headers += "Content-Range: bytes " + std::to_string(start) + "-" + std::to_string(end - 1) + "/" +
+                       std::to_string(entry.content.size()) + "\r\n";
+        }
+    }
+    for (const auto &header : entry.headers)
+    {
+        headers += header.first + ": " + header.second + "\r\n";
+    }
+    bool withBody = (status == 200 || status == 206) && request.method != "HEAD";
+    size_t length = withBody ? end - start : 0;
+    std::string head = "HTTP/1.1 " + std::to_string(status) + " " + reason(status) + "\r\n" +
+                       "Content-Length: " + std::to_string(length) + "\r\n" + headers + "Connection: keep-alive\r\n\r\n";
+    if (!sendAll(fd, head.data(), head.size()))
+    {
+        return false;
+    }
+    return !withBody || sendBody(fd, request.path, entry.content.substr(0, end), start);
+}
+
+// Writes body[start..] in TCP-sized pieces, applying the faults set for path
+bool HostServer::sendBody(int fd, const std::string &path, const std::string &body, size_t start)
+{
+    size_t offset = start;
+    while (offset < body.size())
+    {
+        Fault fault = {body.size(), 0};
+        bool faulty = false;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            auto &faults = files[path].faults;
+            // Faults behind the start of this response have been passed by
+            while (!faults.empty() && faults.front().offset < start)
+            {
+                faults.erase(faults.begin());
+            }
+            if (!faults.empty() && faults.front().offset < body.size())
+            {
+                fault = faults.front();
+                faulty = true;
+            }
+        }
+        if (faulty && offset == fault.offset)
+        {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                auto &faults = files[path].faults;
+                faults.erase(faults.begin());
+            }
+            if (fault.stallMs == 0)
+            {
+                shutdown(fd, SHUT_RDWR);
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(fault.stallMs));
+            continue;
+        }
+        uint32_t bytesPerSecond = rate;
+        size_t piece = body.size() - offset;
+        if (bytesPerSecond > 0)
+        {
+            piece = std::min(piece, PIECE_SIZE);
+        }
+        if (faulty)
+        {
+            piece = std::min(piece, fault.offset - offset);
+        }
+        if (!sendAll(fd, body.data() + offset, piece))
+        {
+            return false;
+        }
+        offset += piece;
+        if (bytesPerSecond > 0)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds((uint64_t)piece * 1000000 / bytesPerSecond));
+        }
+    }
+    return true;
+}
@@ -0,0 +1,106 @@
+#ifndef HOST_SERVER_H
+#define HOST_SERVER_H
+
+// An HTTP/1.1 server on 127.0.0.1 for the library's requests: keep-alive,
+// ETag, If-None-Match, Range and If-Range, plus faults to inject (dropped
+// connections, stalls, slow links) and counters of what it was asked.
+// HTTPS URLs work too; the TLS stand-in passes plain HTTP through.
+
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class HostServer
+{
+public:
+    struct Request
+    {
+        std::string method;
+        std::string path; // without the query
+        std::string target;
+        std::map<std::string, std::string> headers; // names in lower case
+
+        std::string header(const std::string &name) const;
+    };
+
+    struct Response
+    {
+        int status = 200;
+        std::string body;
+        std::vector<std::pair<std::string, std::string> > headers;
+    };
+
+    HostServer();
+    ~HostServer();
+
+    uint16_t port() const { return listenPort; }
+    // http://127.0.0.1:port plus path
+    std::string url(const std::string &path = "") const;
+
+    // Served with a strong ETag derived from the content unless one is set; an empty etag sends none
+    void setFile(const std::string &path, const std::string &content);
+    void setEtag(const std::string &path, const std::string &etag);
+    void setHeader(const std::string &path, const std::string &name, const std::string &value);
+    // Answers path with this status and an empty body, e.g. 503 with a Retry-After header
+    void setStatus(const std::string &path, int status);
+    void remove(const std::string &path);
+    // Called for every request before it is answered; may change what is served
+    void onRequest(std::function<void(const Request &)> hook);
+
+    // Faults. The connection is closed once the body of a response for path
+    // reaches image offset `offset` (Range responses count from their start);
+    // each drop fires once, in order of offset.
+    void dropAt(const std::string &path, size_t offset);
+    // The body pauses for ms at offset, once
+    void stallAt(const std::string &path, size_t offset, uint32_t ms);
+    // Bodies are written at this rate, 0 for as fast as possible
+    void setRate(uint32_t bytesPerSecond);
+
+    uint32_t accepts() const { return acceptCount; }
+    uint32_t requests() const { return requestCount; }
+    std::vector<Request> log() const;
+    void clearLog();
+
+private:
+    struct Fault
+    {
+        size_t offset;
+        uint32_t stallMs; // 0 drops the connection
+    };
+
+    struct Entry
+    {
+        std::string content;
+        std::string etag;
+        bool ownEtag = false;
+        int status = 200;
+        std::vector<std::pair<std::string, std::string> > headers;
+        std::vector<Fault> faults;
+    };
+
+    void acceptLoop();
+    void serve(int fd);
+    bool answer(int fd, const Request &request);
+    bool sendBody(int fd, const std::string &path, const std::string &body, size_t start);
+
+    int listenFd;
+    uint16_t listenPort;
+    std::atomic<bool> stopping;
+    std::thread acceptor;
+    mutable std::mutex lock;
+    std::vector<std::thread> workers;
+    std::vector<int> connections;
+    std::map<std::string, Entry> files;
+    std::vector<Request> requestLog;
+    std::function<void(const Request &)> hook;
+    std::atomic<uint32_t> rate;
+    std::atomic<uint32_t> acceptCount;
+    std::atomic<uint32_t> requestCount;
+};
+
+#endif
@@ -0,0 +1,169 @@
+#include "HostStream.h"
+#include <HostControl.h>
+
+namespace
+{
+    const size_t NEVER = (size_t)-1;
+}
+
+HostStream::HostStream(const std::string &data)
+    : data(data), pos(0), arrived(0), clock(micros()), rate(0), rateOffset(NEVER), laterRate(0), segment(1), window(0),
+      readCost(0), stallOffset(NEVER), stallMs(0), stalling(false), stallUntil(0), limit(data.size()), polls(0), reads(0),
+      largest(0), overlapped(0)
+{
+}
+
+void HostStream::setRate(uint32_t bytesPerSecond)
+{
+    rate = bytesPerSecond;
+}
+
+void HostStream::setRateFrom(size_t offset, uint32_t bytesPerSecond)
+{
+    rateOffset = offset;
+    laterRate = bytesPerSecond;
+}
+
+void HostStream::setSegment(size_t bytes)
+{
+    segment = max(bytes, (size_t)1);
+}
+
+void HostStream::setWindow(size_t bytes)
+{
+    window = bytes;
+}
+
+void HostStream::setReadCost(uint32_t microsPerKB)
+{
+    readCost = microsPerKB;
+}
+
+void HostStream::stallAt(size_t offset, uint32_t ms)
+{
+    stallOffset = offset;
+    stallMs = ms;
+}
+
+void HostStream::endAt(size_t offset)
+{
+    limit = min(offset, data.size());
+}
+
+// Works out how many bytes have arrived by now, one stretch of constant rate at a time
+void HostStream::advance()
+{
+    uint64_t now = micros();
+    while (true)
+    {
+        if (stalling)
+        {
+            if (now < stallUntil)
+            {
+                clock = now;
+                return;
+            }
+            clock = stallUntil;
+            stalling = false;
+            stallOffset = NEVER;
+        }
+        if (arrived >= limit || (window && arrived >= pos + window))
+        {
+            clock = now;
+            return;
+        }
+        if (arrived >= stallOffset)
+        {
+            stalling = true;
+            stallUntil = clock + (uint64_t)stallMs * 1000;
+            continue;
+        }
+        size_t boundary = limit;
+        if (stallOffset > arrived)
+        {
+            boundary = min(boundary, stallOffset);
+        }
+        if (rateOffset > arrived)
+        {
+            boundary = min(boundary, rateOffset);
+        }
+        if (window)
+        {
+            boundary = min(boundary, pos + window);
+        }
+        uint32_t current = arrived >= rateOffset ? laterRate : rate;
+        if (current == 0)
+        {
+            arrived = boundary;
+            continue;
+        }
+        uint64_t needed = (uint64_t)(boundary - arrived) * 1000000 / current;
+        if (clock + needed <= now)
+        {
+            arrived = boundary;
+            clock += needed;
+            continue;
+        }
+        uint64_t bytes = (now - clock) * current / 1000000;
+        arrived += bytes;
+        clock += bytes * 1000000 / current;
+        return;
+    }
+}
+
+size_t HostStream::visible()
+{
+    advance();
+    // Whole segments only, except for the very end of what will arrive
+    size_t whole = arrived == limit ? arrived : arrived - arrived % segment;
+    return whole > pos ? whole - pos : 0;
+}
+
+int HostStream::available()
+{
+    polls++;
+    return visible();
+}
+
+int HostStream::read()
+{
+    uint8_t c;
+    return readBytes((char *)&c, 1) == 1 ? c : -1;
+}
+
+int HostStream::peek()
+{
+    return visible() > 0 ? (uint8_t)data[pos] : -1;
+}
+
+// Takes what has arrived and, like the core, waits up to the timeout for the rest
+size_t HostStream::readBytes(char *buffer, size_t length)
+{
+    reads++;
+    size_t done = 0;
+    unsigned long start = millis();
+    while (done < length)
+    {
+        size_t take = min(length - done, visible());
+        if (take > 0)
+        {
+            memcpy(buffer + done, data.data() + pos, take);
+            pos += take;
+            done += take;
+            bool flashing = host::flashBusy();
+            host::spend((uint64_t)take * readCost / 1024);
+            if (flashing || host::flashBusy())
+            {
+                overlapped += take;
+            }
+            continue;
+        }
+        if (millis() - start >= timeoutMs)
+        {
+            break;
+        }
+        delay(1);
+    }
+    largest = max(largest, done);
+    return done;
+}
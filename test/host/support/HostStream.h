@@ -0,0 +1,72 @@
+#ifndef HOST_STREAM_H
+#define HOST_STREAM_H
+
+// A response body as a socket would deliver it: bytes arrive at a set rate,
+// in whole segments, and can stop arriving for a while or for good. Arrival
+// follows millis(), so under the virtual clock the reader's own delay(1)
+// polls are what move the transfer along.
+
+#include <Arduino.h>
+#include <string>
+
+class HostStream : public Stream
+{
+public:
+    explicit HostStream(const std::string &data);
+
+    // Bytes per second, 0 for everything at once; from offset on, rateFrom applies
+    void setRate(uint32_t bytesPerSecond);
+    void setRateFrom(size_t offset, uint32_t bytesPerSecond);
+    // Data shows up in pieces of this many bytes (the last one may be short)
+    void setSegment(size_t bytes);
+    // At most this many bytes arrive ahead of the reader, like a TCP receive
+    // window: the sender waits while the window is full (0 for no limit)
+    void setWindow(size_t bytes);
+    // CPU time the reader spends per KB taken (TLS decryption, lwIP copies)
+    void setReadCost(uint32_t microsPerKB);
+    // Nothing arrives for ms once offset bytes are in
+    void stallAt(size_t offset, uint32_t ms);
+    // The connection stays open but nothing after offset ever arrives
+    void endAt(size_t offset);
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t readBytes(char *buffer, size_t length) override;
+    size_t write(uint8_t) override { return 0; }
+    using Print::write;
+    using Stream::readBytes;
+
+    size_t position() const { return pos; }
+    uint32_t availableCalls() const { return polls; }
+    uint32_t readCalls() const { return reads; }
+    size_t largestRead() const { return largest; }
+    // Bytes taken while a flash erase or program was under way on another thread
+    size_t overlappedBytes() const { return overlapped; }
+
+private:
+    size_t visible();
+    void advance();
+
+    std::string data;
+    size_t pos;
+    size_t arrived;
+    uint64_t clock; // micros() up to which arrival has been worked out
+    uint32_t rate;
+    size_t rateOffset;
+    uint32_t laterRate;
+    size_t segment;
+    size_t window;
+    uint32_t readCost;
+    size_t stallOffset;
+    uint32_t stallMs;
+    bool stalling;
+    uint64_t stallUntil;
+    size_t limit;
+    uint32_t polls;
+    uint32_t reads;
+    size_t largest;
+    size_t overlapped;
+};
+
+#endif
@@ -0,0 +1,82 @@
+#include "HostTest.h"
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+namespace
+{
+    struct Entry
+    {
+        const char *name;
+        HostTestFunction function;
+    };
+
+    std::vector<Entry> &registry()
+    {
+        static std::vector<Entry> tests;
+        return tests;
+    }
+
+    int failures = 0;
+}
+
+HostTestRegistrar::HostTestRegistrar(const char *name, HostTestFunction function)
+{
+    registry().push_back(Entry{name, function});
+}
+
+bool hostCheck(bool ok, const std::string &expression, const char *file, int line)
+{
+    if (!ok)
+    {
+        failures++;
+        fprintf(stderr, "  %s:%d: CHECK failed: %s\n", file, line, expression.c_str());
+    }
+    return ok;
+}
+
+int hostTestMain(int argc, char **argv)
+{
+    // A peer closing a socket must not kill the process
+    signal(SIGPIPE, SIG_IGN);
+    const char *filter = argc > 1 ? argv[1] : nullptr;
+    int failed = 0;
+    int run = 0;
+    for (const Entry &test : registry())
+    {
+        if (filter && !strstr(test.name, filter))
+        {
+            continue;
+        }
+        host::reset();
+        int before = failures;
+        printf("[ RUN  ] %s\n", test.name);
+        fflush(stdout);
+        try
+        {
+            test.function();
+        }
+        catch (const HostTestAbort &)
+        {
+        }
+        run++;
+        if (failures != before)
+        {
+            failed++;
+            printf("[ FAIL ] %s\n", test.name);
+            if (!getenv("HOST_VERBOSE"))
+            {
+                // The library's log explains most failures
+                fprintf(stderr, "---- serial output ----\n%s-----------------------\n", host::serialOutput().c_str());
+            }
+        }
+        else
+        {
+            printf("[  OK  ] %s\n", test.name);
+        }
+        fflush(stdout);
+    }
+    printf("%d of %d tests passed\n", run - failed, run);
+    return failed == 0 && run > 0 ? 0 : 1;
+}
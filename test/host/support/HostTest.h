@@ -0,0 +1,61 @@
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+// A small test runner: HOST_TEST(name) { ... } registers a test, CHECK and
+// CHECK_EQ record failures and carry on, REQUIRE stops the test. Each test
+// starts from host::reset(). Run a test binary with a substring to pick tests.
+
+#include <Arduino.h>
+#include <HostControl.h>
+#include <sstream>
+#include <string>
+
+struct HostTestAbort
+{
+};
+
+typedef void (*HostTestFunction)();
+
+struct HostTestRegistrar
+{
+    HostTestRegistrar(const char *name, HostTestFunction function);
+};
+
+bool hostCheck(bool ok, const std::string &expression, const char *file, int line);
+
+inline std::ostream &operator<<(std::ostream &out, const String &s)
+{
+    return out << '"' << s.c_str() << '"';
+}
+
+template <typename A, typename B>
+bool hostCheckEq(const A &a, const B &b, const char *textA, const char *textB, const char *file, int line)
+{
+    if (a == b)
+    {
+        return true;
+    }
+    std::ostringstream message;
+    message << textA << " == " << textB << " (" << a << " vs " << b << ")";
+    return hostCheck(false, message.str(), file, line);
+}
+
+#define HOST_TEST(name)                                                  \
+    static void name();                                                  \
+    static HostTestRegistrar name##_registrar(#name, name);              \
+    static void name()
+
+#define CHECK(condition) hostCheck((condition), #condition, __FILE__, __LINE__)
+#define CHECK_EQ(a, b) hostCheckEq((a), (b), #a, #b, __FILE__, __LINE__)
+#define REQUIRE(condition)                                               \
+    do                                                                   \
+    {                                                                    \
+        if (!CHECK(condition))                                           \
+        {                                                                \
+            throw HostTestAbort();                                       \
+        }                                                                \
+    } while (0)
+
+int hostTestMain(int argc, char **argv);
+
+#endif
@@ -0,0 +1,6 @@
+#include "HostTest.h"
+
+int main(int argc, char **argv)
+{
+    return hostTestMain(argc, argv);
+}
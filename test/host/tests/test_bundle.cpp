@@ -0,0 +1,110 @@
+#include <HostTest.h>
+#include <HostImages.h>
+#include <OTABundle.h>
+#include <vector>
+
+namespace
+{
+    // Collects the sections a bundle announces and the bytes of each
+    struct Unpacked
+    {
+        std::vector<OTABundleReader::Section> sections;
+        std::vector<std::string> data;
+        size_t ended = 0;
+        bool rejectEnd = false;
+
+        OTABundleReader reader()
+        {
+            return OTABundleReader([this](const OTABundleReader::Section &section)
+                                   {
+                                       sections.push_back(section);
+                                       data.push_back(std::string());
+                                       return true; },
+                                   [this](const uint8_t *bytes, size_t len)
+                                   {
+                                       data.back().append((const char *)bytes, len);
+                                       return true; },
+                                   [this](const OTABundleReader::Section &)
+                                   {
+                                       ended++;
+                                       return !rejectEnd; });
+        }
+    };
+
+    bool feed(OTABundleReader &reader, const std::string &bundle, size_t piece)
+    {
+        for (size_t offset = 0; offset < bundle.size(); offset += piece)
+        {
+            if (!reader.write((const uint8_t *)bundle.data() + offset, std::min(piece, bundle.size() - offset)))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+HOST_TEST(splits_sections_in_any_pieces)
+{
+    std::string app = images::app(70000);
+    std::string data = images::spiffs(40000);
+    std::string bundle = images::bundle({images::section(OTABundleReader::SECTION_APP, app, true),
+                                         images::section(OTABundleReader::SECTION_SPIFFS, data, false, false)});
+    for (size_t piece : {1, 40, 1460, 1 << 20})
+    {
+        Unpacked unpacked;
+        OTABundleReader reader = unpacked.reader();
+        CHECK(feed(reader, bundle, piece));
+        CHECK(reader.finished());
+        REQUIRE(unpacked.sections.size() == 2);
+        CHECK_EQ(unpacked.ended, 2u);
+        CHECK_EQ(+unpacked.sections[0].type, +OTABundleReader::SECTION_APP);
+        CHECK_EQ(+unpacked.sections[0].encoding, +OTABundleReader::ENCODING_GZIP);
+        CHECK(unpacked.sections[0].hasDigest);
+        CHECK(std::string((const char *)unpacked.sections[0].sha256, 32) == images::sha256(app));
+        CHECK(unpacked.data[0] == images::gzip(app));
+        CHECK_EQ(+unpacked.sections[1].type, +OTABundleReader::SECTION_SPIFFS);
+        CHECK(!unpacked.sections[1].hasDigest);
+        CHECK(unpacked.data[1] == data);
+    }
+}
+
+HOST_TEST(rejects_malformed_bundles)
+{
+    std::string app = images::app(5000);
+    std::string good = images::bundle({images::section(OTABundleReader::SECTION_APP, app)});
+
+    std::string badMagic = good;
+    badMagic[1] = 'X';
+    std::string badVersion = good;
+    badVersion[4] = 2;
+    std::string noSections = good;
+    noSections[5] = 0;
+    std::string badType = good;
+    badType[8] = 7;
+    std::string badEncoding = good;
+    badEncoding[9] = 3;
+    std::string repeated = images::bundle({images::section(OTABundleReader::SECTION_APP, app),
+                                           images::section(OTABundleReader::SECTION_APP, app)});
+    std::string trailing = good + "x";
+
+    for (const std::string *bad : {&badMagic, &badVersion, &noSections, &badType, &badEncoding, &repeated, &trailing})
+    {
+        Unpacked unpacked;
+        OTABundleReader reader = unpacked.reader();
+        CHECK(!feed(reader, *bad, 1460));
+        CHECK(reader.failed());
+    }
+}
+
+HOST_TEST(a_failed_section_stops_the_bundle)
+{
+    std::string bundle = images::bundle({images::section(OTABundleReader::SECTION_APP, images::app(5000)),
+                                         images::section(OTABundleReader::SECTION_SPIFFS, images::spiffs(5000))});
+    Unpacked unpacked;
+    unpacked.rejectEnd = true;
+    OTABundleReader reader = unpacked.reader();
+    CHECK(!feed(reader, bundle, 1460));
+    CHECK(reader.failed());
+    CHECK_EQ(unpacked.sections.size(), 1u);
+}
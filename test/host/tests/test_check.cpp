@@ -0,0 +1,108 @@
+#include <HostTest.h>
+#include <HostImages.h>
+#include <HostServer.h>
+#include <OTAUpdate.h>
+#include <Preferences.h>
+#include <esp_ota_ops.h>
+
+namespace
+{
+    const std::string FIRMWARE_DIGEST(64, 'a');
+    const std::string SPIFFS_DIGEST(64, 'b');
+
+    std::string manifest()
+    {
+        return "{\"firmware_version\": \"1.2.4\", \"sha256\": {\"firmware\": \"" + FIRMWARE_DIGEST +
+               "\", \"spiffs\": \"" + SPIFFS_DIGEST + "\"}}";
+    }
+
+    // What a device that already installed both published images has in NVS
+    void recordInstalled(bool firmware, bool spiffs)
+    {
+        Preferences prefs;
+        prefs.begin("otaupdate", false);
+        if (firmware)
+        {
+            prefs.putString("dg_app", FIRMWARE_DIGEST.c_str());
+            prefs.putUInt("dg_app_part", esp_ota_get_running_partition()->address);
+        }
+        if (spiffs)
+        {
+            prefs.putString("dg_spiffs", SPIFFS_DIGEST.c_str());
+        }
+        prefs.end();
+    }
+}
+
+HOST_TEST(every_image_already_installed_is_up_to_date)
+{
+    HostServer server;
+    server.setFile("/config.json", manifest());
+    recordInstalled(true, true);
+    OTAUpdate ota(server.url().c_str());
+    ota.setFirmwareVersion(1, 2, 3);
+    ota.checkForUpdates();
+    CHECK(ota.getState() == OTA_UP_TO_DATE);
+    CHECK(host::serialContains("Everything is already up-to-date"));
+    CHECK_EQ(server.log().size(), 1u);
+    CHECK_EQ(host::restarts(), 0u);
+}
+
+HOST_TEST(a_failed_download_is_a_failure_not_up_to_date)
+{
+    HostServer server;
+    server.setFile("/config.json", manifest());
+    // SPIFFS is current; the firmware is missing from the server
+    recordInstalled(false, true);
+    OTAUpdate ota(server.url().c_str());
+    ota.setFirmwareVersion(1, 2, 3);
+    ota.checkForUpdates();
+    CHECK(ota.getState() == OTA_FAILED);
+    CHECK(!host::serialContains("Everything is already up-to-date"));
+    CHECK(host::serialContains("Update failed"));
+    CHECK_EQ(host::restarts(), 0u);
+}
+
+HOST_TEST(an_image_that_fails_its_digest_is_a_failure)
+{
+    HostServer server;
+    server.setFile("/config.json", manifest());
+    server.setFile("/firmware.bin", images::app(50000));
+    recordInstalled(false, true);
+    OTAUpdate ota(server.url().c_str());
+    ota.setFirmwareVersion(1, 2, 3);
+    ota.checkForUpdates();
+    CHECK(ota.getState() == OTA_FAILED);
+    CHECK(esp_ota_get_boot_partition() == esp_ota_get_running_partition());
+}
+
+HOST_TEST(an_all_current_check_is_remembered_for_a_fast_start)
+{
+    HostServer server;
+    server.setFile("/config.json", manifest());
+    // A version no other test checks, so nothing is cached for it yet
+    auto fastStartChecks = [&server]()
+    {
+        OTAUpdate rebooted(server.url().c_str());
+        rebooted.setFirmwareVersion(1, 1, 9);
+        return rebooted.beginFast(3600);
+    };
+    REQUIRE(fastStartChecks());
+
+    // A failure isn't remembered
+    recordInstalled(false, true);
+    OTAUpdate failed(server.url().c_str());
+    failed.setFirmwareVersion(1, 1, 9);
+    failed.checkForUpdates();
+    REQUIRE(failed.getState() == OTA_FAILED);
+    CHECK(fastStartChecks());
+
+    // Called directly, not through begin() or loop()
+    recordInstalled(true, true);
+    OTAUpdate ota(server.url().c_str());
+    ota.setFirmwareVersion(1, 1, 9);
+    ota.checkForUpdates();
+    REQUIRE(ota.getState() == OTA_UP_TO_DATE);
+    CHECK(!fastStartChecks());
+    CHECK(host::serialContains("is still fresh"));
+}
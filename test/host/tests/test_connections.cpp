@@ -0,0 +1,69 @@
+#include <HostTest.h>
+#include <HostImages.h>
+#include <HostServer.h>
+#include <OTAUpdate.h>
+
+namespace
+{
+    const char *MANIFEST = "{\"firmware_version\": \"1.2.4\"}";
+
+    void publish(HostServer &server, const std::string &spiffs)
+    {
+        server.setFile("/config.json", MANIFEST);
+        server.setFile("/spiffs.bin", spiffs);
+        server.setFile("/firmware.bin", images::app(200000));
+    }
+}
+
+HOST_TEST(manifest_spiffs_and_firmware_share_one_connection)
+{
+    HostServer server;
+    publish(server, images::spiffs(300000));
+    OTAUpdate ota(server.url().c_str());
+    ota.setFirmwareVersion(1, 2, 3);
+    ota.checkForUpdates();
+
+    CHECK(ota.getState() == OTA_REBOOT_PENDING);
+    CHECK_EQ(host::restarts(), 1u);
+    CHECK_EQ(server.requests(), 3u);
+    CHECK_EQ(server.accepts(), 1u);
+    const OTAConnectionStats &stats = ota.getConnectionStats();
+    CHECK_EQ(stats.requests, 3u);
+    CHECK_EQ(stats.reused, 2u);
+    CHECK_EQ(stats.connects, 1u);
+}
+
+HOST_TEST(a_response_left_unread_is_not_reused)
+{
+    // A LittleFS image on a SPIFFS build is refused at its first bytes, so
+    // the rest of its body is never read and that connection is closed
+    HostServer server;
+    publish(server, images::littlefs(300000));
+    OTAUpdate ota(server.url().c_str());
+    ota.setFirmwareVersion(1, 2, 3);
+    ota.checkForUpdates();
+
+    CHECK_EQ(host::restarts(), 1u);
+    CHECK_EQ(server.requests(), 3u);
+    CHECK_EQ(server.accepts(), 2u);
+    const OTAConnectionStats &stats = ota.getConnectionStats();
+    CHECK_EQ(stats.requests, 3u);
+    CHECK_EQ(stats.reused, 1u);
+    CHECK_EQ(stats.connects, 2u);
+}
+
+HOST_TEST(an_unchanged_manifest_reuses_the_connection_next_time)
+{
+    HostServer server;
+    server.setFile("/config.json", MANIFEST);
+    OTAUpdate ota(server.url().c_str());
+    ota.setFirmwareVersion(1, 2, 4);
+    ota.checkForUpdates();
+    ota.checkForUpdates();
+
+    CHECK(ota.getState() == OTA_UP_TO_DATE);
+    CHECK_EQ(server.requests(), 2u);
+    CHECK_EQ(server.accepts(), 1u);
+    CHECK_EQ(ota.getConnectionStats().reused, 1u);
+    CHECK_EQ(ota.getManifestStats().notModified, 1u);
+}
@@ -0,0 +1,109 @@
+#include <HostTest.h>
+#include <HostImages.h>
+#include <OTADelta.h>
+#include <esp_ota_ops.h>
+
+namespace
+{
+    // The running app as the patcher reads it
+    const esp_partition_t *install(const std::string &image)
+    {
+        const esp_partition_t *running = esp_ota_get_running_partition();
+        host::writePartition(running, image);
+        host::setSketchSize(image.size());
+        return running;
+    }
+
+    std::string edited(const std::string &source)
+    {
+        std::string target = source;
+        // A changed byte here and there, a changed block and a longer tail
+        target[100] ^= 0x5a;
+        target[std::min((size_t)70000, target.size() - 1)] ^= 0x01;
+        for (size_t i = 30000; i < 30300; i++)
+        {
+            target[i] = (char)(i * 7);
+        }
+        return target + images::random(5000, 9);
+    }
+
+    struct Rebuilt
+    {
+        std::string data;
+        OTADeltaPatcher::Output output()
+        {
+            return [this](const uint8_t *bytes, size_t len)
+            {
+                data.append((const char *)bytes, len);
+                return true;
+            };
+        }
+    };
+}
+
+HOST_TEST(rebuilds_the_target_in_any_pieces)
+{
+    std::string source = images::app(120000);
+    std::string target = edited(source);
+    std::string patch = images::delta(source, target);
+    const esp_partition_t *running = install(source);
+    CHECK(patch.size() < target.size() / 4);
+
+    for (size_t piece : {1, 13, 1460, 1 << 20})
+    {
+        Rebuilt out;
+        OTADeltaPatcher patcher(running, ESP.getSketchMD5(), out.output());
+        for (size_t offset = 0; offset < patch.size(); offset += piece)
+        {
+            REQUIRE(patcher.write((const uint8_t *)patch.data() + offset, std::min(piece, patch.size() - offset)));
+        }
+        CHECK(patcher.finished());
+        CHECK_EQ(patcher.targetSize(), target.size());
+        CHECK(out.data == target);
+    }
+}
+
+HOST_TEST(refuses_a_patch_for_another_image)
+{
+    std::string source = images::app(50000);
+    std::string patch = images::delta(images::app(50000, 2), edited(source));
+    const esp_partition_t *running = install(source);
+    Rebuilt out;
+    OTADeltaPatcher patcher(running, ESP.getSketchMD5(), out.output());
+    CHECK(!patcher.write((const uint8_t *)patch.data(), patch.size()));
+    CHECK(patcher.failed());
+    CHECK(out.data.empty());
+}
+
+HOST_TEST(rejects_malformed_patches)
+{
+    std::string source = images::app(80000);
+    std::string target = edited(source);
+    std::string patch = images::delta(source, target);
+    const esp_partition_t *running = install(source);
+
+    std::string badMagic = patch;
+    badMagic[0] = 'X';
+    // Claim a shorter target than the ops produce
+    std::string shortTarget = patch;
+    shortTarget[8] = 0x10;
+    shortTarget[9] = 0;
+    shortTarget[10] = 0;
+    // Copy from beyond the source
+    std::string badOp = patch.substr(0, 32) + std::string("\x01\xff\xff\xff\x00\x10\x00\x00\x00", 9) + '\0';
+
+    for (const std::string *bad : {&badMagic, &shortTarget, &badOp})
+    {
+        Rebuilt out;
+        OTADeltaPatcher patcher(running, ESP.getSketchMD5(), out.output());
+        patcher.write((const uint8_t *)bad->data(), bad->size());
+        CHECK(patcher.failed());
+        CHECK(!patcher.finished());
+    }
+
+    // Ending early
+    Rebuilt out;
+    OTADeltaPatcher patcher(running, ESP.getSketchMD5(), out.output());
+    CHECK(patcher.write((const uint8_t *)patch.data(), patch.size() - 10));
+    CHECK(!patcher.finished());
+}
@@ -0,0 +1,47 @@
+#include <HostTest.h>
+#include <HostImages.h>
+#include <OTADigest.h>
+
+HOST_TEST(finish_ends_the_hash_once)
+{
+    std::string image = images::app(10000);
+    OTADigest digest;
+    digest.begin();
+    digest.update((const uint8_t *)image.data(), 6000);
+    digest.update((const uint8_t *)image.data() + 6000, 4000);
+    const uint8_t *bytes = digest.finish();
+    CHECK(std::string((const char *)bytes, 32) == images::sha256(image));
+    // Later calls return the same digest rather than finishing again
+    CHECK(digest.finish() == bytes);
+    CHECK(std::string((const char *)digest.finish(), 32) == images::sha256(image));
+    CHECK(std::string(digest.hex()) == images::sha256Hex(image));
+    CHECK(std::string(digest.hex()) == images::sha256Hex(image));
+    CHECK_EQ(digest.hashed(), image.size());
+}
+
+HOST_TEST(matches_compares_in_either_case)
+{
+    std::string image = images::app(5000);
+    OTADigest digest;
+    digest.begin();
+    digest.update((const uint8_t *)image.data(), image.size());
+    std::string upper = images::sha256Hex(image);
+    for (char &c : upper)
+    {
+        c = toupper(c);
+    }
+    CHECK(digest.matches(upper.c_str()));
+    CHECK(!digest.matches(images::sha256Hex(image + "x").c_str()));
+}
+
+HOST_TEST(begin_starts_over)
+{
+    OTADigest digest;
+    digest.begin();
+    digest.update((const uint8_t *)"abc", 3);
+    digest.finish();
+    digest.begin();
+    digest.update((const uint8_t *)"xyz", 3);
+    CHECK(std::string((const char *)digest.finish(), 32) == images::sha256("xyz"));
+    CHECK_EQ(digest.hashed(), 3u);
+}
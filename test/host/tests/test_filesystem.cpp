@@ -0,0 +1,131 @@
+#include <HostTest.h>
+#include <HostAccess.h>
+#include <HostImages.h>
+#include <HostStream.h>
+#include <OTAFilesystem.h>
+
+// Built once per filesystem backend (see CMakeLists.txt): each accepts only
+// data images it can mount
+namespace
+{
+    struct Accepts
+    {
+        bool spiffs;
+        bool littlefs;
+        bool fat;
+    };
+
+#if defined(OTA_FILESYSTEM_LITTLEFS)
+    const char *BACKEND = "LittleFS";
+    const Accepts ACCEPTS = {false, true, false};
+#elif defined(OTA_FILESYSTEM_FFAT)
+    const char *BACKEND = "FFat";
+    const Accepts ACCEPTS = {false, false, true};
+#else
+    const char *BACKEND = "SPIFFS";
+    const Accepts ACCEPTS = {true, false, false};
+#endif
+
+    // The partition table the backend is used with
+    void useDataPartition()
+    {
+#if defined(OTA_FILESYSTEM_FFAT)
+        host::setDataPartition(ESP_PARTITION_SUBTYPE_DATA_FAT);
+#endif
+    }
+
+    bool matches(const std::string &image)
+    {
+        return OTAFilesystem::imageMatches((const uint8_t *)image.data(), image.size());
+    }
+
+    // Streams image into the data partition in segments of the given size
+    bool update(const std::string &image, size_t segment)
+    {
+        OTAUpdate ota("http://127.0.0.1");
+        HostStream stream(image);
+        stream.setSegment(segment);
+        return OTAHostAccess::updateFromStream(ota, stream, image.size(), U_SPIFFS);
+    }
+
+    std::string flashed(size_t size)
+    {
+        size_t offset = OTAFilesystem::imageOffset();
+        return host::readPartition(host::dataPartition(), offset + size).substr(offset);
+    }
+}
+
+HOST_TEST(the_backend_is_the_one_built_for)
+{
+    CHECK(strcmp(OTAFilesystem::name(), BACKEND) == 0);
+}
+
+HOST_TEST(images_are_told_apart_by_their_head)
+{
+    CHECK_EQ(matches(images::spiffs(8192)), ACCEPTS.spiffs);
+    CHECK_EQ(matches(images::littlefs(8192)), ACCEPTS.littlefs);
+    CHECK_EQ(matches(images::fat(8192)), ACCEPTS.fat);
+
+    // Only the first bytes are looked at
+    size_t head = +OTAFilesystem::IMAGE_HEAD_SIZE;
+    CHECK_EQ(matches(images::littlefs(8192).substr(0, head)), ACCEPTS.littlefs);
+    CHECK_EQ(matches(images::fat(8192).substr(0, head)), ACCEPTS.fat);
+
+    // A FAT boot sector needs its jump as well as 0x55AA at 510
+    std::string fat = images::fat(8192);
+    fat[0] = 0;
+    CHECK(!matches(fat) || ACCEPTS.spiffs);
+    fat = images::fat(8192);
+    fat[511] = 0;
+    CHECK(!matches(fat) || ACCEPTS.spiffs);
+
+    // A head cut short of a signature carries none
+    CHECK(!matches(images::littlefs(8192).substr(0, 15)) || ACCEPTS.spiffs);
+    CHECK(!matches(images::fat(8192).substr(0, 511)) || ACCEPTS.spiffs);
+}
+
+HOST_TEST(only_a_matching_image_is_written)
+{
+    struct Case
+    {
+        std::string image;
+        bool accepted;
+    } cases[] = {
+        {images::spiffs(100000), ACCEPTS.spiffs},
+        {images::littlefs(100000), ACCEPTS.littlefs},
+        {images::fat(100000), ACCEPTS.fat},
+    };
+    for (const Case &c : cases)
+    {
+        // Segments smaller than the head, so it is gathered across reads
+        for (size_t segment : {100, 1460})
+        {
+            host::reset();
+            useDataPartition();
+            CHECK_EQ(update(c.image, segment), c.accepted);
+            if (c.accepted)
+            {
+                CHECK(flashed(c.image.size()) == c.image);
+            }
+            else
+            {
+                // Refused before anything reached flash
+                CHECK_EQ(host::flashStats().eraseCalls, 0u);
+                CHECK(host::serialContains(std::string("not a ") + BACKEND + " image"));
+                CHECK_EQ(host::flashStats().writeCalls, 0u);
+            }
+        }
+    }
+}
+
+HOST_TEST(an_image_shorter_than_the_head_is_checked_at_the_end)
+{
+    useDataPartition();
+    // Too short to carry a LittleFS or FAT signature
+    std::string image(300, '\x01');
+    CHECK_EQ(update(image, 64), ACCEPTS.spiffs);
+    if (!ACCEPTS.spiffs)
+    {
+        CHECK_EQ(host::flashStats().eraseCalls, 0u);
+    }
+}
@@ -0,0 +1,184 @@
+#include <HostTest.h>
+#include <HostImages.h>
+#include <OTAInflate.h>
+#include <vector>
+
+namespace
+{
+    struct Inflated
+    {
+        std::string data;
+
+        OTAInflater::Output output()
+        {
+            return [this](const uint8_t *bytes, size_t len)
+            {
+                data.append((const char *)bytes, len);
+                return true;
+            };
+        }
+    };
+
+    bool feed(OTAInflater &inflater, const std::string &compressed, size_t piece)
+    {
+        for (size_t offset = 0; offset < compressed.size(); offset += piece)
+        {
+            if (!inflater.write((const uint8_t *)compressed.data() + offset,
+                                std::min(piece, compressed.size() - offset)))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+HOST_TEST(inflates_every_window_size_in_any_pieces)
+{
+    std::string image = images::app(100000);
+    for (int bits = 9; bits <= 15; bits++)
+    {
+        std::string compressed = images::gzip(image, bits);
+        for (size_t piece : {1, 7, 1460, 65536})
+        {
+            Inflated out;
+            OTAInflater inflater(out.output(), bits);
+            REQUIRE(inflater.begin());
+            CHECK(feed(inflater, compressed, piece));
+            CHECK(inflater.finished());
+            CHECK(out.data == image);
+            CHECK_EQ(inflater.produced(), image.size());
+        }
+    }
+}
+
+HOST_TEST(output_comes_in_whole_blocks_when_the_window_holds_them)
+{
+    std::string image = images::app(100000);
+    for (int bits : {11, 12, 15})
+    {
+        std::string compressed = images::gzip(image, bits);
+        for (size_t piece : {7, 1460})
+        {
+            std::vector<size_t> lengths;
+            Inflated out;
+            OTAInflater::Output append = out.output();
+            OTAInflater inflater([&](const uint8_t *bytes, size_t len)
+                                 {
+                                     lengths.push_back(len);
+                                     return append(bytes, len); },
+                                 bits, 4096);
+            REQUIRE(inflater.begin());
+            CHECK(feed(inflater, compressed, piece));
+            CHECK(inflater.finished());
+            CHECK(out.data == image);
+            if (bits < 12)
+            {
+                // A 2 KB window can't hold a block, so output isn't held back
+                continue;
+            }
+            // Every piece but the tail is whole blocks, so each starts on a block boundary
+            for (size_t i = 0; i + 1 < lengths.size(); i++)
+            {
+                CHECK_EQ(lengths[i] % 4096, 0u);
+            }
+            CHECK_EQ(lengths.back(), image.size() % 4096);
+        }
+    }
+}
+
+HOST_TEST(memory_use_is_the_window_plus_fixed_state)
+{
+    std::string compressed = images::gzip(images::app(30000), 12);
+    size_t produced = 0;
+    host::markHeap();
+    {
+        // Counting only, so the heap figures are the inflater's own
+        OTAInflater inflater([&produced](const uint8_t *, size_t len)
+                             {
+                                 produced += len;
+                                 return true; },
+                             12);
+        REQUIRE(inflater.begin());
+        REQUIRE(feed(inflater, compressed, 1460));
+        CHECK(inflater.finished());
+        CHECK(inflater.memoryUsage() >= 4096u);
+        // Nothing grows with the image: the window and decompressor state are all
+        CHECK(host::heapStats().peak <= inflater.memoryUsage() + 256);
+    }
+    CHECK_EQ(host::heapStats().live, 0u);
+    CHECK_EQ(produced, 30000u);
+}
+
+HOST_TEST(a_window_smaller_than_the_stream_needs_fails)
+{
+    std::string image = images::random(4096) + images::app(20000) + images::random(4096) + images::app(20000);
+    // Back references up to 32 KB away can't be resolved from a 512 byte window
+    std::string compressed = images::gzip(image, 15);
+    Inflated out;
+    OTAInflater inflater(out.output(), 9);
+    REQUIRE(inflater.begin());
+    bool ok = feed(inflater, compressed, 1460);
+    CHECK(!ok || !inflater.finished() || out.data != image);
+}
+
+HOST_TEST(header_fields_are_skipped)
+{
+    std::string image = images::app(5000);
+    std::string compressed = images::gzip(image);
+    // FEXTRA, FNAME and FCOMMENT after the fixed 10 byte header
+    std::string extended = compressed.substr(0, 10);
+    extended[3] = 0x04 | 0x08 | 0x10;
+    extended += std::string("\x03\x00xyz", 5);
+    extended += std::string("firmware.bin\0", 13);
+    extended += std::string("built on the host\0", 18);
+    extended += compressed.substr(10);
+    Inflated out;
+    OTAInflater inflater(out.output());
+    REQUIRE(inflater.begin());
+    CHECK(feed(inflater, extended, 3));
+    CHECK(inflater.finished());
+    CHECK(out.data == image);
+}
+
+HOST_TEST(corrupt_streams_are_rejected)
+{
+    std::string image = images::app(20000);
+    std::string compressed = images::gzip(image);
+
+    std::string badMagic = compressed;
+    badMagic[0] = 0x1e;
+    std::string badCrc = compressed;
+    badCrc[badCrc.size() - 6] ^= 0x01;
+    std::string badLength = compressed;
+    badLength[badLength.size() - 2] ^= 0x01;
+    std::string badData = compressed;
+    badData[compressed.size() / 2] ^= 0x55;
+
+    for (const std::string *stream : {&badMagic, &badCrc, &badLength, &badData})
+    {
+        Inflated out;
+        OTAInflater inflater(out.output());
+        REQUIRE(inflater.begin());
+        bool ok = feed(inflater, *stream, 1460);
+        CHECK(!ok || !inflater.finished());
+        CHECK(!(inflater.finished() && out.data == image));
+    }
+
+    // Truncated: never finishes
+    Inflated out;
+    OTAInflater inflater(out.output());
+    REQUIRE(inflater.begin());
+    CHECK(feed(inflater, compressed.substr(0, compressed.size() - 3), 1460));
+    CHECK(!inflater.finished());
+}
+
+HOST_TEST(output_failure_stops_the_stream)
+{
+    std::string compressed = images::gzip(images::app(50000));
+    OTAInflater inflater([](const uint8_t *, size_t)
+                         { return false; });
+    REQUIRE(inflater.begin());
+    CHECK(!feed(inflater, compressed, 1460));
+    CHECK(inflater.failed());
+}
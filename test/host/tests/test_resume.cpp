@@ -0,0 +1,171 @@
+#include <HostTest.h>
+#include <HostAccess.h>
+#include <HostImages.h>
+#include <HostServer.h>
+#include <esp_ota_ops.h>
+#include <algorithm>
+
+namespace
+{
+    const esp_partition_t *nextApp()
+    {
+        return esp_ota_get_next_update_partition(NULL);
+    }
+
+    void configure(OTAUpdate &ota, uint8_t attempts)
+    {
+        ota.setPipelineBufferSize(0);
+        ota.setStallTimeout(500);
+        ota.setResumeAttempts(attempts);
+    }
+
+    // The image requests the server saw, in order
+    std::vector<HostServer::Request> imageRequests(const HostServer &server)
+    {
+        std::vector<HostServer::Request> found;
+        for (const HostServer::Request &request : server.log())
+        {
+            if (request.path == "/firmware.bin")
+            {
+                found.push_back(request);
+            }
+        }
+        return found;
+    }
+
+    size_t rangeStart(const HostServer::Request &request)
+    {
+        std::string range = request.header("range");
+        return range.empty() ? 0 : strtoul(range.c_str() + strlen("bytes="), nullptr, 10);
+    }
+}
+
+HOST_TEST(drops_at_any_offset_resume_to_an_identical_image)
+{
+    std::string image = images::app(400000);
+    for (size_t first : {1, 4095, 65536, 70001, 131073, 249000})
+    {
+        host::reset();
+        HostServer server;
+        server.setFile("/firmware.bin", image);
+        server.dropAt("/firmware.bin", first);
+        server.dropAt("/firmware.bin", first + 150007);
+        OTAUpdate ota(server.url().c_str());
+        configure(ota, 3);
+        CHECK(OTAHostAccess::performUpdate(ota, server.url("/firmware.bin").c_str()));
+        CHECK(host::readPartition(nextApp(), image.size()) == image);
+        CHECK(esp_ota_get_boot_partition() == nextApp());
+        CHECK_EQ(host::flashStats().unerasedWrites, 0u);
+
+        // A drop checkpoints the last whole sector written, and each retry
+        // continues from there on the ETag of the first response
+        std::vector<HostServer::Request> requests = imageRequests(server);
+        REQUIRE(requests.size() == 3);
+        CHECK(requests[0].header("range").empty());
+        CHECK_EQ(rangeStart(requests[1]), first / 4096 * 4096);
+        CHECK_EQ(rangeStart(requests[2]) % 4096, 0u);
+        CHECK(rangeStart(requests[2]) <= first + 150007);
+        CHECK(rangeStart(requests[2]) > rangeStart(requests[1]));
+        for (size_t i = 1; i < requests.size(); i++)
+        {
+            CHECK(requests[i].header("if-range") == (rangeStart(requests[i]) > 0 ? requests[2].header("if-range") : ""));
+        }
+    }
+}
+
+HOST_TEST(a_reset_resumes_from_the_checkpoint_in_nvs)
+{
+    std::string image = images::app(300000);
+    HostServer server;
+    server.setFile("/firmware.bin", image);
+    server.dropAt("/firmware.bin", 200000);
+    {
+        OTAUpdate ota(server.url().c_str());
+        configure(ota, 0);
+        CHECK(!OTAHostAccess::performUpdate(ota, server.url("/firmware.bin").c_str()));
+    }
+    host::clearSerial();
+
+    // A new instance, as after a reset; NVS still holds the checkpoint
+    OTAUpdate ota(server.url().c_str());
+    configure(ota, 0);
+    CHECK(OTAHostAccess::performUpdate(ota, server.url("/firmware.bin").c_str()));
+    CHECK(host::serialContains("Resuming download at 196608"));
+    CHECK(host::readPartition(nextApp(), image.size()) == image);
+    CHECK(esp_ota_get_boot_partition() == nextApp());
+
+    std::vector<HostServer::Request> requests = imageRequests(server);
+    REQUIRE(requests.size() == 2);
+    CHECK(requests[1].header("range") == "bytes=196608-");
+    CHECK(!requests[1].header("if-range").empty());
+}
+
+HOST_TEST(a_changed_etag_restarts_from_zero)
+{
+    std::string image = images::app(300000);
+    std::string newer = images::app(300000, 2);
+    HostServer server;
+    server.setFile("/firmware.bin", image);
+    server.dropAt("/firmware.bin", 200000);
+    {
+        OTAUpdate ota(server.url().c_str());
+        configure(ota, 0);
+        CHECK(!OTAHostAccess::performUpdate(ota, server.url("/firmware.bin").c_str()));
+    }
+
+    // A new build appears in the meantime: If-Range no longer matches, so the
+    // server sends the whole new image and the device writes it from offset 0
+    server.setFile("/firmware.bin", newer);
+    host::clearSerial();
+    OTAUpdate ota(server.url().c_str());
+    configure(ota, 0);
+    CHECK(OTAHostAccess::performUpdate(ota, server.url("/firmware.bin").c_str()));
+    CHECK(!host::serialContains("Resuming"));
+    CHECK(host::readPartition(nextApp(), newer.size()) == newer);
+    CHECK_EQ(ota.getTransferStats().bytes, (uint32_t)newer.size());
+
+    std::vector<HostServer::Request> requests = imageRequests(server);
+    REQUIRE(requests.size() == 2);
+    CHECK(requests[1].header("range") == "bytes=196608-");
+}
+
+HOST_TEST(a_reset_resumes_the_firmware_within_a_full_check)
+{
+    // SPIFFS is fetched before the firmware on every check; its download must
+    // leave the firmware's checkpoint alone
+    std::string image = images::app(300000);
+    HostServer server;
+    server.setFile("/config.json", "{\"firmware_version\": \"1.2.4\"}");
+    server.setFile("/spiffs.bin", images::spiffs(100000));
+    server.setFile("/firmware.bin", image);
+    server.dropAt("/firmware.bin", 200000);
+    {
+        OTAUpdate ota(server.url().c_str());
+        ota.setFirmwareVersion(1, 2, 3);
+        configure(ota, 0);
+        OTAHostAccess::runCheck(ota);
+        // The new SPIFFS restarts the device, the firmware still to come
+        CHECK(ota.getState() == OTA_REBOOT_PENDING);
+        CHECK(esp_ota_get_boot_partition() == esp_ota_get_running_partition());
+    }
+    host::clearSerial();
+
+    OTAUpdate ota(server.url().c_str());
+    ota.setFirmwareVersion(1, 2, 3);
+    configure(ota, 0);
+    OTAHostAccess::runCheck(ota);
+    CHECK(host::serialContains("Resuming download at 196608"));
+    CHECK(host::readPartition(nextApp(), image.size()) == image);
+    CHECK(esp_ota_get_boot_partition() == nextApp());
+
+    std::vector<HostServer::Request> requests = imageRequests(server);
+    REQUIRE(requests.size() == 2);
+    CHECK(requests[1].header("range") == "bytes=196608-");
+    // The second check fetched SPIFFS again in between
+    std::vector<std::string> paths;
+    for (const HostServer::Request &request : server.log())
+    {
+        paths.push_back(request.path);
+    }
+    CHECK(std::count(paths.begin(), paths.end(), "/spiffs.bin") == 2);
+}
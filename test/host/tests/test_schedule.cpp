@@ -0,0 +1,123 @@
+#include <HostTest.h>
+#include <HostAccess.h>
+#include <HostImages.h>
+#include <HostServer.h>
+#include <OTAUpdate.h>
+#include <climits>
+
+namespace
+{
+    const char *MANIFEST = "{\"firmware_version\": \"1.2.4\"}";
+    const unsigned long INTERVAL_MS = 600000;
+
+    // The next check is due within [minMs, maxMs]; a little of it has
+    // already passed by the time nextCheckIn() is asked
+    bool dueWithin(const OTAUpdate &ota, unsigned long minMs, unsigned long maxMs)
+    {
+        unsigned long in = ota.nextCheckIn();
+        return in + 1000 >= minMs && in <= maxMs;
+    }
+
+    struct Scheduled
+    {
+        HostServer server;
+        OTAUpdate ota;
+
+        Scheduled() : ota(server.url().c_str())
+        {
+            ota.setFirmwareVersion(1, 2, 3);
+            ota.setCheckInterval(INTERVAL_MS, 0);
+            ota.setRetryBackoff(10000, 80000);
+        }
+    };
+}
+
+HOST_TEST(failed_manifest_fetches_back_off_and_a_good_check_resets)
+{
+    Scheduled s;
+    s.server.setStatus("/config.json", 500);
+    // Each step doubles up to the cap, and half of it is random
+    unsigned long steps[] = {10000, 20000, 40000, 80000, 80000};
+    for (unsigned i = 0; i < 5; i++)
+    {
+        OTAHostAccess::runCheck(s.ota);
+        CHECK(OTAHostAccess::lastCheckFailed(s.ota));
+        CHECK_EQ(OTAHostAccess::checkFailures(s.ota), i + 1);
+        CHECK(dueWithin(s.ota, steps[i] / 2, steps[i]));
+    }
+    CHECK(host::serialContains("(backing off)"));
+
+    s.server.setFile("/config.json", MANIFEST);
+    s.ota.setFirmwareVersion(1, 2, 4);
+    OTAHostAccess::runCheck(s.ota);
+    CHECK(s.ota.getState() == OTA_UP_TO_DATE);
+    CHECK(!OTAHostAccess::lastCheckFailed(s.ota));
+    CHECK_EQ(OTAHostAccess::checkFailures(s.ota), 0u);
+    CHECK(dueWithin(s.ota, INTERVAL_MS, INTERVAL_MS));
+}
+
+HOST_TEST(retry_after_on_the_manifest_is_a_floor)
+{
+    Scheduled s;
+    s.server.setStatus("/config.json", 503);
+    s.server.setHeader("/config.json", "Retry-After", "120");
+    OTAHostAccess::runCheck(s.ota);
+    CHECK_EQ(OTAHostAccess::retryAfterMs(s.ota), 120000ul);
+    CHECK(dueWithin(s.ota, 120000, 120000));
+
+    // It only holds for the check that got it
+    s.server.remove("/config.json");
+    s.server.setFile("/config.json", MANIFEST);
+    s.ota.setFirmwareVersion(1, 2, 4);
+    OTAHostAccess::runCheck(s.ota);
+    CHECK_EQ(OTAHostAccess::retryAfterMs(s.ota), 0ul);
+    CHECK(dueWithin(s.ota, INTERVAL_MS, INTERVAL_MS));
+}
+
+HOST_TEST(a_missing_image_backs_off)
+{
+    Scheduled s;
+    s.server.setFile("/config.json", MANIFEST);
+    OTAHostAccess::runCheck(s.ota);
+    CHECK(s.ota.getState() == OTA_FAILED);
+    CHECK(OTAHostAccess::lastCheckFailed(s.ota));
+    CHECK(dueWithin(s.ota, 5000, 10000));
+    OTAHostAccess::runCheck(s.ota);
+    CHECK_EQ(OTAHostAccess::checkFailures(s.ota), 2u);
+    CHECK(dueWithin(s.ota, 10000, 20000));
+}
+
+HOST_TEST(an_image_that_fails_its_digest_backs_off)
+{
+    Scheduled s;
+    s.server.setFile("/config.json", "{\"firmware_version\": \"1.2.4\", \"sha256\": {\"firmware\": \"" +
+                                         std::string(64, 'a') + "\"}}");
+    s.server.setFile("/firmware.bin", images::app(50000));
+    OTAHostAccess::runCheck(s.ota);
+    CHECK(s.ota.getState() == OTA_FAILED);
+    CHECK(OTAHostAccess::lastCheckFailed(s.ota));
+    CHECK(dueWithin(s.ota, 5000, 10000));
+}
+
+HOST_TEST(retry_after_on_an_image_is_a_floor)
+{
+    Scheduled s;
+    s.server.setFile("/config.json", MANIFEST);
+    s.server.setStatus("/firmware.bin", 503);
+    s.server.setHeader("/firmware.bin", "Retry-After", "900");
+    OTAHostAccess::runCheck(s.ota);
+    CHECK(s.ota.getState() == OTA_FAILED);
+    CHECK(OTAHostAccess::lastCheckFailed(s.ota));
+    CHECK_EQ(OTAHostAccess::retryAfterMs(s.ota), 900000ul);
+    CHECK(dueWithin(s.ota, 900000, 900000));
+}
+
+HOST_TEST(an_installed_update_schedules_nothing)
+{
+    Scheduled s;
+    s.server.setFile("/config.json", MANIFEST);
+    s.server.setFile("/firmware.bin", images::app(50000));
+    OTAHostAccess::runCheck(s.ota);
+    CHECK(s.ota.getState() == OTA_REBOOT_PENDING);
+    CHECK_EQ(s.ota.nextCheckIn(), ULONG_MAX);
+}
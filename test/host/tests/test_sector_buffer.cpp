@@ -0,0 +1,135 @@
+#include <HostTest.h>
+#include <HostImages.h>
+#include <OTASectorBuffer.h>
+#include <vector>
+
+namespace
+{
+    // Records each block the buffer hands on
+    struct Blocks
+    {
+        std::string image;
+        std::vector<size_t> offsets;
+        std::vector<size_t> lengths;
+        bool fail = false;
+
+        OTASectorBuffer::Output output()
+        {
+            return [this](const uint8_t *data, size_t len)
+            {
+                offsets.push_back(image.size());
+                lengths.push_back(len);
+                image.append((const char *)data, len);
+                return !fail;
+            };
+        }
+    };
+
+    const size_t SECTOR = OTASectorBuffer::SECTOR_SIZE;
+}
+
+HOST_TEST(blocks_start_on_sector_boundaries_whatever_the_pieces)
+{
+    std::string image = images::app(10 * SECTOR + 123);
+    for (size_t piece : {1, 100, 1460, 4095, 4096, 4097, 10000})
+    {
+        Blocks blocks;
+        OTASectorBuffer buffer(blocks.output());
+        REQUIRE(buffer.begin());
+        for (size_t offset = 0; offset < image.size(); offset += piece)
+        {
+            size_t len = std::min(piece, image.size() - offset);
+            REQUIRE(buffer.write((const uint8_t *)image.data() + offset, len));
+        }
+        REQUIRE(buffer.flush());
+        CHECK(blocks.image == image);
+        for (size_t i = 0; i < blocks.offsets.size(); i++)
+        {
+            CHECK_EQ(blocks.offsets[i] % SECTOR, 0u);
+            // Only the tail may be short
+            if (i + 1 < blocks.offsets.size())
+            {
+                CHECK_EQ(blocks.lengths[i] % SECTOR, 0u);
+            }
+        }
+        CHECK_EQ(buffer.writes(), (uint32_t)blocks.offsets.size());
+    }
+}
+
+HOST_TEST(whole_sectors_in_the_input_are_not_copied)
+{
+    std::string image = images::app(8 * SECTOR);
+    Blocks blocks;
+    OTASectorBuffer buffer(blocks.output());
+    REQUIRE(buffer.begin());
+    REQUIRE(buffer.write((const uint8_t *)image.data(), image.size()));
+    REQUIRE(buffer.flush());
+    CHECK_EQ(buffer.copied(), 0u);
+    CHECK_EQ(buffer.writes(), 1u);
+    CHECK(blocks.image == image);
+}
+
+HOST_TEST(only_straddling_bytes_are_copied)
+{
+    std::string image = images::app(4 * SECTOR);
+    Blocks blocks;
+    OTASectorBuffer buffer(blocks.output());
+    REQUIRE(buffer.begin());
+    // 100 bytes, then the rest: the first sector is gathered, the other three pass through
+    REQUIRE(buffer.write((const uint8_t *)image.data(), 100));
+    REQUIRE(buffer.write((const uint8_t *)image.data() + 100, image.size() - 100));
+    REQUIRE(buffer.flush());
+    CHECK_EQ(buffer.copied(), (uint32_t)SECTOR);
+    CHECK(blocks.image == image);
+}
+
+HOST_TEST(bytes_read_into_space_are_taken_in_place)
+{
+    std::string image = images::app(3 * SECTOR + 500);
+    Blocks blocks;
+    OTASectorBuffer buffer(blocks.output());
+    REQUIRE(buffer.begin());
+    size_t offset = 0;
+    while (offset < image.size())
+    {
+        size_t room;
+        uint8_t *dst = buffer.space(room);
+        size_t len = std::min(std::min(room, (size_t)1000), image.size() - offset);
+        memcpy(dst, image.data() + offset, len);
+        REQUIRE(buffer.write(dst, len));
+        offset += len;
+    }
+    REQUIRE(buffer.flush());
+    CHECK_EQ(buffer.copied(), 0u);
+    CHECK(blocks.image == image);
+}
+
+HOST_TEST(external_buffer_is_used_instead_of_the_heap)
+{
+    static uint8_t sector[OTASectorBuffer::SECTOR_SIZE];
+    Blocks blocks;
+    OTASectorBuffer buffer(blocks.output());
+    buffer.useBuffer(sector);
+    host::markHeap();
+    REQUIRE(buffer.begin());
+    CHECK_EQ(host::heapStats().allocations, 0u);
+    size_t room;
+    CHECK(buffer.space(room) == sector);
+    buffer.release();
+}
+
+HOST_TEST(allocation_failure_and_output_failure_are_reported)
+{
+    Blocks blocks;
+    {
+        OTASectorBuffer buffer(blocks.output());
+        host::failAllocations(OTASectorBuffer::SECTOR_SIZE);
+        CHECK(!buffer.begin());
+    }
+
+    OTASectorBuffer buffer(blocks.output());
+    REQUIRE(buffer.begin());
+    std::string image = images::app(2 * SECTOR);
+    blocks.fail = true;
+    CHECK(!buffer.write((const uint8_t *)image.data(), image.size()));
+}
@@ -0,0 +1,103 @@
+#include <HostTest.h>
+#include <HostAccess.h>
+#include <HostImages.h>
+#include <HostStream.h>
+#include <OTASignature.h>
+#include <esp_ota_ops.h>
+
+namespace
+{
+    bool verifies(OTASignature &check, const std::string &image, const std::string &signature)
+    {
+        std::string digest = images::sha256(image);
+        return check.verify((const uint8_t *)digest.data(), signature.c_str());
+    }
+}
+
+HOST_TEST(p256_signatures_verify)
+{
+    images::KeyPair key = images::ecKey();
+    std::string image = images::app(20000);
+    OTASignature check;
+    REQUIRE(check.setPublicKey(key.publicPem.c_str()));
+    CHECK(check.configured());
+    CHECK(verifies(check, image, images::sign(key, image)));
+}
+
+HOST_TEST(bad_signatures_are_rejected)
+{
+    images::KeyPair key = images::ecKey();
+    std::string image = images::app(20000);
+    std::string signature = images::sign(key, image);
+    OTASignature check;
+    REQUIRE(check.setPublicKey(key.publicPem.c_str()));
+
+    // Another image's signature, and one with a flipped bit in s
+    CHECK(!verifies(check, image, images::sign(key, image + "x")));
+    std::string flipped = signature;
+    flipped[flipped.size() - 1] = flipped[flipped.size() - 1] == '0' ? '1' : '0';
+    CHECK(!verifies(check, image, flipped));
+    CHECK(strstr(check.error(), "does not match") != nullptr);
+
+    // Made with another key
+    CHECK(!verifies(check, image, images::sign(images::ecKey(), image)));
+
+    // Truncated DER, odd length, not hex, empty, longer than any P-256 signature
+    CHECK(!verifies(check, image, signature.substr(0, signature.size() - 2)));
+    CHECK(!verifies(check, image, signature.substr(0, 16)));
+    CHECK(!verifies(check, image, signature.substr(0, signature.size() - 1)));
+    std::string notHex = signature;
+    notHex[4] = 'g';
+    CHECK(!verifies(check, image, notHex));
+    CHECK(!verifies(check, image, ""));
+    CHECK(!verifies(check, image, signature + std::string(2 * OTASignature::MAX_SIGNATURE_SIZE, '0')));
+}
+
+HOST_TEST(keys_other_than_p256_are_refused)
+{
+    OTASignature check;
+    CHECK(!check.setPublicKey(images::ecKey("secp384r1").publicPem.c_str()));
+    CHECK(strstr(check.error(), "P-256") != nullptr);
+    CHECK(!check.configured());
+    CHECK(!check.setPublicKey(images::ecKey("secp256k1").publicPem.c_str()));
+    CHECK(!check.configured());
+    CHECK(!check.setPublicKey(images::rsaKey().publicPem.c_str()));
+    CHECK(!check.configured());
+    CHECK(!check.setPublicKey("-----BEGIN PUBLIC KEY-----\nnot a key\n-----END PUBLIC KEY-----\n"));
+    CHECK(!check.configured());
+
+    // A refused key leaves nothing configured, so verify fails closed
+    std::string digest(32, '\0');
+    CHECK(!check.verify((const uint8_t *)digest.data(), "3006020101020101"));
+}
+
+HOST_TEST(only_signed_images_are_activated)
+{
+    images::KeyPair key = images::ecKey();
+    std::string image = images::app(60000);
+    struct Case
+    {
+        std::string signature;
+        bool activated;
+    } cases[] = {
+        {images::sign(key, image), true},
+        {images::sign(images::ecKey(), image), false},
+        {"", false},
+    };
+    for (const Case &c : cases)
+    {
+        host::reset();
+        OTAUpdate ota("http://127.0.0.1");
+        REQUIRE(ota.setSigningKey(key.publicPem.c_str()));
+        OTAHostAccess::expectImage(ota, "", c.signature.c_str());
+        HostStream stream(image);
+        stream.setSegment(1460);
+        CHECK_EQ(OTAHostAccess::updateFromStream(ota, stream, image.size()), c.activated);
+        CHECK_EQ(esp_ota_get_boot_partition() == esp_ota_get_next_update_partition(NULL), c.activated);
+    }
+
+    host::reset();
+    OTAUpdate ota("http://127.0.0.1");
+    CHECK(!ota.setSigningKey(images::ecKey("secp384r1").publicPem.c_str()));
+    CHECK(host::serialContains("Signing key rejected"));
+}
@@ -0,0 +1,128 @@
+#include <HostTest.h>
+#include <OTAProgressSink.h>
+#include <vector>
+
+namespace
+{
+    std::vector<std::string> calls;
+
+    // Logs every hook it receives, tagged with its template argument
+    template <int Id>
+    struct RecordingSink : OTASinkBase
+    {
+        static const bool visual = Id == 2;
+
+        void log(const std::string &what)
+        {
+            calls.push_back(std::to_string(Id) + " " + what);
+        }
+        void begin() { log("begin"); }
+        void setDisplayRefresh(uint16_t ms, bool partial) { log("refresh " + std::to_string(ms) + (partial ? " partial" : "")); }
+        void transferStarted(const String &heading) { log(std::string("start ") + heading.c_str()); }
+        void progress(const String &heading, int progress) { log(std::string(heading.c_str()) + " " + std::to_string(progress)); }
+        void message(const char *line1, const char *line2) { log(std::string(line1) + "/" + (line2 ? line2 : "-")); }
+        void transferFinished(bool ok) { log(ok ? "finished ok" : "finished failed"); }
+        unsigned long ioMicros() { return Id * 100; }
+    };
+
+    struct Report
+    {
+        std::string text;
+        int progress;
+    };
+
+    // The way OTAUpdate holds its sink
+    template <class Sink>
+    struct Holder : OTASinkHolder<Sink>
+    {
+        int payload;
+        Sink &get() { return this->sink(); }
+    };
+}
+
+HOST_TEST(empty_sinks_take_no_space_in_the_holder)
+{
+    CHECK_EQ(sizeof(Holder<OTANullSink>), sizeof(int));
+    CHECK_EQ(sizeof(Holder<OTASerialSink>), sizeof(int));
+    // A sink with state keeps it
+    CHECK(sizeof(Holder<OTACallbackSink>) > sizeof(int));
+
+    Holder<OTACallbackSink> holder;
+    std::vector<Report> reports;
+    holder.get().setCallback([&reports](const char *text, int progress)
+                             { reports.push_back(Report{text, progress}); });
+    holder.get().progress("Firmware OTA", 10);
+    REQUIRE(reports.size() == 1);
+    CHECK(reports[0].text == "Firmware OTA");
+}
+
+HOST_TEST(flags_combine)
+{
+    CHECK(!OTANullSink::enabled);
+    CHECK(OTASerialSink::enabled);
+    CHECK(!OTASerialSink::visual);
+    CHECK(!(OTAMultiSink<OTANullSink, OTANullSink>::enabled));
+    CHECK((OTAMultiSink<OTANullSink, OTASerialSink>::enabled));
+    CHECK(!(OTAMultiSink<OTASerialSink, OTACallbackSink>::visual));
+    CHECK((OTAMultiSink<RecordingSink<1>, RecordingSink<2> >::visual));
+}
+
+HOST_TEST(multi_sink_fans_out_every_call_in_order)
+{
+    calls.clear();
+    OTAMultiSink<RecordingSink<1>, RecordingSink<2> > sink;
+    sink.begin();
+    sink.setDisplayRefresh(250, true);
+    sink.transferStarted("SPIFFS OTA");
+    sink.progress("SPIFFS OTA", 40);
+    sink.message("Already", "Up-to-date");
+    sink.message("Rebooting...", nullptr);
+    sink.transferFinished(true);
+    CHECK_EQ(sink.ioMicros(), 300ul);
+
+    std::vector<std::string> expected = {
+        "1 begin", "2 begin",
+        "1 refresh 250 partial", "2 refresh 250 partial",
+        "1 start SPIFFS OTA", "2 start SPIFFS OTA",
+        "1 SPIFFS OTA 40", "2 SPIFFS OTA 40",
+        "1 Already/Up-to-date", "2 Already/Up-to-date",
+        "1 Rebooting.../-", "2 Rebooting.../-",
+        "1 finished ok", "2 finished ok",
+    };
+    CHECK(calls == expected);
+}
+
+HOST_TEST(serial_and_callback_sinks_together)
+{
+    OTAMultiSink<OTASerialSink, OTACallbackSink> sink;
+    std::vector<Report> reports;
+    // setCallback reaches the sink that uses it and is ignored by the other
+    sink.setCallback([&reports](const char *text, int progress)
+                     { reports.push_back(Report{text, progress}); });
+    sink.progress("Firmware OTA", 42);
+    sink.message("Update Error", "Network Failed");
+    sink.message("Rebooting...", nullptr);
+    sink.transferFinished(false);
+    CHECK_EQ(sink.ioMicros(), 0ul);
+
+    CHECK(host::serialContains("Progress: 42%"));
+    REQUIRE(reports.size() == 3);
+    CHECK(reports[0].text == "Firmware OTA");
+    CHECK_EQ(reports[0].progress, 42);
+    CHECK(reports[1].text == "Update Error Network Failed");
+    CHECK_EQ(reports[1].progress, -1);
+    CHECK(reports[2].text == "Rebooting...");
+    CHECK_EQ(reports[2].progress, -1);
+}
+
+HOST_TEST(callback_sink_without_a_callback_does_nothing)
+{
+    OTACallbackSink sink;
+    sink.progress("Firmware OTA", 5);
+    sink.message("a", "b");
+    host::clearSerial();
+    OTANullSink none;
+    none.progress("Firmware OTA", 5);
+    none.message("a", "b");
+    CHECK(host::serialOutput().empty());
+}
@@ -0,0 +1,109 @@
+#include <HostTest.h>
+#include <HostImages.h>
+#include <HostServer.h>
+#include <OTATlsClient.h>
+
+namespace
+{
+    // A server with its own key and certificate; each test's server has its
+    // own port, so sessions cached by earlier tests don't match it
+    struct TlsServer
+    {
+        HostServer http;
+        images::KeyPair key = images::ecKey();
+        std::string certificate = images::certificate(key);
+        std::string pin = images::sha256Hex(key.publicDer);
+
+        TlsServer(bool trustedByCa = true)
+        {
+            host::setTlsServerCertificate(certificate, trustedByCa);
+        }
+    };
+
+    bool connect(OTATlsClient &client, const TlsServer &server)
+    {
+        bool ok = client.connect("127.0.0.1", server.http.port()) == 1;
+        client.stop();
+        return ok;
+    }
+}
+
+HOST_TEST(a_woken_device_resumes_under_the_same_trust)
+{
+    TlsServer server;
+    {
+        OTATlsClient client;
+        client.setPinnedKey(server.pin.c_str());
+        REQUIRE(connect(client, server));
+        CHECK(!client.lastResumed());
+    }
+    // setup() sets the same pin again after a deep sleep; the ticket survives
+    OTATlsClient client;
+    client.setPinnedKey(server.pin.c_str());
+    REQUIRE(connect(client, server));
+    CHECK(client.lastResumed());
+    CHECK_EQ(host::tlsStats().resumedHandshakes, 1u);
+}
+
+HOST_TEST(a_different_pin_after_a_reset_does_not_resume)
+{
+    TlsServer server;
+    {
+        OTATlsClient client;
+        client.setPinnedKey(server.pin.c_str());
+        REQUIRE(connect(client, server));
+    }
+    // The new firmware pins another key: resuming would skip the pin check
+    // (a resumed handshake carries no certificate), so it has to go in full
+    // and fail on the pin
+    OTATlsClient client;
+    client.setPinnedKey(images::sha256Hex(images::ecKey().publicDer).c_str());
+    CHECK(!connect(client, server));
+    CHECK(!client.lastResumed());
+    CHECK_EQ(host::tlsStats().resumedHandshakes, 0u);
+    CHECK(strstr(client.error(), "pinned") != nullptr);
+}
+
+HOST_TEST(changing_the_pin_at_runtime_drops_the_session)
+{
+    TlsServer server;
+    OTATlsClient client;
+    client.setPinnedKey(server.pin.c_str());
+    REQUIRE(connect(client, server));
+    REQUIRE(connect(client, server));
+    CHECK(client.lastResumed());
+
+    client.setPinnedKey(images::sha256Hex(images::ecKey().publicDer).c_str());
+    CHECK(!connect(client, server));
+    CHECK_EQ(host::tlsStats().resumedHandshakes, 1u);
+
+    // And back: a full handshake again, then resumption
+    client.setPinnedKey(server.pin.c_str());
+    REQUIRE(connect(client, server));
+    CHECK(!client.lastResumed());
+    REQUIRE(connect(client, server));
+    CHECK(client.lastResumed());
+}
+
+HOST_TEST(a_new_ca_certificate_drops_the_session)
+{
+    TlsServer server;
+    OTATlsClient client;
+    REQUIRE(client.setCACert(server.certificate.c_str()));
+    REQUIRE(connect(client, server));
+    REQUIRE(connect(client, server));
+    CHECK(client.lastResumed());
+
+    // A CA that doesn't vouch for this server
+    images::KeyPair other = images::ecKey();
+    host::setTlsServerCertificate(server.certificate, false);
+    REQUIRE(client.setCACert(images::certificate(other, "other CA").c_str()));
+    CHECK(!connect(client, server));
+    CHECK_EQ(host::tlsStats().resumedHandshakes, 1u);
+
+    // The same after a reset
+    OTATlsClient rebooted;
+    REQUIRE(rebooted.setCACert(images::certificate(other, "other CA").c_str()));
+    CHECK(!connect(rebooted, server));
+    CHECK_EQ(host::tlsStats().resumedHandshakes, 1u);
+}
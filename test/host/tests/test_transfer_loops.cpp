@@ -0,0 +1,244 @@
+#include <HostTest.h>
+#include <HostAccess.h>
+#include <HostImages.h>
+#include <HostServer.h>
+#include <HostStream.h>
+#include <Preferences.h>
+#include <SPIFFS.h>
+#include <esp_ota_ops.h>
+
+namespace
+{
+    const esp_partition_t *nextApp()
+    {
+        return esp_ota_get_next_update_partition(NULL);
+    }
+
+    std::string flashed(const esp_partition_t *partition, size_t size)
+    {
+        return host::readPartition(partition, size);
+    }
+}
+
+HOST_TEST(direct_loop_writes_the_image)
+{
+    host::useVirtualClock(true);
+    std::string image = images::app(300000);
+    for (size_t segment : {536, 1460, 16384})
+    {
+        OTAUpdate ota("http://127.0.0.1");
+        ota.setPipelineBufferSize(0);
+        HostStream stream(image);
+        stream.setRate(500 * 1024);
+        stream.setSegment(segment);
+        REQUIRE(OTAHostAccess::updateFromStream(ota, stream, image.size()));
+        CHECK(flashed(nextApp(), image.size()) == image);
+        CHECK(esp_ota_get_boot_partition() == nextApp());
+        CHECK_EQ(host::flashStats().unerasedWrites, 0u);
+        const OTATransferStats &stats = ota.getTransferStats();
+        CHECK_EQ(stats.bytes, (uint32_t)image.size());
+        // Read into the sector being assembled: nothing copied on the way to flash
+        CHECK_EQ(stats.copiedBytes, 0u);
+        // Sectors go straight to the partition, not through Update's own copy
+        CHECK_EQ(host::updateStats().writes, 0u);
+    }
+}
+
+HOST_TEST(pipelined_loop_writes_the_image)
+{
+    std::string image = images::app(400000);
+    for (size_t ring : {4096, 16384, 65536})
+    {
+        host::reset();
+        OTAUpdate ota("http://127.0.0.1");
+        ota.setPipelineBufferSize(ring);
+        HostStream stream(image);
+        stream.setSegment(1460);
+        REQUIRE(OTAHostAccess::updateFromStream(ota, stream, image.size()));
+        CHECK(flashed(nextApp(), image.size()) == image);
+        CHECK(esp_ota_get_boot_partition() == nextApp());
+        CHECK_EQ(ota.getTransferStats().bytes, (uint32_t)image.size());
+    }
+}
+
+HOST_TEST(gzip_images_are_inflated_on_the_way)
+{
+    std::string image = images::app(250000);
+    for (size_t ring : {0, 16384})
+    {
+        for (int bits : {10, 15})
+        {
+            host::reset();
+            std::string compressed = images::gzip(image, bits);
+            OTAUpdate ota("http://127.0.0.1");
+            ota.setPipelineBufferSize(ring);
+            ota.setDecompressionWindowBits(bits);
+            HostStream stream(compressed);
+            stream.setSegment(1460);
+            REQUIRE(OTAHostAccess::updateFromStream(ota, stream, compressed.size(), U_FLASH, OTA_ENCODING_GZIP));
+            CHECK(flashed(nextApp(), image.size()) == image);
+            CHECK_EQ(ota.getTransferStats().bytes, (uint32_t)compressed.size());
+            // A window that holds whole sectors hands them on aligned; only the tail is gathered
+            CHECK_EQ(ota.getTransferStats().copiedBytes == image.size() % 4096, bits >= 12);
+        }
+    }
+}
+
+HOST_TEST(data_images_go_to_the_data_partition)
+{
+    std::string image = images::spiffs(200000);
+    OTAUpdate ota("http://127.0.0.1");
+    HostStream stream(image);
+    REQUIRE(OTAHostAccess::updateFromStream(ota, stream, image.size(), U_SPIFFS));
+    CHECK(flashed(host::dataPartition(), image.size()) == image);
+    // The running app stays the boot partition
+    CHECK(esp_ota_get_boot_partition() == esp_ota_get_running_partition());
+}
+
+HOST_TEST(a_digest_mismatch_is_never_activated)
+{
+    std::string image = images::app(100000);
+    OTAUpdate ota("http://127.0.0.1");
+    OTAHostAccess::expectImage(ota, images::sha256Hex(image + "x").c_str());
+    HostStream stream(image);
+    CHECK(!OTAHostAccess::updateFromStream(ota, stream, image.size()));
+    CHECK(esp_ota_get_boot_partition() == esp_ota_get_running_partition());
+    // The held-back header never went in, so nothing written can boot
+    CHECK_EQ((uint8_t)host::readPartition(esp_ota_get_next_update_partition(NULL), 1)[0], 0xFF);
+    CHECK(host::serialContains("SHA-256 mismatch"));
+}
+
+HOST_TEST(short_streams_fail_and_abort)
+{
+    host::useVirtualClock(true);
+    std::string image = images::app(100000);
+    OTAUpdate ota("http://127.0.0.1");
+    ota.setPipelineBufferSize(0);
+    ota.setStallTimeout(2000);
+    HostStream stream(image);
+    stream.endAt(60000);
+    CHECK(!OTAHostAccess::updateFromStream(ota, stream, image.size()));
+    CHECK(ota.getTransferStats().stalled);
+    // The held-back header never went in, so nothing written can boot
+    CHECK_EQ((uint8_t)host::readPartition(esp_ota_get_next_update_partition(NULL), 1)[0], 0xFF);
+    CHECK(esp_ota_get_boot_partition() == esp_ota_get_running_partition());
+}
+
+HOST_TEST(files_on_the_filesystem_are_applied)
+{
+    std::string image = images::app(120000);
+    REQUIRE(SPIFFS.begin(true));
+    File file = SPIFFS.open("/update.bin", "w");
+    file.write((const uint8_t *)image.data(), image.size());
+    file.close();
+
+    OTAUpdate ota("http://127.0.0.1");
+    file = SPIFFS.open("/update.bin", "r");
+    REQUIRE(file);
+    CHECK(OTAHostAccess::updateFromFile(ota, file, file.size()));
+    CHECK(flashed(nextApp(), image.size()) == image);
+}
+
+HOST_TEST(web_uploads_are_applied)
+{
+    std::string image = images::app(150000);
+    for (bool gzip : {false, true})
+    {
+        host::reset();
+        OTAUpdate ota("http://127.0.0.1");
+        WebServer server;
+        ota.setupManualOTA(server);
+        std::string body = gzip ? images::gzip(image) : image;
+        REQUIRE(server.postUpload("/update", body, {{"sha256", images::sha256Hex(image).c_str()}}));
+        CHECK_EQ(server.response().code, 200);
+        CHECK(flashed(nextApp(), image.size()) == image);
+        CHECK(esp_ota_get_boot_partition() == nextApp());
+        CHECK_EQ(host::restarts(), 1u);
+    }
+}
+
+HOST_TEST(downloads_stream_from_the_server)
+{
+    HostServer server;
+    std::string image = images::app(300000);
+    server.setFile("/firmware.bin", image);
+    OTAUpdate ota(server.url().c_str());
+    REQUIRE(OTAHostAccess::performUpdate(ota, server.url("/firmware.bin").c_str()));
+    CHECK(flashed(nextApp(), image.size()) == image);
+    CHECK(esp_ota_get_boot_partition() == nextApp());
+    CHECK(ota.getTransferStats().firstByteMs < 5000);
+}
+
+HOST_TEST(delta_updates_rebuild_from_the_running_app)
+{
+    HostServer server;
+    std::string source = images::app(150000);
+    std::string target = source;
+    target[5000] ^= 0x11;
+    target += images::random(3000);
+    host::writePartition(esp_ota_get_running_partition(), source);
+    host::setSketchSize(source.size());
+    server.setFile("/firmware.otad", images::delta(source, target));
+
+    OTAUpdate ota(server.url().c_str());
+    OTAHostAccess::expectImage(ota, images::sha256Hex(target).c_str());
+    REQUIRE(OTAHostAccess::performDeltaUpdate(ota, server.url("/firmware.otad").c_str()));
+    CHECK(flashed(nextApp(), target.size()) == target);
+    CHECK(esp_ota_get_boot_partition() == nextApp());
+}
+
+HOST_TEST(bundles_write_both_partitions)
+{
+    HostServer server;
+    std::string app = images::app(200000);
+    std::string data = images::spiffs(100000);
+    server.setFile("/bundle.otab", images::bundle({images::section(OTABundleReader::SECTION_APP, app, true),
+                                                   images::section(OTABundleReader::SECTION_SPIFFS, data)}));
+    OTAUpdate ota(server.url().c_str());
+    REQUIRE(OTAHostAccess::performBundleUpdate(ota, server.url("/bundle.otab").c_str()));
+    CHECK(flashed(nextApp(), app.size()) == app);
+    CHECK(flashed(host::dataPartition(), data.size()) == data);
+    CHECK(esp_ota_get_boot_partition() == nextApp());
+    CHECK_EQ(host::flashStats().unerasedWrites, 0u);
+}
+
+HOST_TEST(bundled_spiffs_is_only_written_after_the_app_verifies)
+{
+    std::string app = images::app(200000);
+    std::string data = images::spiffs(100000);
+    std::string before = flashed(host::dataPartition(), data.size());
+    size_t appStart = 8 + 40 * 2;
+
+    // SPIFFS first: refused before any of it is written
+    std::string spiffsFirst = images::bundle({images::section(OTABundleReader::SECTION_SPIFFS, data),
+                                              images::section(OTABundleReader::SECTION_APP, app)});
+    // The app's bytes don't match its digest: SPIFFS is never reached
+    std::string badApp = images::bundle({images::section(OTABundleReader::SECTION_APP, app),
+                                         images::section(OTABundleReader::SECTION_SPIFFS, data)});
+    badApp[appStart + 1000] ^= 0x01;
+    for (const std::string *bundle : {&spiffsFirst, &badApp})
+    {
+        host::reset();
+        HostServer server;
+        server.setFile("/bundle.otab", *bundle);
+        OTAUpdate ota(server.url().c_str());
+        CHECK(!OTAHostAccess::performBundleUpdate(ota, server.url("/bundle.otab").c_str()));
+        CHECK(flashed(host::dataPartition(), data.size()) == before);
+        CHECK(esp_ota_get_boot_partition() != nextApp());
+    }
+
+    // SPIFFS fails after the app verified: the app isn't activated
+    std::string badSpiffs = images::bundle({images::section(OTABundleReader::SECTION_APP, app),
+                                            images::section(OTABundleReader::SECTION_SPIFFS, data)});
+    badSpiffs[appStart + app.size() + 1000] ^= 0x01;
+    host::reset();
+    HostServer server;
+    server.setFile("/bundle.otab", badSpiffs);
+    OTAUpdate ota(server.url().c_str());
+    CHECK(!OTAHostAccess::performBundleUpdate(ota, server.url("/bundle.otab").c_str()));
+    CHECK(esp_ota_get_boot_partition() != nextApp());
+    Preferences prefs;
+    prefs.begin("otaupdate", true);
+    CHECK(!prefs.isKey("dg_spiffs"));
+    prefs.end();
+}
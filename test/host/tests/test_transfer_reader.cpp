@@ -0,0 +1,255 @@
+#include <HostTest.h>
+#include <HostAccess.h>
+#include <HostImages.h>
+#include <HostStream.h>
+#include <OTATransferReader.h>
+#include <esp_ota_ops.h>
+
+namespace
+{
+    // Reads everything the way the transfer loops do and returns it
+    std::string drain(OTATransferReader &reader, size_t room)
+    {
+        std::string out;
+        std::string buffer(room, '\0');
+        while (!reader.done())
+        {
+            size_t n = reader.read((uint8_t *)&buffer[0], room);
+            out.append(buffer, 0, n);
+        }
+        return out;
+    }
+}
+
+HOST_TEST(delivers_the_body_unchanged_for_any_segment_and_room)
+{
+    host::useVirtualClock(true);
+    std::string body = images::app(50000);
+    for (size_t segment : {1, 536, 1460, 8192})
+    {
+        for (size_t room : {1, 512, 4096, 16384})
+        {
+            HostStream stream(body);
+            stream.setRate(200 * 1024);
+            stream.setSegment(segment);
+            OTATransferReader reader(stream, body.size(), room);
+            CHECK(drain(reader, room) == body);
+            CHECK_EQ(reader.status(), OTATransferReader::DONE);
+            CHECK_EQ(reader.received(), body.size());
+            CHECK(reader.stats().maxReadSize <= std::max(room, (size_t)128));
+        }
+    }
+}
+
+HOST_TEST(reads_only_what_has_arrived)
+{
+    host::useVirtualClock(true);
+    std::string body = images::app(20000);
+    HostStream stream(body);
+    stream.setRate(10 * 1024);
+    stream.setSegment(1460);
+    // Any wait inside readBytes() would show up as the stream timeout
+    stream.setTimeout(60000);
+    OTATransferReader reader(stream, body.size(), 4096);
+    unsigned long start = millis();
+    CHECK(drain(reader, 4096) == body);
+    unsigned long elapsed = millis() - start;
+    // 20000 bytes at 10 KB/s: about two seconds, never a readBytes() timeout
+    CHECK(elapsed < 2500);
+    CHECK_EQ(stream.readCalls(), reader.stats().reads);
+}
+
+HOST_TEST(stops_at_the_content_length)
+{
+    host::useVirtualClock(true);
+    std::string body = images::app(10000) + "trailing bytes of the next response";
+    HostStream stream(body);
+    OTATransferReader reader(stream, 10000, 4096);
+    CHECK(drain(reader, 4096) == body.substr(0, 10000));
+    CHECK_EQ(stream.position(), 10000u);
+}
+
+HOST_TEST(empty_body_is_done_at_once)
+{
+    HostStream stream("");
+    OTATransferReader reader(stream, 0, 4096);
+    CHECK(reader.done());
+    CHECK(!reader.failed());
+    uint8_t buffer[16];
+    CHECK_EQ(reader.read(buffer, sizeof(buffer)), 0u);
+}
+
+HOST_TEST(read_size_grows_while_data_piles_up_and_shrinks_on_a_slow_link)
+{
+    host::useVirtualClock(true);
+    std::string body = images::app(120000);
+    HostStream stream(body);
+    // The first 100000 bytes are already waiting, the rest trickles in
+    stream.setRateFrom(100000, 2 * 1024);
+    OTATransferReader reader(stream, body.size(), 16384);
+    CHECK_EQ(reader.readSize(), 1460u);
+
+    std::string out;
+    std::string buffer(16384, '\0');
+    while (reader.received() < 100000)
+    {
+        out.append(buffer, 0, reader.read((uint8_t *)&buffer[0], buffer.size()));
+    }
+    // Doubled on every read up to the room it was given
+    CHECK_EQ(reader.readSize(), 16384u);
+    CHECK_EQ(reader.stats().maxReadSize, 16384u);
+    CHECK(reader.stats().reads < 12);
+
+    out += drain(reader, buffer.size());
+    CHECK(out == body);
+    // 2 KB/s brings 512 bytes per 250 ms window: halved until a read fits in that
+    CHECK_EQ(reader.readSize(), 512u);
+    CHECK_EQ(reader.stats().minReadSize, 512u);
+    CHECK(stream.largestRead() <= 16384u);
+}
+
+HOST_TEST(a_stall_past_the_deadline_stops_the_reader)
+{
+    host::useVirtualClock(true);
+    std::string body = images::app(60000);
+    HostStream stream(body);
+    stream.setRate(100 * 1024);
+    stream.setSegment(1460);
+    stream.stallAt(20440, 60000);
+    OTATransferReader reader(stream, body.size(), 4096);
+    reader.setDeadlines(3000, 0, 0);
+    unsigned long start = millis();
+    std::string out = drain(reader, 4096);
+    unsigned long elapsed = millis() - start;
+
+    CHECK_EQ(reader.status(), OTATransferReader::STALLED);
+    CHECK(reader.failed());
+    CHECK_EQ(reader.received(), 20440u);
+    CHECK(out == body.substr(0, 20440));
+    // 20440 bytes at 100 KB/s, then the deadline and the poll that notices it
+    CHECK(elapsed >= 200 + 3000);
+    CHECK(elapsed <= 200 + 3000 + 10);
+    // The stall that ended the transfer is counted too
+    CHECK_EQ(reader.stats().stallEvents, 1u);
+    CHECK(reader.stats().longestGapMs > 3000);
+    CHECK_EQ(reader.stats().stalledMs, reader.stats().longestGapMs);
+    // A stopped reader reads nothing more
+    uint8_t byte;
+    CHECK_EQ(reader.read(&byte, 1), 0u);
+}
+
+HOST_TEST(stalls_shorter_than_the_deadline_are_counted_and_survived)
+{
+    host::useVirtualClock(true);
+    std::string body = images::app(60000);
+    HostStream stream(body);
+    stream.setRate(100 * 1024);
+    stream.setSegment(1460);
+    stream.stallAt(14600, 2500);
+    OTATransferReader reader(stream, body.size(), 4096);
+    reader.setDeadlines(3000, 0, 0);
+    CHECK(drain(reader, 4096) == body);
+
+    CHECK_EQ(reader.status(), OTATransferReader::DONE);
+    CHECK_EQ(reader.stats().stallEvents, 1u);
+    CHECK(reader.stats().longestGapMs >= 2500);
+    CHECK(reader.stats().longestGapMs <= 2520);
+    CHECK_EQ(reader.stats().stalledMs, reader.stats().longestGapMs);
+}
+
+HOST_TEST(gaps_under_the_event_threshold_are_not_stalls)
+{
+    host::useVirtualClock(true);
+    std::string body = images::app(30000);
+    HostStream stream(body);
+    // A segment every 500 ms
+    stream.setRate(2920);
+    stream.setSegment(1460);
+    OTATransferReader reader(stream, body.size(), 4096);
+    reader.setDeadlines(3000, 0, 0);
+    CHECK(drain(reader, 4096) == body);
+    CHECK_EQ(reader.stats().stallEvents, 0u);
+    CHECK_EQ(reader.stats().stalledMs, 0u);
+}
+
+HOST_TEST(a_rate_below_the_floor_stops_the_reader_after_the_grace)
+{
+    host::useVirtualClock(true);
+    std::string body = images::app(60000);
+    HostStream stream(body);
+    stream.setRate(1024);
+    stream.setSegment(256);
+    OTATransferReader reader(stream, body.size(), 4096);
+    reader.setDeadlines(0, 2048, 2000);
+    unsigned long start = millis();
+    drain(reader, 4096);
+    unsigned long elapsed = millis() - start;
+
+    CHECK_EQ(reader.status(), OTATransferReader::TOO_SLOW);
+    CHECK(reader.failed());
+    CHECK(elapsed > 2000);
+    CHECK(elapsed <= 2010);
+    CHECK(reader.received() <= 2048u + 256u);
+}
+
+HOST_TEST(a_slow_start_above_the_floor_on_average_is_kept)
+{
+    host::useVirtualClock(true);
+    std::string body = images::app(60000);
+    HostStream stream(body);
+    // Everything the floor asks for over the whole transfer, if not at first
+    stream.setRate(1024);
+    stream.setRateFrom(1024, 64 * 1024);
+    stream.setSegment(256);
+    OTATransferReader reader(stream, body.size(), 4096);
+    reader.setDeadlines(0, 4096, 2000);
+    CHECK(drain(reader, 4096) == body);
+    CHECK_EQ(reader.status(), OTATransferReader::DONE);
+}
+
+HOST_TEST(an_update_that_stalls_or_crawls_is_aborted)
+{
+    std::string image = images::app(200000);
+    for (bool stall : {true, false})
+    {
+        host::reset();
+        host::useVirtualClock(true);
+        OTAUpdate ota("http://127.0.0.1");
+        ota.setPipelineBufferSize(0);
+        ota.setStallTimeout(2000);
+        HostStream stream(image);
+        stream.setSegment(1460);
+        if (stall)
+        {
+            stream.setRate(100 * 1024);
+            stream.stallAt(65700, 60000);
+        }
+        else
+        {
+            ota.setMinTransferRate(8192, 3000);
+            stream.setRate(2048);
+        }
+
+        CHECK(!OTAHostAccess::updateFromStream(ota, stream, image.size()));
+        // Nothing half-written is activated, or can boot
+        CHECK_EQ((uint8_t)host::readPartition(esp_ota_get_next_update_partition(NULL), 1)[0], 0xFF);
+        CHECK(esp_ota_get_boot_partition() == esp_ota_get_running_partition());
+
+        const OTATransferStats &stats = ota.getTransferStats();
+        CHECK_EQ(stats.stalled, stall);
+        CHECK_EQ(stats.tooSlow, !stall);
+        if (stall)
+        {
+            CHECK_EQ(stats.bytes, 65700u);
+            CHECK_EQ(stats.reads.stallEvents, 1u);
+            CHECK(stats.reads.longestGapMs > 2000);
+            CHECK(host::serialContains("transfer stalled at 65700 bytes"));
+        }
+        else
+        {
+            CHECK_EQ(stats.reads.stallEvents, 0u);
+            CHECK(stats.bytes <= 3 * 2048u + 1460u);
+            CHECK(host::serialContains("Transfer below 8192 B/s after 3000 ms"));
+        }
+    }
+}
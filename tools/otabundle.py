@@ -0,0 +1,101 @@
+#!/usr/bin/env python3
+"""Pack firmware and SPIFFS images into one OTAB bundle for OTAUpdate.
+
+    otabundle.py [--gzip] [--window-bits N] [--app firmware.bin] [--spiffs spiffs.bin] out.bundle
+    otabundle.py --list out.bundle
+
+The app section is written first so a bad or truncated firmware image is
+caught before SPIFFS is touched. Each entry carries the SHA-256 of the raw
+image, which the device checks before anything is activated. Publish the
+bundle as "bundle" in config.json. See src/OTABundle.h for the format.
+"""
+
+import argparse
+import hashlib
+import os
+import struct
+import sys
+import zlib
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from otacompress import gzip_compress  # noqa: E402
+
+SECTION_APP = 0
+SECTION_SPIFFS = 1
+ENCODING_RAW = 0
+ENCODING_GZIP = 1
+NAMES = {SECTION_APP: "app", SECTION_SPIFFS: "spiffs"}
+
+
+def pack(images, compress, window_bits):
+    entries = bytearray()
+    payload = bytearray()
+    for section_type, data in images:
+        stored = gzip_compress(data, window_bits) if compress else data
+        encoding = ENCODING_GZIP if compress else ENCODING_RAW
+        entries += struct.pack("<BBxxI", section_type, encoding, len(stored)) + hashlib.sha256(data).digest()
+        payload += stored
+    return b"OTAB" + struct.pack("<BBxx", 1, len(images)) + bytes(entries) + bytes(payload)
+
+
+def unpack(bundle):
+    if bundle[:4] != b"OTAB" or bundle[4] != 1:
+        raise ValueError("not an OTAB v1 bundle")
+    count = bundle[5]
+    pos = 8 + 40 * count
+    sections = []
+    for i in range(count):
+        section_type, encoding, length = struct.unpack_from("<BBxxI", bundle, 8 + 40 * i)
+        digest = bundle[16 + 40 * i:48 + 40 * i]
+        stored = bundle[pos:pos + length]
+        if len(stored) != length:
+            raise ValueError("bundle is truncated")
+        data = zlib.decompress(stored, 16 + 15) if encoding == ENCODING_GZIP else stored
+        if any(digest) and hashlib.sha256(data).digest() != digest:
+            raise ValueError("%s section does not match its SHA-256" % NAMES.get(section_type, section_type))
+        sections.append((section_type, encoding, length, data))
+        pos += length
+    if pos != len(bundle):
+        raise ValueError("trailing data after the last section")
+    return sections
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--app")
+    parser.add_argument("--spiffs")
+    parser.add_argument("--gzip", action="store_true")
+    parser.add_argument("--window-bits", type=int, default=15, choices=range(9, 16))
+    parser.add_argument("--list", action="store_true")
+    parser.add_argument("bundle")
+    args = parser.parse_args()
+
+    if args.list:
+        with open(args.bundle, "rb") as f:
+            sections = unpack(f.read())
+        for section_type, encoding, length, data in sections:
+            print("%-6s %8d bytes%s, sha256 %s" % (NAMES.get(section_type, section_type), length,
+                                                 " gzip -> %d" % len(data) if encoding else "",
+                                                 hashlib.sha256(data).hexdigest()))
+        return 0
+
+    images = []
+    for section_type, path in ((SECTION_APP, args.app), (SECTION_SPIFFS, args.spiffs)):
+        if path:
+            with open(path, "rb") as f:
+                images.append((section_type, f.read()))
+    if not images:
+        parser.error("give --app and/or --spiffs")
+
+    bundle = pack(images, args.gzip, args.window_bits)
+    if [s[3] for s in unpack(bundle)] != [data for _, data in images]:
+        sys.stderr.write("error: round trip mismatch, bundle not written\n")
+        return 1
+    with open(args.bundle, "wb") as f:
+        f.write(bundle)
+    print("%s: %d bytes, %s" % (args.bundle, len(bundle), ", ".join(NAMES[t] for t, _ in images)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
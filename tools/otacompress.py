@@ -0,0 +1,51 @@
+#!/usr/bin/env python3
+"""Compress firmware/SPIFFS images for OTAUpdate.
+
+    otacompress.py [--window-bits N] image.bin [image.gz]
+
+Writes a standard gzip file whose deflate stream only references the last
+2^N bytes (default 15, the gzip maximum). The device needs a decompression
+window at least that large, so publish the same value as "window_bits" in
+config.json when using anything below 15.
+"""
+
+import argparse
+import struct
+import sys
+import time
+import zlib
+
+
+def gzip_compress(data, window_bits):
+    compressor = zlib.compressobj(9, zlib.DEFLATED, -window_bits, 9)
+    body = compressor.compress(data) + compressor.flush()
+    header = b"\x1f\x8b\x08\x00" + struct.pack("<I", int(time.time())) + b"\x02\xff"
+    trailer = struct.pack("<II", zlib.crc32(data) & 0xFFFFFFFF, len(data) & 0xFFFFFFFF)
+    return header + body + trailer
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--window-bits", type=int, default=15, choices=range(9, 16))
+    parser.add_argument("image")
+    parser.add_argument("output", nargs="?")
+    args = parser.parse_args()
+
+    with open(args.image, "rb") as f:
+        data = f.read()
+    packed = gzip_compress(data, args.window_bits)
+
+    if zlib.decompress(packed, 16 + 15) != data:
+        sys.stderr.write("error: round trip mismatch\n")
+        return 1
+
+    output = args.output or args.image + ".gz"
+    with open(output, "wb") as f:
+        f.write(packed)
+    print("%s: %d -> %d bytes (%.1f%%), window %d bytes"
+          % (output, len(data), len(packed), 100.0 * len(packed) / max(len(data), 1), 1 << args.window_bits))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
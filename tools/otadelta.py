@@ -0,0 +1,157 @@
+#!/usr/bin/env python3
+"""Build and check OTAD delta patches for OTAUpdate.
+
+    otadelta.py diff  old.bin new.bin patch.bin   # build a patch and verify it
+    otadelta.py apply old.bin patch.bin out.bin   # rebuild an image from a patch
+
+old.bin must be the exact firmware.bin the devices are running; the patch
+records its MD5 and the device refuses to apply it to anything else.
+See src/OTADelta.h for the format.
+"""
+
+import hashlib
+import struct
+import sys
+
+OP_END = 0x00
+OP_COPY = 0x01
+OP_INSERT = 0x02
+OP_ADD = 0x03
+
+KEY = 16         # bytes hashed to find candidate matches
+STRIDE = 4       # index every STRIDE-th position of the old image
+MIN_COPY = 24    # shorter matches are cheaper as literals
+
+
+def build_index(old):
+    index = {}
+    for pos in range(0, len(old) - KEY + 1, STRIDE):
+        index.setdefault(old[pos:pos + KEY], pos)
+    return index
+
+
+def emit_literal(ops, old, new, start, end, last_src):
+    """Literal run new[start:end]; use ADD against the previous alignment when mostly equal."""
+    if start >= end:
+        return
+    if last_src is not None and last_src + (end - start) <= len(old):
+        diff = bytes((new[start + i] - old[last_src + i]) & 0xFF for i in range(end - start))
+        if diff.count(0) * 2 >= len(diff):
+            ops.append((OP_ADD, last_src, diff))
+            return
+    ops.append((OP_INSERT, bytes(new[start:end])))
+
+
+def diff(old, new):
+    index = build_index(old)
+    ops = []
+    literal_start = 0
+    last_src = None
+    i = 0
+    while i < len(new):
+        src = index.get(new[i:i + KEY]) if i + KEY <= len(new) else None
+        if src is None:
+            i += 1
+            continue
+
+        # Extend the candidate backwards into the pending literal and forwards
+        start, s = i, src
+        while start > literal_start and s > 0 and new[start - 1] == old[s - 1]:
+            start -= 1
+            s -= 1
+        end, e = i + KEY, src + KEY
+        while end < len(new) and e < len(old) and new[end] == old[e]:
+            end += 1
+            e += 1
+
+        if end - start < MIN_COPY:
+            i += 1
+            continue
+
+        emit_literal(ops, old, new, literal_start, start, last_src)
+        ops.append((OP_COPY, s, end - start))
+        last_src = e
+        literal_start = i = end
+
+    emit_literal(ops, old, new, literal_start, len(new), last_src)
+
+    out = bytearray(b"OTAD")
+    out += struct.pack("<B3xII", 1, len(new), len(old))
+    out += hashlib.md5(old).digest()
+    for op in ops:
+        if op[0] == OP_COPY:
+            out += struct.pack("<BII", OP_COPY, op[1], op[2])
+        elif op[0] == OP_ADD:
+            out += struct.pack("<BII", OP_ADD, op[1], len(op[2])) + op[2]
+        else:
+            out += struct.pack("<BI", OP_INSERT, len(op[1])) + op[1]
+    out.append(OP_END)
+    return bytes(out)
+
+
+def apply(old, patch):
+    if patch[:4] != b"OTAD" or patch[4] != 1:
+        raise ValueError("not an OTAD v1 patch")
+    target, source_size = struct.unpack_from("<II", patch, 8)
+    if source_size != len(old) or patch[16:32] != hashlib.md5(old).digest():
+        raise ValueError("patch was built for a different source image")
+
+    out = bytearray()
+    pos = 32
+    while True:
+        op = patch[pos]
+        pos += 1
+        if op == OP_END:
+            break
+        if op == OP_INSERT:
+            (length,) = struct.unpack_from("<I", patch, pos)
+            pos += 4
+            out += patch[pos:pos + length]
+            pos += length
+        elif op in (OP_COPY, OP_ADD):
+            src, length = struct.unpack_from("<II", patch, pos)
+            pos += 8
+            if src + length > source_size:
+                raise ValueError("patch reads past the source image")
+            if op == OP_COPY:
+                out += old[src:src + length]
+            else:
+                out += bytes((old[src + k] + patch[pos + k]) & 0xFF for k in range(length))
+                pos += length
+        else:
+            raise ValueError("unknown op 0x%02x" % op)
+
+    if pos != len(patch) or len(out) != target:
+        raise ValueError("patch is truncated or has trailing data")
+    return bytes(out)
+
+
+def main(argv):
+    if len(argv) != 5 or argv[1] not in ("diff", "apply"):
+        sys.stderr.write(__doc__)
+        return 2
+
+    with open(argv[2], "rb") as f:
+        old = f.read()
+    with open(argv[3], "rb") as f:
+        second = f.read()
+
+    if argv[1] == "diff":
+        patch = diff(old, second)
+        if apply(old, patch) != second:
+            sys.stderr.write("error: reconstruction mismatch, patch not written\n")
+            return 1
+        with open(argv[4], "wb") as f:
+            f.write(patch)
+        print("%s: %d bytes (%.1f%% of %d), reconstruction verified"
+              % (argv[4], len(patch), 100.0 * len(patch) / max(len(second), 1), len(second)))
+    else:
+        image = apply(old, second)
+        with open(argv[4], "wb") as f:
+            f.write(image)
+        print("%s: %d bytes, md5 %s" % (argv[4], len(image), hashlib.md5(image).hexdigest()))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+"""Simulate a fleet polling config.json to tune the OTAUpdate scheduler.
+
+    otafleet.py [--devices 2000] [--capacity 50] [--interval 3600] [--jitter 600]
+                [--backoff 30 3600] [--retry-after 60] [--hours 3]
+
+Every device powers up at t=0, as after a power cut. The server stand-in
+answers at most --capacity requests per second and sends 503 with
+Retry-After to the rest. Devices follow the same rules as
+OTAUpdate::scheduleNextCheck(): interval plus random jitter after a good
+check; after a failure, backoff doubling from the minimum up to the maximum
+with half of each step random, and never sooner than Retry-After.
+The "naive" run is what a hand-rolled loop does: check at boot, then every
+interval, and retry failures after the minimum backoff.
+"""
+
+import argparse
+import heapq
+import random
+
+
+def scheduled_wait(args, failures, retry_after):
+    if failures:
+        step = min(args.backoff[0] * 2 ** (failures - 1), args.backoff[1])
+        wait = step / 2 + random.uniform(0, step / 2)
+    else:
+        wait = args.interval + random.uniform(0, args.jitter)
+    return max(wait, retry_after)
+
+
+def naive_wait(args, failures, retry_after):
+    return args.backoff[0] if failures else args.interval
+
+
+def simulate(args, policy, first_check):
+    end = args.hours * 3600
+    events = [(first_check(), device, 0) for device in range(args.devices)]
+    heapq.heapify(events)
+    per_second = [0] * (end + 1)
+    served = [0] * (end + 1)
+    rejected = 0
+    done = set()
+    all_done_at = None
+    while events:
+        t, device, failures = heapq.heappop(events)
+        if t > end:
+            break
+        second = int(t)
+        per_second[second] += 1
+        if served[second] < args.capacity:
+            served[second] += 1
+            failures = 0
+            retry_after = 0
+            done.add(device)
+            if all_done_at is None and len(done) == args.devices:
+                all_done_at = t
+        else:
+            rejected += 1
+            failures += 1
+            retry_after = args.retry_after
+        heapq.heappush(events, (t + policy(args, failures, retry_after), device, failures))
+    return per_second, rejected, all_done_at
+
+
+def report(name, per_second, rejected, all_done_at, args):
+    busy = [n for n in per_second if n]
+    print("%s:" % name)
+    print("  peak %d req/s, %d seconds over capacity, %d requests rejected" %
+          (max(per_second), sum(1 for n in per_second if n > args.capacity), rejected))
+    print("  every device checked in by %s" % ("%.0f s" % all_done_at if all_done_at is not None else "never"))
+    print("  busiest minute %d requests, mean %.1f req/s while active" %
+          (max(sum(per_second[i:i + 60]) for i in range(0, len(per_second), 60)), sum(busy) / max(len(busy), 1)))
+    # Requests per minute over the first half hour
+    for minute in range(0, 30, 3):
+        count = sum(per_second[minute * 60:(minute + 3) * 60])
+        print("  %3d min %6d %s" % (minute, count, "#" * min(60, count * 60 // args.devices)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--devices", type=int, default=2000)
+    parser.add_argument("--capacity", type=int, default=50, help="requests per second the server can answer")
+    parser.add_argument("--interval", type=float, default=3600)
+    parser.add_argument("--jitter", type=float, default=600)
+    parser.add_argument("--backoff", type=float, nargs=2, default=(30, 3600), metavar=("MIN", "MAX"))
+    parser.add_argument("--retry-after", type=float, default=60)
+    parser.add_argument("--hours", type=int, default=3)
+    parser.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args()
+
+    random.seed(args.seed)
+    report("naive", *simulate(args, naive_wait, lambda: random.uniform(0, 2)), args)
+    random.seed(args.seed)
+    report("scheduled", *simulate(args, scheduled_wait, lambda: random.uniform(0, args.jitter)), args)
+
+
+if __name__ == "__main__":
+    main()
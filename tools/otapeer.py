@@ -0,0 +1,174 @@
+#!/usr/bin/env python3
+"""Stand-in for OTAUpdate's LAN peer sharing, for trying it with local processes.
+
+    otapeer.py serve firmware.bin --version 1.2.4 [--port 8081]
+    otapeer.py fetch --version 1.2.4 --sha256 <hex> --server http://host/ out.bin [--share 8082]
+
+"serve" behaves like a device after sharePeerFirmware(): it serves the image
+at /ota/firmware.bin and advertises _otaupdate._tcp with version and sha256
+TXT records. "fetch" behaves like a device with setPeerFetch(true). It picks
+a random peer with the wanted version, checks the download against --sha256,
+and falls back to <server>/firmware.bin. With --share it then serves what it
+fetched, so a chain of processes shows the load moving off the server.
+
+Discovery uses python-zeroconf. Give every process the same --registry DIR
+to use a directory of advertisement files instead, e.g. on hosts without
+multicast.
+"""
+
+import argparse
+import hashlib
+import http.server
+import json
+import os
+import random
+import signal
+import socket
+import sys
+import time
+import urllib.request
+
+SERVICE = "_otaupdate._tcp.local."
+PATH = "/ota/firmware.bin"
+
+
+class Advertiser:
+    def __init__(self, args):
+        self.args = args
+        self.handle = None
+
+    def publish(self, name, port, txt):
+        if self.args.registry:
+            os.makedirs(self.args.registry, exist_ok=True)
+            self.handle = os.path.join(self.args.registry, name + ".json")
+            with open(self.handle, "w") as f:
+                json.dump({"name": name, "address": self.args.address, "port": port, "txt": txt}, f)
+            return
+        from zeroconf import ServiceInfo, Zeroconf
+        self.handle = Zeroconf()
+        self.handle.register_service(ServiceInfo(SERVICE, "%s.%s" % (name, SERVICE), port=port, properties=txt,
+                                                 addresses=[socket.inet_aton(self.args.address)]))
+
+    def browse(self):
+        if self.args.registry:
+            peers = []
+            for entry in sorted(os.listdir(self.args.registry)) if os.path.isdir(self.args.registry) else []:
+                with open(os.path.join(self.args.registry, entry)) as f:
+                    peers.append(json.load(f))
+            return peers
+        from zeroconf import ServiceBrowser, Zeroconf
+        zc = Zeroconf()
+        names = []
+        ServiceBrowser(zc, SERVICE, handlers=[lambda zeroconf, service_type, name, state_change: names.append(name)])
+        time.sleep(self.args.browse_time)
+        peers = []
+        for name in set(names):
+            info = zc.get_service_info(SERVICE, name)
+            if info and info.addresses:
+                txt = {k.decode(): (v or b"").decode() for k, v in info.properties.items()}
+                peers.append({"name": name, "address": socket.inet_ntoa(info.addresses[0]), "port": info.port, "txt": txt})
+        zc.close()
+        return peers
+
+    def withdraw(self):
+        if self.args.registry and self.handle:
+            os.remove(self.handle)
+        elif self.handle:
+            self.handle.unregister_all_services()
+            self.handle.close()
+
+
+def serve(args, image, version, port):
+    digest = hashlib.sha256(image).hexdigest()
+
+    class Handler(http.server.BaseHTTPRequestHandler):
+        def do_GET(self):
+            if self.path != PATH:
+                self.send_error(404)
+                return
+            self.send_response(200)
+            self.send_header("Content-Length", str(len(image)))
+            self.send_header("ETag", '"%s"' % digest)
+            self.end_headers()
+            self.wfile.write(image)
+            sys.stderr.write("%s: served %d bytes to %s\n" % (port, len(image), self.client_address[0]))
+
+        def log_message(self, *_):
+            pass
+
+    server = http.server.ThreadingHTTPServer(("", port), Handler)
+    advertiser = Advertiser(args)
+    advertiser.publish("peer-%d" % port, port, {"version": version, "sha256": digest})
+    # Withdraw the advertisement on kill too, so stale peers don't linger in the registry
+    signal.signal(signal.SIGTERM, lambda *_: sys.exit(0))
+    print("sharing %s (%d bytes, sha256 %s) on port %d" % (version, len(image), digest, port))
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        advertiser.withdraw()
+
+
+def fetch(args):
+    # Same rules as OTAUpdate::findPeerUrl()
+    peers = [p for p in Advertiser(args).browse()
+             if p["txt"].get("version") == args.version and
+             (not p["txt"].get("sha256") or p["txt"]["sha256"].lower() == args.sha256.lower())]
+    sources = []
+    if peers:
+        peer = random.choice(peers)
+        sources.append(("peer %s" % peer["name"], "http://%s:%d%s" % (peer["address"], peer["port"], PATH)))
+    sources.append(("server", args.server.rstrip("/") + "/firmware.bin"))
+
+    for label, url in sources:
+        try:
+            with urllib.request.urlopen(url, timeout=10) as response:
+                image = response.read()
+        except OSError as e:
+            print("%s: %s, trying next source" % (label, e))
+            continue
+        if hashlib.sha256(image).hexdigest() != args.sha256.lower():
+            print("%s: image does not match the manifest sha256, trying next source" % label)
+            continue
+        print("fetched %d bytes from %s (%d peers had %s)" % (len(image), label, len(peers), args.version))
+        return image
+    return None
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--registry", help="directory shared by all processes, replaces mDNS")
+    parser.add_argument("--address", default="127.0.0.1", help="address advertised for this process")
+    parser.add_argument("--browse-time", type=float, default=2.0)
+    sub = parser.add_subparsers(dest="command", required=True)
+    serve_parser = sub.add_parser("serve")
+    serve_parser.add_argument("image")
+    serve_parser.add_argument("--version", required=True)
+    serve_parser.add_argument("--port", type=int, default=8081)
+    fetch_parser = sub.add_parser("fetch")
+    fetch_parser.add_argument("--version", required=True)
+    fetch_parser.add_argument("--sha256", required=True)
+    fetch_parser.add_argument("--server", required=True)
+    fetch_parser.add_argument("--share", type=int, metavar="PORT", help="serve the fetched image afterwards")
+    fetch_parser.add_argument("out")
+    args = parser.parse_args()
+
+    if args.command == "serve":
+        with open(args.image, "rb") as f:
+            serve(args, f.read(), args.version, args.port)
+        return 0
+
+    image = fetch(args)
+    if image is None:
+        print("no source delivered a valid image")
+        return 1
+    with open(args.out, "wb") as f:
+        f.write(image)
+    if args.share:
+        serve(args, image, args.version, args.share)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,66 @@
+#!/usr/bin/env python3
+"""Build the sector map OTAUpdate uses to sync SPIFFS sector by sector.
+
+    otasectors.py spiffs.bin spiffs.sectors
+    otasectors.py --diff old.bin spiffs.sectors
+
+The map holds the SHA-256 of every 4 KB sector of the image. Publish it as
+"spiffs_sectors" in config.json next to the raw spiffs.bin, which must be
+served with Range support; the manifest also needs "sha256": {"spiffs": ...}.
+--diff shows how many sectors a device holding old.bin would rewrite.
+"""
+
+import argparse
+import hashlib
+import struct
+import sys
+
+SECTOR_BITS = 12
+SECTOR_SIZE = 1 << SECTOR_BITS
+
+
+def build(image):
+    hashes = b"".join(hashlib.sha256(image[i:i + SECTOR_SIZE]).digest() for i in range(0, len(image), SECTOR_SIZE))
+    return b"OTAS" + struct.pack("<BBxxI", 1, SECTOR_BITS, len(image)) + hashes
+
+
+def parse(sector_map):
+    if sector_map[:4] != b"OTAS" or sector_map[4] != 1 or sector_map[5] != SECTOR_BITS:
+        raise ValueError("not an OTAS v1 sector map")
+    (length,) = struct.unpack_from("<I", sector_map, 8)
+    count = (length + SECTOR_SIZE - 1) // SECTOR_SIZE
+    if len(sector_map) != 12 + 32 * count:
+        raise ValueError("sector map size does not match the image length")
+    return length, [sector_map[12 + 32 * i:44 + 32 * i] for i in range(count)]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--diff", action="store_true")
+    parser.add_argument("image")
+    parser.add_argument("map")
+    args = parser.parse_args()
+
+    with open(args.image, "rb") as f:
+        image = f.read()
+
+    if args.diff:
+        with open(args.map, "rb") as f:
+            length, hashes = parse(f.read())
+        changed = [i for i, h in enumerate(hashes)
+                   if hashlib.sha256(image[i * SECTOR_SIZE:min((i + 1) * SECTOR_SIZE, length)]).digest() != h]
+        runs = sum(1 for n, i in enumerate(changed) if n == 0 or changed[n - 1] != i - 1)
+        print("%d of %d sectors changed in %d runs, %d bytes to fetch" %
+              (len(changed), len(hashes), runs, sum(min(SECTOR_SIZE, length - i * SECTOR_SIZE) for i in changed)))
+        return 0
+
+    sector_map = build(image)
+    _, hashes = parse(sector_map)
+    with open(args.map, "wb") as f:
+        f.write(sector_map)
+    print("%s: %d sectors, %d bytes" % (args.map, len(hashes), len(sector_map)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+"""Sign and check OTAUpdate images with an ECDSA P-256 key.
+
+    otasign.py keygen key.pem pub.pem        # new key pair; pub.pem goes into the sketch
+    otasign.py sign   key.pem image.bin      # print the hex signature for the manifest
+    otasign.py verify pub.pem image.bin SIG  # check a hex signature like the device does
+
+The signature is over the SHA-256 of the raw image (the decoded firmware.bin
+or spiffs.bin, not a .gz or delta patch), DER encoded, as hex. Put it in the
+manifest's "signature" object or pass it as ?sig= when uploading to /update.
+Uses the openssl command line tool.
+"""
+
+import hashlib
+import os
+import subprocess
+import sys
+import tempfile
+
+
+def openssl(*args, data=None):
+    return subprocess.run(("openssl",) + args, input=data, stdout=subprocess.PIPE,
+                          stderr=subprocess.PIPE, check=False)
+
+
+def keygen(key_path, pub_path):
+    result = openssl("ecparam", "-name", "prime256v1", "-genkey", "-noout", "-out", key_path)
+    if result.returncode == 0:
+        result = openssl("ec", "-in", key_path, "-pubout", "-out", pub_path)
+    if result.returncode != 0:
+        sys.stderr.write(result.stderr.decode())
+        return 1
+    print("%s: private key, keep it off the devices\n%s: public key for setSigningKey()" % (key_path, pub_path))
+    return 0
+
+
+def sign(key_path, image_path):
+    result = openssl("dgst", "-sha256", "-sign", key_path, image_path)
+    if result.returncode != 0:
+        sys.stderr.write(result.stderr.decode())
+        return 1
+    with open(image_path, "rb") as f:
+        digest = hashlib.sha256(f.read()).hexdigest()
+    print("sha256    %s" % digest)
+    print("signature %s" % result.stdout.hex())
+    return 0
+
+
+def verify(pub_path, image_path, signature_hex):
+    try:
+        signature = bytes.fromhex(signature_hex)
+    except ValueError:
+        sys.stderr.write("error: signature is not hex\n")
+        return 1
+    with tempfile.NamedTemporaryFile(delete=False) as sig_file:
+        sig_file.write(signature)
+    try:
+        result = openssl("dgst", "-sha256", "-verify", pub_path, "-signature", sig_file.name, image_path)
+    finally:
+        os.unlink(sig_file.name)
+    print(result.stdout.decode().strip() or result.stderr.decode().strip())
+    return 0 if result.returncode == 0 else 1
+
+
+def main(argv):
+    if len(argv) == 4 and argv[1] == "keygen":
+        return keygen(argv[2], argv[3])
+    if len(argv) == 4 and argv[1] == "sign":
+        return sign(argv[2], argv[3])
+    if len(argv) == 5 and argv[1] == "verify":
+        return verify(argv[2], argv[3], argv[4])
+    sys.stderr.write(__doc__)
+    return 2
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))